@@ -0,0 +1,163 @@
+#include "copyright.h"
+/*============================================================================*/
+/*! \file ath_zip.c
+ *  \brief Compression of the fields of binary dumps with zlib.
+ *
+ * PURPOSE: Compression of the fields of binary dumps with zlib, selected with
+ *   compress=zlib, abs or rel in the <output> block (see dump_binary.c).
+ *   Each field of n floats is written as
+ *   -  int     mode       0 = lossless, 1 = quantized
+ *   -  double  x0, dx     (mode 1 only) values are x0 + dx*q, see below
+ *   -  int64   nbyte      size of the deflated data
+ *   -  nbyte bytes of deflated data
+ *
+ *   in the byte order of the host, like the rest of the file.
+ *
+ *   Lossless (compress=zlib): the 4 bytes of the floats are shuffled into 4
+ *   planes (the first byte of all values, then the second, ...), so that the
+ *   sign and exponent bytes, which change little across smooth fields and
+ *   not at all in a uniform medium, are deflated together.
+ *
+ *   Quantized (compress=abs or rel): each value x is replaced by the nearest
+ *   x0 + dx*q, with x0 the minimum of the field and dx = 2*tol (abs) or
+ *   2*tol*(max-min) (rel), so it is read back to within tol (or tol times the
+ *   range of the field) plus the rounding to float.  The first q, then the
+ *   differences of q between consecutive values, zigzag coded (2d for d >= 0,
+ *   -2d-1 for d < 0), are shuffled as 32 bit words and deflated.  A
+ *   field that does not fit in 32 bit q, or is not finite, is written
+ *   lossless.
+ *
+ *   vis/binz/unzip_bin.c converts the files back to plain .bin files.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ * - ath_zwrite() - writes one compressed field                              */
+/*============================================================================*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "defs.h"
+#include "athena.h"
+#include "prototypes.h"
+
+#ifdef ZLIB_ENABLED
+#include <zlib.h>
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   shuffle() - gathers the bytes of n words of 4 bytes into 4 planes
+ *   deflate_out() - deflates a buffer and writes its size and data
+ *============================================================================*/
+
+static void shuffle(const unsigned char *src, unsigned char *dst,
+                    const long n);
+static void deflate_out(const unsigned char *src, const long len, FILE *fp);
+
+/*=========================== PUBLIC FUNCTIONS ===============================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn void ath_zwrite(const float *data, const long n, const int mode,
+ *                      const Real tol, FILE *fp)
+ *  \brief Writes the n floats of data to fp with compression mode (ZipMode,
+ *   not zip_none) and error bound tol, in the format described above. */
+
+void ath_zwrite(const float *data, const long n, const int mode,
+                const Real tol, FILE *fp)
+{
+  uint32_t *q;
+  unsigned char *buf;
+  double x0=0.0,x1,dx=0.0,qmax;
+  int32_t d;
+  int quant=0;
+  long i;
+
+  if ((q = (uint32_t*)malloc(n*sizeof(uint32_t))) == NULL ||
+      (buf = (unsigned char*)malloc(n*sizeof(uint32_t))) == NULL)
+    ath_error("[ath_zwrite]: malloc returned a NULL pointer\n");
+
+/* Step of the quantized values, if the field can be quantized */
+
+  if (mode == zip_abs || mode == zip_rel) {
+    x0 = x1 = (n > 0) ? data[0] : 0.0;
+    quant = 1;
+    for (i=0; i<n; i++) {
+      if (!isfinite(data[i])) quant = 0;
+      x0 = MIN(x0,data[i]);
+      x1 = MAX(x1,data[i]);
+    }
+    dx = (mode == zip_abs) ? 2.0*tol : 2.0*tol*(x1 - x0);
+    if (x1 == x0) dx = 1.0;
+    qmax = (dx > 0.0) ? (x1 - x0)/dx + 1.0 : 0.0;
+    if (dx <= 0.0 || qmax >= 4294967295.0) quant = 0;
+  }
+
+  if (quant) {
+    for (i=0; i<n; i++)
+      q[i] = (uint32_t)floor(((double)data[i] - x0)/dx + 0.5);
+    for (i=n-1; i>0; i--) {
+      d = (int32_t)(q[i] - q[i-1]);
+      q[i] = ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+    }
+    fwrite(&quant,sizeof(int),1,fp);
+    fwrite(&x0,sizeof(double),1,fp);
+    fwrite(&dx,sizeof(double),1,fp);
+  } else {
+    memcpy(q,data,n*sizeof(float));
+    fwrite(&quant,sizeof(int),1,fp);
+  }
+
+  shuffle((unsigned char*)q,buf,n);
+  deflate_out(buf,n*sizeof(uint32_t),fp);
+
+  free(q);
+  free(buf);
+
+  return;
+}
+
+/*=========================== PRIVATE FUNCTIONS ==============================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn static void shuffle(const unsigned char *src, unsigned char *dst,
+ *                          const long n)
+ *  \brief Copies byte b of word i of src to dst[b*n + i], for n words of 4
+ *   bytes. */
+
+static void shuffle(const unsigned char *src, unsigned char *dst,
+                    const long n)
+{
+  long i;
+  int b;
+
+  for (i=0; i<n; i++)
+    for (b=0; b<4; b++) dst[b*n + i] = src[4*i + b];
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void deflate_out(const unsigned char *src, const long len,
+ *                              FILE *fp)
+ *  \brief Deflates len bytes of src with zlib, and writes the size of the
+ *   result and the result to fp. */
+
+static void deflate_out(const unsigned char *src, const long len, FILE *fp)
+{
+  unsigned char *dst;
+  uLongf nout = compressBound((uLong)len);
+  int64_t nbyte;
+
+  if ((dst = (unsigned char*)malloc(nout)) == NULL)
+    ath_error("[ath_zwrite]: malloc returned a NULL pointer\n");
+  if (compress2(dst,&nout,src,(uLong)len,Z_DEFAULT_COMPRESSION) != Z_OK)
+    ath_error("[ath_zwrite]: zlib failed to compress %ld bytes\n",len);
+
+  nbyte = (int64_t)nout;
+  fwrite(&nbyte,sizeof(int64_t),1,fp);
+  fwrite(dst,1,(size_t)nout,fp);
+  free(dst);
+
+  return;
+}
+
+#endif /* ZLIB_ENABLED */
@@ -261,6 +261,7 @@ typedef struct GridOvrlp_s{
   int ID, DomN;        /*!< processor ID, and Domain #, of OVERLAP Grid */
   int nWordsRC, nWordsP; /*!< # of words communicated for Rest/Corr and Prol */
   ConsS **myFlx[6];   /*!< fluxes of conserved variables at 6 boundaries */
+  ConsS **subFlx[6];  /*!< myFlx of first substep with subcycling */
 #ifdef ION_RADPLANE
   Real *ionFlx[6];
 #ifdef MPI_PARALLEL
@@ -275,6 +276,21 @@ typedef struct GridOvrlp_s{
 }GridOvrlpS;
 #endif /* STATIC_MESH_REFINEMENT */
 
+/*----------------------------------------------------------------------------*/
+/*! \struct ExciseS
+ *  \brief Excision mask of a Grid: zones held at a fixed state by the problem
+ *   generator, which integrators and source terms can skip.  See excise.c.
+ */
+typedef struct Excise_s{
+  char ***flag;     /*!< EXCISE_* flags of every zone, ghost zones included */
+  int nzone;        /*!< # of excised active zones */
+  int ninterior;    /*!< # of active zones flagged EXCISE_INTERIOR */
+  int all;          /*!< 1 if every active zone is EXCISE_INTERIOR */
+  int rad;          /*!< 1 if radiation skips interior zones (approximate) */
+  ConsS *U;         /*!< fixed state of the excised active zones, k,j,i order */
+  Real vmax[3];     /*!< max signal speeds over the interior zones in U */
+}ExciseS;
+
 /*----------------------------------------------------------------------------*/
 /*! \struct GridS
  *  \brief 3D arrays of dependent variables, plus grid data, plus particle data,
@@ -304,6 +320,7 @@ typedef struct Grid_s{
   Real MaxX[3];       /*!< max(x) in each dir on this Grid [0,1,2]=[x1,x2,x3] */
   Real dx1,dx2,dx3;   /*!< cell size on this Grid */
   Real time, dt;           /*!< current time and timestep  */
+  int substep;        /*!< substep (0,1) within parent step, SMR subcycling */
   int is,ie;		   /*!< start/end cell index in x1 direction */
   int js,je;		   /*!< start/end cell index in x2 direction */
   int ks,ke;		   /*!< start/end cell index in x3 direction */
@@ -313,6 +330,11 @@ typedef struct Grid_s{
   int rx1_id, lx1_id;  /*!< ID of Grid to R/L in x1-dir (default=-1; no Grid) */
   int rx2_id, lx2_id;  /*!< ID of Grid to R/L in x2-dir (default=-1; no Grid) */
   int rx3_id, lx3_id;  /*!< ID of Grid to R/L in x3-dir (default=-1; no Grid) */
+  int bvals_dirty;     /*!< DIRTY_* flags of variables changed since bvals */
+  Real cfl_vmax[3];    /*!< max signal speed in x1/x2/x3 over active zones */
+  int cfl_valid;       /*!< cfl_vmax folded from current U (see new_dt.c) */
+  double work_time;    /*!< wall time spent stepping this Grid (MPI only) */
+  ExciseS *excise;     /*!< excised zones, NULL if none (see excise.c) */
 
 #ifdef ION_RADPLANE
   Real ***EdgeFlux;
@@ -411,6 +433,7 @@ typedef struct Mesh_s{
   Real time, dt;  /*!< current time and timestep for entire Mesh */
   int Nx[3];    /*!< # of zones in each dir on root Domain [0,1,2]=[x1,x2,x3] */
   int nstep;                 /*!< number of integration steps taken */
+  int subcycle;     /*!< 1 if each SMR level steps with half dt of its parent */
   int BCFlag_ix1, BCFlag_ox1;  /*!< BC flag on root domain for inner/outer x1 */
   int BCFlag_ix2, BCFlag_ox2;  /*!< BC flag on root domain for inner/outer x2 */
   int BCFlag_ix3, BCFlag_ox3;  /*!< BC flag on root domain for inner/outer x3 */
@@ -462,6 +485,14 @@ typedef struct Output_s{
 /* level and domain number of output (default = [-1,-1] = output all levels) */
 
   int nlevel, ndomain;
+  int shared;     /*!< vtk: 1 = one file per Domain written with MPI-IO */
+  int async;      /*!< vtk: 1 = files written by a background thread */
+  int zip;        /*!< bin: compression of fields, see enum ZipMode */
+  Real ztol;      /*!< bin: error bound of zip_abs and zip_rel compression */
+  int delta;      /*!< rst: # of delta restarts after each full one */
+  int dblock;     /*!< rst: size of the blocks of delta restarts, in zones */
+  int comp_level; /*!< vtk: level of the composite of all levels, -1 = none */
+  int coarsen;    /*!< vtk: # of coarsened copies of the finest level */
 
 /* variables which describe data min/max */
   Real dmin,dmax;   /*!< user defined min/max for scaling data */
@@ -514,6 +545,9 @@ typedef Real (*OrbitalFun_t)(const Real x1);
 typedef Real (*ShearFun_t)(const Real x1);
 #endif
 #endif /* Cylindrical */
+/*! \fn int (*ExciseFun_t)(const Real x1, const Real x2, const Real x3)
+ *  \brief Returns 1 for positions inside an excised region. */
+typedef int (*ExciseFun_t)(const Real x1, const Real x2, const Real x3);
 /*! \fn Real (*CoolingFun_t)(const Real d, const Real p, const Real dt);
  *  \brief Cooling function. */
 typedef Real (*CoolingFun_t)(const Real d, const Real p, const Real dt);
@@ -542,4 +576,8 @@ typedef Real (*TSFun_t)(GridS *pG, int type, Real rho, Real cs, Real vd);
  *  \brief Directions for the set_bvals_fun() function */
 enum BCDirection {left_x1, right_x1, left_x2, right_x2, left_x3, right_x3};
 
+/*! \enum ZipMode
+ *  \brief Compression of the fields of binary dumps, see ath_zip.c */
+enum ZipMode {zip_none, zip_lossless, zip_abs, zip_rel};
+
 #endif /* ATHENA_H */
@@ -42,10 +42,63 @@
  * With SELF-GRAVITY: BCs for Phi are set independently of the MHD variables
  *   in a separate function bvals_grav(). 
  *
+ * SPLIT-PHASE EXCHANGE
+ *   bvals_mhd() is bvals_mhd_start() followed by bvals_mhd_finish().  The start
+ *   phase posts the receives and packs/sends the x1-boundary data; everything
+ *   else (physical BCs, unpacking, and the x2 and x3 rounds, which need the x1
+ *   ghost zones to fill the corners) is done in the finish phase.  Any work
+ *   that does not read or write the ghost zones, and does not modify the
+ *   nghost active cells adjacent to an MPI boundary, may be placed between
+ *   the two calls.  Send/receive buffers are kept per Domain, so the start
+ *   phase can be called for every Domain before any of them is finished.
+ *
+ *   The integrators are NOT split into an interior sweep run between the two
+ *   calls and a boundary sweep run after them.  The CTU update of a cell
+ *   reads nghost cells on each side (through the transverse flux
+ *   corrections), so only cells at least nghost from every Grid edge could be
+ *   updated early; on the 40x20x20 root Grids of ioniz_sphere_hires that is
+ *   under 30% of the work.  The update also overwrites U in place, while the
+ *   boundary sweep needs the old U of the interior cells next to it, and the
+ *   SMR flux correction and H-correction arrays assume a single sweep.
+ *
+ * SKIPPING UNCHANGED VARIABLES
+ *   GridS.bvals_dirty flags the groups of conserved variables (DIRTY_D, _M,
+ *   _E, _B, _S) that have changed since the last exchange on that Grid; it is
+ *   cleared by bvals_mhd_finish().  Only flagged variables are sent with MPI,
+ *   and if none are flagged no messages are sent at all (physical BCs are
+ *   always applied).  Any function that changes U must OR the appropriate
+ *   flags into bvals_dirty on every Grid of the Domain, since neighbors must
+ *   agree on the message contents.  With MHD all variables are sent if any
+ *   are flagged.  The bytes not sent are returned by bvals_mhd_bytes_saved().
+ *
+ * SINGLE-ROUND EXCHANGE
+ *   With <job>/bvals_rounds = 1 (hydro only), the three x1-x2-x3 rounds are
+ *   replaced by a single round in which faces, edges and corners are sent
+ *   directly to all (up to 26) neighboring Grids.  The physical BCs are applied
+ *   before packing, so that edge and corner messages include the ghost zones
+ *   of the sender at physical boundaries (which is how corners are filled in
+ *   the three-round scheme), and the x2 and x3 physical BCs are re-applied
+ *   after unpacking to fill cells which need ghost zones received via MPI.
+ *   This gives results identical to the three-round exchange for BCs that are
+ *   local in the transverse directions (all built-in BCs).  The index ranges
+ *   of each message are computed once in bvals_mhd_init(), and a single pair of
+ *   pack/unpack functions loops over them.  With <job>/bvals_zerocopy = 1 the
+ *   messages are described by MPI subarray types over U instead, and are sent
+ *   and received in place without packing.
+ *
+ * All MPI requests are persistent (MPI_Send_init/MPI_Recv_init), created in
+ *   bvals_mhd_init() for every message and every set of exchanged variables,
+ *   and only started and completed in bvals_mhd_start()/bvals_mhd_finish().
+ *
  * CONTAINS PUBLIC FUNCTIONS: 
- * - bvals_mhd()      - calls appropriate functions to set ghost cells
- * - bvals_mhd_init() - sets function pointers used by bvals_mhd()
- * - bvals_mhd_fun()  - enrolls a pointer to a user-defined BC function
+ * - bvals_mhd()        - calls appropriate functions to set ghost cells
+ * - bvals_mhd_start()  - posts MPI exchange of x1 ghost zones
+ * - bvals_mhd_finish() - completes exchange, sets all remaining ghost cells
+ * - bvals_mhd_init()   - sets function pointers used by bvals_mhd()
+ * - bvals_mhd_fun()    - enrolls a pointer to a user-defined BC function
+ * - bvals_mhd_destruct() - frees MPI buffers and requests of a Mesh
+ * - bvals_mhd_wait_time() - returns time spent waiting on MPI in bvals_mhd
+ * - bvals_mhd_bytes_saved() - returns bytes not sent for unchanged variables
  *
  * PRIVATE FUNCTION PROTOTYPES:
  * - reflect_ix1()  - reflecting BCs at boundary ix1
@@ -83,9 +136,18 @@
  * - unpack_ix2()   - unpack data for MPI non-blocking receive at ix2 boundary
  * - unpack_ox2()   - unpack data for MPI non-blocking receive at ox2 boundary
  * - unpack_ix3()   - unpack data for MPI non-blocking receive at ix3 boundary
- * - unpack_ox3()   - unpack data for MPI non-blocking receive at ox3 boundary*/
+ * - unpack_ox3()   - unpack data for MPI non-blocking receive at ox3 boundary
+ * - set_vars()     - sets list of variables to be exchanged from bvals_dirty
+ * - msg_cnt()      - number of doubles in x1/x2/x3 message of three-round case
+ * - phys_bvals()   - applies physical BCs only
+ * - init_nbr26()   - finds neighbors and index ranges for single-round exchange
+ * - pack_range()   - pack data in an index range for single-round exchange
+ * - unpack_range() - unpack data in an index range for single-round exchange
+ * - start_nbr26()  - start phase of the single-round exchange
+ * - finish_nbr26() - finish phase of the single-round exchange */
 /*============================================================================*/
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include "defs.h"
@@ -94,9 +156,45 @@
 #include "prototypes.h"
 
 #ifdef MPI_PARALLEL
-/* MPI send and receive buffers */
+/* MPI send and receive buffers, and requests, of the Domain being updated */
 static double **send_buf = NULL, **recv_buf = NULL;
 static MPI_Request *recv_rq, *send_rq;
+
+/* buffers and requests for every Domain [nl][nd], so that exchanges on
+ * different Domains can be in flight at the same time.  The requests are
+ * persistent, created once in bvals_mhd_init() for every direction and every
+ * number of variables: [nl][nd][2*(dir*(NVAR+1)+nvar)+(0:L,1:R)] */
+static double ****send_bufD = NULL, ****recv_bufD = NULL;
+static MPI_Request ***recv_rqD = NULL, ***send_rqD = NULL;
+
+/* time spent in MPI_Wait* calls since last call to bvals_mhd_wait_time() */
+static double wait_time = 0.0;
+
+/* number of, and offsets into ConsS of, variables in the current exchange,
+ * and bytes not sent since the last call to bvals_mhd_bytes_saved() */
+static int nvar_bv = NVAR, var_bv[NVAR], mask_bv = DIRTY_ALL;
+static double bytes_saved = 0.0;
+
+/* Single-round exchange.  Messages are indexed by the direction (dl,dm,dn) of
+ * the neighbor, n=(dn+1)*9+(dm+1)*3+(dl+1), so n=13 (the Grid itself) is not
+ * used.  The message sent in direction n is received from direction 26-n.
+ * Persistent requests are created for every set of variables (DIRTY_* mask):
+ * [nl][nd][mask*NNBR+n].  With bvals_zerocopy=1 they use MPI subarray types
+ * over U, so nothing is packed or unpacked. */
+#define NNBR 27
+
+typedef struct NbrMsg_s{
+  int id;              /* ID in Comm_Domain of neighbor, -1 if none */
+  int scnt, rcnt;      /* number of doubles sent/received (all variables) */
+  int sis,sie,sjs,sje,sks,ske;   /* range of cells packed for send */
+  int ris,rie,rjs,rje,rks,rke;   /* range of cells unpacked on receive */
+  double *send_buf, *recv_buf;
+}NbrMsgS;
+
+static int bvals_rounds = 3;              /* 3 = x1-x2-x3 rounds, 1 = single */
+static int bvals_zerocopy = 0;            /* 1 = send/recv directly from U */
+static NbrMsgS ***nbrD = NULL;            /* messages of each Domain [nl][nd] */
+static MPI_Request ***nbr_recv_rqD = NULL, ***nbr_send_rqD = NULL;
 #endif /* MPI_PARALLEL */
 
 /*==============================================================================
@@ -153,6 +251,23 @@ static void unpack_ix2(GridS *pG);
 static void unpack_ox2(GridS *pG);
 static void unpack_ix3(GridS *pG);
 static void unpack_ox3(GridS *pG);
+
+static int set_vars(int mask);
+static void init_rq(DomainS *pD);
+static int msg_cnt(GridS *pG, int dir, int nvar);
+static void phys_bvals(DomainS *pD);
+static void init_nbr26(DomainS *pD, int myL, int myM, int myN);
+static void pack_range(GridS *pG, int is, int ie, int js, int je, int ks,
+  int ke, double *pSnd);
+static void unpack_range(GridS *pG, int is, int ie, int js, int je, int ks,
+  int ke, double *pRcv);
+static void start_nbr26(DomainS *pD);
+static void finish_nbr26(DomainS *pD);
+
+static void set_bufs(DomainS *pD, int dir);
+static int timed_wait(MPI_Request *rq);
+static int timed_waitany(int n, MPI_Request *rq, int *pIndex);
+static int timed_waitall(int n, MPI_Request *rq);
 #endif /* MPI_PARALLEL */
 
 /*=========================== PUBLIC FUNCTIONS ===============================*/
@@ -172,13 +287,106 @@ static void unpack_ox3(GridS *pG);
  */
 
 void bvals_mhd(DomainS *pD)
+{
+  bvals_mhd_start(pD);
+  bvals_mhd_finish(pD);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void bvals_mhd_start(DomainS *pD)
+ *  \brief Posts non-blocking receives, and packs and sends data, for the MPI
+ *   boundaries in the x1-direction.  Must be followed by bvals_mhd_finish().
+ *
+ *   Only the active cells within nghost of an MPI boundary are read here, so
+ *   the interior of the Grid may be used or updated before the finish phase.
+ */
+
+void bvals_mhd_start(DomainS *pD)
+{
+#ifdef MPI_PARALLEL
+  GridS *pGrid = (pD->Grid);
+  int ierr, dir, nmsg;
+
+  if (bvals_rounds == 1) {
+    start_nbr26(pD);
+    return;
+  }
+
+/* Count bytes not sent because variables are unchanged.  Nothing is sent at
+ * all if no variables have changed. */
+
+  set_vars(pGrid->bvals_dirty);
+  for (dir=0; dir<3; dir++) {
+    if (pGrid->Nx[dir] == 1) continue;
+    nmsg = 0;
+    if (dir == 0) nmsg = (pGrid->lx1_id >= 0) + (pGrid->rx1_id >= 0);
+    if (dir == 1) nmsg = (pGrid->lx2_id >= 0) + (pGrid->rx2_id >= 0);
+    if (dir == 2) nmsg = (pGrid->lx3_id >= 0) + (pGrid->rx3_id >= 0);
+    bytes_saved += (double)nmsg*sizeof(double)*
+      (msg_cnt(pGrid,dir,NVAR) - msg_cnt(pGrid,dir,nvar_bv));
+  }
+  if (nvar_bv == 0) return;
+
+  if (pGrid->Nx[0] > 1){
+
+    set_bufs(pD,0);
+
+/* Post non-blocking receives for data from L and R Grids */
+    if (pGrid->lx1_id >= 0) {
+      ierr = MPI_Start(&(recv_rq[0]));
+    }
+    if (pGrid->rx1_id >= 0) {
+      ierr = MPI_Start(&(recv_rq[1]));
+    }
+
+/* pack and send data L and R */
+    if (pGrid->lx1_id >= 0) {
+      pack_ix1(pGrid);
+      ierr = MPI_Start(&(send_rq[0]));
+    }
+    if (pGrid->rx1_id >= 0) {
+      pack_ox1(pGrid); 
+      ierr = MPI_Start(&(send_rq[1]));
+    }
+  }
+#endif /* MPI_PARALLEL */
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void bvals_mhd_finish(DomainS *pD)
+ *  \brief Completes the x1 exchange started by bvals_mhd_start(), then sets
+ *   the physical x1 boundaries and all ghost zones in the x2 and x3 directions.
+ */
+
+void bvals_mhd_finish(DomainS *pD)
 {
   GridS *pGrid = (pD->Grid);
 #ifdef SHEARING_BOX
   int myL,myM,myN,BCFlag;
 #endif
 #ifdef MPI_PARALLEL
-  int cnt, cnt2, cnt3, ierr, mIndex;
+  int ierr, mIndex;
+#endif /* MPI_PARALLEL */
+
+#ifdef MPI_PARALLEL
+  if (bvals_rounds == 1) {
+    finish_nbr26(pD);
+    pGrid->bvals_dirty = 0;
+    return;
+  }
+
+/* Nothing has changed since the last exchange: only set physical BCs */
+  if (set_vars(pGrid->bvals_dirty) == 0) {
+    phys_bvals(pD);
+    pGrid->bvals_dirty = 0;
+    return;
+  }
+
+  set_bufs(pD,0);
 #endif /* MPI_PARALLEL */
 
 /*--- Step 1. ------------------------------------------------------------------
@@ -187,41 +395,17 @@ void bvals_mhd(DomainS *pD)
   if (pGrid->Nx[0] > 1){
 
 #ifdef MPI_PARALLEL
-    cnt = nghost*(pGrid->Nx[1])*(pGrid->Nx[2])*(NVAR);
-#ifdef MHD
-    cnt2 = (pGrid->Nx[1] > 1) ? (pGrid->Nx[1] + 1) : 1;
-    cnt3 = (pGrid->Nx[2] > 1) ? (pGrid->Nx[2] + 1) : 1;
-    cnt += (nghost-1)*(pGrid->Nx[1])*(pGrid->Nx[2]);
-    cnt += nghost*cnt2*(pGrid->Nx[2]);
-    cnt += nghost*(pGrid->Nx[1])*cnt3;
-#endif
-
 /* MPI blocks to both left and right */
     if (pGrid->rx1_id >= 0 && pGrid->lx1_id >= 0) {
 
-      /* Post non-blocking receives for data from L and R Grids */
-      ierr = MPI_Irecv(&(recv_buf[0][0]),cnt,MPI_DOUBLE,pGrid->lx1_id,LtoR_tag,
-        pD->Comm_Domain, &(recv_rq[0]));
-      ierr = MPI_Irecv(&(recv_buf[1][0]),cnt,MPI_DOUBLE,pGrid->rx1_id,RtoL_tag,
-        pD->Comm_Domain, &(recv_rq[1]));
-
-      /* pack and send data L and R */
-      pack_ix1(pGrid);
-      ierr = MPI_Isend(&(send_buf[0][0]),cnt,MPI_DOUBLE,pGrid->lx1_id,RtoL_tag,
-        pD->Comm_Domain, &(send_rq[0]));
-
-      pack_ox1(pGrid); 
-      ierr = MPI_Isend(&(send_buf[1][0]),cnt,MPI_DOUBLE,pGrid->rx1_id,LtoR_tag,
-        pD->Comm_Domain, &(send_rq[1]));
-
       /* check non-blocking sends have completed. */
-      ierr = MPI_Waitall(2, send_rq, MPI_STATUS_IGNORE);
+      ierr = timed_waitall(2, send_rq);
 
       /* check non-blocking receives and unpack data in any order. */
-      ierr = MPI_Waitany(2,recv_rq,&mIndex,MPI_STATUS_IGNORE);
+      ierr = timed_waitany(2,recv_rq,&mIndex);
       if (mIndex == 0) unpack_ix1(pGrid);
       if (mIndex == 1) unpack_ox1(pGrid);
-      ierr = MPI_Waitany(2,recv_rq,&mIndex,MPI_STATUS_IGNORE);
+      ierr = timed_waitany(2,recv_rq,&mIndex);
       if (mIndex == 0) unpack_ix1(pGrid);
       if (mIndex == 1) unpack_ox1(pGrid);
 
@@ -230,23 +414,14 @@ void bvals_mhd(DomainS *pD)
 /* Physical boundary on left, MPI block on right */
     if (pGrid->rx1_id >= 0 && pGrid->lx1_id < 0) {
 
-      /* Post non-blocking receive for data from R Grid */
-      ierr = MPI_Irecv(&(recv_buf[1][0]),cnt,MPI_DOUBLE,pGrid->rx1_id,RtoL_tag,
-        pD->Comm_Domain, &(recv_rq[1]));
-
-      /* pack and send data R */
-      pack_ox1(pGrid); 
-      ierr = MPI_Isend(&(send_buf[1][0]),cnt,MPI_DOUBLE,pGrid->rx1_id,LtoR_tag,
-        pD->Comm_Domain, &(send_rq[1]));
-
       /* set physical boundary */
       (*(pD->ix1_BCFun))(pGrid);
 
       /* check non-blocking send has completed. */
-      ierr = MPI_Wait(&(send_rq[1]), MPI_STATUS_IGNORE);
+      ierr = timed_wait(&(send_rq[1]));
 
       /* wait on non-blocking receive from R and unpack data */
-      ierr = MPI_Wait(&(recv_rq[1]), MPI_STATUS_IGNORE);
+      ierr = timed_wait(&(recv_rq[1]));
       unpack_ox1(pGrid);
 
     }
@@ -254,23 +429,14 @@ void bvals_mhd(DomainS *pD)
 /* MPI block on left, Physical boundary on right */
     if (pGrid->rx1_id < 0 && pGrid->lx1_id >= 0) {
 
-      /* Post non-blocking receive for data from L grid */
-      ierr = MPI_Irecv(&(recv_buf[0][0]),cnt,MPI_DOUBLE,pGrid->lx1_id,LtoR_tag,
-        pD->Comm_Domain, &(recv_rq[0]));
-
-      /* pack and send data L */
-      pack_ix1(pGrid); 
-      ierr = MPI_Isend(&(send_buf[0][0]),cnt,MPI_DOUBLE,pGrid->lx1_id,RtoL_tag,
-        pD->Comm_Domain, &(send_rq[0]));
-
       /* set physical boundary */
       (*(pD->ox1_BCFun))(pGrid);
 
       /* check non-blocking send has completed. */
-      ierr = MPI_Wait(&(send_rq[0]), MPI_STATUS_IGNORE);
+      ierr = timed_wait(&(send_rq[0]));
 
       /* wait on non-blocking receive from L and unpack data */
-      ierr = MPI_Wait(&(recv_rq[0]), MPI_STATUS_IGNORE);
+      ierr = timed_wait(&(recv_rq[0]));
       unpack_ix1(pGrid);
 
     }
@@ -290,40 +456,30 @@ void bvals_mhd(DomainS *pD)
   if (pGrid->Nx[1] > 1){
 
 #ifdef MPI_PARALLEL
-    cnt = (pGrid->Nx[0] + 2*nghost)*nghost*(pGrid->Nx[2])*(NVAR);
-#ifdef MHD
-    cnt3 = (pGrid->Nx[2] > 1) ? (pGrid->Nx[2] + 1) : 1;
-    cnt += (pGrid->Nx[0] + 2*nghost - 1)*nghost*(pGrid->Nx[2]);
-    cnt += (pGrid->Nx[0] + 2*nghost)*(nghost-1)*(pGrid->Nx[2]);
-    cnt += (pGrid->Nx[0] + 2*nghost)*nghost*cnt3;
-#endif
+    set_bufs(pD,1);
 
 /* MPI blocks to both left and right */
     if (pGrid->rx2_id >= 0 && pGrid->lx2_id >= 0) {
 
       /* Post non-blocking receives for data from L and R Grids */
-      ierr = MPI_Irecv(&(recv_buf[0][0]),cnt,MPI_DOUBLE,pGrid->lx2_id,LtoR_tag,
-        pD->Comm_Domain, &(recv_rq[0]));
-      ierr = MPI_Irecv(&(recv_buf[1][0]),cnt,MPI_DOUBLE,pGrid->rx2_id,RtoL_tag,
-        pD->Comm_Domain, &(recv_rq[1]));
+      ierr = MPI_Start(&(recv_rq[0]));
+      ierr = MPI_Start(&(recv_rq[1]));
 
       /* pack and send data L and R */
       pack_ix2(pGrid);
-      ierr = MPI_Isend(&(send_buf[0][0]),cnt,MPI_DOUBLE,pGrid->lx2_id,RtoL_tag,
-        pD->Comm_Domain, &(send_rq[0]));
+      ierr = MPI_Start(&(send_rq[0]));
 
       pack_ox2(pGrid); 
-      ierr = MPI_Isend(&(send_buf[1][0]),cnt,MPI_DOUBLE,pGrid->rx2_id,LtoR_tag,
-        pD->Comm_Domain, &(send_rq[1]));
+      ierr = MPI_Start(&(send_rq[1]));
 
       /* check non-blocking sends have completed. */
-      ierr = MPI_Waitall(2, send_rq, MPI_STATUS_IGNORE);
+      ierr = timed_waitall(2, send_rq);
 
       /* check non-blocking receives and unpack data in any order. */
-      ierr = MPI_Waitany(2,recv_rq,&mIndex,MPI_STATUS_IGNORE);
+      ierr = timed_waitany(2,recv_rq,&mIndex);
       if (mIndex == 0) unpack_ix2(pGrid);
       if (mIndex == 1) unpack_ox2(pGrid);
-      ierr = MPI_Waitany(2,recv_rq,&mIndex,MPI_STATUS_IGNORE);
+      ierr = timed_waitany(2,recv_rq,&mIndex);
       if (mIndex == 0) unpack_ix2(pGrid);
       if (mIndex == 1) unpack_ox2(pGrid);
 
@@ -333,22 +489,20 @@ void bvals_mhd(DomainS *pD)
     if (pGrid->rx2_id >= 0 && pGrid->lx2_id < 0) {
 
       /* Post non-blocking receive for data from R Grid */
-      ierr = MPI_Irecv(&(recv_buf[1][0]),cnt,MPI_DOUBLE,pGrid->rx2_id,RtoL_tag,
-        pD->Comm_Domain, &(recv_rq[1]));
+      ierr = MPI_Start(&(recv_rq[1]));
 
       /* pack and send data R */
       pack_ox2(pGrid); 
-      ierr = MPI_Isend(&(send_buf[1][0]),cnt,MPI_DOUBLE,pGrid->rx2_id,LtoR_tag,
-        pD->Comm_Domain, &(send_rq[1]));
+      ierr = MPI_Start(&(send_rq[1]));
 
       /* set physical boundary */
       (*(pD->ix2_BCFun))(pGrid);
 
       /* check non-blocking send has completed. */
-      ierr = MPI_Wait(&(send_rq[1]), MPI_STATUS_IGNORE);
+      ierr = timed_wait(&(send_rq[1]));
 
       /* wait on non-blocking receive from R and unpack data */
-      ierr = MPI_Wait(&(recv_rq[1]), MPI_STATUS_IGNORE);
+      ierr = timed_wait(&(recv_rq[1]));
       unpack_ox2(pGrid);
 
     }
@@ -357,22 +511,20 @@ void bvals_mhd(DomainS *pD)
     if (pGrid->rx2_id < 0 && pGrid->lx2_id >= 0) {
 
       /* Post non-blocking receive for data from L grid */
-      ierr = MPI_Irecv(&(recv_buf[0][0]),cnt,MPI_DOUBLE,pGrid->lx2_id,LtoR_tag,
-        pD->Comm_Domain, &(recv_rq[0]));
+      ierr = MPI_Start(&(recv_rq[0]));
 
       /* pack and send data L */
       pack_ix2(pGrid); 
-      ierr = MPI_Isend(&(send_buf[0][0]),cnt,MPI_DOUBLE,pGrid->lx2_id,RtoL_tag,
-        pD->Comm_Domain, &(send_rq[0]));
+      ierr = MPI_Start(&(send_rq[0]));
 
       /* set physical boundary */
       (*(pD->ox2_BCFun))(pGrid);
 
       /* check non-blocking send has completed. */
-      ierr = MPI_Wait(&(send_rq[0]), MPI_STATUS_IGNORE);
+      ierr = timed_wait(&(send_rq[0]));
 
       /* wait on non-blocking receive from L and unpack data */
-      ierr = MPI_Wait(&(recv_rq[0]), MPI_STATUS_IGNORE);
+      ierr = timed_wait(&(recv_rq[0]));
       unpack_ix2(pGrid);
 
     }
@@ -409,39 +561,30 @@ void bvals_mhd(DomainS *pD)
   if (pGrid->Nx[2] > 1){
 
 #ifdef MPI_PARALLEL
-    cnt = (pGrid->Nx[0] + 2*nghost)*(pGrid->Nx[1] + 2*nghost)*nghost*(NVAR);
-#ifdef MHD
-    cnt += (pGrid->Nx[0] + 2*nghost - 1)*(pGrid->Nx[1] + 2*nghost)*nghost;
-    cnt += (pGrid->Nx[0] + 2*nghost)*(pGrid->Nx[1] + 2*nghost - 1)*nghost;
-    cnt += (pGrid->Nx[0] + 2*nghost)*(pGrid->Nx[1] + 2*nghost)*(nghost-1);
-#endif
+    set_bufs(pD,2);
 
 /* MPI blocks to both left and right */
     if (pGrid->rx3_id >= 0 && pGrid->lx3_id >= 0) {
 
       /* Post non-blocking receives for data from L and R Grids */
-      ierr = MPI_Irecv(&(recv_buf[0][0]),cnt,MPI_DOUBLE,pGrid->lx3_id,LtoR_tag,
-        pD->Comm_Domain, &(recv_rq[0]));
-      ierr = MPI_Irecv(&(recv_buf[1][0]),cnt,MPI_DOUBLE,pGrid->rx3_id,RtoL_tag,
-        pD->Comm_Domain, &(recv_rq[1]));
+      ierr = MPI_Start(&(recv_rq[0]));
+      ierr = MPI_Start(&(recv_rq[1]));
 
       /* pack and send data L and R */
       pack_ix3(pGrid);
-      ierr = MPI_Isend(&(send_buf[0][0]),cnt,MPI_DOUBLE,pGrid->lx3_id,RtoL_tag,
-        pD->Comm_Domain, &(send_rq[0]));
+      ierr = MPI_Start(&(send_rq[0]));
 
       pack_ox3(pGrid); 
-      ierr = MPI_Isend(&(send_buf[1][0]),cnt,MPI_DOUBLE,pGrid->rx3_id,LtoR_tag,
-        pD->Comm_Domain, &(send_rq[1]));
+      ierr = MPI_Start(&(send_rq[1]));
 
       /* check non-blocking sends have completed. */
-      ierr = MPI_Waitall(2, send_rq, MPI_STATUS_IGNORE);
+      ierr = timed_waitall(2, send_rq);
 
       /* check non-blocking receives and unpack data in any order. */
-      ierr = MPI_Waitany(2,recv_rq,&mIndex,MPI_STATUS_IGNORE);
+      ierr = timed_waitany(2,recv_rq,&mIndex);
       if (mIndex == 0) unpack_ix3(pGrid);
       if (mIndex == 1) unpack_ox3(pGrid);
-      ierr = MPI_Waitany(2,recv_rq,&mIndex,MPI_STATUS_IGNORE);
+      ierr = timed_waitany(2,recv_rq,&mIndex);
       if (mIndex == 0) unpack_ix3(pGrid);
       if (mIndex == 1) unpack_ox3(pGrid);
 
@@ -451,22 +594,20 @@ void bvals_mhd(DomainS *pD)
     if (pGrid->rx3_id >= 0 && pGrid->lx3_id < 0) {
 
       /* Post non-blocking receive for data from R Grid */
-      ierr = MPI_Irecv(&(recv_buf[1][0]),cnt,MPI_DOUBLE,pGrid->rx3_id,RtoL_tag,
-        pD->Comm_Domain, &(recv_rq[1]));
+      ierr = MPI_Start(&(recv_rq[1]));
 
       /* pack and send data R */
       pack_ox3(pGrid); 
-      ierr = MPI_Isend(&(send_buf[1][0]),cnt,MPI_DOUBLE,pGrid->rx3_id,LtoR_tag,
-        pD->Comm_Domain, &(send_rq[1]));
+      ierr = MPI_Start(&(send_rq[1]));
 
       /* set physical boundary */
       (*(pD->ix3_BCFun))(pGrid);
 
       /* check non-blocking send has completed. */
-      ierr = MPI_Wait(&(send_rq[1]), MPI_STATUS_IGNORE);
+      ierr = timed_wait(&(send_rq[1]));
 
       /* wait on non-blocking receive from R and unpack data */
-      ierr = MPI_Wait(&(recv_rq[1]), MPI_STATUS_IGNORE);
+      ierr = timed_wait(&(recv_rq[1]));
       unpack_ox3(pGrid);
 
     }
@@ -475,22 +616,20 @@ void bvals_mhd(DomainS *pD)
     if (pGrid->rx3_id < 0 && pGrid->lx3_id >= 0) {
 
       /* Post non-blocking receive for data from L grid */
-      ierr = MPI_Irecv(&(recv_buf[0][0]),cnt,MPI_DOUBLE,pGrid->lx3_id,LtoR_tag,
-        pD->Comm_Domain, &(recv_rq[0]));
+      ierr = MPI_Start(&(recv_rq[0]));
 
       /* pack and send data L */
       pack_ix3(pGrid); 
-      ierr = MPI_Isend(&(send_buf[0][0]),cnt,MPI_DOUBLE,pGrid->lx3_id,RtoL_tag,
-        pD->Comm_Domain, &(send_rq[0]));
+      ierr = MPI_Start(&(send_rq[0]));
 
       /* set physical boundary */
       (*(pD->ox3_BCFun))(pGrid);
 
       /* check non-blocking send has completed. */
-      ierr = MPI_Wait(&(send_rq[0]), MPI_STATUS_IGNORE);
+      ierr = timed_wait(&(send_rq[0]));
 
       /* wait on non-blocking receive from L and unpack data */
-      ierr = MPI_Wait(&(recv_rq[0]), MPI_STATUS_IGNORE);
+      ierr = timed_wait(&(recv_rq[0]));
       unpack_ix3(pGrid);
 
     }
@@ -504,6 +643,8 @@ void bvals_mhd(DomainS *pD)
 
   }
 
+  pGrid->bvals_dirty = 0;
+
   return;
 }
 
@@ -519,8 +660,58 @@ void bvals_mhd_init(MeshS *pM)
   DomainS *pD;
   int i,nl,nd,irefine;
 #ifdef MPI_PARALLEL
-  int myL,myM,myN,l,m,n,nx1t,nx2t,nx3t,size;
-  int x1cnt=0, x2cnt=0, x3cnt=0; /* Number of words passed in x1/x2/x3-dir. */
+  int myL,myM,myN,l,m,n,nx1t,nx2t,nx3t,size,maxND;
+  int x1cnt, x2cnt, x3cnt; /* Number of words passed in x1/x2/x3-dir. */
+
+/* Allocate arrays of pointers to send/receive buffers and MPI_Requests for
+ * every Domain.  Buffers themselves are allocated below for Domains with a
+ * Grid on this processor. */
+
+  maxND = 1;
+  for (nl=0; nl<(pM->NLevels); nl++)
+    maxND = MAX(maxND, pM->DomainsPerLevel[nl]);
+
+  if((send_bufD = (double****)calloc_2d_array(pM->NLevels,maxND,
+    sizeof(double**))) == NULL)
+    ath_error("[bvals_init]: Failed to allocate send buffer pointers\n");
+  if((recv_bufD = (double****)calloc_2d_array(pM->NLevels,maxND,
+    sizeof(double**))) == NULL)
+    ath_error("[bvals_init]: Failed to allocate recv buffer pointers\n");
+
+  if((recv_rqD = (MPI_Request***)calloc_3d_array(pM->NLevels,maxND,
+    6*((NVAR)+1),sizeof(MPI_Request))) == NULL)
+    ath_error("[bvals_init]: Failed to allocate recv MPI_Request array\n");
+  if((send_rqD = (MPI_Request***)calloc_3d_array(pM->NLevels,maxND,
+    6*((NVAR)+1),sizeof(MPI_Request))) == NULL)
+    ath_error("[bvals_init]: Failed to allocate send MPI_Request array\n");
+
+/* Number of rounds used to exchange ghost zones with neighboring Grids */
+
+  bvals_rounds = par_geti_def("job","bvals_rounds",3);
+  if (bvals_rounds != 1 && bvals_rounds != 3)
+    ath_error("[bvals_init]: bvals_rounds=%d must be 1 or 3\n",bvals_rounds);
+#if defined(MHD) || defined(SHEARING_BOX)
+  if (bvals_rounds == 1)
+    ath_error("[bvals_init]: bvals_rounds=1 only implemented for hydro without shearing box\n");
+#endif
+
+/* Zero-copy exchange with MPI subarray types over U (single round only) */
+
+  bvals_zerocopy = par_geti_def("job","bvals_zerocopy",0);
+  if (bvals_zerocopy != 0 && bvals_rounds != 1)
+    ath_error("[bvals_init]: bvals_zerocopy=1 requires bvals_rounds=1\n");
+
+  if (bvals_rounds == 1) {
+    if((nbrD = (NbrMsgS***)calloc_3d_array(pM->NLevels,maxND,NNBR,
+      sizeof(NbrMsgS))) == NULL)
+      ath_error("[bvals_init]: Failed to allocate neighbor messages\n");
+    if((nbr_recv_rqD = (MPI_Request***)calloc_3d_array(pM->NLevels,maxND,
+      (DIRTY_ALL+1)*NNBR,sizeof(MPI_Request))) == NULL)
+      ath_error("[bvals_init]: Failed to allocate recv MPI_Request array\n");
+    if((nbr_send_rqD = (MPI_Request***)calloc_3d_array(pM->NLevels,maxND,
+      (DIRTY_ALL+1)*NNBR,sizeof(MPI_Request))) == NULL)
+      ath_error("[bvals_init]: Failed to allocate send MPI_Request array\n");
+  }
 #endif /* MPI_PARALLEL */
 
 /* Cycle through all the Domains that have active Grids on this proc */
@@ -532,6 +723,7 @@ void bvals_mhd_init(MeshS *pM)
     pG = pM->Domain[nl][nd].Grid;          /* ptr to Grid */
     irefine = 1;
     for (i=1;i<=nl;i++) irefine *= 2;   /* C pow fn only takes doubles !! */
+    pG->bvals_dirty = DIRTY_ALL;
 #ifdef MPI_PARALLEL
 /* get (l,m,n) coordinates of Grid being updated on this processor */
     get_myGridIndex(pD, myID_Comm_world, &myL, &myM, &myN);
@@ -837,6 +1029,7 @@ void bvals_mhd_init(MeshS *pM)
 
 #ifdef MPI_PARALLEL
 
+    x1cnt = x2cnt = x3cnt = 0;
     for (n=0; n<(pD->NGrid[2]); n++){
     for (m=0; m<(pD->NGrid[1]); m++){
       for (l=0; l<(pD->NGrid[0]); l++){
@@ -875,37 +1068,36 @@ void bvals_mhd_init(MeshS *pM)
 	}
       }
     }}
-#endif /* MPI_PARALLEL */
-
-  }}}  /* End loop over all Domains with active Grids -----------------------*/
 
-#ifdef MPI_PARALLEL
-/* Allocate memory for send/receive buffers and MPI_Requests */
+/* Allocate memory for send/receive buffers of this Domain */
 
-  size = x1cnt > x2cnt ? x1cnt : x2cnt;
-  size = x3cnt >  size ? x3cnt : size;
+    size = x1cnt > x2cnt ? x1cnt : x2cnt;
+    size = x3cnt >  size ? x3cnt : size;
 
 #ifdef MHD
-  size *= nghost*((NVAR)+3);
+    size *= nghost*((NVAR)+3);
 #else
-  size *= nghost*(NVAR);
+    size *= nghost*(NVAR);
 #endif
 
-  if (size > 0) {
-    if((send_buf = (double**)calloc_2d_array(2,size,sizeof(double))) == NULL)
-      ath_error("[bvals_init]: Failed to allocate send buffer\n");
+    if (size > 0) {
+      if((send_bufD[nl][nd] = (double**)calloc_2d_array(2,size,sizeof(double)))
+        == NULL) ath_error("[bvals_init]: Failed to allocate send buffer\n");
 
-    if((recv_buf = (double**)calloc_2d_array(2,size,sizeof(double))) == NULL)
-      ath_error("[bvals_init]: Failed to allocate recv buffer\n");
-  }
+      if((recv_bufD[nl][nd] = (double**)calloc_2d_array(2,size,sizeof(double)))
+        == NULL) ath_error("[bvals_init]: Failed to allocate recv buffer\n");
+    }
 
-  if((recv_rq = (MPI_Request*) calloc_1d_array(2,sizeof(MPI_Request))) == NULL)
-    ath_error("[bvals_init]: Failed to allocate recv MPI_Request array\n");
-  if((send_rq = (MPI_Request*) calloc_1d_array(2,sizeof(MPI_Request))) == NULL)
-    ath_error("[bvals_init]: Failed to allocate send MPI_Request array\n");
+/* Persistent requests, and neighbors and index ranges for single-round
+ * exchange.  Must come after the MPI neighbors at periodic boundaries have
+ * been set above. */
 
+    init_rq(pD);
+    if (bvals_rounds == 1) init_nbr26(pD, myL, myM, myN);
 #endif /* MPI_PARALLEL */
 
+  }}}  /* End loop over all Domains with active Grids -----------------------*/
+
   return;
 }
 
@@ -942,6 +1134,96 @@ void bvals_mhd_fun(DomainS *pD, enum BCDirection dir, VGFun_t prob_bc)
   return;
 }
 
+/*----------------------------------------------------------------------------*/
+/*! \fn void bvals_mhd_destruct(MeshS *pM)
+ *  \brief Frees the persistent requests and buffers created by bvals_mhd_init()
+ *   for the Domains of pM, so that bvals_mhd_init() can be called again for a
+ *   new Mesh.  Must be called with the Mesh that was passed to the init, and
+ *   with no exchange in flight.
+ */
+
+void bvals_mhd_destruct(MeshS *pM)
+{
+#ifdef MPI_PARALLEL
+  int nl,nd,n,ierr;
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+  for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+    if (pM->Domain[nl][nd].Grid == NULL) continue;
+
+    for (n=0; n<6*((NVAR)+1); n++) {
+      if (recv_rqD[nl][nd][n] != MPI_REQUEST_NULL)
+        ierr = MPI_Request_free(&(recv_rqD[nl][nd][n]));
+      if (send_rqD[nl][nd][n] != MPI_REQUEST_NULL)
+        ierr = MPI_Request_free(&(send_rqD[nl][nd][n]));
+    }
+    if (send_bufD[nl][nd] != NULL) free_2d_array(send_bufD[nl][nd]);
+    if (recv_bufD[nl][nd] != NULL) free_2d_array(recv_bufD[nl][nd]);
+
+    if (bvals_rounds == 1) {
+      for (n=0; n<(DIRTY_ALL+1)*NNBR; n++) {
+        if (nbr_recv_rqD[nl][nd][n] != MPI_REQUEST_NULL)
+          ierr = MPI_Request_free(&(nbr_recv_rqD[nl][nd][n]));
+        if (nbr_send_rqD[nl][nd][n] != MPI_REQUEST_NULL)
+          ierr = MPI_Request_free(&(nbr_send_rqD[nl][nd][n]));
+      }
+      for (n=0; n<NNBR; n++) {
+        if (nbrD[nl][nd][n].send_buf != NULL) free_1d_array(nbrD[nl][nd][n].send_buf);
+        if (nbrD[nl][nd][n].recv_buf != NULL) free_1d_array(nbrD[nl][nd][n].recv_buf);
+      }
+    }
+  }}
+
+  free_2d_array(send_bufD);
+  free_2d_array(recv_bufD);
+  free_3d_array(recv_rqD);
+  free_3d_array(send_rqD);
+  send_bufD = NULL;  recv_bufD = NULL;
+  recv_rqD = NULL;   send_rqD = NULL;
+  send_buf = NULL;   recv_buf = NULL;
+
+  if (bvals_rounds == 1) {
+    free_3d_array(nbrD);
+    free_3d_array(nbr_recv_rqD);
+    free_3d_array(nbr_send_rqD);
+    nbrD = NULL;  nbr_recv_rqD = NULL;  nbr_send_rqD = NULL;
+  }
+#endif /* MPI_PARALLEL */
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn double bvals_mhd_wait_time(void)
+ *  \brief Returns the wall time (in seconds) spent waiting for MPI messages in
+ *   bvals_mhd_finish() since the previous call, and resets the counter.
+ */
+
+double bvals_mhd_wait_time(void)
+{
+  double t = 0.0;
+#ifdef MPI_PARALLEL
+  t = wait_time;
+  wait_time = 0.0;
+#endif /* MPI_PARALLEL */
+  return t;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn double bvals_mhd_bytes_saved(void)
+ *  \brief Returns the number of bytes not sent with MPI since the previous
+ *   call because the variables were unchanged, and resets the counter.
+ */
+
+double bvals_mhd_bytes_saved(void)
+{
+  double b = 0.0;
+#ifdef MPI_PARALLEL
+  b = bytes_saved;
+  bytes_saved = 0.0;
+#endif /* MPI_PARALLEL */
+  return b;
+}
+
 /*=========================== PRIVATE FUNCTIONS ==============================*/
 /* Following are the functions:
  *   reflecting_???:   where ???=[ix1,ox1,ix2,ox2,ix3,ox3]
@@ -2323,30 +2605,16 @@ static void pack_ix1(GridS *pG)
 #ifdef MHD
   int ju, ku; /* j-upper, k-upper */
 #endif
-#if (NSCALARS > 0)
   int n;
-#endif
+  Real *pU;
   double *pSnd;
   pSnd = (double*)&(send_buf[0][0]);
 
   for (k=ks; k<=ke; k++){
     for (j=js; j<=je; j++){
       for (i=is; i<=is+(nghost-1); i++){
-        *(pSnd++) = pG->U[k][j][i].d;
-        *(pSnd++) = pG->U[k][j][i].M1;
-        *(pSnd++) = pG->U[k][j][i].M2;
-        *(pSnd++) = pG->U[k][j][i].M3;
-#ifndef BAROTROPIC
-        *(pSnd++) = pG->U[k][j][i].E;
-#endif /* BAROTROPIC */
-#ifdef MHD
-        *(pSnd++) = pG->U[k][j][i].B1c;
-        *(pSnd++) = pG->U[k][j][i].B2c;
-        *(pSnd++) = pG->U[k][j][i].B3c;
-#endif /* MHD */
-#if (NSCALARS > 0)
-        for (n=0; n<NSCALARS; n++) *(pSnd++) = pG->U[k][j][i].s[n];
-#endif
+        pU = (Real*)&(pG->U[k][j][i]);
+        for (n=0; n<nvar_bv; n++) *(pSnd++) = pU[var_bv[n]];
       }
     }
   }
@@ -2396,30 +2664,16 @@ static void pack_ox1(GridS *pG)
 #ifdef MHD
   int ju, ku; /* j-upper, k-upper */
 #endif
-#if (NSCALARS > 0)
   int n;
-#endif
+  Real *pU;
   double *pSnd;
   pSnd = (double*)&(send_buf[1][0]);
 
   for (k=ks; k<=ke; k++){
     for (j=js; j<=je; j++){
       for (i=ie-(nghost-1); i<=ie; i++){
-        *(pSnd++) = pG->U[k][j][i].d;
-        *(pSnd++) = pG->U[k][j][i].M1;
-        *(pSnd++) = pG->U[k][j][i].M2;
-        *(pSnd++) = pG->U[k][j][i].M3;
-#ifndef BAROTROPIC
-        *(pSnd++) = pG->U[k][j][i].E;
-#endif /* BAROTROPIC */
-#ifdef MHD
-        *(pSnd++) = pG->U[k][j][i].B1c;
-        *(pSnd++) = pG->U[k][j][i].B2c;
-        *(pSnd++) = pG->U[k][j][i].B3c;
-#endif /* MHD */
-#if (NSCALARS > 0)
-        for (n=0; n<NSCALARS; n++) *(pSnd++) = pG->U[k][j][i].s[n];
-#endif
+        pU = (Real*)&(pG->U[k][j][i]);
+        for (n=0; n<nvar_bv; n++) *(pSnd++) = pU[var_bv[n]];
       }
     }
   }
@@ -2468,30 +2722,16 @@ static void pack_ix2(GridS *pG)
 #ifdef MHD
   int ku; /* k-upper */
 #endif
-#if (NSCALARS > 0)
   int n;
-#endif
+  Real *pU;
   double *pSnd;
   pSnd = (double*)&(send_buf[0][0]);
 
   for (k=ks; k<=ke; k++) {
     for (j=js; j<=js+(nghost-1); j++) {
       for (i=is-nghost; i<=ie+nghost; i++) {
-        *(pSnd++) = pG->U[k][j][i].d;
-        *(pSnd++) = pG->U[k][j][i].M1;
-        *(pSnd++) = pG->U[k][j][i].M2;
-        *(pSnd++) = pG->U[k][j][i].M3;
-#ifndef BAROTROPIC
-        *(pSnd++) = pG->U[k][j][i].E;
-#endif /* BAROTROPIC */
-#ifdef MHD
-        *(pSnd++) = pG->U[k][j][i].B1c;
-        *(pSnd++) = pG->U[k][j][i].B2c;
-        *(pSnd++) = pG->U[k][j][i].B3c;
-#endif /* MHD */
-#if (NSCALARS > 0)
-        for (n=0; n<NSCALARS; n++) *(pSnd++) = pG->U[k][j][i].s[n];
-#endif
+        pU = (Real*)&(pG->U[k][j][i]);
+        for (n=0; n<nvar_bv; n++) *(pSnd++) = pU[var_bv[n]];
       }
     }
   }
@@ -2541,30 +2781,16 @@ static void pack_ox2(GridS *pG)
 #ifdef MHD
   int ku; /* k-upper */
 #endif
-#if (NSCALARS > 0)
   int n;
-#endif
+  Real *pU;
   double *pSnd;
   pSnd = (double*)&(send_buf[1][0]);
 
   for (k=ks; k<=ke; k++){
     for (j=je-(nghost-1); j<=je; j++){
       for (i=is-nghost; i<=ie+nghost; i++){
-        *(pSnd++) = pG->U[k][j][i].d;
-        *(pSnd++) = pG->U[k][j][i].M1;
-        *(pSnd++) = pG->U[k][j][i].M2;
-        *(pSnd++) = pG->U[k][j][i].M3;
-#ifndef BAROTROPIC
-        *(pSnd++) = pG->U[k][j][i].E;
-#endif /* BAROTROPIC */
-#ifdef MHD
-        *(pSnd++) = pG->U[k][j][i].B1c;
-        *(pSnd++) = pG->U[k][j][i].B2c;
-        *(pSnd++) = pG->U[k][j][i].B3c;
-#endif /* MHD */
-#if (NSCALARS > 0)
-        for (n=0; n<NSCALARS; n++) *(pSnd++) = pG->U[k][j][i].s[n];
-#endif
+        pU = (Real*)&(pG->U[k][j][i]);
+        for (n=0; n<nvar_bv; n++) *(pSnd++) = pU[var_bv[n]];
       }
     }
   }
@@ -2611,30 +2837,16 @@ static void pack_ix3(GridS *pG)
   int js = pG->js, je = pG->je;
   int ks = pG->ks, ke = pG->ke;
   int i,j,k;
-#if (NSCALARS > 0)
   int n;
-#endif
+  Real *pU;
   double *pSnd;
   pSnd = (double*)&(send_buf[0][0]);
 
   for (k=ks; k<=ks+(nghost-1); k++) {
     for (j=js-nghost; j<=je+nghost; j++) {
       for (i=is-nghost; i<=ie+nghost; i++) {
-        *(pSnd++) = pG->U[k][j][i].d;
-        *(pSnd++) = pG->U[k][j][i].M1;
-        *(pSnd++) = pG->U[k][j][i].M2;
-        *(pSnd++) = pG->U[k][j][i].M3;
-#ifndef BAROTROPIC
-        *(pSnd++) = pG->U[k][j][i].E;
-#endif /* BAROTROPIC */
-#ifdef MHD
-        *(pSnd++) = pG->U[k][j][i].B1c;
-        *(pSnd++) = pG->U[k][j][i].B2c;
-        *(pSnd++) = pG->U[k][j][i].B3c;
-#endif /* MHD */
-#if (NSCALARS > 0)
-        for (n=0; n<NSCALARS; n++) *(pSnd++) = pG->U[k][j][i].s[n];
-#endif
+        pU = (Real*)&(pG->U[k][j][i]);
+        for (n=0; n<nvar_bv; n++) *(pSnd++) = pU[var_bv[n]];
       }
     }
   }
@@ -2681,30 +2893,16 @@ static void pack_ox3(GridS *pG)
   int js = pG->js, je = pG->je;
   int ks = pG->ks, ke = pG->ke;
   int i,j,k;
-#if (NSCALARS > 0)
   int n;
-#endif
+  Real *pU;
   double *pSnd;
   pSnd = (double*)&(send_buf[1][0]);
 
   for (k=ke-(nghost-1); k<=ke; k++) {
     for (j=js-nghost; j<=je+nghost; j++) {
       for (i=is-nghost; i<=ie+nghost; i++) {
-        *(pSnd++) = pG->U[k][j][i].d;
-        *(pSnd++) = pG->U[k][j][i].M1;
-        *(pSnd++) = pG->U[k][j][i].M2;
-        *(pSnd++) = pG->U[k][j][i].M3;
-#ifndef BAROTROPIC
-        *(pSnd++) = pG->U[k][j][i].E;
-#endif /* BAROTROPIC */
-#ifdef MHD
-        *(pSnd++) = pG->U[k][j][i].B1c;
-        *(pSnd++) = pG->U[k][j][i].B2c;
-        *(pSnd++) = pG->U[k][j][i].B3c;
-#endif /* MHD */
-#if (NSCALARS > 0)
-        for (n=0; n<NSCALARS; n++) *(pSnd++) = pG->U[k][j][i].s[n];
-#endif
+        pU = (Real*)&(pG->U[k][j][i]);
+        for (n=0; n<nvar_bv; n++) *(pSnd++) = pU[var_bv[n]];
       }
     }
   }
@@ -2754,30 +2952,16 @@ static void unpack_ix1(GridS *pG)
 #ifdef MHD
   int ju, ku; /* j-upper, k-upper */
 #endif
-#if (NSCALARS > 0)
   int n;
-#endif
+  Real *pU;
   double *pRcv;
   pRcv = (double*)&(recv_buf[0][0]);
 
   for (k=ks; k<=ke; k++){
     for (j=js; j<=je; j++){
       for (i=is-nghost; i<=is-1; i++){
-        pG->U[k][j][i].d  = *(pRcv++);
-        pG->U[k][j][i].M1 = *(pRcv++);
-        pG->U[k][j][i].M2 = *(pRcv++);
-        pG->U[k][j][i].M3 = *(pRcv++);
-#ifndef BAROTROPIC
-        pG->U[k][j][i].E  = *(pRcv++);
-#endif /* BAROTROPIC */
-#ifdef MHD
-        pG->U[k][j][i].B1c = *(pRcv++);
-        pG->U[k][j][i].B2c = *(pRcv++);
-        pG->U[k][j][i].B3c = *(pRcv++);
-#endif /* MHD */
-#if (NSCALARS > 0)
-        for (n=0; n<NSCALARS; n++) pG->U[k][j][i].s[n] = *(pRcv++);
-#endif
+        pU = (Real*)&(pG->U[k][j][i]);
+        for (n=0; n<nvar_bv; n++) pU[var_bv[n]] = *(pRcv++);
       }
     }
   }
@@ -2827,30 +3011,16 @@ static void unpack_ox1(GridS *pG)
 #ifdef MHD
   int ju, ku; /* j-upper, k-upper */
 #endif
-#if (NSCALARS > 0)
   int n;
-#endif
+  Real *pU;
   double *pRcv;
   pRcv = (double*)&(recv_buf[1][0]);
 
   for (k=ks; k<=ke; k++) {
     for (j=js; j<=je; j++) {
       for (i=ie+1; i<=ie+nghost; i++) {
-        pG->U[k][j][i].d  = *(pRcv++);
-        pG->U[k][j][i].M1 = *(pRcv++);
-        pG->U[k][j][i].M2 = *(pRcv++);
-        pG->U[k][j][i].M3 = *(pRcv++);
-#ifndef BAROTROPIC
-        pG->U[k][j][i].E  = *(pRcv++);
-#endif /* BAROTROPIC */
-#ifdef MHD
-        pG->U[k][j][i].B1c = *(pRcv++);
-        pG->U[k][j][i].B2c = *(pRcv++);
-        pG->U[k][j][i].B3c = *(pRcv++);
-#endif /* MHD */
-#if (NSCALARS > 0)
-        for (n=0; n<NSCALARS; n++) pG->U[k][j][i].s[n] = *(pRcv++);
-#endif
+        pU = (Real*)&(pG->U[k][j][i]);
+        for (n=0; n<nvar_bv; n++) pU[var_bv[n]] = *(pRcv++);
       }
     }
   }
@@ -2900,30 +3070,16 @@ static void unpack_ix2(GridS *pG)
 #ifdef MHD
   int ku; /* k-upper */
 #endif
-#if (NSCALARS > 0)
   int n;
-#endif
+  Real *pU;
   double *pRcv;
   pRcv = (double*)&(recv_buf[0][0]);
 
   for (k=ks; k<=ke; k++) {
     for (j=js-nghost; j<=js-1; j++) {
       for (i=is-nghost; i<=ie+nghost; i++) {
-        pG->U[k][j][i].d  = *(pRcv++);
-        pG->U[k][j][i].M1 = *(pRcv++);
-        pG->U[k][j][i].M2 = *(pRcv++);
-        pG->U[k][j][i].M3 = *(pRcv++);
-#ifndef BAROTROPIC
-        pG->U[k][j][i].E  = *(pRcv++);
-#endif /* BAROTROPIC */
-#ifdef MHD
-        pG->U[k][j][i].B1c = *(pRcv++);
-        pG->U[k][j][i].B2c = *(pRcv++);
-        pG->U[k][j][i].B3c = *(pRcv++);
-#endif /* MHD */
-#if (NSCALARS > 0)
-        for (n=0; n<NSCALARS; n++) pG->U[k][j][i].s[n] = *(pRcv++);
-#endif
+        pU = (Real*)&(pG->U[k][j][i]);
+        for (n=0; n<nvar_bv; n++) pU[var_bv[n]] = *(pRcv++);
       }
     }
   }
@@ -2973,30 +3129,16 @@ static void unpack_ox2(GridS *pG)
 #ifdef MHD
   int ku; /* k-upper */
 #endif
-#if (NSCALARS > 0)
   int n;
-#endif
+  Real *pU;
   double *pRcv;
   pRcv = (double*)&(recv_buf[1][0]);
 
   for (k=ks; k<=ke; k++) {
     for (j=je+1; j<=je+nghost; j++) {
       for (i=is-nghost; i<=ie+nghost; i++) {
-        pG->U[k][j][i].d  = *(pRcv++);
-        pG->U[k][j][i].M1 = *(pRcv++);
-        pG->U[k][j][i].M2 = *(pRcv++);
-        pG->U[k][j][i].M3 = *(pRcv++);
-#ifndef BAROTROPIC
-        pG->U[k][j][i].E  = *(pRcv++);
-#endif /* BAROTROPIC */
-#ifdef MHD
-        pG->U[k][j][i].B1c = *(pRcv++);
-        pG->U[k][j][i].B2c = *(pRcv++);
-        pG->U[k][j][i].B3c = *(pRcv++);
-#endif /* MHD */
-#if (NSCALARS > 0)
-        for (n=0; n<NSCALARS; n++) pG->U[k][j][i].s[n] = *(pRcv++);
-#endif
+        pU = (Real*)&(pG->U[k][j][i]);
+        for (n=0; n<nvar_bv; n++) pU[var_bv[n]] = *(pRcv++);
       }
     }
   }
@@ -3043,30 +3185,16 @@ static void unpack_ix3(GridS *pG)
   int js = pG->js, je = pG->je;
   int ks = pG->ks;
   int i,j,k;
-#if (NSCALARS > 0)
   int n;
-#endif
+  Real *pU;
   double *pRcv;
   pRcv = (double*)&(recv_buf[0][0]);
 
   for (k=ks-nghost; k<=ks-1; k++) {
     for (j=js-nghost; j<=je+nghost; j++) {
       for (i=is-nghost; i<=ie+nghost; i++) {
-        pG->U[k][j][i].d  = *(pRcv++);
-        pG->U[k][j][i].M1 = *(pRcv++);
-        pG->U[k][j][i].M2 = *(pRcv++);
-        pG->U[k][j][i].M3 = *(pRcv++);
-#ifndef BAROTROPIC
-        pG->U[k][j][i].E  = *(pRcv++);
-#endif /* BAROTROPIC */
-#ifdef MHD
-        pG->U[k][j][i].B1c = *(pRcv++);
-        pG->U[k][j][i].B2c = *(pRcv++);
-        pG->U[k][j][i].B3c = *(pRcv++);
-#endif /* MHD */
-#if (NSCALARS > 0)
-        for (n=0; n<NSCALARS; n++) pG->U[k][j][i].s[n] = *(pRcv++);
-#endif
+        pU = (Real*)&(pG->U[k][j][i]);
+        for (n=0; n<nvar_bv; n++) pU[var_bv[n]] = *(pRcv++);
       }
     }
   }
@@ -3113,30 +3241,16 @@ static void unpack_ox3(GridS *pG)
   int js = pG->js, je = pG->je;
   int ke = pG->ke;
   int i,j,k;
-#if (NSCALARS > 0)
   int n;
-#endif
+  Real *pU;
   double *pRcv;
   pRcv = (double*)&(recv_buf[1][0]);
 
   for (k=ke+1; k<=ke+nghost; k++) {
     for (j=js-nghost; j<=je+nghost; j++) {
       for (i=is-nghost; i<=ie+nghost; i++) {
-        pG->U[k][j][i].d  = *(pRcv++);
-        pG->U[k][j][i].M1 = *(pRcv++);
-        pG->U[k][j][i].M2 = *(pRcv++);
-        pG->U[k][j][i].M3 = *(pRcv++);
-#ifndef BAROTROPIC
-        pG->U[k][j][i].E  = *(pRcv++);
-#endif /* BAROTROPIC */
-#ifdef MHD
-        pG->U[k][j][i].B1c = *(pRcv++);
-        pG->U[k][j][i].B2c = *(pRcv++);
-        pG->U[k][j][i].B3c = *(pRcv++);
-#endif /* MHD */
-#if (NSCALARS > 0)
-        for (n=0; n<NSCALARS; n++) pG->U[k][j][i].s[n] = *(pRcv++);
-#endif
+        pU = (Real*)&(pG->U[k][j][i]);
+        for (n=0; n<nvar_bv; n++) pU[var_bv[n]] = *(pRcv++);
       }
     }
   }
@@ -3172,4 +3286,526 @@ static void unpack_ox3(GridS *pG)
 
   return;
 }
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void set_bufs(DomainS *pD, int dir)
+ *  \brief Points send/recv buffers and MPI_Requests at those of Domain pD,
+ *   for the exchange in direction dir of nvar_bv variables */
+
+static void set_bufs(DomainS *pD, int dir)
+{
+  int nl = pD->Level, nd = pD->DomNumber;
+
+  send_buf = send_bufD[nl][nd];
+  recv_buf = recv_bufD[nl][nd];
+  recv_rq  = &(recv_rqD[nl][nd][2*(dir*((NVAR)+1) + nvar_bv)]);
+  send_rq  = &(send_rqD[nl][nd][2*(dir*((NVAR)+1) + nvar_bv)]);
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void init_rq(DomainS *pD)
+ *  \brief Creates persistent requests for the three-round exchange, for each
+ *   direction and each number of variables */
+
+static void init_rq(DomainS *pD)
+{
+  GridS *pG = pD->Grid;
+  MPI_Request *rrq = recv_rqD[pD->Level][pD->DomNumber];
+  MPI_Request *srq = send_rqD[pD->Level][pD->DomNumber];
+  int dir,nvar,cnt,lid,rid,n,ierr;
+
+  for (n=0; n<6*((NVAR)+1); n++) {
+    rrq[n] = MPI_REQUEST_NULL;
+    srq[n] = MPI_REQUEST_NULL;
+  }
+  if (bvals_rounds != 3) return;
+
+  for (dir=0; dir<3; dir++) {
+    if (pG->Nx[dir] == 1) continue;
+    if (dir == 0) {lid = pG->lx1_id;  rid = pG->rx1_id;}
+    if (dir == 1) {lid = pG->lx2_id;  rid = pG->rx2_id;}
+    if (dir == 2) {lid = pG->lx3_id;  rid = pG->rx3_id;}
+
+    for (nvar=1; nvar<=(NVAR); nvar++) {
+      cnt = msg_cnt(pG,dir,nvar);
+      n = 2*(dir*((NVAR)+1) + nvar);
+      if (lid >= 0) {
+        ierr = MPI_Recv_init(&(recv_bufD[pD->Level][pD->DomNumber][0][0]),cnt,
+          MPI_DOUBLE,lid,LtoR_tag,pD->Comm_Domain,&(rrq[n]));
+        ierr = MPI_Send_init(&(send_bufD[pD->Level][pD->DomNumber][0][0]),cnt,
+          MPI_DOUBLE,lid,RtoL_tag,pD->Comm_Domain,&(srq[n]));
+      }
+      if (rid >= 0) {
+        ierr = MPI_Recv_init(&(recv_bufD[pD->Level][pD->DomNumber][1][0]),cnt,
+          MPI_DOUBLE,rid,RtoL_tag,pD->Comm_Domain,&(rrq[n+1]));
+        ierr = MPI_Send_init(&(send_bufD[pD->Level][pD->DomNumber][1][0]),cnt,
+          MPI_DOUBLE,rid,LtoR_tag,pD->Comm_Domain,&(srq[n+1]));
+      }
+    }
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int timed_wait(MPI_Request *rq)
+ *  \brief MPI_Wait, adding time spent to wait_time */
+
+static int timed_wait(MPI_Request *rq)
+{
+  int ierr;
+  double t0 = MPI_Wtime();
+
+  ierr = MPI_Wait(rq, MPI_STATUS_IGNORE);
+  wait_time += MPI_Wtime() - t0;
+  return ierr;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int timed_waitany(int n, MPI_Request *rq, int *pIndex)
+ *  \brief MPI_Waitany, adding time spent to wait_time */
+
+static int timed_waitany(int n, MPI_Request *rq, int *pIndex)
+{
+  int ierr;
+  double t0 = MPI_Wtime();
+
+  ierr = MPI_Waitany(n, rq, pIndex, MPI_STATUS_IGNORE);
+  wait_time += MPI_Wtime() - t0;
+  return ierr;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int timed_waitall(int n, MPI_Request *rq)
+ *  \brief MPI_Waitall, adding time spent to wait_time */
+
+static int timed_waitall(int n, MPI_Request *rq)
+{
+  int ierr;
+  double t0 = MPI_Wtime();
+
+  ierr = MPI_Waitall(n, rq, MPI_STATUSES_IGNORE);
+  wait_time += MPI_Wtime() - t0;
+  return ierr;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int set_vars(int mask)
+ *  \brief Sets the list of variables to be exchanged from DIRTY_* flags
+ *   (usually pG->bvals_dirty), returns the number of variables */
+
+static int set_vars(int mask)
+{
+#if (NSCALARS > 0)
+  int n;
+#endif
+
+/* shearing-sheet BCs are always needed; interface fields are not split */
+#ifdef SHEARING_BOX
+  mask = DIRTY_ALL;
+#elif defined(MHD)
+  if (mask != 0) mask = DIRTY_ALL;
+#else
+  mask &= ~DIRTY_B;
+#endif
+#ifdef BAROTROPIC
+  mask &= ~DIRTY_E;
+#endif
+#if (NSCALARS == 0)
+  mask &= ~DIRTY_S;
+#endif
+  mask_bv = mask;
+
+  nvar_bv = 0;
+  if (mask & DIRTY_D) var_bv[nvar_bv++] = offsetof(ConsS,d)/sizeof(Real);
+  if (mask & DIRTY_M) {
+    var_bv[nvar_bv++] = offsetof(ConsS,M1)/sizeof(Real);
+    var_bv[nvar_bv++] = offsetof(ConsS,M2)/sizeof(Real);
+    var_bv[nvar_bv++] = offsetof(ConsS,M3)/sizeof(Real);
+  }
+#ifndef BAROTROPIC
+  if (mask & DIRTY_E) var_bv[nvar_bv++] = offsetof(ConsS,E)/sizeof(Real);
+#endif
+#ifdef MHD
+  if (mask & DIRTY_B) {
+    var_bv[nvar_bv++] = offsetof(ConsS,B1c)/sizeof(Real);
+    var_bv[nvar_bv++] = offsetof(ConsS,B2c)/sizeof(Real);
+    var_bv[nvar_bv++] = offsetof(ConsS,B3c)/sizeof(Real);
+  }
+#endif
+#if (NSCALARS > 0)
+  if (mask & DIRTY_S) {
+    for (n=0; n<NSCALARS; n++)
+      var_bv[nvar_bv++] = offsetof(ConsS,s)/sizeof(Real) + n;
+  }
+#endif
+
+  return nvar_bv;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int msg_cnt(GridS *pG, int dir, int nvar)
+ *  \brief Number of doubles in the message in direction dir (0,1,2 for
+ *   x1,x2,x3) of the three-round exchange when nvar variables are sent.  With
+ *   MHD, the interface fields are included only if all variables are sent. */
+
+static int msg_cnt(GridS *pG, int dir, int nvar)
+{
+  int cnt=0;
+#ifdef MHD
+  int cnt2, cnt3;
+#endif
+
+  if (dir == 0) {
+    cnt = nghost*(pG->Nx[1])*(pG->Nx[2])*nvar;
+#ifdef MHD
+    if (nvar == NVAR) {
+      cnt2 = (pG->Nx[1] > 1) ? (pG->Nx[1] + 1) : 1;
+      cnt3 = (pG->Nx[2] > 1) ? (pG->Nx[2] + 1) : 1;
+      cnt += (nghost-1)*(pG->Nx[1])*(pG->Nx[2]);
+      cnt += nghost*cnt2*(pG->Nx[2]);
+      cnt += nghost*(pG->Nx[1])*cnt3;
+    }
+#endif
+  }
+
+  if (dir == 1) {
+    cnt = (pG->Nx[0] + 2*nghost)*nghost*(pG->Nx[2])*nvar;
+#ifdef MHD
+    if (nvar == NVAR) {
+      cnt3 = (pG->Nx[2] > 1) ? (pG->Nx[2] + 1) : 1;
+      cnt += (pG->Nx[0] + 2*nghost - 1)*nghost*(pG->Nx[2]);
+      cnt += (pG->Nx[0] + 2*nghost)*(nghost-1)*(pG->Nx[2]);
+      cnt += (pG->Nx[0] + 2*nghost)*nghost*cnt3;
+    }
+#endif
+  }
+
+  if (dir == 2) {
+    cnt = (pG->Nx[0] + 2*nghost)*(pG->Nx[1] + 2*nghost)*nghost*nvar;
+#ifdef MHD
+    if (nvar == NVAR) {
+      cnt += (pG->Nx[0] + 2*nghost - 1)*(pG->Nx[1] + 2*nghost)*nghost;
+      cnt += (pG->Nx[0] + 2*nghost)*(pG->Nx[1] + 2*nghost - 1)*nghost;
+      cnt += (pG->Nx[0] + 2*nghost)*(pG->Nx[1] + 2*nghost)*(nghost-1);
+    }
+#endif
+  }
+
+  return cnt;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void phys_bvals(DomainS *pD)
+ *  \brief Applies the BC functions at all boundaries without an MPI neighbor,
+ *   in the order x1-x2-x3 */
+
+static void phys_bvals(DomainS *pD)
+{
+  GridS *pG = pD->Grid;
+
+  if (pG->Nx[0] > 1) {
+    if (pG->lx1_id < 0) (*(pD->ix1_BCFun))(pG);
+    if (pG->rx1_id < 0) (*(pD->ox1_BCFun))(pG);
+  }
+  if (pG->Nx[1] > 1) {
+    if (pG->lx2_id < 0) (*(pD->ix2_BCFun))(pG);
+    if (pG->rx2_id < 0) (*(pD->ox2_BCFun))(pG);
+  }
+  if (pG->Nx[2] > 1) {
+    if (pG->lx3_id < 0) (*(pD->ix3_BCFun))(pG);
+    if (pG->rx3_id < 0) (*(pD->ox3_BCFun))(pG);
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void init_nbr26(DomainS *pD, int myL, int myM, int myN)
+ *  \brief Finds the IDs of all neighboring Grids, and the index ranges that
+ *   are packed/unpacked for each of them, for the single-round exchange.
+ *
+ *   In each direction with a neighbor offset d=-1 (+1), the nghost active cells
+ *   at the L (R) edge are sent, and the L (R) ghost zones are received.  In
+ *   directions with d=0 the active cells are exchanged, plus the ghost zones
+ *   on each side with no MPI neighbor (set by physical BCs or by Prolongate);
+ *   the sender and receiver share the same boundaries in these directions.
+ */
+
+static void init_nbr26(DomainS *pD, int myL, int myM, int myN)
+{
+  GridS *pG = pD->Grid;
+  NbrMsgS *pMsg = nbrD[pD->Level][pD->DomNumber];
+  MPI_Request *rrq = nbr_recv_rqD[pD->Level][pD->DomNumber];
+  MPI_Request *srq = nbr_send_rqD[pD->Level][pD->DomNumber];
+  int s[3],e[3],lid[3],rid[3],my[3],d[3];
+  int sl[3],su[3],rl[3],ru[3];
+  int dir,dl,dm,dn,n,l,m,nk,mask,ierr;
+  int sizes[3],subsizes[3],starts[3];
+  MPI_Datatype cell_type, tmp_type, send_type, recv_type;
+
+  s[0] = pG->is;  e[0] = pG->ie;  lid[0] = pG->lx1_id;  rid[0] = pG->rx1_id;
+  s[1] = pG->js;  e[1] = pG->je;  lid[1] = pG->lx2_id;  rid[1] = pG->rx2_id;
+  s[2] = pG->ks;  e[2] = pG->ke;  lid[2] = pG->lx3_id;  rid[2] = pG->rx3_id;
+  my[0] = myL;  my[1] = myM;  my[2] = myN;
+
+  for (n=0; n<NNBR; n++) pMsg[n].id = -1;
+  for (n=0; n<(DIRTY_ALL+1)*NNBR; n++) {
+    rrq[n] = MPI_REQUEST_NULL;
+    srq[n] = MPI_REQUEST_NULL;
+  }
+
+  for (dn=-1; dn<=1; dn++) {
+  for (dm=-1; dm<=1; dm++) {
+  for (dl=-1; dl<=1; dl++) {
+    n = (dn+1)*9 + (dm+1)*3 + (dl+1);
+    d[0] = dl;  d[1] = dm;  d[2] = dn;
+    if (n == 13) continue;
+
+/* A neighbor exists if there is an MPI neighbor in every direction with d!=0 */
+    for (dir=0; dir<3; dir++) {
+      if (d[dir] == 0) continue;
+      if (pG->Nx[dir] == 1) break;
+      if (d[dir] < 0 && lid[dir] < 0) break;
+      if (d[dir] > 0 && rid[dir] < 0) break;
+    }
+    if (dir < 3) continue;
+
+    for (dir=0; dir<3; dir++) {
+      if (d[dir] < 0) {
+        sl[dir] = s[dir];           su[dir] = s[dir] + nghost - 1;
+        rl[dir] = s[dir] - nghost;  ru[dir] = s[dir] - 1;
+      } else if (d[dir] > 0) {
+        sl[dir] = e[dir] - nghost + 1;  su[dir] = e[dir];
+        rl[dir] = e[dir] + 1;           ru[dir] = e[dir] + nghost;
+      } else {
+        sl[dir] = s[dir];  su[dir] = e[dir];
+        if (pG->Nx[dir] > 1) {
+          if (lid[dir] < 0) sl[dir] -= nghost;
+          if (rid[dir] < 0) su[dir] += nghost;
+        }
+        rl[dir] = sl[dir];  ru[dir] = su[dir];
+      }
+    }
+
+    l = (my[0] + dl + pD->NGrid[0]) % pD->NGrid[0];
+    m = (my[1] + dm + pD->NGrid[1]) % pD->NGrid[1];
+    nk = (my[2] + dn + pD->NGrid[2]) % pD->NGrid[2];
+    pMsg[n].id = pD->GData[nk][m][l].ID_Comm_Domain;
+
+    pMsg[n].sis = sl[0];  pMsg[n].sie = su[0];
+    pMsg[n].sjs = sl[1];  pMsg[n].sje = su[1];
+    pMsg[n].sks = sl[2];  pMsg[n].ske = su[2];
+    pMsg[n].ris = rl[0];  pMsg[n].rie = ru[0];
+    pMsg[n].rjs = rl[1];  pMsg[n].rje = ru[1];
+    pMsg[n].rks = rl[2];  pMsg[n].rke = ru[2];
+
+    pMsg[n].scnt = (su[0]-sl[0]+1)*(su[1]-sl[1]+1)*(su[2]-sl[2]+1)*(NVAR);
+    pMsg[n].rcnt = (ru[0]-rl[0]+1)*(ru[1]-rl[1]+1)*(ru[2]-rl[2]+1)*(NVAR);
+
+    if((pMsg[n].send_buf = (double*)calloc_1d_array(pMsg[n].scnt,
+      sizeof(double))) == NULL)
+      ath_error("[bvals_init]: Failed to allocate neighbor send buffer\n");
+    if((pMsg[n].recv_buf = (double*)calloc_1d_array(pMsg[n].rcnt,
+      sizeof(double))) == NULL)
+      ath_error("[bvals_init]: Failed to allocate neighbor recv buffer\n");
+  }}}
+
+/* Create persistent requests for every distinct set of variables.  Masks with
+ * flags for variables that do not exist are mapped onto others in set_vars(),
+ * and are skipped here. */
+
+  sizes[0] = (pG->Nx[2] > 1) ? pG->Nx[2] + 2*nghost : 1;
+  sizes[1] = (pG->Nx[1] > 1) ? pG->Nx[1] + 2*nghost : 1;
+  sizes[2] = (pG->Nx[0] > 1) ? pG->Nx[0] + 2*nghost : 1;
+
+  for (mask=1; mask<=DIRTY_ALL; mask++) {
+    if (set_vars(mask) == 0 || mask_bv != mask) continue;
+
+/* with zero-copy, the type of a cell holds the nvar_bv variables of ConsS */
+    if (bvals_zerocopy) {
+      ierr = MPI_Type_create_indexed_block(nvar_bv,1,var_bv,MPI_DOUBLE,
+        &tmp_type);
+      ierr = MPI_Type_create_resized(tmp_type,0,sizeof(ConsS),&cell_type);
+      ierr = MPI_Type_free(&tmp_type);
+    }
+
+    for (n=0; n<NNBR; n++) {
+      if (pMsg[n].id < 0) continue;
+
+      if (bvals_zerocopy) {
+        subsizes[0] = pMsg[n].ske - pMsg[n].sks + 1;  starts[0] = pMsg[n].sks;
+        subsizes[1] = pMsg[n].sje - pMsg[n].sjs + 1;  starts[1] = pMsg[n].sjs;
+        subsizes[2] = pMsg[n].sie - pMsg[n].sis + 1;  starts[2] = pMsg[n].sis;
+        ierr = MPI_Type_create_subarray(3,sizes,subsizes,starts,MPI_ORDER_C,
+          cell_type,&send_type);
+        ierr = MPI_Type_commit(&send_type);
+
+        subsizes[0] = pMsg[n].rke - pMsg[n].rks + 1;  starts[0] = pMsg[n].rks;
+        subsizes[1] = pMsg[n].rje - pMsg[n].rjs + 1;  starts[1] = pMsg[n].rjs;
+        subsizes[2] = pMsg[n].rie - pMsg[n].ris + 1;  starts[2] = pMsg[n].ris;
+        ierr = MPI_Type_create_subarray(3,sizes,subsizes,starts,MPI_ORDER_C,
+          cell_type,&recv_type);
+        ierr = MPI_Type_commit(&recv_type);
+
+        ierr = MPI_Recv_init(&(pG->U[0][0][0]), 1, recv_type, pMsg[n].id,
+          nbr26_tag + (NNBR-1-n), pD->Comm_Domain, &(rrq[mask*NNBR+n]));
+        ierr = MPI_Send_init(&(pG->U[0][0][0]), 1, send_type, pMsg[n].id,
+          nbr26_tag + n, pD->Comm_Domain, &(srq[mask*NNBR+n]));
+
+        ierr = MPI_Type_free(&send_type);
+        ierr = MPI_Type_free(&recv_type);
+      } else {
+        ierr = MPI_Recv_init(pMsg[n].recv_buf, (pMsg[n].rcnt/(NVAR))*nvar_bv,
+          MPI_DOUBLE, pMsg[n].id, nbr26_tag + (NNBR-1-n), pD->Comm_Domain,
+          &(rrq[mask*NNBR+n]));
+        ierr = MPI_Send_init(pMsg[n].send_buf, (pMsg[n].scnt/(NVAR))*nvar_bv,
+          MPI_DOUBLE, pMsg[n].id, nbr26_tag + n, pD->Comm_Domain,
+          &(srq[mask*NNBR+n]));
+      }
+    }
+
+    if (bvals_zerocopy) ierr = MPI_Type_free(&cell_type);
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void pack_range(GridS *pG, int is, int ie, int js, int je,
+ *                              int ks, int ke, double *pSnd)
+ *  \brief Packs conserved variables in cells [ks:ke][js:je][is:ie] */
+
+static void pack_range(GridS *pG, int is, int ie, int js, int je, int ks,
+  int ke, double *pSnd)
+{
+  int i,j,k,n;
+  Real *pU;
+
+  for (k=ks; k<=ke; k++){
+    for (j=js; j<=je; j++){
+      for (i=is; i<=ie; i++){
+        pU = (Real*)&(pG->U[k][j][i]);
+        for (n=0; n<nvar_bv; n++) *(pSnd++) = pU[var_bv[n]];
+      }
+    }
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void unpack_range(GridS *pG, int is, int ie, int js, int je,
+ *                                int ks, int ke, double *pRcv)
+ *  \brief Unpacks conserved variables into cells [ks:ke][js:je][is:ie] */
+
+static void unpack_range(GridS *pG, int is, int ie, int js, int je, int ks,
+  int ke, double *pRcv)
+{
+  int i,j,k,n;
+  Real *pU;
+
+  for (k=ks; k<=ke; k++){
+    for (j=js; j<=je; j++){
+      for (i=is; i<=ie; i++){
+        pU = (Real*)&(pG->U[k][j][i]);
+        for (n=0; n<nvar_bv; n++) pU[var_bv[n]] = *(pRcv++);
+      }
+    }
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void start_nbr26(DomainS *pD)
+ *  \brief Sets physical BCs, then starts receives from and packs and starts
+ *   sends to all neighbors for the single-round exchange */
+
+static void start_nbr26(DomainS *pD)
+{
+  GridS *pG = pD->Grid;
+  NbrMsgS *pMsg = nbrD[pD->Level][pD->DomNumber];
+  MPI_Request *rrq = nbr_recv_rqD[pD->Level][pD->DomNumber];
+  MPI_Request *srq = nbr_send_rqD[pD->Level][pD->DomNumber];
+  int n,ierr;
+
+/* Physical BCs only use active cells, except at corners where they also use
+ * ghost zones that are received below.  Those corners are not sent, and are
+ * reset in finish_nbr26(). */
+
+  phys_bvals(pD);
+
+  set_vars(pG->bvals_dirty);
+  for (n=0; n<NNBR; n++) {
+    if (pMsg[n].id < 0) continue;
+    bytes_saved += (double)sizeof(double)*(pMsg[n].scnt/(NVAR))*(NVAR-nvar_bv);
+  }
+  if (nvar_bv == 0) return;
+
+  rrq += mask_bv*NNBR;
+  srq += mask_bv*NNBR;
+
+  for (n=0; n<NNBR; n++) {
+    if (pMsg[n].id < 0) continue;
+    ierr = MPI_Start(&(rrq[n]));
+  }
+
+  for (n=0; n<NNBR; n++) {
+    if (pMsg[n].id < 0) continue;
+    if (!bvals_zerocopy)
+      pack_range(pG, pMsg[n].sis, pMsg[n].sie, pMsg[n].sjs, pMsg[n].sje,
+        pMsg[n].sks, pMsg[n].ske, pMsg[n].send_buf);
+    ierr = MPI_Start(&(srq[n]));
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void finish_nbr26(DomainS *pD)
+ *  \brief Unpacks messages from all neighbors in order of arrival (or just
+ *   waits for them with zero-copy), then re-applies the x2 and x3 physical BCs
+ *   for the single-round exchange */
+
+static void finish_nbr26(DomainS *pD)
+{
+  GridS *pG = pD->Grid;
+  NbrMsgS *pMsg = nbrD[pD->Level][pD->DomNumber];
+  MPI_Request *rrq = nbr_recv_rqD[pD->Level][pD->DomNumber];
+  MPI_Request *srq = nbr_send_rqD[pD->Level][pD->DomNumber];
+  int n,nrecv=0,ierr,mIndex;
+
+  if (set_vars(pG->bvals_dirty) > 0) {
+    for (n=0; n<NNBR; n++) if (pMsg[n].id >= 0) nrecv++;
+  }
+  rrq += mask_bv*NNBR;
+  srq += mask_bv*NNBR;
+
+  if (bvals_zerocopy && nrecv > 0) {
+    ierr = timed_waitall(NNBR, rrq);
+    nrecv = 0;
+  }
+
+  for (; nrecv>0; nrecv--) {
+    ierr = timed_waitany(NNBR, rrq, &mIndex);
+    n = mIndex;
+    unpack_range(pG, pMsg[n].ris, pMsg[n].rie, pMsg[n].rjs, pMsg[n].rje,
+      pMsg[n].rks, pMsg[n].rke, pMsg[n].recv_buf);
+  }
+
+  if (nvar_bv > 0) ierr = timed_waitall(NNBR, srq);
+
+  if (pG->Nx[1] > 1) {
+    if (pG->lx2_id < 0) (*(pD->ix2_BCFun))(pG);
+    if (pG->rx2_id < 0) (*(pD->ox2_BCFun))(pG);
+  }
+  if (pG->Nx[2] > 1) {
+    if (pG->lx3_id < 0) (*(pD->ix3_BCFun))(pG);
+    if (pG->rx3_id < 0) (*(pD->ox3_BCFun))(pG);
+  }
+
+  return;
+}
 #endif /* MPI_PARALLEL */
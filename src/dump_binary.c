@@ -7,9 +7,18 @@
  *   can be read, e.g., by IDL scripts.  With SMR, dumps are made for all levels
  *   and domains, unless nlevel and ndomain are specified in <output> block.
  *
+ *   With compress=zlib, abs or rel in the <output> block (and configure
+ *   --enable-zlib) the fields are compressed, lossless or to within the error
+ *   bound tol, and the file is named .binz instead of .bin (see ath_zip.c).
+ *   The header and coordinates are the same as in a .bin file.
+ *
  * CONTAINS PUBLIC FUNCTIONS: 
  * - dump_binary() - writes either conserved or primitive variables depending
- *                 on value of pOut->out read from input block.		      */
+ *                 on value of pOut->out read from input block.
+ *
+ * PRIVATE FUNCTION PROTOTYPES:
+ * - bin_row()   - writes one row of a field, or keeps it for bin_field()
+ * - bin_field() - writes the compressed field kept by bin_row()	      */
 /*============================================================================*/
 
 #include <stdio.h>
@@ -23,6 +32,20 @@
 #include "particles/particle.h"
 #endif
 
+/* field being compressed, and # of floats in it */
+static float *zfield = NULL;
+static long zlen = 0;
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   bin_row()   - writes one row of a field, or keeps it for bin_field()
+ *   bin_field() - writes the compressed field kept by bin_row()
+ *============================================================================*/
+
+static void bin_row(float *row, const int n, FILE *fp, OutputS *pOut);
+static void bin_field(FILE *fp, OutputS *pOut);
+
+/*=========================== PUBLIC FUNCTIONS ===============================*/
 /*----------------------------------------------------------------------------*/
 /*! \fn void dump_binary(MeshS *pM, OutputS *pOut)
  *  \brief Function to write an unformatted dump of the field variables. */
@@ -75,19 +98,10 @@ void dump_binary(MeshS *pM, OutputS *pOut)
         ndata[1] = ju-jl+1;
         ndata[2] = ku-kl+1;
 
-/* calculate primitive variables, if needed */
-
-        if(strcmp(pOut->out,"prim") == 0) {
-          if((W = (PrimS***)
-            calloc_3d_array(ndata[2],ndata[1],ndata[0],sizeof(PrimS))) == NULL)
-            ath_error("[dump_bin]: failed to allocate Prim array\n");
+/* primitive variables, if needed, shared with other outputs of this cycle */
 
-          for (k=kl; k<=ku; k++) {
-          for (j=jl; j<=ju; j++) {
-          for (i=il; i<=iu; i++) {
-            W[k-kl][j-jl][i-il] = Cons_to_Prim(&(pGrid->U[k][j][i]));
-          }}}
-        }
+        if(strcmp(pOut->out,"prim") == 0)
+          W = OutPrim3(pGrid,&ndata[0],&ndata[1],&ndata[2]);
 
 /* construct filename, open file */
         if (nl>0) {
@@ -99,7 +113,7 @@ void dump_binary(MeshS *pM, OutputS *pOut)
           sprintf(pdom,"dom%d",nd);
         }
         if((fname = ath_fname(plev,pM->outfilename,plev,pdom,num_digit,
-            pOut->num,NULL,"bin")) == NULL){
+            pOut->num,NULL,(pOut->zip == zip_none) ? "bin" : "binz")) == NULL){
           ath_error("[dump_binary]: Error constructing filename\n");
         }
 
@@ -190,6 +204,12 @@ void dump_binary(MeshS *pM, OutputS *pOut)
         }
         fwrite(dataz,sizeof(float),(size_t)ndata[2],p_binfile);
 
+        if (pOut->zip != zip_none) {
+          zfield = (float*)malloc(ndata[0]*ndata[1]*ndata[2]*sizeof(float));
+          if (zfield == NULL)
+            ath_error("[dump_binary]: malloc failed for temporary array\n");
+        }
+
 /* Write cell-centered data (either conserved or primitives) */
 
         for (n=0;n<NVAR; n++) {
@@ -205,9 +225,10 @@ void dump_binary(MeshS *pM, OutputS *pOut)
               datax[i] = (float)(*pData);
 
             }
-            fwrite(datax,sizeof(float),(size_t)ndata[0],p_binfile);
+            bin_row(datax,ndata[0],p_binfile,pOut);
 
           }}
+          bin_field(p_binfile,pOut);
         }
 
 #ifdef SELF_GRAVITY
@@ -217,8 +238,9 @@ void dump_binary(MeshS *pM, OutputS *pOut)
             pData = &(pGrid->Phi[k+kl][j+jl][i+il]);
             datax[i] = (float)(*pData);
           }
-          fwrite(datax,sizeof(float),(size_t)ndata[0],p_binfile);
+          bin_row(datax,ndata[0],p_binfile,pOut);
         }}
+        bin_field(p_binfile,pOut);
 #endif
 
 #ifdef PARTICLES
@@ -228,29 +250,33 @@ void dump_binary(MeshS *pM, OutputS *pOut)
             for (i=0; i<ndata[0]; i++) {
               datax[i] = pGrid->Coup[k+kl][j+jl][i+il].grid_d;
             }
-            fwrite(datax,sizeof(float),(size_t)ndata[0],p_binfile);
+            bin_row(datax,ndata[0],p_binfile,pOut);
           }}
+          bin_field(p_binfile,pOut);
           for (k=0; k<ndata[2]; k++) {
           for (j=0; j<ndata[1]; j++) {
             for (i=0; i<ndata[0]; i++) {
               datax[i] = pGrid->Coup[k+kl][j+jl][i+il].grid_v1;
             }
-            fwrite(datax,sizeof(float),(size_t)ndata[0],p_binfile);
+            bin_row(datax,ndata[0],p_binfile,pOut);
           }}
+          bin_field(p_binfile,pOut);
           for (k=0; k<ndata[2]; k++) {
           for (j=0; j<ndata[1]; j++) {
             for (i=0; i<ndata[0]; i++) {
               datax[i] = pGrid->Coup[k+kl][j+jl][i+il].grid_v2;
             }
-            fwrite(datax,sizeof(float),(size_t)ndata[0],p_binfile);
+            bin_row(datax,ndata[0],p_binfile,pOut);
           }}
+          bin_field(p_binfile,pOut);
           for (k=0; k<ndata[2]; k++) {
           for (j=0; j<ndata[1]; j++) {
             for (i=0; i<ndata[0]; i++) {
               datax[i] = pGrid->Coup[k+kl][j+jl][i+il].grid_v3;
             }
-            fwrite(datax,sizeof(float),(size_t)ndata[0],p_binfile);
+            bin_row(datax,ndata[0],p_binfile,pOut);
           }}
+          bin_field(p_binfile,pOut);
         }
 #endif
 
@@ -259,8 +285,42 @@ void dump_binary(MeshS *pM, OutputS *pOut)
         free(datax); 
         free(datay); 
         free(dataz); 
-        if(strcmp(pOut->out,"prim") == 0) free_3d_array(W);
+        if (zfield != NULL) free(zfield);
+        zfield = NULL;
       }}
     }
   }
 }
+
+/*=========================== PRIVATE FUNCTIONS ==============================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn static void bin_row(float *row, const int n, FILE *fp, OutputS *pOut)
+ *  \brief Writes the n floats of a row of a field to fp, or, if the fields
+ *   are compressed, appends them to the field written by bin_field(). */
+
+static void bin_row(float *row, const int n, FILE *fp, OutputS *pOut)
+{
+  if (pOut->zip == zip_none) {
+    fwrite(row,sizeof(float),(size_t)n,fp);
+    return;
+  }
+  memcpy(zfield+zlen,row,n*sizeof(float));
+  zlen += n;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void bin_field(FILE *fp, OutputS *pOut)
+ *  \brief Writes the field of rows kept by bin_row() compressed to fp. */
+
+static void bin_field(FILE *fp, OutputS *pOut)
+{
+  if (pOut->zip == zip_none) return;
+#ifdef ZLIB_ENABLED
+  ath_zwrite(zfield,zlen,pOut->zip,pOut->ztol,fp);
+#endif
+  zlen = 0;
+
+  return;
+}
@@ -0,0 +1,291 @@
+#include "copyright.h"
+/*============================================================================*/
+/*! \file dump_vti.c
+ *  \brief Function to write a dump in VTK XML ImageData format.
+ *
+ * PURPOSE: Function to write a dump in VTK XML ImageData format (out_fmt=vti)
+ *   with the variables of dump_vtk().  Each Grid writes a .vti file with its
+ *   fields as raw appended data in the byte order of the host, so each field
+ *   is built in one buffer and written as is.  Rank 0 writes a .pvti file for
+ *   each Domain listing the files of its Grids, and a .vtm file listing the
+ *   .pvti files of the dump (see vtk_file.c).  With SMR, dumps are made for
+ *   all levels and domains, unless nlevel and ndomain are specified in
+ *   <output> block.  Works for BOTH conserved and primitives.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ * - dump_vti() - writes VTK XML dump (all variables).
+ *
+ * PRIVATE FUNCTION PROTOTYPES:
+ * - vti_fields() - names and # of components of the variables of the dump
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "athena.h"
+#include "prototypes.h"
+#ifdef PARTICLES
+#include "particles/particle.h"
+#endif
+
+#define VTI_MAXARR (6 + NSCALARS)
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   vti_fields() - names and # of components of the variables of the dump
+ *============================================================================*/
+
+static int vti_fields(OutputS *pOut, char name[][32], int ncomp[]);
+
+/*=========================== PUBLIC FUNCTIONS ===============================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn void dump_vti(MeshS *pM, OutputS *pOut)
+ *  \brief Writes VTK XML dump (all variables).			      */
+
+void dump_vti(MeshS *pM, OutputS *pOut)
+{
+  GridS *pGrid;
+  PrimS ***W=NULL;
+  int i,j,k,il,iu,jl,ju,kl,ku,nl,nd,m,nx[3],narr,cons;
+  int ncomp[VTI_MAXARR];
+  char names[VTI_MAXARR][32],*name[VTI_MAXARR];
+  float *data;   /* points to 3*nx[0]*nx[1]*nx[2] allocated floats */
+#if (NSCALARS > 0)
+  int n;
+#endif
+
+#ifdef WRITE_GHOST_CELLS
+  ath_error("[dump_vti]: vti files cannot include ghost cells\n");
+#endif
+
+  cons = (strcmp(pOut->out,"cons") == 0);
+  narr = vti_fields(pOut,names,ncomp);
+  for (m=0; m<narr; m++) name[m] = names[m];
+
+/* Loop over all Domains in Mesh, and output Grid data */
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      if (pM->Domain[nl][nd].Grid != NULL){
+
+/* write files if domain and level match input, or are not specified (-1) */
+      if ((pOut->nlevel == -1 || pOut->nlevel == nl) &&
+          (pOut->ndomain == -1 || pOut->ndomain == nd)){
+        pGrid = pM->Domain[nl][nd].Grid;
+
+        il = pGrid->is, iu = pGrid->ie;
+        jl = pGrid->js, ju = pGrid->je;
+        kl = pGrid->ks, ku = pGrid->ke;
+        nx[0] = iu-il+1;
+        nx[1] = ju-jl+1;
+        nx[2] = ku-kl+1;
+
+/* primitive variables, if needed, shared with other outputs of this cycle */
+
+        if (!cons) W = OutPrim3(pGrid,&nx[0],&nx[1],&nx[2]);
+
+        if((data = (float *)malloc(3*nx[0]*nx[1]*nx[2]*sizeof(float)))
+           == NULL){
+          ath_error("[dump_vti]: malloc failed for temporary array\n");
+          return;
+        }
+
+/* open file, and write header; fields follow in the order of vti_fields() */
+
+        vtk_open(pM,pOut,nl,nd,NULL,nx);
+        vti_header(pGrid->time,narr,name,ncomp);
+
+/* Write density */
+
+        m = 0;
+        for (k=kl; k<=ku; k++) {
+          for (j=jl; j<=ju; j++) {
+            for (i=il; i<=iu; i++) {
+              if (cons) data[m++] = (float)pGrid->U[k][j][i].d;
+              else      data[m++] = (float)W[k-kl][j-jl][i-il].d;
+            }
+          }
+        }
+        vti_write(data,1);
+
+/* Write momentum or velocity */
+
+        m = 0;
+        for (k=kl; k<=ku; k++) {
+          for (j=jl; j<=ju; j++) {
+            for (i=il; i<=iu; i++) {
+              if (cons) {
+                data[m++] = (float)pGrid->U[k][j][i].M1;
+                data[m++] = (float)pGrid->U[k][j][i].M2;
+                data[m++] = (float)pGrid->U[k][j][i].M3;
+              } else {
+                data[m++] = (float)W[k-kl][j-jl][i-il].V1;
+                data[m++] = (float)W[k-kl][j-jl][i-il].V2;
+                data[m++] = (float)W[k-kl][j-jl][i-il].V3;
+              }
+            }
+          }
+        }
+        vti_write(data,3);
+
+/* Write total energy or pressure */
+
+#ifndef BAROTROPIC
+        m = 0;
+        for (k=kl; k<=ku; k++) {
+          for (j=jl; j<=ju; j++) {
+            for (i=il; i<=iu; i++) {
+              if (cons) data[m++] = (float)pGrid->U[k][j][i].E;
+              else      data[m++] = (float)W[k-kl][j-jl][i-il].P;
+            }
+          }
+        }
+        vti_write(data,1);
+#endif
+
+/* Write cell centered B */
+
+#ifdef MHD
+        m = 0;
+        for (k=kl; k<=ku; k++) {
+          for (j=jl; j<=ju; j++) {
+            for (i=il; i<=iu; i++) {
+              data[m++] = (float)pGrid->U[k][j][i].B1c;
+              data[m++] = (float)pGrid->U[k][j][i].B2c;
+              data[m++] = (float)pGrid->U[k][j][i].B3c;
+            }
+          }
+        }
+        vti_write(data,3);
+#endif
+
+/* Write gravitational potential */
+
+#ifdef SELF_GRAVITY
+        m = 0;
+        for (k=kl; k<=ku; k++) {
+          for (j=jl; j<=ju; j++) {
+            for (i=il; i<=iu; i++) {
+              data[m++] = (float)pGrid->Phi[k][j][i];
+            }
+          }
+        }
+        vti_write(data,1);
+#endif
+
+/* Write binned particle grid */
+
+#ifdef PARTICLES
+        if (pOut->out_pargrid) {
+          m = 0;
+          for (k=kl; k<=ku; k++) {
+            for (j=jl; j<=ju; j++) {
+              for (i=il; i<=iu; i++) {
+                data[m++] = pGrid->Coup[k][j][i].grid_d;
+              }
+            }
+          }
+          vti_write(data,1);
+          m = 0;
+          for (k=kl; k<=ku; k++) {
+            for (j=jl; j<=ju; j++) {
+              for (i=il; i<=iu; i++) {
+                data[m++] = pGrid->Coup[k][j][i].grid_v1;
+                data[m++] = pGrid->Coup[k][j][i].grid_v2;
+                data[m++] = pGrid->Coup[k][j][i].grid_v3;
+              }
+            }
+          }
+          vti_write(data,3);
+        }
+#endif
+
+/* Write passive scalars */
+
+#if (NSCALARS > 0)
+        for (n=0; n<NSCALARS; n++){
+          m = 0;
+          for (k=kl; k<=ku; k++) {
+            for (j=jl; j<=ju; j++) {
+              for (i=il; i<=iu; i++) {
+                if (cons) data[m++] = (float)pGrid->U[k][j][i].s[n];
+                else      data[m++] = (float)W[k-kl][j-jl][i-il].r[n];
+              }
+            }
+          }
+          vti_write(data,1);
+        }
+#endif
+
+/* close file and free memory */
+
+        vti_close();
+        free(data);
+      }}
+    }
+  }
+
+/* Write the index files of all Domains dumped, including those of which
+ * rank 0 updates no Grid */
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      if ((pOut->nlevel == -1 || pOut->nlevel == nl) &&
+          (pOut->ndomain == -1 || pOut->ndomain == nd))
+        vti_index(pM,pOut,nl,nd,NULL,narr,name,ncomp);
+    }
+  }
+  vti_blocks(pM,pOut,NULL);
+
+  return;
+}
+
+/*=========================== PRIVATE FUNCTIONS ==============================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn static int vti_fields(OutputS *pOut, char name[][32], int ncomp[])
+ *  \brief Sets the names and # of components of the variables written by
+ *   dump_vti(), in the order they are written, and returns their number. */
+
+static int vti_fields(OutputS *pOut, char name[][32], int ncomp[])
+{
+  int narr=0,cons;
+#if (NSCALARS > 0)
+  int n;
+#endif
+
+  cons = (strcmp(pOut->out,"cons") == 0);
+
+  strcpy(name[narr],"density");
+  ncomp[narr++] = 1;
+  strcpy(name[narr],cons ? "momentum" : "velocity");
+  ncomp[narr++] = 3;
+#ifndef BAROTROPIC
+  strcpy(name[narr],cons ? "total_energy" : "pressure");
+  ncomp[narr++] = 1;
+#endif
+#ifdef MHD
+  strcpy(name[narr],"cell_centered_B");
+  ncomp[narr++] = 3;
+#endif
+#ifdef SELF_GRAVITY
+  strcpy(name[narr],"gravitational_potential");
+  ncomp[narr++] = 1;
+#endif
+#ifdef PARTICLES
+  if (pOut->out_pargrid) {
+    strcpy(name[narr],"particle_density");
+    ncomp[narr++] = 1;
+    strcpy(name[narr],"particle_momentum");
+    ncomp[narr++] = 3;
+  }
+#endif
+#if (NSCALARS > 0)
+  for (n=0; n<NSCALARS; n++){
+    sprintf(name[narr],cons ? "scalar[%d]" : "specific_scalar[%d]",n);
+    ncomp[narr++] = 1;
+  }
+#endif
+
+  return narr;
+}
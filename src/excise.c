@@ -0,0 +1,265 @@
+#include "copyright.h"
+/*============================================================================*/
+/*! \file excise.c
+ *  \brief Excision mask of zones held at a fixed state by the problem.
+ *
+ * PURPOSE: Excision mask of zones held at a fixed state by the problem.  A
+ *   problem generator that resets some region to a fixed state every step
+ *   (e.g. the interior of a planet) marks it with excise_grid(), fills it, and
+ *   calls excise_save().  Userwork_in_loop() then restores the region with
+ *   excise_reset() instead of recomputing it zone by zone.
+ *
+ *   Zones flagged EXCISE_INTERIOR are excised, and so is every zone within
+ *   nghost of them, so no hydrodynamic update outside the region depends on
+ *   their update: a Grid whose active zones are all interior is not
+ *   integrated at all, and Userwork_in_loop() can skip them after the reset.
+ *   Their signal speeds are those of the saved state, folded by excise_cfl().
+ *
+ *   The ionizing radiation is different: rays are marched through the
+ *   region, and read the neutral density that the chemistry updates there in
+ *   each radiation sub-step, and the chemistry and thermal time steps are
+ *   limited by its zones.  Skipping the interior zones in the radiation
+ *   kernels (excise_grid() with rad=1) is therefore an approximation: it holds
+ *   them at the saved state during the sub-steps as well, and drops them from
+ *   the radiation time step.  Results are unchanged only if the region stays
+ *   optically thick and its zones never limit the time step.  It is off
+ *   unless the problem turns it on.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ * - excise_grid()  - builds the mask of a Grid from a region function
+ * - excise_save()  - saves the state of the excised zones
+ * - excise_reset() - restores the excised zones to the saved state
+ * - excise_cfl()   - folds the signal speeds of the interior zones
+ * - excise_regrid() - rebuilds the mask and state of a Grid made by a regrid
+ * - excise_free()  - frees the mask of a Grid                               */
+/*============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "defs.h"
+#include "athena.h"
+#include "globals.h"
+#include "prototypes.h"
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   erode() - keeps the flags of zones whose neighbors along one axis are set
+ *============================================================================*/
+
+static void erode(char ***src, char ***dst, const int n[3], const int dim,
+                  const int r);
+
+/* region function and radiation flag of the last call to excise_grid(), used
+ * to rebuild the masks of new Grids in excise_regrid() */
+static ExciseFun_t ex_inside = NULL;
+static int ex_rad = 0;
+
+/*=========================== PUBLIC FUNCTIONS ===============================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn void excise_grid(GridS *pG, ExciseFun_t inside, const int rad)
+ *  \brief Flags the zones of a Grid (ghost zones included) whose centers are
+ *   inside the region, and those of them that are interior.  The ionizing
+ *   radiation skips the interior zones if rad is 1.  Leaves pG->excise NULL if
+ *   no active zone is excised. */
+
+void excise_grid(GridS *pG, ExciseFun_t inside, const int rad)
+{
+  ExciseS *pE;
+  char ***tmp1,***tmp2;
+  int i,j,k,n[3],dim;
+  Real x1,x2,x3;
+
+  ex_inside = inside;
+  ex_rad = rad;
+
+  for (dim=0; dim<3; dim++)
+    n[dim] = (pG->Nx[dim] > 1) ? pG->Nx[dim] + 2*nghost : 1;
+
+  if ((pE = (ExciseS*)calloc(1,sizeof(ExciseS))) == NULL)
+    ath_error("[excise_grid]: malloc returned a NULL pointer\n");
+  pE->flag = (char***)calloc_3d_array(n[2],n[1],n[0],sizeof(char));
+  tmp1 = (char***)calloc_3d_array(n[2],n[1],n[0],sizeof(char));
+  tmp2 = (char***)calloc_3d_array(n[2],n[1],n[0],sizeof(char));
+  if (pE->flag == NULL || tmp1 == NULL || tmp2 == NULL)
+    ath_error("[excise_grid]: malloc returned a NULL pointer\n");
+
+  for (k=0; k<n[2]; k++) {
+  for (j=0; j<n[1]; j++) {
+  for (i=0; i<n[0]; i++) {
+    cc_pos(pG,i,j,k,&x1,&x2,&x3);
+    pE->flag[k][j][i] = (*inside)(x1,x2,x3) ? EXCISE_ZONE : 0;
+  }}}
+
+/* A zone is interior if the box of zones within nghost of it is excised */
+
+  erode(pE->flag,tmp1,n,0,(pG->Nx[0] > 1) ? nghost : 0);
+  erode(tmp1,tmp2,n,1,(pG->Nx[1] > 1) ? nghost : 0);
+  erode(tmp2,tmp1,n,2,(pG->Nx[2] > 1) ? nghost : 0);
+
+  for (k=pG->ks; k<=pG->ke; k++) {
+  for (j=pG->js; j<=pG->je; j++) {
+  for (i=pG->is; i<=pG->ie; i++) {
+    if (pE->flag[k][j][i] == 0) continue;
+    pE->nzone++;
+    if (tmp1[k][j][i]) {
+      pE->flag[k][j][i] |= EXCISE_INTERIOR;
+      pE->ninterior++;
+    }
+  }}}
+  pE->all = (pE->ninterior == pG->Nx[0]*pG->Nx[1]*pG->Nx[2]);
+  pE->rad = rad;
+
+  free_3d_array(tmp1);
+  free_3d_array(tmp2);
+
+  if (pE->nzone == 0) {
+    free_3d_array(pE->flag);
+    free(pE);
+    pE = NULL;
+  }
+  pG->excise = pE;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void excise_save(GridS *pG)
+ *  \brief Saves the current state of the excised active zones, as the state
+ *   they are held at, and the signal speeds of the interior ones. */
+
+void excise_save(GridS *pG)
+{
+  ExciseS *pE = pG->excise;
+  Real vmax[3];
+  int i,j,k,n=0;
+
+  if (pE == NULL) return;
+
+  if (pE->U == NULL) {
+    pE->U = (ConsS*)calloc_1d_array(pE->nzone,sizeof(ConsS));
+    if (pE->U == NULL)
+      ath_error("[excise_save]: malloc returned a NULL pointer\n");
+  }
+
+/* Use the cache of the Grid to fold the speeds, and put it back */
+
+  for (i=0; i<3; i++) vmax[i] = pG->cfl_vmax[i];
+  cfl_reset(pG);
+  for (k=pG->ks; k<=pG->ke; k++) {
+  for (j=pG->js; j<=pG->je; j++) {
+  for (i=pG->is; i<=pG->ie; i++) {
+    if (pE->flag[k][j][i] == 0) continue;
+    pE->U[n++] = pG->U[k][j][i];
+    if (pE->flag[k][j][i] & EXCISE_INTERIOR) cfl_fold(pG,i,j,k);
+  }}}
+  for (i=0; i<3; i++) {
+    pE->vmax[i] = pG->cfl_vmax[i];
+    pG->cfl_vmax[i] = vmax[i];
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void excise_reset(GridS *pG)
+ *  \brief Restores the excised active zones to the state saved by
+ *   excise_save(). */
+
+void excise_reset(GridS *pG)
+{
+  ExciseS *pE = pG->excise;
+  int i,j,k,n=0;
+
+  if (pE == NULL) return;
+
+  for (k=pG->ks; k<=pG->ke; k++) {
+  for (j=pG->js; j<=pG->je; j++) {
+  for (i=pG->is; i<=pG->ie; i++) {
+    if (pE->flag[k][j][i]) pG->U[k][j][i] = pE->U[n++];
+  }}}
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void excise_cfl(GridS *pG)
+ *  \brief Folds the signal speeds of the interior zones, as saved by
+ *   excise_save(), into Grid->cfl_vmax[].  Callers that fold every other
+ *   zone then have the same cache as if they had folded all of them. */
+
+void excise_cfl(GridS *pG)
+{
+  int n;
+
+  if (pG->excise == NULL) return;
+
+  for (n=0; n<3; n++)
+    pG->cfl_vmax[n] = MAX(pG->cfl_vmax[n],pG->excise->vmax[n]);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void excise_regrid(GridS *pG)
+ *  \brief Builds the mask of a Grid created by a regrid (see refine_flag.c)
+ *   with the region of the last excise_grid() call, and saves its state.
+ *
+ *   Zones that were already on the level before the regrid were held at the
+ *   saved state, and the remapped data there is that state.  Zones newly
+ *   covered by the level are prolongated from the coarser level, so the state
+ *   they are held at is an interpolation of the one the problem set. */
+
+void excise_regrid(GridS *pG)
+{
+  if (ex_inside == NULL) return;
+
+  excise_grid(pG, ex_inside, ex_rad);
+  excise_save(pG);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void excise_free(GridS *pG)
+ *  \brief Frees the mask and saved state of a Grid, and sets it to NULL. */
+
+void excise_free(GridS *pG)
+{
+  ExciseS *pE = pG->excise;
+
+  if (pE == NULL) return;
+
+  free_3d_array(pE->flag);
+  if (pE->U != NULL) free_1d_array(pE->U);
+  free(pE);
+  pG->excise = NULL;
+
+  return;
+}
+
+/*=========================== PRIVATE FUNCTIONS ==============================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn static void erode(char ***src, char ***dst, const int n[3],
+ *                        const int dim, const int r)
+ *  \brief Sets dst to 1 at zones where src is set at every zone within r
+ *   along axis dim, and to 0 elsewhere (including within r of the edges). */
+
+static void erode(char ***src, char ***dst, const int n[3], const int dim,
+                  const int r)
+{
+  int i,j,k,m,ijk[3],set;
+
+  for (k=0; k<n[2]; k++) {
+  for (j=0; j<n[1]; j++) {
+  for (i=0; i<n[0]; i++) {
+    ijk[0] = i;  ijk[1] = j;  ijk[2] = k;
+    set = (ijk[dim] >= r && ijk[dim] < n[dim]-r);
+    for (m=-r; m<=r && set; m++) {
+      ijk[dim] = (dim == 0 ? i : (dim == 1 ? j : k)) + m;
+      set = (src[ijk[2]][ijk[1]][ijk[0]] != 0);
+    }
+    dst[k][j][i] = (char)set;
+  }}}
+
+  return;
+}
@@ -12,10 +12,12 @@
  *
  * CONTAINS PUBLIC FUNCTIONS: 
  * - init_grid()
+ * - grid_destruct() - frees a Grid allocated by init_grid()
  *
  * PRIVATE FUNCTION PROTOTYPES:
  * - checkOverlap() - checks for overlap of cubes, and returns overlap coords
- * - checkOverlapTouch() - same as above, but checks for overlap and/or touch */
+ * - checkOverlapTouch() - same as above, but checks for overlap and/or touch
+ * - overlap_range() - finds the Grids of a Domain that can overlap a cube    */
 /*============================================================================*/
 
 #include <math.h>
@@ -30,6 +32,7 @@
  * PRIVATE FUNCTION PROTOTYPES:
  *  checkOverlap() - checks for overlap of cubes, and returns overlap coords
  *  checkOverlapTouch() - same as above, but checks for overlap and/or touch
+ *  overlap_range() - finds the Grids of a Domain that can overlap a cube
  *============================================================================*/
 #ifdef STATIC_MESH_REFINEMENT
 /*! \fn int checkOverlap(SideS *pC1, SideS *pC2, SideS *pC3);
@@ -38,6 +41,10 @@ int checkOverlap(SideS *pC1, SideS *pC2, SideS *pC3);
 /*! \fn int checkOverlapTouch(SideS *pC1, SideS *pC2, SideS *pC3);
  *  \brief Same as above, but checks for overlap and/or touch */
 int checkOverlapTouch(SideS *pC1, SideS *pC2, SideS *pC3);
+static int grid_edge(const DomainS *pD, const int dim, const int idx,
+                     const int right, const int scale);
+static void overlap_range(const DomainS *pD, const SideS *pC, const int scale,
+                          int rng[3][2]);
 #endif
 
 /*----------------------------------------------------------------------------*/
@@ -62,6 +69,7 @@ void init_grid(MeshS *pM)
   int isDOverlap,isGOverlap,irefine,ncd,npd,dim,iGrid;
   int ncg,nCG,nMyCG,nCB[6],nMyCB[6],nb;
   int npg,nPG,nMyPG,nPB[6],nMyPB[6];
+  int rng[3][2];
 #endif
 
 /* number of dimensions in Grid. */
@@ -77,6 +85,9 @@ void init_grid(MeshS *pM)
       pG = pM->Domain[nl][nd].Grid;          /* set ptr to Grid */
 
       pG->time = pM->time;
+      pG->cfl_valid = 0;
+      pG->work_time = 0.0;
+      pG->excise = NULL;
 
 #ifdef ION_RADPLANE
       pG->Mesh = pM; /*set ptr to Mesh*/
@@ -341,11 +352,13 @@ void init_grid(MeshS *pM)
 
 /*----------------------------------------------------------------------------*/
 /* There is a child Domain that overlaps. So on the child Domain, find all the
- * Grids that overlap this Grid. */
+ * Grids that overlap this Grid.  Only the range of Grids returned by
+ * overlap_range() need to be checked. */
 
-          for (n=0; n<pCD->NGrid[2]; n++){
-          for (m=0; m<pCD->NGrid[1]; m++){
-          for (l=0; l<pCD->NGrid[0]; l++){
+          overlap_range(pCD, &G1, -2, rng);
+          for (n=rng[2][0]; n<=rng[2][1]; n++){
+          for (m=rng[1][0]; m<=rng[1][1]; m++){
+          for (l=rng[0][0]; l<=rng[0][1]; l++){
 
 /* edges of child Grid */
 /* Divide by two to check in units of this (not the child) grid coordinates */
@@ -382,6 +395,7 @@ void init_grid(MeshS *pM)
         for (ncg=0; ncg<pG->NCGrid; ncg++){
           for (dim=0; dim<6; dim++) {
             pG->CGrid[ncg].myFlx[dim] = NULL;
+            pG->CGrid[ncg].subFlx[dim] = NULL;
 #ifdef ION_RADPLANE
 	    pG->CGrid[ncg].ionFlx[dim] = NULL;
 #endif /*ION_RADPLANE*/
@@ -419,9 +433,10 @@ void init_grid(MeshS *pM)
 /* Found the Domain that overlaps, so on the child Domain check if there
  * is a Grid that overlaps */
 
-          for (n=0; n<pCD->NGrid[2]; n++){
-          for (m=0; m<pCD->NGrid[1]; m++){
-          for (l=0; l<pCD->NGrid[0]; l++){
+          overlap_range(pCD, &G1, -2, rng);
+          for (n=rng[2][0]; n<=rng[2][1]; n++){
+          for (m=rng[1][0]; m<=rng[1][1]; m++){
+          for (l=rng[0][0]; l<=rng[0][1]; l++){
 
 /* edges of child Grid */
 /* Divide by two to check in units of this (not the child) grid coordinates */
@@ -798,11 +813,13 @@ printf("Child_ID=%d DomN=%d nWordsRC=%d nWordsP=%d\n",
 
 /*----------------------------------------------------------------------------*/
 /* Found parent Domain that overlaps.  So on the parent Domain, find all the
- * Grids that overlap this Grid. */
+ * Grids that overlap this Grid.  Only the range of Grids returned by
+ * overlap_range() need to be checked. */
 
-          for (n=0; n<pPD->NGrid[2]; n++){
-          for (m=0; m<pPD->NGrid[1]; m++){
-          for (l=0; l<pPD->NGrid[0]; l++){
+          overlap_range(pPD, &G1, 2, rng);
+          for (n=rng[2][0]; n<=rng[2][1]; n++){
+          for (m=rng[1][0]; m<=rng[1][1]; m++){
+          for (l=rng[0][0]; l<=rng[0][1]; l++){
 
 /* edges of parent Grid */
 /* Multiply by two to check in units of this (not the parent) grid coord */
@@ -837,6 +854,7 @@ printf("Child_ID=%d DomN=%d nWordsRC=%d nWordsP=%d\n",
         for (npg=0; npg<pG->NPGrid; npg++){
           for (dim=0; dim<6; dim++) {
             pG->PGrid[npg].myFlx[dim] = NULL;
+            pG->PGrid[npg].subFlx[dim] = NULL;
 #ifdef ION_RADPLANE
 	    pG->PGrid[npg].ionFlx[dim] = NULL;
 #endif /*ION_RADPLANE*/
@@ -872,9 +890,10 @@ printf("Child_ID=%d DomN=%d nWordsRC=%d nWordsP=%d\n",
 /* Found the Domain that overlaps, so on the parent Domain check if there is a
  * Grid that overlaps */
 
-          for (n=0; n<pPD->NGrid[2]; n++){
-          for (m=0; m<pPD->NGrid[1]; m++){
-          for (l=0; l<pPD->NGrid[0]; l++){
+          overlap_range(pPD, &G1, 2, rng);
+          for (n=rng[2][0]; n<=rng[2][1]; n++){
+          for (m=rng[1][0]; m<=rng[1][1]; m++){
+          for (l=rng[0][0]; l<=rng[0][1]; l++){
 
 /* edges of parent Grid */
 /* Multiply by two to check in units of this (not the parent) grid coord */
@@ -984,6 +1003,12 @@ printf("Child_ID=%d DomN=%d nWordsRC=%d nWordsP=%d\n",
                       n2z,n1z, sizeof(ConsS));
                     if(pG->PGrid[npg].myFlx[2*dim] == NULL) ath_error(
                       "[init_grid]:failed to allocate PGrid ixb myFlx\n");
+                    if (pM->subcycle) {
+                      pG->PGrid[npg].subFlx[2*dim] = (ConsS**)
+                        calloc_2d_array(n2z,n1z, sizeof(ConsS));
+                      if(pG->PGrid[npg].subFlx[2*dim] == NULL) ath_error(
+                        "[init_grid]:failed to allocate PGrid ixb subFlx\n");
+                    }
 if(myID_Comm_world==0){
 printf("Allocated %d x %d array for ixb PGrid.myFlx\n",n2z,n1z);
 }
@@ -1105,6 +1130,12 @@ printf("Allocated %d x %d array for ixb PGrid.myEMF2\n",n2z,n1z+1);
                       (ConsS**)calloc_2d_array(n2z,n1z, sizeof(ConsS));
                     if(pG->PGrid[npg].myFlx[(2*dim)+1] == NULL) ath_error(
                       "[init_grid]:failed to allocate PGrid oxb myFlx\n");
+                    if (pM->subcycle) {
+                      pG->PGrid[npg].subFlx[(2*dim)+1] = (ConsS**)
+                        calloc_2d_array(n2z,n1z, sizeof(ConsS));
+                      if(pG->PGrid[npg].subFlx[(2*dim)+1] == NULL) ath_error(
+                        "[init_grid]:failed to allocate PGrid oxb subFlx\n");
+                    }
 if(myID_Comm_world==0){
 printf("Allocated %d x %d array for oxb PGrid.myFlx\n",n2z,n1z);
 }
@@ -1259,6 +1290,74 @@ printf("Parent_ID=%d DomN=%d nWordsRC=%d nWordsP=%d\n",
     ath_error("[init_grid]: Error allocating memory\n");
 }
 
+/*----------------------------------------------------------------------------*/
+/*! \fn void grid_destruct(GridS *pG)
+ *  \brief Frees all memory of a Grid allocated by init_grid(), including its
+ *   child and parent overlaps and any excised zones, and the GridS itself. */
+
+void grid_destruct(GridS *pG)
+{
+#ifdef STATIC_MESH_REFINEMENT
+  int n,dim;
+  GridOvrlpS *pO;
+#endif
+
+  if (pG == NULL) return;
+
+  free_3d_array(pG->U);
+#ifdef MHD
+  free_3d_array(pG->B1i);
+  free_3d_array(pG->B2i);
+  free_3d_array(pG->B3i);
+#endif
+#ifdef RESISTIVITY
+  free_3d_array(pG->eta_Ohm);
+  free_3d_array(pG->eta_Hall);
+  free_3d_array(pG->eta_AD);
+#endif
+#ifdef SELF_GRAVITY
+  free_3d_array(pG->Phi);
+  free_3d_array(pG->Phi_old);
+  free_3d_array(pG->x1MassFlux);
+  free_3d_array(pG->x2MassFlux);
+  free_3d_array(pG->x3MassFlux);
+#endif
+#ifdef CYLINDRICAL
+  free_1d_array(pG->r);
+  free_1d_array(pG->ri);
+#endif
+#ifdef ION_RADPLANE
+  free_3d_array(pG->EdgeFlux);
+#endif
+
+#ifdef STATIC_MESH_REFINEMENT
+/* Overlap arrays were calloc'ed, so faces without fluxes are NULL */
+
+  for (n=0; n<(pG->NCGrid + pG->NPGrid); n++) {
+    pO = (n < pG->NCGrid) ? &(pG->CGrid[n]) : &(pG->PGrid[n - pG->NCGrid]);
+    for (dim=0; dim<6; dim++) {
+      if (pO->myFlx[dim]  != NULL) free_2d_array(pO->myFlx[dim]);
+      if (pO->subFlx[dim] != NULL) free_2d_array(pO->subFlx[dim]);
+#ifdef ION_RADPLANE
+      if (pO->ionFlx[dim] != NULL) free_1d_array(pO->ionFlx[dim]);
+#endif
+#ifdef MHD
+      if (pO->myEMF1[dim] != NULL) free_2d_array(pO->myEMF1[dim]);
+      if (pO->myEMF2[dim] != NULL) free_2d_array(pO->myEMF2[dim]);
+      if (pO->myEMF3[dim] != NULL) free_2d_array(pO->myEMF3[dim]);
+#endif
+    }
+  }
+  if (pG->CGrid != NULL) free_1d_array(pG->CGrid);
+  if (pG->PGrid != NULL) free_1d_array(pG->PGrid);
+#endif /* STATIC_MESH_REFINEMENT */
+
+  if (pG->excise != NULL) excise_free(pG);
+  free(pG);
+
+  return;
+}
+
 #ifdef STATIC_MESH_REFINEMENT
 /*=========================== PRIVATE FUNCTIONS ==============================*/
 /*----------------------------------------------------------------------------*/
@@ -1332,4 +1431,73 @@ int checkOverlapTouch(SideS *pC1, SideS *pC2, SideS *pC3)
 
   return isOverlap;
 }
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int grid_edge(const DomainS *pD, const int dim, const int idx,
+ *                           const int right, const int scale)
+ *  \brief Returns the left (right=0) or right (right=1) edge in direction dim
+ *   of the idx-th Grid along dim in Domain pD.  With scale=2 the edge is in
+ *   units of the next level (pD is a parent), with scale=-2 in units of the
+ *   last level (pD is a child), as in the loops over Grids in init_grid(). */
+
+static int grid_edge(const DomainS *pD, const int dim, const int idx,
+                     const int right, const int scale)
+{
+  const GridsDataS *pGD;
+
+/* Domains are divided into Grids as a tensor product, so the edges in dim only
+ * depend on the index along dim */
+  if (dim == 0) pGD = &(pD->GData[0][0][idx]);
+  else if (dim == 1) pGD = &(pD->GData[0][idx][0]);
+  else pGD = &(pD->GData[idx][0][0]);
+
+  if (scale > 0) {
+    return right ? 2*(pGD->Disp[dim] + pGD->Nx[dim]) : 2*(pGD->Disp[dim]);
+  }
+  if (!right) return pGD->Disp[dim]/2;
+  return (pD->Nx[dim] > 1) ? (pGD->Disp[dim] + pGD->Nx[dim])/2 : 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void overlap_range(const DomainS *pD, const SideS *pC,
+ *                               const int scale, int rng[3][2])
+ *  \brief Returns in rng[dim][0..1] the first and last index along each
+ *   direction of the Grids in Domain pD that overlap cube pC in that
+ *   direction (the range is empty if rng[dim][0] > rng[dim][1]).  Edges of
+ *   Grids increase with their index, so each end is found by bisection, and
+ *   every Grid in the range overlaps pC; see grid_edge() for scale.
+ *
+ *   With thousands of Grids per Domain this replaces checking every Grid of
+ *   every overlapping Domain by a few checks per Grid that overlaps. */
+
+static void overlap_range(const DomainS *pD, const SideS *pC, const int scale,
+                          int rng[3][2])
+{
+  int dim,lo,hi,mid;
+
+  for (dim=0; dim<3; dim++) {
+
+/* first Grid with right edge > left edge of cube */
+    lo = 0;
+    hi = pD->NGrid[dim];
+    while (lo < hi) {
+      mid = (lo + hi)/2;
+      if (grid_edge(pD,dim,mid,1,scale) > pC->ijkl[dim]) hi = mid;
+      else lo = mid + 1;
+    }
+    rng[dim][0] = lo;
+
+/* last Grid with left edge < right edge of cube */
+    lo = 0;
+    hi = pD->NGrid[dim];
+    while (lo < hi) {
+      mid = (lo + hi)/2;
+      if (grid_edge(pD,dim,mid,0,scale) < pC->ijkr[dim]) lo = mid + 1;
+      else hi = mid;
+    }
+    rng[dim][1] = lo - 1;
+  }
+
+  return;
+}
 #endif /* STATIC_MESH_REFINEMENT */
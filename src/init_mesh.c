@@ -37,11 +37,38 @@
  * CONTAINS PUBLIC FUNCTIONS: 
  * - init_mesh()
  * - get_myGridIndex()							      
+ * - decomp_calibrate()
+ * - get_nGrids()      - total number of Grids in the Mesh
+ * - get_myGridID()    - index of the Grid of a Domain on this rank
+ * - rebalance_check() - plans new ranks for Grids from measured step times
  *
  * PRIVATE FUNCTION PROTOTYPES:
  * - dom_decomp()    - calls auto domain decomposition functions 
  * - dom_decomp_2d() - finds optimum domain decomposition in 2D 
- * - dom_decomp_3d() - finds optimum domain decomposition in 3D		      */
+ * - dom_decomp_3d() - finds optimum domain decomposition in 3D
+ * - grid_work()     - cells and ghost cells exchanged by one Grid
+ * - grid_cost()     - model cost of one Grid per root step
+ * - best_shape()    - cheapest division of a Domain into a given # of Grids
+ * - plan_layout()   - assigns Grids on all levels to ranks by cost
+ * - plan_decomp()   - chooses # of Grids in each Domain by cost
+ * - report_decomp() - prints predicted load imbalance of the decomposition
+ *
+ * With decomp_plan=1 in <job>, the number of Grids in Domains without an
+ * explicit NGrid_x* or AutoWithNProc is chosen by a cost model, and Grids on
+ * all levels are assigned to ranks so that the summed work on each rank is
+ * balanced (levels are integrated in sequence by the same ranks).  The model
+ * charges cost_hydro and cost_rad per cell update, and cost_comm per ghost
+ * cell exchanged; with decomp_calibrate=1, decomp_calibrate() prints values
+ * measured in a short run.  The predicted load imbalance is only printed when
+ * the planner is used or decomp_calibrate=1.
+ * With decomp_rad_dir=+-1,2,3 the planner knows the direction of planar
+ * radiation, which is swept through Grids in that direction one at a time, so
+ * the radiation work of a Grid is that of its whole pencil of Grids along the
+ * sweep.  Grids can be capped at decomp_max_cells cells to bound memory.
+ *
+ * rebalance_check() reassigns Grids to ranks by their measured step times.
+ * The new layout is applied here in Step 6 when migrate_grids() (see
+ * refine_flag.c) rebuilds the Mesh to move the Grids to their new ranks.    */
 /*============================================================================*/
 
 #include <math.h>
@@ -75,6 +102,33 @@ static int dom_decomp_2d(const int Nx, const int Ny, const int Np,
  *  \brief finds optimum domain decomposition in 3D  */
 static int dom_decomp_3d(const int Nx, const int Ny, const int Nz, const int Np,
   int *pNGx, int *pNGy, int *pNGz);
+
+static void grid_work(const DomainS *pD, const int NG[3], const int idx[3],
+  double *pcells, double *pghost);
+static double grid_cost(const DomainS *pD, const int NG[3], const int idx[3],
+  const Real wlev);
+static int best_shape(const DomainS *pD, const int P, const Real wlev,
+  int NG[3]);
+static double plan_layout(MeshS *pM, int (*NG)[3], const int Nproc,
+  const double *work, int *rank, double *load);
+static void plan_decomp(MeshS *pM, const int Nproc);
+static void report_decomp(MeshS *pM, const int Nproc);
+static int cmp_cost(const void *a, const void *b);
+
+/* Cost model of the decomposition planner, set from <job> in init_mesh() */
+static Real cost_hydro, cost_rad, cost_comm;
+
+/* Axis (0,1,2) of planar radiation sweeps or -1, and maximum cells per Grid
+ * allowed by the planner (0 for no limit), set from <job> in init_mesh() */
+static int rad_axis=-1;
+static double max_cells=0.0;
+
+/* Grid costs being sorted by cmp_cost() */
+static double *sort_cost=NULL;
+
+/* Ranks of all Grids planned by rebalance_check() and not yet applied by
+ * init_mesh(), or NULL */
+static int *next_rank=NULL, rebal_ngrid=0;
 #endif
 
 /*----------------------------------------------------------------------------*/
@@ -99,6 +153,7 @@ void init_mesh(MeshS *pM)
   DomainS *pD, *pCD;
 #ifdef MPI_PARALLEL
   int ierr,child_found,groupn,Nranks,Nranks0,max_rank,irank,*ranks;
+  int plan=0,*plan_rank,(*plan_NG)[3],*lay_rank;
   MPI_Group world_group;
 
 /* Get total # of processes, in MPI_COMM_WORLD */
@@ -111,6 +166,23 @@ void init_mesh(MeshS *pM)
   pM->nstep = 0;
   pM->outfilename = par_gets("job","problem_id");
 
+/* With SMR, each level may step with half the dt of its parent (see main.c).
+ * Only the hydro fluxes at fine/coarse boundaries are averaged over substeps
+ * (not EMFs), and the other operators below act once per root step. */
+
+  pM->subcycle = 0;
+#ifdef STATIC_MESH_REFINEMENT
+  pM->subcycle = par_geti_def("time","subcycle",0);
+#if defined(MHD) || defined(SELF_GRAVITY) || defined(PARTICLES) || defined(FARGO)
+  if (pM->subcycle)
+    ath_error("[init_mesh]: subcycle=1 not supported with MHD, self-gravity, particles or FARGO\n");
+#endif
+#if defined(RESISTIVITY) || defined(VISCOSITY) || defined(THERMAL_CONDUCTION)
+  if (pM->subcycle)
+    ath_error("[init_mesh]: subcycle=1 not supported with explicit diffusion\n");
+#endif
+#endif /* STATIC_MESH_REFINEMENT */
+
 #ifdef ION_RADPLANE
   /*Initialize the planar ionizing radiation source*/
   pM->radplanelist=(Radplane*)calloc(1,sizeof(Radplane));
@@ -509,6 +581,25 @@ nl,next_domainid[nl],pM->DomainsPerLevel[nl]);
 
   next_procID = 0;  /* start assigning processors to Grids at ID=0 */
 
+#ifdef MPI_PARALLEL
+  cost_hydro = par_getd_def("job","cost_hydro",1.0);
+#ifdef ION_RADIATION
+  cost_rad = par_getd_def("job","cost_rad",1.0);
+#else
+  cost_rad = par_getd_def("job","cost_rad",0.0);
+#endif
+  cost_comm = par_getd_def("job","cost_comm",0.1);
+  max_cells = par_getd_def("job","decomp_max_cells",0.0);
+#ifdef ION_RADPLANE
+  i = par_geti_def("job","decomp_rad_dir",0);
+  if (i < -3 || i > 3)
+    ath_error("[init_mesh]: decomp_rad_dir=%d must be 0, +-1, 2, or 3\n",i);
+  rad_axis = (i == 0) ? -1 : abs(i) - 1;
+#endif
+  plan = par_geti_def("job","decomp_plan",0);
+  if (plan) plan_decomp(pM, Nproc_Comm_world);
+#endif /* MPI_PARALLEL */
+
   for (nl=0; nl<=maxlevel; nl++){
     for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
       pD = (DomainS*)&(pM->Domain[nl][nd]);  /* set ptr to this Domain */
@@ -655,12 +746,101 @@ nl,next_domainid[nl],pM->DomainsPerLevel[nl]);
     }  /* end loop over ndomains */
   }    /* end loop over nlevels */
 
+/* With the planner, reassign Grids to ranks by cost.  Every rank must still
+ * hold at least one Grid. */
+
+#ifdef MPI_PARALLEL
+  if (plan) {
+    nproc = 0;
+    for (nl=0; nl<=maxlevel; nl++) nproc += pM->DomainsPerLevel[nl];
+    plan_NG = (int(*)[3])calloc_1d_array(nproc,3*sizeof(int));
+    plan_rank = (int*)calloc_1d_array(nproc*Nproc_Comm_world,sizeof(int));
+    if (plan_NG == NULL || plan_rank == NULL)
+      ath_error("[init_mesh]: malloc returned a NULL pointer\n");
+
+    irank = 0;
+    for (nl=0; nl<=maxlevel; nl++){
+      for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+        for (i=0; i<3; i++) plan_NG[irank][i] = pM->Domain[nl][nd].NGrid[i];
+        irank++;
+      }
+    }
+    plan_layout(pM, plan_NG, Nproc_Comm_world, NULL, plan_rank, NULL);
+
+    irank = 0;
+    for (nl=0; nl<=maxlevel; nl++){
+      for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+        pD = (DomainS*)&(pM->Domain[nl][nd]);
+        for(n=0; n<(pD->NGrid[2]); n++){
+        for(m=0; m<(pD->NGrid[1]); m++){
+        for(l=0; l<(pD->NGrid[0]); l++){
+          pD->GData[n][m][l].ID_Comm_world = plan_rank[irank++];
+        }}}
+      }
+    }
+    free_1d_array(plan_NG);
+    free_1d_array(plan_rank);
+    if (irank < Nproc_Comm_world)
+      ath_error("[init_mesh]: %d Grids planned for %d MPI procs\n",irank,
+        Nproc_Comm_world);
+    next_procID = 0;
+  }
+
+/* On restart, Grids go to the ranks recorded with the restart files, which
+ * differ from the above after a load rebalance (unless the restart is to be
+ * repartitioned over the Grids set above) */
+
+  lay_rank = restart_grid_ranks(pM);
+  if (lay_rank != NULL) {
+    irank = 0;
+    for (nl=0; nl<=maxlevel; nl++){
+      for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+        pD = (DomainS*)&(pM->Domain[nl][nd]);
+        for(n=0; n<(pD->NGrid[2]); n++){
+        for(m=0; m<(pD->NGrid[1]); m++){
+        for(l=0; l<(pD->NGrid[0]); l++){
+          pD->GData[n][m][l].ID_Comm_world = lay_rank[irank++];
+        }}}
+      }
+    }
+    next_procID = 0;
+  }
+
+/* When the Mesh is rebuilt by migrate_grids(), Grids go to the ranks planned
+ * by rebalance_check() */
+
+  if (next_rank != NULL) {
+    if (get_nGrids(pM) != rebal_ngrid)
+      ath_error("[init_mesh]: %d Grids planned by rebalance_check(), %d in Mesh\n",
+        rebal_ngrid,get_nGrids(pM));
+    irank = 0;
+    for (nl=0; nl<=maxlevel; nl++){
+      for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+        pD = (DomainS*)&(pM->Domain[nl][nd]);
+        for(n=0; n<(pD->NGrid[2]); n++){
+        for(m=0; m<(pD->NGrid[1]); m++){
+        for(l=0; l<(pD->NGrid[0]); l++){
+          pD->GData[n][m][l].ID_Comm_world = next_rank[irank++];
+        }}}
+      }
+    }
+    free_1d_array(next_rank);
+    next_rank = NULL;
+    next_procID = 0;
+  }
+#endif /* MPI_PARALLEL */
+
 /* check that total number of Grids was partitioned evenly over total number of
  * MPI processes available (equal to one for single processor jobs) */ 
 
   if (next_procID != 0)
     ath_error("[init_mesh]:total # of Grids != total # of MPI procs\n");
 
+#ifdef MPI_PARALLEL
+  if (plan || par_geti_def("job","decomp_calibrate",0))
+    report_decomp(pM, Nproc_Comm_world);
+#endif
+
 /*--- Step 7: Allocate a Grid for each Domain on this processor --------------*/
 
   for (nl=0; nl<=maxlevel; nl++){
@@ -824,7 +1004,7 @@ printf("WorldID=%d Domain_CommID=%d\n",myID_Comm_world,myrank);
             groupn++;
             Nranks++;
           } else {
-            pCD->GData[n][m][l].ID_Comm_Parent = ranks[irank];
+            pCD->GData[n][m][l].ID_Comm_Parent = irank;
           }
 	  /* fprintf(stderr, "nl%d, nd%d, ID_Comm_world: %d, ID_Comm_Domain %d, ID_Comm_Parent %d \n", nl, nd, pD->GData[n][m][l].ID_Comm_world, pD->GData[n][m][l].ID_Comm_Domain, pD->GData[n][m][l].ID_Comm_Parent, n, m, l); */
         }}}
@@ -900,6 +1080,184 @@ void get_myGridIndex(DomainS *pD, const int myID,
   ath_error("[get_myGridIndex]: Can't find ID=%i in GData\n", myID);
 }
 
+#ifdef MPI_PARALLEL
+/*----------------------------------------------------------------------------*/
+/*! \fn void decomp_calibrate(MeshS *pM, const double t_hydro,
+ *                   const double t_rad, const double t_comm, const int nstep)
+ *  \brief Prints the cost model of the decomposition planner measured from
+ *   the time spent by this run in the integrator, radiation transfer and
+ *   waiting on boundary messages (each summed over nstep steps on this rank).
+ *   The costs are normalized to cost_hydro=1 and can be copied into <job>. */
+
+void decomp_calibrate(MeshS *pM, const double t_hydro, const double t_rad,
+                      const double t_comm, const int nstep)
+{
+  DomainS *pD;
+  int nl,nd,idx[3],ierr;
+  double cells,ghost,wlev,my_work[5],work[5],c_hydro;
+
+  my_work[0] = t_hydro;
+  my_work[1] = t_rad;
+  my_work[2] = t_comm;
+  my_work[3] = my_work[4] = 0.0;
+  for (nl=0; nl<(pM->NLevels); nl++){
+    wlev = pM->subcycle ? (double)(1<<nl) : 1.0;
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      pD = (DomainS*)&(pM->Domain[nl][nd]);
+      if (pD->Grid == NULL) continue;
+      get_myGridIndex(pD, myID_Comm_world, &idx[0], &idx[1], &idx[2]);
+      grid_work(pD, pD->NGrid, idx, &cells, &ghost);
+      my_work[3] += wlev*cells;
+      my_work[4] += wlev*ghost*nghost;
+    }
+  }
+
+  ierr = MPI_Allreduce(my_work, work, 5, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  if (nstep <= 0 || work[0] <= 0.0 || work[3] <= 0.0) return;
+
+  c_hydro = work[0]/(work[3]*nstep);
+  ath_pout(0,"\ndecomp_plan cost model from this run: cost_hydro = 1.0");
+  ath_pout(0,"  cost_rad = %e",work[1]/(work[3]*nstep)/c_hydro);
+  ath_pout(0,"  cost_comm = %e\n",
+    work[4] > 0.0 ? work[2]/(work[4]*nstep)/c_hydro : 0.0);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn int get_nGrids(MeshS *pM)
+ *  \brief Returns the total number of Grids in all Domains of the Mesh. */
+
+int get_nGrids(MeshS *pM)
+{
+  int nl,nd,ng=0;
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      ng += pM->Domain[nl][nd].NGrid[0]*pM->Domain[nl][nd].NGrid[1]*
+            pM->Domain[nl][nd].NGrid[2];
+    }
+  }
+  return ng;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn int get_myGridID(MeshS *pM, const int nl, const int nd)
+ *  \brief Returns the index of the Grid of Domain[nl][nd] on this rank among
+ *   all Grids of the Mesh, counted level by level, Domain by Domain, and in
+ *   GData order within each Domain; or -1 if there is no such Grid. */
+
+int get_myGridID(MeshS *pM, const int nl, const int nd)
+{
+  DomainS *pD;
+  int i,d,n,m,l,g=0;
+
+  for (i=0; i<=nl; i++){
+    for (d=0; d<(pM->DomainsPerLevel[i]); d++){
+      pD = (DomainS*)&(pM->Domain[i][d]);
+      if (i == nl && d == nd) {
+        for(n=0; n<(pD->NGrid[2]); n++){
+        for(m=0; m<(pD->NGrid[1]); m++){
+        for(l=0; l<(pD->NGrid[0]); l++){
+          if (pD->GData[n][m][l].ID_Comm_world == myID_Comm_world) return g;
+          g++;
+        }}}
+        return -1;
+      }
+      g += pD->NGrid[0]*pD->NGrid[1]*pD->NGrid[2];
+    }
+  }
+  return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn int rebalance_check(MeshS *pM, const Real threshold)
+ *  \brief Gathers the wall time spent stepping each Grid since the last call
+ *   (GridS.work_time, which is reset here).  If the load imbalance (max/mean
+ *   over ranks) exceeds threshold, Grids are reassigned to ranks by these
+ *   times with plan_layout().  Returns 1 if the new layout lowers the maximum
+ *   load by at least 5%, in which case it is applied by the next init_mesh()
+ *   (see migrate_grids()); else 0.  Must be called by all ranks. */
+
+int rebalance_check(MeshS *pM, const Real threshold)
+{
+  DomainS *pD;
+  int nl,nd,n,m,l,g,r,id,ng,ndom=0,Nproc,ierr,ret=0,*rank;
+  int (*NG)[3];
+  double *my_work,*work,*ld,lmax=0.0,lsum=0.0,lnew;
+
+  ierr = MPI_Comm_size(MPI_COMM_WORLD, &Nproc);
+  for (nl=0; nl<(pM->NLevels); nl++) ndom += pM->DomainsPerLevel[nl];
+  ng = get_nGrids(pM);
+  my_work = (double*)calloc_1d_array(ng,sizeof(double));
+  work = (double*)calloc_1d_array(ng,sizeof(double));
+  ld = (double*)calloc_1d_array(Nproc,sizeof(double));
+  NG = (int(*)[3])calloc_1d_array(ndom,3*sizeof(int));
+  if (my_work == NULL || work == NULL || ld == NULL || NG == NULL)
+    ath_error("[rebalance_check]: malloc returned a NULL pointer\n");
+
+  id = 0;
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      pD = (DomainS*)&(pM->Domain[nl][nd]);
+      for (l=0; l<3; l++) NG[id][l] = pD->NGrid[l];
+      id++;
+      if (pD->Grid != NULL) {
+        my_work[get_myGridID(pM,nl,nd)] = pD->Grid->work_time;
+        pD->Grid->work_time = 0.0;
+      }
+    }
+  }
+  ierr = MPI_Allreduce(my_work, work, ng, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+/* Load of each rank in the current layout.  Every Grid is charged some time,
+ * so that plan_layout() leaves no rank without a Grid. */
+
+  g = 0;
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      pD = (DomainS*)&(pM->Domain[nl][nd]);
+      for(n=0; n<(pD->NGrid[2]); n++){
+      for(m=0; m<(pD->NGrid[1]); m++){
+      for(l=0; l<(pD->NGrid[0]); l++){
+        work[g] = MAX(work[g],1.0e-9);
+        ld[pD->GData[n][m][l].ID_Comm_world] += work[g];
+        g++;
+      }}}
+    }
+  }
+  for (r=0; r<Nproc; r++){
+    lmax = MAX(lmax,ld[r]);
+    lsum += ld[r];
+  }
+  ath_pout(1,"[rebalance_check]: measured load imbalance (max/mean) = %5.3f\n",
+    lmax*Nproc/lsum);
+
+  if (lmax*Nproc > threshold*lsum) {
+    rank = (int*)calloc_1d_array(ng,sizeof(int));
+    if (rank == NULL)
+      ath_error("[rebalance_check]: malloc returned a NULL pointer\n");
+    lnew = plan_layout(pM, NG, Nproc, work, rank, NULL);
+    if (lnew > 0.0 && lnew < 0.95*lmax) {
+      ath_pout(0,"[rebalance_check]: load imbalance (max/mean) %5.3f -> %5.3f\n",
+        lmax*Nproc/lsum, lnew*Nproc/lsum);
+      if (next_rank != NULL) free_1d_array(next_rank);
+      next_rank = rank;
+      rebal_ngrid = ng;
+      ret = 1;
+    } else {
+      free_1d_array(rank);
+    }
+  }
+
+  free_1d_array(my_work);
+  free_1d_array(work);
+  free_1d_array(ld);
+  free_1d_array(NG);
+  return ret;
+}
+#endif /* MPI_PARALLEL */
+
 #ifdef MPI_PARALLEL
 /*=========================== PRIVATE FUNCTIONS ==============================*/
 /*! \fn static int dom_decomp(const int Nx, const int Ny, const int Nz,
@@ -1076,4 +1434,392 @@ static int dom_decomp_3d(const int Nx, const int Ny, const int Nz,
   return 0;
 }
 
+/*----------------------------------------------------------------------------*/
+/*! \fn static void grid_work(const DomainS *pD, const int NG[3],
+ *                   const int idx[3], double *pcells, double *pghost)
+ *  \brief Returns the number of cells in Grid idx[] of Domain pD divided into
+ *   NG[] Grids, and the number of cells (per ghost layer) on faces exchanged
+ *   with other Grids.  Faces at the boundary of a Domain at level>0 are filled
+ *   by Prolongate() and are also counted.  Extra cells go to the first Grid in
+ *   each direction, as in init_mesh(). */
+
+static void grid_work(const DomainS *pD, const int NG[3], const int idx[3],
+                      double *pcells, double *pghost)
+{
+  int i,nx[3];
+  div_t xdiv;
+  double area;
+
+  for (i=0; i<3; i++){
+    xdiv = div(pD->Nx[i], NG[i]);
+    nx[i] = xdiv.quot + (idx[i] == 0 ? xdiv.rem : 0);
+  }
+  *pcells = (double)nx[0]*(double)nx[1]*(double)nx[2];
+
+  *pghost = 0.0;
+  for (i=0; i<3; i++){
+    if (pD->Nx[i] <= 1) continue;
+    area = *pcells/(double)nx[i];
+    if (idx[i] > 0 || pD->Level > 0) *pghost += area;
+    if (idx[i] < NG[i]-1 || pD->Level > 0) *pghost += area;
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static double grid_cost(const DomainS *pD, const int NG[3],
+ *                                const int idx[3], const Real wlev)
+ *  \brief Model cost of Grid idx[] of Domain pD divided into NG[] Grids, for
+ *   wlev updates of its level per root step.  With a radiation direction the
+ *   Grid is busy or waiting for the radiation of its whole pencil. */
+
+static double grid_cost(const DomainS *pD, const int NG[3], const int idx[3],
+                        const Real wlev)
+{
+  double cells,ghost,rad;
+
+  grid_work(pD, NG, idx, &cells, &ghost);
+  rad = (rad_axis < 0) ? cells : cells*(double)NG[rad_axis];
+  return wlev*(cells*cost_hydro + rad*cost_rad + cost_comm*nghost*ghost);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int best_shape(const DomainS *pD, const int P, const Real wlev,
+ *                             int NG[3])
+ *  \brief Finds the division of Domain pD into P Grids with the smallest
+ *   maximum (then total) Grid cost.  Grids must be at least nghost cells wide,
+ *   and have at most max_cells cells.  Returns 1 if there is no such division*/
+
+static int best_shape(const DomainS *pD, const int P, const Real wlev,
+                      int NG[3])
+{
+  int g1,g2,g3,n,m,l,idx[3],NGt[3],found=0;
+  double c,cmax,ctot,best_max=0.0,best_tot=0.0,cells,ghost;
+
+  for (g1=1; g1<=P; g1++){
+    if (P % g1 != 0 || (g1 > 1 && pD->Nx[0]/g1 < nghost)) continue;
+    for (g2=1; g2<=P/g1; g2++){
+      if ((P/g1) % g2 != 0 || (g2 > 1 && pD->Nx[1]/g2 < nghost)) continue;
+      g3 = P/(g1*g2);
+      if (g3 > 1 && pD->Nx[2]/g3 < nghost) continue;
+
+      NGt[0] = g1;  NGt[1] = g2;  NGt[2] = g3;
+      if (max_cells > 0.0) {
+        idx[0] = idx[1] = idx[2] = 0;  /* first Grid is the largest */
+        grid_work(pD, NGt, idx, &cells, &ghost);
+        if (cells > max_cells) continue;
+      }
+      cmax = ctot = 0.0;
+      for (n=0; n<g3; n++){
+      for (m=0; m<g2; m++){
+      for (l=0; l<g1; l++){
+        idx[0] = l;  idx[1] = m;  idx[2] = n;
+        c = grid_cost(pD, NGt, idx, wlev);
+        cmax = MAX(cmax,c);
+        ctot += c;
+      }}}
+
+      if (!found || cmax < best_max || (cmax == best_max && ctot < best_tot)){
+        NG[0] = g1;  NG[1] = g2;  NG[2] = g3;
+        best_max = cmax;
+        best_tot = ctot;
+        found = 1;
+      }
+    }
+  }
+
+  return (found ? 0 : 1);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static double plan_layout(MeshS *pM, int (*NG)[3], const int Nproc,
+ *                   const double *work, int *rank, double *load)
+ *  \brief Assigns the Grids of all Domains (divided into NG[id] Grids, where
+ *   id counts Domains level by level) to Nproc ranks, largest cost first, each
+ *   to the least loaded rank without a Grid of the same Domain.  The cost of
+ *   each Grid is taken from work[] (in GData order) if not NULL, else from
+ *   grid_cost().  Ranks are
+ *   returned in rank[] in the order Grids are stored in GData, and the load of
+ *   each rank in load[] (if not NULL).  Returns the maximum load, or -1 if
+ *   there are fewer Grids than ranks.  A Domain with more Grids than ranks is
+ *   a fatal error. */
+
+static double plan_layout(MeshS *pM, int (*NG)[3], const int Nproc,
+                          const double *work, int *rank, double *load)
+{
+  DomainS *pD;
+  int nl,nd,id,ndom=0,ng=0,g,i,r,best,n,m,l,idx[3];
+  int *dom,*order;
+  char *has;
+  double *cost,*ld,lmax=0.0;
+  Real wlev;
+
+/* A Domain with more Grids than ranks would leave a Grid without a rank */
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      n = NG[ndom][0]*NG[ndom][1]*NG[ndom][2];
+      if (n > Nproc)
+        ath_error("[plan_layout]: %d Grids requested by block domain%d and only %d procs\n",
+          n,pM->Domain[nl][nd].InputBlock,Nproc);
+      ng += n;
+      ndom++;
+    }
+  }
+  if (ng < Nproc) return -1.0;
+
+  cost = (double*)calloc_1d_array(ng,sizeof(double));
+  dom = (int*)calloc_1d_array(ng,sizeof(int));
+  order = (int*)calloc_1d_array(ng,sizeof(int));
+  has = (char*)calloc_1d_array(Nproc*ndom,sizeof(char));
+  ld = (load != NULL) ? load : (double*)calloc_1d_array(Nproc,sizeof(double));
+  if (cost == NULL || dom == NULL || order == NULL || has == NULL || ld == NULL)
+    ath_error("[plan_layout]: malloc returned a NULL pointer\n");
+
+  g = 0;
+  id = 0;
+  for (nl=0; nl<(pM->NLevels); nl++){
+    wlev = pM->subcycle ? (Real)(1<<nl) : 1.0;
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      pD = (DomainS*)&(pM->Domain[nl][nd]);
+      for(n=0; n<NG[id][2]; n++){
+      for(m=0; m<NG[id][1]; m++){
+      for(l=0; l<NG[id][0]; l++){
+        idx[0] = l;  idx[1] = m;  idx[2] = n;
+        cost[g] = (work != NULL) ? work[g] : grid_cost(pD, NG[id], idx, wlev);
+        dom[g] = id;
+        order[g] = g;
+        g++;
+      }}}
+      id++;
+    }
+  }
+
+  sort_cost = cost;
+  qsort(order, ng, sizeof(int), cmp_cost);
+
+  for (r=0; r<Nproc; r++) ld[r] = 0.0;
+  for (g=0; g<ng; g++){
+    i = order[g];
+    best = -1;
+    for (r=0; r<Nproc; r++){
+      if (has[r*ndom + dom[i]]) continue;
+      if (best < 0 || ld[r] < ld[best]) best = r;
+    }
+    rank[i] = best;
+    ld[best] += cost[i];
+    has[best*ndom + dom[i]] = 1;
+  }
+  for (r=0; r<Nproc; r++) lmax = MAX(lmax,ld[r]);
+
+  free_1d_array(cost);
+  free_1d_array(dom);
+  free_1d_array(order);
+  free_1d_array(has);
+  if (load == NULL) free_1d_array(ld);
+
+  return lmax;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void plan_decomp(MeshS *pM, const int Nproc)
+ *  \brief Chooses the number of Grids in each Domain that has neither
+ *   NGrid_x* nor AutoWithNProc in its input block, to minimize the maximum
+ *   load over ranks returned by plan_layout().  Starting from Nproc Grids in
+ *   each such Domain, a few candidate counts are tried for one Domain at a
+ *   time.  The result is stored as NGrid_x* in the par database. */
+
+static void plan_decomp(MeshS *pM, const int Nproc)
+{
+  DomainS *pD;
+  char block[80];
+  int nl,nd,id,ndom=0,i,k,pass,ncand,P,cand[11],NGt[3],NGbest[3];
+  int *fixed,*rank,(*NG)[3];
+  Real wlev;
+  double c,best,total=0.0,*dwork;
+
+  for (nl=0; nl<(pM->NLevels); nl++) ndom += pM->DomainsPerLevel[nl];
+  NG = (int(*)[3])calloc_1d_array(ndom,3*sizeof(int));
+  fixed = (int*)calloc_1d_array(ndom,sizeof(int));
+  dwork = (double*)calloc_1d_array(ndom,sizeof(double));
+  rank = (int*)calloc_1d_array(ndom*Nproc,sizeof(int));
+  if (NG == NULL || fixed == NULL || dwork == NULL || rank == NULL)
+    ath_error("[plan_decomp]: malloc returned a NULL pointer\n");
+
+/* Domains decomposed by hand or by AutoWithNProc keep their layout */
+
+  id = 0;
+  for (nl=0; nl<(pM->NLevels); nl++){
+    wlev = pM->subcycle ? (Real)(1<<nl) : 1.0;
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      pD = (DomainS*)&(pM->Domain[nl][nd]);
+      sprintf(block,"domain%d",pD->InputBlock);
+      dwork[id] = wlev*(double)pD->Nx[0]*(double)pD->Nx[1]*(double)pD->Nx[2];
+      total += dwork[id];
+      fixed[id] = 1;
+      P = par_geti_def(block,"AutoWithNProc",0);
+      if (P > 0) {
+        if (dom_decomp(pD->Nx[0],pD->Nx[1],pD->Nx[2],P,
+            &(NG[id][0]),&(NG[id][1]),&(NG[id][2])))
+          ath_error("[init_mesh]: Error in automatic Domain decomposition\n");
+      } else if (par_exist(block,"NGrid_x1") || par_exist(block,"NGrid_x2") ||
+                 par_exist(block,"NGrid_x3")) {
+        NG[id][0] = par_geti_def(block,"NGrid_x1",1);
+        NG[id][1] = par_geti_def(block,"NGrid_x2",1);
+        NG[id][2] = par_geti_def(block,"NGrid_x3",1);
+      } else {
+        fixed[id] = 0;
+        for (P=Nproc; P>0; P--) if (best_shape(pD,P,wlev,NG[id]) == 0) break;
+        if (P == 0) ath_error(
+          "[init_mesh]: no decomposition of %s fits decomp_max_cells\n",block);
+      }
+      id++;
+    }
+  }
+
+/* Try Nproc/k Grids (k=1..8), and a share of Nproc proportional to the cells
+ * in the Domain, for each free Domain in turn */
+
+  best = plan_layout(pM, NG, Nproc, NULL, rank, NULL);
+  for (pass=0; pass<2; pass++){
+    id = 0;
+    for (nl=0; nl<(pM->NLevels); nl++){
+      wlev = pM->subcycle ? (Real)(1<<nl) : 1.0;
+      for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++, id++){
+        if (fixed[id]) continue;
+        pD = (DomainS*)&(pM->Domain[nl][nd]);
+        ncand = 0;
+        for (k=1; k<=8; k++) cand[ncand++] = (Nproc + k - 1)/k;
+        P = (int)(Nproc*dwork[id]/total + 0.5);
+        for (k=-1; k<=1; k++) cand[ncand++] = MIN(MAX(P+k,1),Nproc);
+
+        for (i=0; i<3; i++) NGbest[i] = NG[id][i];
+        for (k=0; k<ncand; k++){
+          if (best_shape(pD,cand[k],wlev,NGt)) continue;
+          for (i=0; i<3; i++) NG[id][i] = NGt[i];
+          c = plan_layout(pM, NG, Nproc, NULL, rank, NULL);
+          if (c >= 0.0 && (best < 0.0 || c < best*(1.0 - 1.0e-12))){
+            best = c;
+            for (i=0; i<3; i++) NGbest[i] = NGt[i];
+          }
+        }
+        for (i=0; i<3; i++) NG[id][i] = NGbest[i];
+      }
+    }
+  }
+  if (best < 0.0)
+    ath_error("[init_mesh]: decomp_plan found no layout with a Grid on each of %d procs\n",Nproc);
+
+/* Store the planned decomposition in the par database */
+
+  id = 0;
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++, id++){
+      if (fixed[id]) continue;
+      sprintf(block,"domain%d",pM->Domain[nl][nd].InputBlock);
+      par_seti(block,"NGrid_x1","%d",NG[id][0],"x1 decomp");
+      par_seti(block,"NGrid_x2","%d",NG[id][1],"x2 decomp");
+      par_seti(block,"NGrid_x3","%d",NG[id][2],"x3 decomp");
+    }
+  }
+
+  free_1d_array(NG);
+  free_1d_array(fixed);
+  free_1d_array(dwork);
+  free_1d_array(rank);
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void report_decomp(MeshS *pM, const int Nproc)
+ *  \brief Prints the model work per root step on the most loaded rank and on
+ *   average, for the whole Mesh and for each level, for the Grids as assigned
+ *   to ranks in GData.  With a radiation direction, also prints the length of
+ *   the radiation critical path in each Domain. */
+
+static void report_decomp(MeshS *pM, const int Nproc)
+{
+  DomainS *pD;
+  int nl,nd,n,m,l,r,idx[3];
+  double *ld,*ld_lev,lmax,lsum,path;
+  Real wlev;
+
+  ld = (double*)calloc_1d_array(Nproc,sizeof(double));
+  ld_lev = (double*)calloc_1d_array(Nproc,sizeof(double));
+  if (ld == NULL || ld_lev == NULL)
+    ath_error("[report_decomp]: malloc returned a NULL pointer\n");
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    wlev = pM->subcycle ? (Real)(1<<nl) : 1.0;
+    for (r=0; r<Nproc; r++) ld_lev[r] = 0.0;
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      pD = (DomainS*)&(pM->Domain[nl][nd]);
+      for(n=0; n<(pD->NGrid[2]); n++){
+      for(m=0; m<(pD->NGrid[1]); m++){
+      for(l=0; l<(pD->NGrid[0]); l++){
+        idx[0] = l;  idx[1] = m;  idx[2] = n;
+        ld_lev[pD->GData[n][m][l].ID_Comm_world] +=
+          grid_cost(pD, pD->NGrid, idx, wlev);
+      }}}
+    }
+    lmax = lsum = 0.0;
+    for (r=0; r<Nproc; r++){
+      lmax = MAX(lmax,ld_lev[r]);
+      lsum += ld_lev[r];
+      ld[r] += ld_lev[r];
+    }
+    ath_pout(0,"[init_mesh]: level %d predicted work max=%e mean=%e\n",nl,
+      lmax,lsum/Nproc);
+  }
+
+  lmax = lsum = 0.0;
+  for (r=0; r<Nproc; r++){
+    lmax = MAX(lmax,ld[r]);
+    lsum += ld[r];
+  }
+  ath_pout(0,"[init_mesh]: predicted load imbalance (max/mean) = %5.3f\n",
+    lsum > 0.0 ? lmax*Nproc/lsum : 1.0);
+
+/* Radiation critical path: the largest pencil of Grids swept in sequence in
+ * each Domain (extra cells are on the first Grid in each direction) */
+
+  if (rad_axis >= 0) {
+    lsum = 0.0;
+    for (nl=0; nl<(pM->NLevels); nl++){
+      wlev = pM->subcycle ? (Real)(1<<nl) : 1.0;
+      for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+        pD = (DomainS*)&(pM->Domain[nl][nd]);
+        path = (double)pD->Nx[rad_axis];
+        for (l=0; l<3; l++){
+          if (l == rad_axis) continue;
+          path *= (double)(pD->Nx[l]/pD->NGrid[l] + pD->Nx[l]%pD->NGrid[l]);
+        }
+        ath_pout(0,"[init_mesh]: level %d domain %d radiation critical path = %d Grids, %e cells\n",
+          nl,nd,pD->NGrid[rad_axis],path);
+        lsum += wlev*cost_rad*path;
+      }
+    }
+    ath_pout(0,"[init_mesh]: radiation critical path work per root step = %e (%5.3f of max load)\n",
+      lsum, lmax > 0.0 ? lsum/lmax : 0.0);
+  }
+
+  free_1d_array(ld);
+  free_1d_array(ld_lev);
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int cmp_cost(const void *a, const void *b)
+ *  \brief qsort comparator ordering Grid indices by decreasing sort_cost[] */
+
+static int cmp_cost(const void *a, const void *b)
+{
+  int i = *(const int*)a, j = *(const int*)b;
+
+  if (sort_cost[i] > sort_cost[j]) return -1;
+  if (sort_cost[i] < sort_cost[j]) return 1;
+  return (i - j);
+}
+
 #endif /* MPI_PARALLEL */
@@ -3,6 +3,10 @@
 /*! \file integrate.c
  *  \brief Contains public functions to set integrator.
  *
+ * A Grid whose active zones are all in the interior of an excised region (see
+ *   excise.c) is not integrated: every zone it would update is reset by the
+ *   problem, and no zone outside it depends on them.
+ *
  * CONTAINS PUBLIC FUNCTIONS: 
  * - integrate_init()        - set pointer to integrate function based on dim
  * - integrate_destruct()    - call destruct integrate function based on dim */
@@ -17,6 +21,15 @@
 
 /* dimension of calculation (determined at runtime) */
 static int dim=0;
+/* integrator for this dimension, called by integrate_grid() */
+static VDFun_t integrate_fun=NULL;
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   integrate_grid() - calls the integrator unless the Grid is excised
+ *============================================================================*/
+
+static void integrate_grid(DomainS *pD);
 
 /*----------------------------------------------------------------------------*/
 /*! \fn VDFun_t integrate_init(MeshS *pM)
@@ -36,12 +49,14 @@ VDFun_t integrate_init(MeshS *pM)
     if(pM->Nx[0] <= 1) break;
     integrate_init_1d(pM);
 #if defined(CTU_INTEGRATOR)
-    return integrate_1d_ctu;
+    integrate_fun = integrate_1d_ctu;
+    return integrate_grid;
 #elif defined(VL_INTEGRATOR)
     cfl = par_getd("time","cour_no");
     if (cfl > 0.5)
       ath_error("<time>cour_no=%e, must be <= 0.5 with 1D VL integrator\n",cfl);
-    return integrate_1d_vl;
+    integrate_fun = integrate_1d_vl;
+    return integrate_grid;
 #else
     ath_err("[integrate_init]: Invalid integrator defined for 1D problem");
 #endif
@@ -50,12 +65,14 @@ VDFun_t integrate_init(MeshS *pM)
     if(pM->Nx[2] > 1) break;
     integrate_init_2d(pM);
 #if defined(CTU_INTEGRATOR)
-    return integrate_2d_ctu;
+    integrate_fun = integrate_2d_ctu;
+    return integrate_grid;
 #elif defined(VL_INTEGRATOR)
     cfl = par_getd("time","cour_no");
     if (cfl > 0.5)
       ath_error("<time>cour_no=%e, must be <= 0.5 with 2D VL integrator\n",cfl);
-    return integrate_2d_vl;
+    integrate_fun = integrate_2d_vl;
+    return integrate_grid;
 #else
     ath_err("[integrate_init]: Invalid integrator defined for 2D problem");
 #endif
@@ -66,12 +83,14 @@ VDFun_t integrate_init(MeshS *pM)
     cfl = par_getd("time","cour_no");
     if (cfl > 0.5)
       ath_error("<time>cour_no=%e, must be <= 0.5 with 3D CTU integrator\n",cfl);
-    return integrate_3d_ctu;
+    integrate_fun = integrate_3d_ctu;
+    return integrate_grid;
 #elif defined(VL_INTEGRATOR)
     cfl = par_getd("time","cour_no");
     if (cfl > 0.5)
       ath_error("<time>cour_no=%e, must be <= 0.5 with 3D VL integrator\n",cfl);
-    return integrate_3d_vl;
+    integrate_fun = integrate_3d_vl;
+    return integrate_grid;
 #else
     ath_err("[integrate_init]: Invalid integrator defined for 3D problem");
 #endif
@@ -106,3 +125,16 @@ void integrate_destruct()
 
   ath_error("[integrate_destruct]: Grid dimension = %d\n",dim);
 }
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void integrate_grid(DomainS *pD)
+ *  \brief Calls the integrator, unless all active zones of the Grid are
+ *   interior zones of an excised region */
+static void integrate_grid(DomainS *pD)
+{
+  if (pD->Grid->excise != NULL && pD->Grid->excise->all) {
+    pD->Grid->cfl_valid = 0;
+    return;
+  }
+  (*integrate_fun)(pD);
+}
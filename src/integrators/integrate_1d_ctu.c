@@ -528,9 +528,12 @@ void integrate_1d_ctu(DomainS *pD)
 /*=== STEP 12: Update cell-centered values for a full timestep ===============*/
 
 /*--- Step 12a -----------------------------------------------------------------
- * Update cell-centered variables in pG using 1D x1-fluxes
+ * Update cell-centered variables in pG using 1D x1-fluxes.  This is the last
+ * write to each zone, so the CFL signal speeds used by new_dt() are folded in
+ * here while the zone is still in cache.
  */
 
+  cfl_reset(pG);
   for (i=is; i<=ie; i++) {
 #ifdef CYLINDRICAL
     rsf = ri[i+1]/r[i];  lsf = ri[i]/r[i];
@@ -553,7 +556,9 @@ void integrate_1d_ctu(DomainS *pD)
     for (n=0; n<NSCALARS; n++)
       pG->U[ks][js][i].s[n] -= dtodx1*(rsf*x1Flux[i+1].s[n] - lsf*x1Flux[i].s[n]);
 #endif
+    cfl_fold(pG,i,js,ks);
   }
+  pG->cfl_valid = 1;
 
 /*--- Step 12b: Not needed in 1D ---*/
 /*--- Step 12c: Not needed in 1D ---*/
@@ -315,9 +315,12 @@ void integrate_1d_vl(DomainS *pD)
 /*=== STEP 13: Update cell-centered values for a full timestep ===============*/
 
 /*--- Step 13a -----------------------------------------------------------------
- * Update cell-centered variables in pG (including B2c and B3c) using x1-Fluxes
+ * Update cell-centered variables in pG (including B2c and B3c) using x1-Fluxes.
+ * This is the last write to each zone, so the CFL signal speeds used by
+ * new_dt() are folded in here while the zone is still in cache.
  */
 
+  cfl_reset(pG);
   for (i=is; i<=ie; i++) {
     pG->U[ks][js][i].d  -= dtodx1*(x1Flux[i+1].d  - x1Flux[i].d );
     pG->U[ks][js][i].M1 -= dtodx1*(x1Flux[i+1].Mx - x1Flux[i].Mx);
@@ -337,7 +340,9 @@ void integrate_1d_vl(DomainS *pD)
     for (n=0; n<NSCALARS; n++)
       pG->U[ks][js][i].s[n] -= dtodx1*(x1Flux[i+1].s[n] - x1Flux[i].s[n]);
 #endif
+    cfl_fold(pG,i,js,ks);
   }
+  pG->cfl_valid = 1;
 
 #ifdef STATIC_MESH_REFINEMENT
 /*--- Step 13d -----------------------------------------------------------------
@@ -1673,9 +1673,12 @@ void integrate_2d_ctu(DomainS *pD)
   }
 
 /*--- Step 12b -----------------------------------------------------------------
- * Update cell-centered variables in pG using 2D x2-fluxes
+ * Update cell-centered variables in pG using 2D x2-fluxes.  This is the last
+ * write to each zone (for hydro), so the CFL signal speeds used by new_dt()
+ * are folded in here while the zone is still in cache.
  */
 
+  cfl_reset(pG);
   for (j=js; j<=je; j++) {
     for (i=is; i<=ie; i++) {
 #ifdef CYLINDRICAL
@@ -1696,13 +1699,17 @@ void integrate_2d_ctu(DomainS *pD)
       for (n=0; n<NSCALARS; n++)
         pG->U[ks][j][i].s[n] -= dtodx2*(x2Flux[j+1][i].s[n] 
                                          - x2Flux[j  ][i].s[n]);
+#endif
+#ifndef MHD
+      cfl_fold(pG,i,j,ks);
 #endif
     }
   }
 
 /*--- Step 12c: Not needed in 2D ---*/
 /*--- Step 12d -----------------------------------------------------------------
- * Set cell centered magnetic fields to average of updated face centered fields.
+ * Set cell centered magnetic fields to average of updated face centered fields,
+ * and fold the CFL signal speeds with MHD.
  */
 
 #ifdef MHD
@@ -1715,9 +1722,11 @@ void integrate_2d_ctu(DomainS *pD)
       pG->U[ks][j][i].B2c =0.5*(    pG->B2i[ks][j][i] +     pG->B2i[ks][j+1][i]);
 /* Set the 3-interface magnetic field equal to the cell center field. */
       pG->B3i[ks][j][i] = pG->U[ks][j][i].B3c;
+      cfl_fold(pG,i,j,ks);
     }
   }
 #endif /* MHD */
+  pG->cfl_valid = 1;
 
 #ifdef STATIC_MESH_REFINEMENT
 /*--- Step 12e -----------------------------------------------------------------
@@ -821,9 +821,12 @@ void integrate_2d_vl(DomainS *pD)
   }
 
 /*--- Step 13b -----------------------------------------------------------------
- * Update cell-centered variables in pG (including B3c) using 2D x2-Fluxes
+ * Update cell-centered variables in pG (including B3c) using 2D x2-Fluxes.
+ * This is the last write to each zone (unless it is corrected in Step 14), so
+ * the CFL signal speeds used by new_dt() are folded in here.
  */
 
+  cfl_reset(pG);
   for (j=js; j<=je; j++) {
     for (i=is; i<=ie; i++) {
       pG->U[ks][j][i].d   -= dtodx2*(x2Flux[j+1][i].d  - x2Flux[j][i].d );
@@ -841,8 +844,10 @@ void integrate_2d_vl(DomainS *pD)
         pG->U[ks][j][i].s[n] -= dtodx2*(x2Flux[j+1][i].s[n]
                                       - x2Flux[j  ][i].s[n]);
 #endif
+      cfl_fold(pG,i,j,ks);
     }
   }
+  pG->cfl_valid = 1;
 
 #ifdef FIRST_ORDER_FLUX_CORRECTION
 /*=== STEP 14: First-order flux correction ===================================*/
@@ -874,8 +879,11 @@ void integrate_2d_vl(DomainS *pD)
     }
   }
 
-  if (negd > 0 || negP > 0)
+  if (negd > 0 || negP > 0) {
     printf("[Step14]: %i cells had d<0; %i cells had P<0\n",negd,negP);
+/* FixCell() changes zones already folded, so leave them to new_dt() */
+    pG->cfl_valid = 0;
+  }
 #endif /* FIRST_ORDER_FLUX_CORRECTION */
 
 #ifdef STATIC_MESH_REFINEMENT
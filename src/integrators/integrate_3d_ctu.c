@@ -3027,9 +3027,12 @@ void integrate_3d_ctu(DomainS *pD)
   }
 
 /*--- Step 12c -----------------------------------------------------------------
- * Update cell-centered variables in pG using 3D x3-Fluxes
+ * Update cell-centered variables in pG using 3D x3-Fluxes.  This is the last
+ * write to each zone (for hydro), so the CFL signal speeds used by new_dt()
+ * are folded in here while the zone is still in cache.
  */
 
+  cfl_reset(pG);
   for (k=ks; k<=ke; k++) {
     for (j=js; j<=je; j++) {
       for (i=is; i<=ie; i++) {
@@ -3044,13 +3047,17 @@ void integrate_3d_ctu(DomainS *pD)
         for (n=0; n<NSCALARS; n++)
           pG->U[k][j][i].s[n] -= dtodx3*(x3Flux[k+1][j][i].s[n]
                                        - x3Flux[k  ][j][i].s[n]);
+#endif
+#ifndef MHD
+        cfl_fold(pG,i,j,k);
 #endif
       }
     }
   }
 
 /*--- Step 12d -----------------------------------------------------------------
- * Set cell centered magnetic fields to average of updated face centered fields.
+ * Set cell centered magnetic fields to average of updated face centered fields,
+ * and fold the CFL signal speeds with MHD.
  */
 
 #ifdef MHD
@@ -3063,10 +3070,12 @@ void integrate_3d_ctu(DomainS *pD)
         pG->U[k][j][i].B1c = 0.5*(lsf*pG->B1i[k][j][i] + rsf*pG->B1i[k][j][i+1]);
         pG->U[k][j][i].B2c = 0.5*(    pG->B2i[k][j][i] +     pG->B2i[k][j+1][i]);
         pG->U[k][j][i].B3c = 0.5*(    pG->B3i[k][j][i] +     pG->B3i[k+1][j][i]);
+        cfl_fold(pG,i,j,k);
       }
     }
   }
 #endif /* MHD */
+  pG->cfl_valid = 1;
 
 #ifdef STATIC_MESH_REFINEMENT
 /*--- Step 12e -----------------------------------------------------------------
@@ -1224,9 +1224,12 @@ void integrate_3d_vl(DomainS *pD)
   }
 
 /*--- Step 13c -----------------------------------------------------------------
- * Update cell-centered variables in pG using 3D x3-Fluxes
+ * Update cell-centered variables in pG using 3D x3-Fluxes.  This is the last
+ * write to each zone (unless it is corrected in Step 14), so the CFL signal
+ * speeds used by new_dt() are folded in here.
  */
 
+  cfl_reset(pG);
   for (k=ks; k<=ke; k++) {
     for (j=js; j<=je; j++) {
       for (i=is; i<=ie; i++) {
@@ -1242,9 +1245,11 @@ void integrate_3d_vl(DomainS *pD)
           pG->U[k][j][i].s[n] -= dtodx3*(x3Flux[k+1][j][i].s[n]
                                        - x3Flux[k  ][j][i].s[n]);
 #endif
+        cfl_fold(pG,i,j,k);
       }
     }
   }
+  pG->cfl_valid = 1;
 
 #ifdef FIRST_ORDER_FLUX_CORRECTION
 /*=== STEP 14: First-order flux correction ===================================*/
@@ -1278,8 +1283,11 @@ void integrate_3d_vl(DomainS *pD)
     }
   }
 
-  if (negd > 0 || negP > 0)
+  if (negd > 0 || negP > 0) {
     printf("[Step14]: %i cells had d<0; %i cells had P<0\n",negd,negP);
+/* FixCell() changes zones already folded, so leave them to new_dt() */
+    pG->cfl_valid = 0;
+  }
 #endif /* FIRST_ORDER_FLUX_CORRECTION */
 
 #ifdef STATIC_MESH_REFINEMENT
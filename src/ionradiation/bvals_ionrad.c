@@ -12,7 +12,8 @@
  *
  * CONTAINS PUBLIC FUNCTIONS: 
  * - bvals_ionrad(DomainS *pD) - calls appropriate functions to set ghost cells
- * - bvals_ionrad_init(MeshS *pM) - sets function pointers used by bvals_ionrad*/
+ * - bvals_ionrad_init(MeshS *pM) - sets function pointers used by bvals_ionrad
+ * - bvals_ionrad_destruct() - clears those pointers before the Mesh is rebuilt*/
 /*============================================================================*/
 
 #include <stdio.h>
@@ -291,6 +292,24 @@ void bvals_ionrad_init(MeshS *pM)
 }
 
 
+/*----------------------------------------------------------------------------*/
+/*! \fn void bvals_ionrad_destruct(void)
+ *  \brief Clears the function pointers set by bvals_ionrad_init(), so that
+ *   they are chosen again from the Grids held after the Mesh is rebuilt.
+ */
+
+void bvals_ionrad_destruct(void)
+{
+  ix1_radBCFun = NULL;
+  ox1_radBCFun = NULL;
+  ix2_radBCFun = NULL;
+  ox2_radBCFun = NULL;
+  ix3_radBCFun = NULL;
+  ox3_radBCFun = NULL;
+
+  return;
+}
+
 /*=========================== PRIVATE FUNCTIONS ==============================*/
 /* Following are the functions:
  *   outflow_??? where ???=[ix1,ox1,ix2,ox2,ix3,ox3]
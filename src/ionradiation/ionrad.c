@@ -10,6 +10,8 @@
  *                            radiative transfer function
  *   ion_radtransfer_init_domain() - sets domain information for ionizing
  *                                   radiative transfer module
+ *   ion_radtransfer_destruct() - frees memory allocated by
+ *                                ion_radtransfer_init()
  *============================================================================*/
 
 #include <stdio.h>
@@ -148,4 +150,11 @@ VDFun_t ion_radtransfer_init(MeshS *pM, int ires){
   return NULL;
 }
 
+void ion_radtransfer_destruct(void){
+
+  /* Only the 3D module allocates memory */
+  if (dim == 3) ion_radtransfer_destruct_3d();
+  return;
+}
+
 #endif /* ION_RADIATION */
@@ -14,6 +14,7 @@
  *                                      update
  *   ion_radtransfer_init_3d        - handles internal initialization
  *   ion_radtransfer_init_domain_3d - handles internal initialization
+ *   ion_radtransfer_destruct_3d    - frees memory of internal initialization
  *============================================================================*/
 
 #include <math.h>
@@ -66,7 +67,14 @@ void ph_rate_init(GridS *pGrid)
   }
 }
 
-/* Routine to floor temperatures */
+/* If the problem opts in (see excise.c), the per-zone routines below skip
+   the interior of an excised region, holding it at its saved state during
+   the radiation sub-steps too.  This is an approximation: rays are still
+   marched through those zones. */
+
+/* Routine to floor temperatures.  This is the last change to E in each
+   radiation sub-step, so the CFL signal speeds are folded into
+   pGrid->cfl_vmax here for compute_dt_hydro(). */
 void apply_temp_floor(GridS *pGrid) {
   int i,j,k;
   Real e_sp, e_thermal, ke, T, x, n_H, n_Hplus, n_e;
@@ -74,9 +82,12 @@ void apply_temp_floor(GridS *pGrid) {
   Real be;
 #endif
 
+  cfl_reset(pGrid);
+  if (pGrid->excise != NULL && pGrid->excise->rad) excise_cfl(pGrid);
   for (k=pGrid->ks; k<=pGrid->ke; k++) {
     for (j=pGrid->js; j<=pGrid->je; j++) {
       for (i=pGrid->is; i<=pGrid->ie; i++) {
+	if (EXCISE_RAD_SKIP(pGrid,i,j,k)) continue;
 
 	/* Compute temperature */
 	n_H = pGrid->U[k][j][i].s[0] / m_H;
@@ -130,6 +141,7 @@ void apply_temp_floor(GridS *pGrid) {
 	    + e_sp * pGrid->U[k][j][i].d;
 	}
 
+	cfl_fold(pGrid,i,j,k);
       }
     }
   }
@@ -144,6 +156,7 @@ void apply_neutral_floor(GridS *pGrid) {
   for (k=pGrid->ks; k<=pGrid->ke; k++) {
     for (j=pGrid->js; j<=pGrid->je; j++) {
       for (i=pGrid->is; i<=pGrid->ie; i++) {
+	if (EXCISE_RAD_SKIP(pGrid,i,j,k)) continue;
 	d_nlim = pGrid->U[k][j][i].d*IONFRACFLOOR;
 	d_nlim = d_nlim < d_nlo ? d_nlim : d_nlo;
 	if (pGrid->U[k][j][i].s[0] < d_nlim) {
@@ -167,6 +180,7 @@ void save_energy_and_x(GridS *pGrid)
   for (k=pGrid->ks; k<=pGrid->ke; k++) {
     for (j=pGrid->js; j<=pGrid->je; j++) {
       for (i=pGrid->is; i<=pGrid->ie; i++) {
+	if (EXCISE_RAD_SKIP(pGrid,i,j,k)) continue;
 
 	/* Compute thermal energy */
 	e_thermal = pGrid->U[k][j][i].E - 0.5 *
@@ -218,6 +232,7 @@ int check_range(DomainS *pDomain) {
   for (k=pGrid->ks; k<=pGrid->ke; k++) {
     for (j=pGrid->js; j<=pGrid->je; j++) {
       for (i=pGrid->is; i<=pGrid->ie; i++) {
+	if (EXCISE_RAD_SKIP(pGrid,i,j,k)) continue;
 
 	/* Check D type condition */
 	n_H = pGrid->U[k][j][i].s[0] / m_H;
@@ -307,6 +322,7 @@ Real compute_chem_rates(DomainS *pDomain)
   for (k=pGrid->ks; k<=pGrid->ke; k++) {
     for (j=pGrid->js; j<=pGrid->je; j++) {
       for (i=pGrid->is; i<=pGrid->ie; i++) {
+	if (EXCISE_RAD_SKIP(pGrid,i,j,k)) continue;
 
 
 	/* Get species abundances */
@@ -433,6 +449,7 @@ Real compute_therm_rates(DomainS *pDomain)
   for (k=pGrid->ks; k<=pGrid->ke; k++) {
     for (j=pGrid->js; j<=pGrid->je; j++) {
       for (i=pGrid->is; i<=pGrid->ie; i++) {
+	if (EXCISE_RAD_SKIP(pGrid,i,j,k)) continue;
 
 	/* Get species abundances */
 	n_H = pGrid->U[k][j][i].s[0] / m_H;
@@ -570,6 +587,7 @@ void ionization_update(GridS *pGrid, Real dt)
   for (k=pGrid->ks; k<=pGrid->ke; k++) {
     for (j=pGrid->js; j<=pGrid->je; j++) {
       for (i=pGrid->is; i<=pGrid->ie; i++) {
+	if (EXCISE_RAD_SKIP(pGrid,i,j,k)) continue;
 
 	d_nlim = pGrid->U[k][j][i].d*IONFRACFLOOR;
 	d_nlim = d_nlim < d_nlo ? d_nlim : d_nlo;
@@ -590,80 +608,24 @@ void ionization_update(GridS *pGrid, Real dt)
 }
 
 
+/* Hydro time step from the signal speeds folded by the last call to
+   apply_temp_floor(); d, M and B are not changed by the radiation update */
 Real compute_dt_hydro(DomainS *pDomain) {
   GridS *pGrid = pDomain->Grid;
-  int i,j,k;
-  Real di,v1,v2,v3,qsq,p,asq,cf1sq,cf2sq,cf3sq,max_dti=0.0,dt;
-#ifdef MHD
-  Real b1,b2,b3,bsq,tsum,tdif;
-#endif /* MHD */
+  Real max_dti=0.0,dt;
 #ifdef MPI_PARALLEL
   MPI_Comm Comm_Domain = pDomain->Comm_Domain;
   Real dt_glob;
   int err;
 #endif /* MPI_PARALLEL */
 
-  for (k=pGrid->ks; k<=pGrid->ke; k++) {
-    for (j=pGrid->js; j<=pGrid->je; j++) {
-      for (i=pGrid->is; i<=pGrid->ie; i++) {
-	di = 1.0/(pGrid->U[k][j][i].d);
-	v1 = pGrid->U[k][j][i].M1*di;
-	v2 = pGrid->U[k][j][i].M2*di;
-	v3 = pGrid->U[k][j][i].M3*di;
-	qsq = v1*v1 + v2*v2 + v3*v3;
-
-#ifdef MHD
-	/* Use maximum of face-centered fields (always larger than
-	   cell-centered B) */
-	b1 = pGrid->U[k][j][i].B1c 
-	  + fabs((double)(pGrid->B1i[k][j][i] - pGrid->U[k][j][i].B1c));
-	b2 = pGrid->U[k][j][i].B2c 
-	  + fabs((double)(pGrid->B2i[k][j][i] - pGrid->U[k][j][i].B2c));
-	b3 = pGrid->U[k][j][i].B3c 
-	  + fabs((double)(pGrid->B3i[k][j][i] - pGrid->U[k][j][i].B3c));
-	bsq = b1*b1 + b2*b2 + b3*b3;
-	/* compute sound speed squared */
-#ifdef ADIABATIC
-	p = MAX(Gamma_1*(pGrid->U[k][j][i].E - 0.5*pGrid->U[k][j][i].d*qsq
-			 - 0.5*bsq), TINY_NUMBER);
-	asq = Gamma*p*di;
-#else
-	asq = Iso_csound2;
-#endif /* ADIABATIC */
-	/* compute fast magnetosonic speed squared in each direction */
-	tsum = bsq*di + asq;
-	tdif = bsq*di - asq;
-	cf1sq = 0.5*(tsum + sqrt(tdif*tdif + 4.0*asq*(b2*b2+b3*b3)*di));
-	cf2sq = 0.5*(tsum + sqrt(tdif*tdif + 4.0*asq*(b1*b1+b3*b3)*di));
-	cf3sq = 0.5*(tsum + sqrt(tdif*tdif + 4.0*asq*(b1*b1+b2*b2)*di));
-	
-#else /* MHD */
-	
-	/* compute sound speed squared */
-#ifdef ADIABATIC
-	p = MAX(Gamma_1*(pGrid->U[k][j][i].E - 0.5*pGrid->U[k][j][i].d*qsq),
-		TINY_NUMBER);
-	asq = Gamma*p*di;
-#else
-	asq = Iso_csound2;
-#endif /* ADIABATIC */
-	/* compute fast magnetosonic speed squared in each direction */
-	cf1sq = asq;
-	cf2sq = asq;
-	cf3sq = asq;
-	
-#endif /* MHD */
-
-	/* compute maximum inverse of dt (corresponding to minimum dt) */
-	if (pGrid->Nx[0] > 1)
-	  max_dti = MAX(max_dti,(fabs(v1)+sqrt((double)cf1sq))/pGrid->dx1);
-	if (pGrid->Nx[1] > 1)
-	  max_dti = MAX(max_dti,(fabs(v2)+sqrt((double)cf2sq))/pGrid->dx2);
-	if (pGrid->Nx[2] > 1)
-	  max_dti = MAX(max_dti,(fabs(v3)+sqrt((double)cf3sq))/pGrid->dx3);
-      }
-    }
-  }
+  /* compute maximum inverse of dt (corresponding to minimum dt) */
+  if (pGrid->Nx[0] > 1)
+    max_dti = MAX(max_dti,pGrid->cfl_vmax[0]/pGrid->dx1);
+  if (pGrid->Nx[1] > 1)
+    max_dti = MAX(max_dti,pGrid->cfl_vmax[1]/pGrid->dx2);
+  if (pGrid->Nx[2] > 1)
+    max_dti = MAX(max_dti,pGrid->cfl_vmax[2]/pGrid->dx3);
 
   /* get timestep. */
   dt = CourNo/max_dti;
@@ -814,6 +776,32 @@ void ion_radtransfer_init_3d(GridS *pGrid, DomainS *pDomain, int ires, int sizei
 }
 
 
+/* Frees the rate arrays allocated by ion_radtransfer_init_3d(), so that it
+ * can be called again when the Grids change size (see refine_flag.c) */
+
+void ion_radtransfer_destruct_3d(void) {
+
+  if (ph_rate != NULL) free_3d_array(ph_rate);
+  if (edot != NULL) free_3d_array(edot);
+  if (nHdot != NULL) free_3d_array(nHdot);
+  if (last_sign != NULL) free_3d_array(last_sign);
+  if (sign_count != NULL) free_3d_array(sign_count);
+  if (e_init != NULL) free_3d_array(e_init);
+  if (e_th_init != NULL) free_3d_array(e_th_init);
+  if (x_init != NULL) free_3d_array(x_init);
+  ph_rate = NULL;
+  edot = NULL;
+  nHdot = NULL;
+  last_sign = NULL;
+  sign_count = NULL;
+  e_init = NULL;
+  e_th_init = NULL;
+  x_init = NULL;
+
+  return;
+}
+
+
 void ion_radtransfer_init_domain_3d(GridS *pGrid, DomainS *pDomain) {
 
   /*A Tripathi 06/01/12: CHECK to see if this is correct and/or necessary*/
@@ -843,6 +831,10 @@ void set_coarse_time(){
 #endif
 }
 
+Real get_coarse_time(){
+  return tcoarse;
+}
+
 void clear_coarse_time(){
 #ifdef MPI_PARALLEL
   MPI_Barrier(MPI_COMM_WORLD);
@@ -863,7 +855,7 @@ void ion_radtransfer_3d(DomainS *pDomain)
 {
   MeshS *pMesh = pDomain->Mesh;
   GridS *pGrid = pDomain->Grid;
-  Real dt_chem, dt_therm, dt_hydro, dt, dt_done;
+  Real dt_chem, dt_therm, dt_hydro, dt, dt_done, tlevel;
   int n, niter, hydro_done;
   int nchem, ntherm;
   int finegrid, coarsetime_done;
@@ -881,10 +873,18 @@ void ion_radtransfer_3d(DomainS *pDomain)
   /*Set the finegrid flag if on level number > 0*/
   if(pDomain->Level != 0) finegrid = 1;
 
+  /*Fine grids run to the coarse time step, or with SMR subcycling to their
+    own level time step set by the main loop*/
+  tlevel = tcoarse;
+  if (pMesh->subcycle) tlevel = pGrid->dt;
+
 #ifdef STATIC_MESH_REFINEMENT
   if (finegrid) { 
     /*If not on root domain, go to the receive function.  Send call in line 1046*/
-    ionrad_prolong_rcv(pGrid, dim, pDomain->Level, pDomain->DomNumber);
+    /*With subcycling the parent sends once per parent step, and the
+      EdgeFlux received on the first substep is reused on the second*/
+    if (!pMesh->subcycle || pGrid->substep == 0)
+      ionrad_prolong_rcv(pGrid, dim, pDomain->Level, pDomain->DomNumber);
   }
   else { 
     /*AT 4/3/13: This step may be redundant, given the existence of the clear_coarse_time called in the main.*/
@@ -892,6 +892,10 @@ void ion_radtransfer_3d(DomainS *pDomain)
   } /*AT 11/19/12: Will need to fix placement of calls to be valid for MPI+-SMR*/
 #endif
 
+  /* Only the energy and neutral density are changed, so only these need to
+     be exchanged in the next call to bvals_mhd() */
+  pGrid->bvals_dirty |= (DIRTY_E | DIRTY_S);
+
   /* Set all temperatures below the floor to the floor */
   apply_temp_floor(pGrid);
 
@@ -955,8 +959,8 @@ void ion_radtransfer_3d(DomainS *pDomain)
     /* If necessary and on a fine grid, scale back time step to avoid 
        exceeding coarse time step. */
     } else {
-       if (dt_done + dt >tcoarse) {
-	dt = tcoarse - dt_done;
+       if (dt_done + dt >tlevel) {
+	dt = tlevel - dt_done;
 	coarsetime_done = 1;
        }
     }
@@ -1030,7 +1034,8 @@ void ion_radtransfer_3d(DomainS *pDomain)
 
     /*Set mesh timestep equal to grid timestep*/
     /*AT:4/15/13: Moved outside of !finegrid conditional*/
-    pMesh->dt = pGrid->dt;
+    /*With subcycling the fine grid steps are fractions of the mesh step*/
+    if (!finegrid || !pMesh->subcycle) pMesh->dt = pGrid->dt;
 
 #ifdef STATIC_MESH_REFINEMENT
   /*Send radiation flux to finer grids that overlap*/
@@ -28,19 +28,23 @@
 /* bvals_ionrad.c  */
 void bvals_ionrad_init(MeshS *pM);
 void bvals_ionrad(DomainS *pDomain);
+void bvals_ionrad_destruct(void);
 
 /*----------------------------------------------------------------------------*/
 /* ionrad.c */
 void ion_radtransfer_init_domain(MeshS *pM);
 VDFun_t ion_radtransfer_init(MeshS *pM, int ires);
+void ion_radtransfer_destruct(void);
 
 /*----------------------------------------------------------------------------*/
 /* ionrad_3d.c */
 void ion_radtransfer_3d(DomainS *pD);
 void ion_radtransfer_init_3d(GridS *pG, DomainS *pD, int ires, int sizei, int sizej, int sizek);
 void ion_radtransfer_init_domain_3d(GridS *pG, DomainS *pD);
+void ion_radtransfer_destruct_3d(void);
 void set_coarse_time();
 void clear_coarse_time();
+Real get_coarse_time();
 
 /*----------------------------------------------------------------------------*/
 /* ionrad_chemistry.c */
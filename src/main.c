@@ -30,7 +30,9 @@
  * See the GNU General Public License for usage restrictions. 
  *									        
  * PRIVATE FUNCTION PROTOTYPES:
+ * - advance_level() - advances one SMR level, subcycling finer levels
  * - change_rundir() - creates and outputs data to new directory
+ * - finish_bvals()  - finishes boundary exchanges of a range of levels
  * - usage()         - outputs help message and terminates execution	      */
 /*============================================================================*/
 static char *athena_version = "version 4.0 - 01-Jul-2010";
@@ -59,10 +61,18 @@ static char *athena_version = "version 4.0 - 01-Jul-2010";
 
 /*==============================================================================
  * PRIVATE FUNCTION PROTOTYPES:
+ *   advance_level - advances one SMR level, subcycling finer levels
  *   change_rundir - creates and outputs data to new directory
+ *   finish_bvals  - finishes boundary exchanges of a range of levels
  *   usage         - outputs help message and terminates execution
  *============================================================================*/
+#ifdef STATIC_MESH_REFINEMENT
+static void advance_level(MeshS *pM, const int nl, const int substep,
+                          const int first, const int last,
+                          VDFun_t Integrate, VDFun_t RadTransfer);
+#endif
 static void change_rundir(const char *name);
+static void finish_bvals(MeshS *pM, const int nlmin, const int nlmax);
 static void usage(const char *prog);
 
 /* Maximum number of mkdir() and chdir() file operations that will be executed
@@ -71,6 +81,12 @@ static void usage(const char *prog);
  */ 
 #define MAX_FILE_OP 256
 
+#ifdef MPI_PARALLEL
+/* Time spent in the integrator and in radiation transfer on this rank, used
+ * to calibrate the decomposition cost model (see decomp_calibrate()) */
+static double t_integrate=0.0, t_radtransfer=0.0;
+#endif
+
 /*----------------------------------------------------------------------------*/
 /*! \fn int main(int argc, char *argv[]) 
  *  \brief Athena main program  
@@ -98,7 +114,7 @@ int main(int argc, char *argv[])
 #ifdef ION_RADIATION 
   VDFun_t IonRadTransfer; /* function pointer to ionization, set at runtime */
 #endif
-  int nl,nd;
+  int nl,nd,il;
   char *definput = "athinput";  /* default input filename */
   char *athinput = definput;
   int ires=0;             /* restart flag, set to 1 if -r argument on cmdline */
@@ -125,18 +141,29 @@ int main(int argc, char *argv[])
   time_t start, stop;
   int have_time = time(&start);  /* Is current calendar time (UTC) available? */
   int zones;
-  double cpu_time, zcs;
+  double cpu_time, zcs, t_mesh;
   long clk_tck = sysconf(_SC_CLK_TCK);
   struct tms tbuf;
   clock_t time0,time1, have_times;
-  struct timeval tvs, tve;
+  struct timeval tvs, tve, tvi;
   Real dt_done;
+  int regrid=0;           /* 1 if the Mesh was regridded in this cycle */
 
 #ifdef MPI_PARALLEL
   char *pc, *suffix, new_name[MAXLEN];
   int len, h, m, s, err, use_wtlim=0;
+  int thread_level;         /* thread support provided by MPI_Init_thread */
   double wtend;
-  if(MPI_SUCCESS != MPI_Init(&argc, &argv))
+  double wait_cycle, wait_total=0.0; /* time waiting on bvals_mhd messages */
+  double saved_cycle, saved_total=0.0; /* bytes not sent by bvals_mhd */
+  double tw;                /* wall time of one Grid update */
+  int rebal_int;            /* steps between load rebalance checks (0=off) */
+  Real rebal_thr;           /* load imbalance (max/mean) that is rebalanced */
+/* Only the main thread makes MPI calls (vtk files may be written by another).
+ * If the library provides less than MPI_THREAD_FUNNELED, async outputs are
+ * written by the main thread */
+  if(MPI_SUCCESS != MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED,
+                                    &thread_level))
     ath_error("[main]: Error on calling MPI_Init\n");
 #endif /* MPI_PARALLEL */
 
@@ -350,10 +377,19 @@ int main(int argc, char *argv[])
     ath_pout(0,"Simulation started on %s\n",ctime(&start));
 
 /*--- Step 4. ----------------------------------------------------------------*/
-/* Initialize nested mesh hierarchy. */
+/* Initialize nested mesh hierarchy.  On restart, the ranks of Grids recorded
+ * with the restart files (if any) are read first, for init_mesh().  The wall
+ * time of this and of the whole setup is printed before the main loop. */
 
+  gettimeofday(&tvi,NULL);
+#ifdef MPI_PARALLEL
+  if(ires) read_grid_layout(res_file);
+#endif
   init_mesh(&Mesh);
   init_grid(&Mesh);
+  gettimeofday(&tve,NULL);
+  t_mesh = (double)(tve.tv_sec - tvi.tv_sec) +
+    1.0e-6*(double)(tve.tv_usec - tvi.tv_usec);
 #ifdef PARTICLES
   init_particle(&Mesh);
 #endif
@@ -456,6 +492,11 @@ int main(int argc, char *argv[])
  * Allocate temporary arrays */
 
   init_output(&Mesh); 
+  refine_flag_init(&Mesh);
+#ifdef MPI_PARALLEL
+  rebal_int = par_geti_def("job","rebalance_interval",0);
+  rebal_thr = par_getd_def("job","rebalance_threshold",1.2);
+#endif
   lr_states_init(&Mesh);
   Integrate = integrate_init(&Mesh);
 #ifdef SELF_GRAVITY
@@ -500,6 +541,10 @@ int main(int argc, char *argv[])
 
   if (ires==0) data_output(&Mesh, 1);
 
+  cpu_time = (double)(tvs.tv_sec - tvi.tv_sec) +
+    1.0e-6*(double)(tvs.tv_usec - tvi.tv_usec);
+  ath_pout(0,"\nsetup wall time = %e sec (mesh and Grids %e sec)\n",
+    cpu_time,t_mesh);
   ath_pout(0,"\nSetup complete, entering main loop...\n\n");
   ath_pout(0,"cycle=%i time=%e next dt=%e\n",Mesh.nstep, Mesh.time, Mesh.dt);
 
@@ -532,6 +577,7 @@ int main(int argc, char *argv[])
     for (nl=0; nl<(Mesh.NLevels); nl++){ 
       for (nd=0; nd<(Mesh.DomainsPerLevel[nl]); nd++){  
         if (Mesh.Domain[nl][nd].Grid != NULL){
+          Mesh.Domain[nl][nd].Grid->bvals_dirty = DIRTY_ALL;
           bvals_mhd(&(Mesh.Domain[nl][nd]));
         }
       }
@@ -543,12 +589,20 @@ int main(int argc, char *argv[])
        because it is capable of decreasing the time step relative to
        the value computed by Courant. */
 
-    if (Mesh.radplanelist[0].nradplane > 0) {
+    if (Mesh.radplanelist[0].nradplane > 0 && !Mesh.subcycle) {
       clear_coarse_time(); /*Used to synchronize radiation time step across levels*/
       for (nl=0; nl<(Mesh.NLevels); nl++){
 	for (nd=0; nd<(Mesh.DomainsPerLevel[nl]); nd++){
 	  if (Mesh.Domain[nl][nd].Grid != NULL){
+#ifdef MPI_PARALLEL
+	    tw = MPI_Wtime();
+	    (*IonRadTransfer)(&(Mesh.Domain[nl][nd]));
+	    tw = MPI_Wtime() - tw;
+	    t_radtransfer += tw;
+	    Mesh.Domain[nl][nd].Grid->work_time += tw;
+#else
 	    (*IonRadTransfer)(&(Mesh.Domain[nl][nd]));
+#endif
 	    bvals_mhd(&(Mesh.Domain[nl][nd]));/* Re-apply hydro bc's. */
 	  }
 	  if (nl==0) set_coarse_time();
@@ -567,34 +621,72 @@ int main(int argc, char *argv[])
 
 #endif
 /*--- Step 9c. ---------------------------------------------------------------*/
-/* Loop over all Domains and call Integrator */
+/* Loop over all Domains and call Integrator.  All variables, on all Grids
+ * (including those changed by RestrictCorrect and Userwork below), must be
+ * exchanged in step 9h.  With subcycling, each level is advanced with its own
+ * dt (radiation included) by advance_level().  Otherwise with SMR, levels are
+ * integrated from the finest down, and each is restricted onto its parents
+ * (Step 9d) as soon as it is done, so that its messages are in flight while
+ * the coarser levels are integrated. */
 
-    for (nl=0; nl<(Mesh.NLevels); nl++){ 
+#ifdef STATIC_MESH_REFINEMENT
+    if (Mesh.subcycle) {
+#ifdef ION_RADIATION
+      advance_level(&Mesh, 0, 0, 1, 1, Integrate,
+        (Mesh.radplanelist[0].nradplane > 0) ? IonRadTransfer : NULL);
+#else
+      advance_level(&Mesh, 0, 0, 1, 1, Integrate, NULL);
+#endif
+    } else
+#endif /* STATIC_MESH_REFINEMENT */
+    for (il=0; il<(Mesh.NLevels); il++){ 
+#ifdef STATIC_MESH_REFINEMENT
+      nl = (Mesh.NLevels) - 1 - il;
+#else
+      nl = il;
+#endif
       for (nd=0; nd<(Mesh.DomainsPerLevel[nl]); nd++){  
         if (Mesh.Domain[nl][nd].Grid != NULL){
+#ifdef MPI_PARALLEL
+          tw = MPI_Wtime();
           (*Integrate)(&(Mesh.Domain[nl][nd]));
+          tw = MPI_Wtime() - tw;
+          t_integrate += tw;
+          Mesh.Domain[nl][nd].Grid->work_time += tw;
+#else
+          (*Integrate)(&(Mesh.Domain[nl][nd]));
+#endif
+          Mesh.Domain[nl][nd].Grid->bvals_dirty = DIRTY_ALL;
 
 #ifdef FARGO
           Fargo(&(Mesh.Domain[nl][nd]));
+          Mesh.Domain[nl][nd].Grid->cfl_valid = 0;
 #ifdef PARTICLES
           advect_particles(&level0_Grid, &level0_Domain);
 #endif
 #endif /* FARGO */
         }
       }
-    }
 
 /*--- Step 9d. ---------------------------------------------------------------*/
-/* With SMR, restrict solution from Child --> Parent grids  */
+/* With SMR, restrict solution from Child --> Parent grids.  With subcycling
+ * the whole Mesh is restricted once all levels are advanced. */
 
 #ifdef STATIC_MESH_REFINEMENT
-    RestrictCorrect(&Mesh);
+      RestrictCorrectStep(&Mesh, nl);
+#endif
+    }
+
+#ifdef STATIC_MESH_REFINEMENT
+    if (Mesh.subcycle) RestrictCorrect(&Mesh);
 #endif
 
 /*--- Step 9e. ---------------------------------------------------------------*/
-/* User work (defined in problem()) */
+/* User work (defined in problem()).  Signal speeds cached by the integrator
+ * for new_dt() are dropped unless the problem keeps them up to date. */
 
     Userwork_in_loop(&Mesh);
+    cfl_userwork_done(&Mesh);
 
 /*--- Step 9f. ---------------------------------------------------------------*/
 /* Compute gravitational potential using new density, and add second-order
@@ -607,13 +699,14 @@ int main(int argc, char *argv[])
           (*SelfGrav)(&(Mesh.Domain[nl][nd]));
           bvals_grav(&(Mesh.Domain[nl][nd]));
           selfg_fc(&(Mesh.Domain[nl][nd]));
+          Mesh.Domain[nl][nd].Grid->cfl_valid = 0;
         }
       }
     }
 #endif
 
 /*--- Step 9g. ---------------------------------------------------------------*/
-/* Update Mesh time, and time in all Grid's.  Compute new dt */
+/* Update Mesh time, and time in all Grid's.  New dt is computed in step 9h */
 
     Mesh.nstep++;
     Mesh.time += Mesh.dt;
@@ -625,27 +718,61 @@ int main(int argc, char *argv[])
       }
     }
 
-    dt_done = Mesh.dt;
-    new_dt(&Mesh);
-
 /*--- Step 9h. ---------------------------------------------------------------*/
 /* Boundary values must be set after time is updated for t-dependent BCs.
- * With SMR, ghost zones at internal fine/coarse boundaries set by Prolongate */
+ * With SMR, ghost zones at internal fine/coarse boundaries set by Prolongate.
+ * The x1-exchange of every Domain is started first, so that the messages are
+ * in flight while the new dt is computed (which only uses active zones).  With
+ * SMR the exchanges are finished one level at a time from the root, and each
+ * level is prolongated into its children as soon as its own ghost zones are
+ * set, so that those messages are in flight while the next level is
+ * finished. */
 
     for (nl=0; nl<(Mesh.NLevels); nl++){ 
       for (nd=0; nd<(Mesh.DomainsPerLevel[nl]); nd++){  
         if (Mesh.Domain[nl][nd].Grid != NULL){
-          bvals_mhd(&(Mesh.Domain[nl][nd]));
-#ifdef PARTICLES
-          bvals_particle(&level0_Grid, &level0_Domain);
-#endif
+          bvals_mhd_start(&(Mesh.Domain[nl][nd]));
         }
       }
     }
 
+    dt_done = Mesh.dt;
+    new_dt(&Mesh);
+
 #ifdef STATIC_MESH_REFINEMENT
-    Prolongate(&Mesh);
+    for (nl=0; nl<(Mesh.NLevels); nl++){
+      finish_bvals(&Mesh, nl, nl);
+      ProlongateStep(&Mesh, nl);
+    }
+#else
+    finish_bvals(&Mesh, 0, (Mesh.NLevels)-1);
+#endif
+
+/* Regrid the fine levels to the cells that need refinement (every
+ * refine_interval steps).  Otherwise, every rebalance_interval steps, move
+ * Grids to other ranks if that balances the measured load (the Grids of a
+ * cycle that regridded are untimed).  The integrator and radiation arrays are
+ * sized by the Grids, so they are allocated again for the new ones. */
+
+    regrid = refine_flag(&Mesh);
+#ifdef MPI_PARALLEL
+    if(rebal_int > 0 && !regrid &&
+       ((Mesh.nstep - nstep_start) % rebal_int) == 0 &&
+       rebalance_check(&Mesh, rebal_thr)) {
+      migrate_grids(&Mesh);
+      regrid = 1;
+    }
+#endif /* MPI_PARALLEL */
+    if (regrid) {
+      lr_states_destruct();
+      integrate_destruct();
+      lr_states_init(&Mesh);
+      Integrate = integrate_init(&Mesh);
+#ifdef ION_RADIATION
+      ion_radtransfer_destruct();
+      IonRadTransfer = ion_radtransfer_init(&Mesh, 1);
 #endif
+    }
 
 /*--- Step 9i. ---------------------------------------------------------------*/
 /* Force quit if wall time limit reached.  Check signals from system */
@@ -660,6 +787,14 @@ int main(int argc, char *argv[])
 
     ath_pout(0,MAKE_GREEN"cycle=%i time=%e next dt=%e last dt=%e\n" RESET_COLOR2,
 	     Mesh.nstep,Mesh.time,Mesh.dt,dt_done);
+#ifdef MPI_PARALLEL
+    wait_cycle = bvals_mhd_wait_time();
+    wait_total += wait_cycle;
+    ath_pout(1,"  bvals MPI wait time this cycle = %e s\n",wait_cycle);
+    saved_cycle = bvals_mhd_bytes_saved();
+    saved_total += saved_cycle;
+    ath_pout(1,"  bvals bytes not sent this cycle = %e\n",saved_cycle);
+#endif /* MPI_PARALLEL */
 
     if(nflush == Mesh.nstep){
       ath_flush_out();
@@ -712,6 +847,16 @@ int main(int argc, char *argv[])
   ath_pout(0,"  tlim= %e   nlim= %i\n",tlim,nlim);
   ath_pout(0,"  time= %e  cycle= %i\n",Mesh.time,Mesh.nstep);
   ath_pout(0,"\nzone-cycles/cpu-second = %e\n",zcs);
+#ifdef MPI_PARALLEL
+  ath_pout(0,"\ntotal bvals MPI wait time = %e s\n",wait_total);
+  ath_pout(0,"total bvals bytes not sent = %e\n",saved_total);
+  if (par_geti_def("job","decomp_calibrate",0))
+    decomp_calibrate(&Mesh, t_integrate, t_radtransfer, wait_total,
+                     Mesh.nstep - nstep_start);
+#endif /* MPI_PARALLEL */
+#ifdef STATIC_MESH_REFINEMENT
+  SMR_report();
+#endif
 
 /* Calculate and print the zone-cycles/wall-second on this processor */
 
@@ -741,6 +886,7 @@ int main(int argc, char *argv[])
 /* Final output everything (last argument of data_output = 1) */
 
   data_output(&Mesh, 1);
+  vtk_report();
 
 /* Free all memory */
 
@@ -772,6 +918,143 @@ int main(int argc, char *argv[])
 }
 
 /*============================================================================*/
+#ifdef STATIC_MESH_REFINEMENT
+/*----------------------------------------------------------------------------*/
+/*! \fn static void advance_level(MeshS *pM, const int nl, const int substep,
+ *                          const int first, const int last,
+ *                          VDFun_t Integrate, VDFun_t RadTransfer)
+ *  \brief Advances all Grids on level nl by their own dt = pM->dt/2^nl, then
+ *   takes two substeps of level nl+1 and restricts them back onto level nl
+ *   (Berger-Oliger subcycling).
+ *
+ *   substep is 0 or 1 within the step of the parent level.  first (last) is
+ *   set if this is the first (last) step of level nl in the root step: ghost
+ *   zones at the start of the root step are set in Step 9h, and the final
+ *   restriction is done by RestrictCorrect() in Step 9d.  RadTransfer is NULL
+ *   if there is no ionizing radiation. */
+
+static void advance_level(MeshS *pM, const int nl, const int substep,
+                          const int first, const int last,
+                          VDFun_t Integrate, VDFun_t RadTransfer)
+{
+  DomainS *pD;
+  int nd;
+#ifdef ION_RADIATION
+  int l;
+#endif
+#ifdef MPI_PARALLEL
+  double tw;
+#endif
+
+/* Same-level boundaries, then fine/coarse boundaries interpolated in time
+ * between the start and end of the parent step in progress */
+
+  if (!first) {
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      pD = &(pM->Domain[nl][nd]);
+      if (pD->Grid != NULL) bvals_mhd(pD);
+    }
+    ProlongateLevel(pM, nl, 0.5*(Real)substep);
+  }
+  if (nl < (pM->NLevels - 1)) ProlongateSave(pM, nl);
+
+  for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+    pD = &(pM->Domain[nl][nd]);
+    if (pD->Grid != NULL){
+      pD->Grid->dt = pM->dt/(Real)(1<<nl);
+      pD->Grid->substep = substep;
+    }
+  }
+
+/* Radiation over the step of this level.  On the root level it may shorten
+ * dt, which is then spread to all levels. */
+
+#ifdef ION_RADIATION
+  if (RadTransfer != NULL) {
+    if (nl == 0) clear_coarse_time();
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      pD = &(pM->Domain[nl][nd]);
+      if (pD->Grid != NULL){
+#ifdef MPI_PARALLEL
+        tw = MPI_Wtime();
+        (*RadTransfer)(pD);
+        tw = MPI_Wtime() - tw;
+        t_radtransfer += tw;
+        pD->Grid->work_time += tw;
+#else
+        (*RadTransfer)(pD);
+#endif
+        bvals_mhd(pD);
+      }
+    }
+    if (nl == 0) {
+      set_coarse_time();
+      pM->dt = get_coarse_time();
+      for (l=1; l<(pM->NLevels); l++){
+        for (nd=0; nd<(pM->DomainsPerLevel[l]); nd++){
+          if (pM->Domain[l][nd].Grid != NULL)
+            pM->Domain[l][nd].Grid->dt = pM->dt/(Real)(1<<l);
+        }
+      }
+    }
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      pD = &(pM->Domain[nl][nd]);
+      if (pD->Grid != NULL) pD->Grid->dt = pM->dt/(Real)(1<<nl);
+    }
+  }
+#endif /* ION_RADIATION */
+
+  for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+    pD = &(pM->Domain[nl][nd]);
+    if (pD->Grid != NULL){
+#ifdef MPI_PARALLEL
+      tw = MPI_Wtime();
+      (*Integrate)(pD);
+      tw = MPI_Wtime() - tw;
+      t_integrate += tw;
+      pD->Grid->work_time += tw;
+#else
+      (*Integrate)(pD);
+#endif
+      pD->Grid->bvals_dirty = DIRTY_ALL;
+      pD->Grid->time += pD->Grid->dt;
+    }
+  }
+  if (nl > 0) SubcycleFluxes(pM, nl, substep);
+
+  if (nl < (pM->NLevels - 1)) {
+    advance_level(pM, nl+1, 0, first, 0, Integrate, RadTransfer);
+    advance_level(pM, nl+1, 1, 0, last, Integrate, RadTransfer);
+    if (!last) RestrictCorrectLevel(pM, nl+1);
+  }
+
+  return;
+}
+#endif /* STATIC_MESH_REFINEMENT */
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void finish_bvals(MeshS *pM, const int nlmin, const int nlmax)
+ *  \brief Finishes the boundary exchanges started by bvals_mhd_start() on all
+ *   Domains at levels nlmin to nlmax with a Grid on this rank. */
+
+static void finish_bvals(MeshS *pM, const int nlmin, const int nlmax)
+{
+  int nl,nd;
+
+  for (nl=nlmin; nl<=nlmax; nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      if (pM->Domain[nl][nd].Grid != NULL){
+        bvals_mhd_finish(&(pM->Domain[nl][nd]));
+#ifdef PARTICLES
+        bvals_particle(&level0_Grid, &level0_Domain);
+#endif
+      }
+    }
+  }
+
+  return;
+}
+
 /*----------------------------------------------------------------------------*/
 /*! \fn void change_rundir(const char *name) 
  *  \brief Change run directory;  create it if it does not exist yet
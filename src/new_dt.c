@@ -8,14 +8,33 @@
  *   being updated on this processor.  With MPI parallel jobs, also finds
  *   minimum dt across all processors.
  *
+ * With SMR subcycling (<time>/subcycle=1) the root dt is limited by 2^nl times
+ * the CFL dt of each level nl, and Grids at level nl get dt/2^nl.
+ *
  * For special relativity, the time step limit is just (1/dx), since the fastest
  * wave speed is never larger than c=1.
  *
  * A CFL condition is also applied using particle velocities if PARTICLES is
  * defined.
  *
+ * FUSED REDUCTION: the maximum signal speed in each direction over the active
+ *   zones of a Grid is kept in Grid->cfl_vmax[].  Integrators that call
+ *   cfl_fold() on every zone as they write its final updated value set
+ *   Grid->cfl_valid, and new_dt() then only reduces these per-Grid scalars
+ *   instead of making another sweep over U.  The CTU and VL integrators in 1D,
+ *   2D and 3D all do so.  Grids without a valid cache (first-order flux
+ *   correction in VL, FARGO, self-gravity, parents changed by
+ *   RestrictCorrect) are swept here as before.  Since Userwork_in_loop() may
+ *   change U anywhere, the cache is dropped after it unless the problem
+ *   generator has called cfl_track_userwork() to promise that it folds every
+ *   zone it changes.
+ *
  * CONTAINS PUBLIC FUNCTIONS: 
- * - new_dt() - computes dt						      */
+ * - new_dt() - computes dt
+ * - cfl_reset() - zeroes the cached signal speeds of a Grid
+ * - cfl_fold() - folds the signal speeds of one zone into the cache
+ * - cfl_track_userwork() - keep cache across Userwork_in_loop()
+ * - cfl_userwork_done() - drop cache after Userwork_in_loop() if untracked   */
 /*============================================================================*/
 
 #include <stdio.h>
@@ -25,6 +44,9 @@
 #include "globals.h"
 #include "prototypes.h"
 
+/* TRUE if Userwork_in_loop() folds every zone it changes into the cache */
+static int userwork_tracked = 0;
+
 /*----------------------------------------------------------------------------*/
 /*! \fn void new_dt(MeshS *pM)
  *  \brief Computes timestep using CFL condition. */ 
@@ -34,13 +56,6 @@ void new_dt(MeshS *pM)
   GridS *pGrid;
 #ifndef SPECIAL_RELATIVITY
   int i,j,k;
-  Real di,v1,v2,v3,qsq,asq,cf1sq,cf2sq,cf3sq;
-#ifdef ADIABATIC
-  Real p;
-#endif
-#ifdef MHD
-  Real b1,b2,b3,bsq,tsum,tdif;
-#endif /* MHD */
 #ifdef PARTICLES
   long q;
 #endif /* PARTICLES */
@@ -51,7 +66,6 @@ void new_dt(MeshS *pM)
 #endif
   int nl,nd;
   Real tlim,max_v1=0.0,max_v2=0.0,max_v3=0.0,max_dti = 0.0;
-  Real x1,x2,x3;
 
 /* Loop over all Domains with a Grid on this processor -----------------------*/
 
@@ -66,77 +80,28 @@ void new_dt(MeshS *pM)
     max_v1 = max_v2 = max_v3 = 1.0;
 #else
 
-    for (k=pGrid->ks; k<=pGrid->ke; k++) {
-    for (j=pGrid->js; j<=pGrid->je; j++) {
-      for (i=pGrid->is; i<=pGrid->ie; i++) {
-        di = 1.0/(pGrid->U[k][j][i].d);
-        v1 = pGrid->U[k][j][i].M1*di;
-        v2 = pGrid->U[k][j][i].M2*di;
-        v3 = pGrid->U[k][j][i].M3*di;
-        qsq = v1*v1 + v2*v2 + v3*v3;
-	/* if (isnan(di) || isnan(v1)) { */
-	/*     newvar = -999; */
-	/*     fprintf(stderr, "Level: %d, Domain: %d, k:%d, j:%d, i:%d, d = %f, m1 = %f, s=%f \n", nl, nd, k-nghost, j-nghost, i-nghost, pGrid->U[k][j][i].d, pGrid->U[k][j][i].M1, pGrid->U[k][j][i].s[0]); */
-	/*   } */
-
-
-#ifdef MHD
-
-/* Use maximum of face-centered fields (always larger than cell-centered B) */
-        b1 = pGrid->U[k][j][i].B1c 
-          + fabs((double)(pGrid->B1i[k][j][i] - pGrid->U[k][j][i].B1c));
-        b2 = pGrid->U[k][j][i].B2c 
-          + fabs((double)(pGrid->B2i[k][j][i] - pGrid->U[k][j][i].B2c));
-        b3 = pGrid->U[k][j][i].B3c 
-          + fabs((double)(pGrid->B3i[k][j][i] - pGrid->U[k][j][i].B3c));
-        bsq = b1*b1 + b2*b2 + b3*b3;
-/* compute sound speed squared */
-#ifdef ADIABATIC
-        p = MAX(Gamma_1*(pGrid->U[k][j][i].E - 0.5*pGrid->U[k][j][i].d*qsq
-                - 0.5*bsq), TINY_NUMBER);
-        asq = Gamma*p*di;
-#elif defined ISOTHERMAL
-        asq = Iso_csound2;
-#endif /* EOS */
-/* compute fast magnetosonic speed squared in each direction */
-        tsum = bsq*di + asq;
-        tdif = bsq*di - asq;
-        cf1sq = 0.5*(tsum + sqrt(tdif*tdif + 4.0*asq*(b2*b2+b3*b3)*di));
-        cf2sq = 0.5*(tsum + sqrt(tdif*tdif + 4.0*asq*(b1*b1+b3*b3)*di));
-        cf3sq = 0.5*(tsum + sqrt(tdif*tdif + 4.0*asq*(b1*b1+b2*b2)*di));
-
-#else /* MHD */
-
-/* compute sound speed squared */
-#ifdef ADIABATIC
-        p = MAX(Gamma_1*(pGrid->U[k][j][i].E - 0.5*pGrid->U[k][j][i].d*qsq),
-                TINY_NUMBER);
-        asq = Gamma*p*di;
-#elif defined ISOTHERMAL
-        asq = Iso_csound2;
-#endif /* EOS */
-/* compute fast magnetosonic speed squared in each direction */
-        cf1sq = asq;
-        cf2sq = asq;
-        cf3sq = asq;
-
-#endif /* MHD */
-
-/* compute maximum cfl velocity (corresponding to minimum dt) */
-        if (pGrid->Nx[0] > 1)
-          max_v1 = MAX(max_v1,fabs(v1)+sqrt((double)cf1sq));
-        if (pGrid->Nx[1] > 1)
-#ifdef CYLINDRICAL
-          cc_pos(pGrid,i,j,k,&x1,&x2,&x3);
-          max_v2 = MAX(max_v2,(fabs(v2)+sqrt((double)cf2sq))/x1);
-#else
-          max_v2 = MAX(max_v2,fabs(v2)+sqrt((double)cf2sq));
-#endif
-        if (pGrid->Nx[2] > 1)
-          max_v3 = MAX(max_v3,fabs(v3)+sqrt((double)cf3sq));
+/* Sweep the active zones only if the integrator did not fold them */
+    if (pGrid->cfl_valid == 0) {
+      cfl_reset(pGrid);
+      for (k=pGrid->ks; k<=pGrid->ke; k++) {
+      for (j=pGrid->js; j<=pGrid->je; j++) {
+        for (i=pGrid->is; i<=pGrid->ie; i++) {
+          cfl_fold(pGrid,i,j,k);
+        }
+      }}
+    }
+    pGrid->cfl_valid = 0;
 
-      }
-    }}
+/* With SMR subcycling, level nl takes 2^nl steps per step of the root */
+    if (pM->subcycle) {
+      max_v1 = pGrid->cfl_vmax[0]/(Real)(1 << nl);
+      max_v2 = pGrid->cfl_vmax[1]/(Real)(1 << nl);
+      max_v3 = pGrid->cfl_vmax[2]/(Real)(1 << nl);
+    } else {
+      max_v1 = MAX(max_v1,pGrid->cfl_vmax[0]);
+      max_v2 = MAX(max_v2,pGrid->cfl_vmax[1]);
+      max_v3 = MAX(max_v3,pGrid->cfl_vmax[2]);
+    }
 
 #endif /* SPECIAL_RELATIVITY */
 
@@ -189,10 +154,143 @@ void new_dt(MeshS *pM)
   for (nl=0; nl<=(pM->NLevels)-1; nl++){
     for (nd=0; nd<=(pM->DomainsPerLevel[nl])-1; nd++){
       if (pM->Domain[nl][nd].Grid != NULL) {
-        pM->Domain[nl][nd].Grid->dt = pM->dt;
+        if (pM->subcycle)
+          pM->Domain[nl][nd].Grid->dt = pM->dt/(Real)(1 << nl);
+        else
+          pM->Domain[nl][nd].Grid->dt = pM->dt;
       }
     }
   }
 
   return;
 }
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void cfl_reset(GridS *pG)
+ *  \brief Zeroes the cached maximum signal speeds of a Grid.  Does not change
+ *   Grid->cfl_valid, which the caller sets once every zone has been folded. */
+
+void cfl_reset(GridS *pG)
+{
+  pG->cfl_vmax[0] = 0.0;
+  pG->cfl_vmax[1] = 0.0;
+  pG->cfl_vmax[2] = 0.0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void cfl_fold(GridS *pG, const int i, const int j, const int k)
+ *  \brief Folds the maximum signal speed in each direction of zone (i,j,k)
+ *   into Grid->cfl_vmax[].  Uses cell-centered velocities and sound speed,
+ *   and Alfven speed from face-centered B, so the face fields must already be
+ *   updated when this is called with MHD. */
+
+void cfl_fold(GridS *pG, const int i, const int j, const int k)
+{
+#ifdef SPECIAL_RELATIVITY
+  pG->cfl_vmax[0] = pG->cfl_vmax[1] = pG->cfl_vmax[2] = 1.0;
+#else
+  Real di,v1,v2,v3,qsq,asq,cf1sq,cf2sq,cf3sq;
+#ifdef ADIABATIC
+  Real p;
+#endif
+#ifdef MHD
+  Real b1,b2,b3,bsq,tsum,tdif;
+#endif /* MHD */
+#ifdef CYLINDRICAL
+  Real x1,x2,x3;
+#endif
+
+  di = 1.0/(pG->U[k][j][i].d);
+  v1 = pG->U[k][j][i].M1*di;
+  v2 = pG->U[k][j][i].M2*di;
+  v3 = pG->U[k][j][i].M3*di;
+  qsq = v1*v1 + v2*v2 + v3*v3;
+
+#ifdef MHD
+
+/* Use maximum of face-centered fields (always larger than cell-centered B) */
+  b1 = pG->U[k][j][i].B1c 
+    + fabs((double)(pG->B1i[k][j][i] - pG->U[k][j][i].B1c));
+  b2 = pG->U[k][j][i].B2c 
+    + fabs((double)(pG->B2i[k][j][i] - pG->U[k][j][i].B2c));
+  b3 = pG->U[k][j][i].B3c 
+    + fabs((double)(pG->B3i[k][j][i] - pG->U[k][j][i].B3c));
+  bsq = b1*b1 + b2*b2 + b3*b3;
+/* compute sound speed squared */
+#ifdef ADIABATIC
+  p = MAX(Gamma_1*(pG->U[k][j][i].E - 0.5*pG->U[k][j][i].d*qsq
+          - 0.5*bsq), TINY_NUMBER);
+  asq = Gamma*p*di;
+#elif defined ISOTHERMAL
+  asq = Iso_csound2;
+#endif /* EOS */
+/* compute fast magnetosonic speed squared in each direction */
+  tsum = bsq*di + asq;
+  tdif = bsq*di - asq;
+  cf1sq = 0.5*(tsum + sqrt(tdif*tdif + 4.0*asq*(b2*b2+b3*b3)*di));
+  cf2sq = 0.5*(tsum + sqrt(tdif*tdif + 4.0*asq*(b1*b1+b3*b3)*di));
+  cf3sq = 0.5*(tsum + sqrt(tdif*tdif + 4.0*asq*(b1*b1+b2*b2)*di));
+
+#else /* MHD */
+
+/* compute sound speed squared */
+#ifdef ADIABATIC
+  p = MAX(Gamma_1*(pG->U[k][j][i].E - 0.5*pG->U[k][j][i].d*qsq),
+          TINY_NUMBER);
+  asq = Gamma*p*di;
+#elif defined ISOTHERMAL
+  asq = Iso_csound2;
+#endif /* EOS */
+/* compute fast magnetosonic speed squared in each direction */
+  cf1sq = asq;
+  cf2sq = asq;
+  cf3sq = asq;
+
+#endif /* MHD */
+
+/* compute maximum cfl velocity (corresponding to minimum dt) */
+  if (pG->Nx[0] > 1)
+    pG->cfl_vmax[0] = MAX(pG->cfl_vmax[0],fabs(v1)+sqrt((double)cf1sq));
+  if (pG->Nx[1] > 1) {
+#ifdef CYLINDRICAL
+    cc_pos(pG,i,j,k,&x1,&x2,&x3);
+    pG->cfl_vmax[1] = MAX(pG->cfl_vmax[1],(fabs(v2)+sqrt((double)cf2sq))/x1);
+#else
+    pG->cfl_vmax[1] = MAX(pG->cfl_vmax[1],fabs(v2)+sqrt((double)cf2sq));
+#endif
+  }
+  if (pG->Nx[2] > 1)
+    pG->cfl_vmax[2] = MAX(pG->cfl_vmax[2],fabs(v3)+sqrt((double)cf3sq));
+#endif /* SPECIAL_RELATIVITY */
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void cfl_track_userwork(void)
+ *  \brief Called by a problem generator whose Userwork_in_loop() calls
+ *   cfl_fold() on every zone it changes, so the cache survives it. */
+
+void cfl_track_userwork(void)
+{
+  userwork_tracked = 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void cfl_userwork_done(MeshS *pM)
+ *  \brief Drops the cached signal speeds of all Grids after
+ *   Userwork_in_loop(), unless the problem has called cfl_track_userwork(). */
+
+void cfl_userwork_done(MeshS *pM)
+{
+  int nl,nd;
+
+  if (userwork_tracked) return;
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      if (pM->Domain[nl][nd].Grid != NULL)
+        pM->Domain[nl][nd].Grid->cfl_valid = 0;
+    }
+  }
+}
@@ -16,7 +16,7 @@
  *
  * OPTIONS available in an <outputN> block are:
  * - out       = cons,prim,d,M1,M2,M3,E,B1c,B2c,B3c,ME,V1,V2,V3,P,S,cs2,G
- * - out_fmt   = bin,hst,tab,rst,vtk,pdf,pgm,ppm
+ * - out_fmt   = bin,hst,tab,rst,vtk,vti,pdf,pgm,ppm
  * - dat_fmt   = format string used to write tabular output (e.g. %12.5e)
  * - dt        = problem time between outputs
  * - time      = time of next output (useful for restarts)
@@ -26,6 +26,17 @@
  * - x1,x2,x3  = range over which data is averaged or sliced; see parse_slice()
  * - usr_expr_flag = 1 for user-defined expression (defined in problem.c)
  * - level,domain = integer indices of level and domain to be output with SMR
+ * - shared    = 1 to write one vtk file per Domain with MPI-IO, not per rank
+ * - async     = 1 to write vtk or vti files in a background thread
+ * - compress  = none,zlib,abs,rel: compression of bin dumps (see ath_zip.c)
+ * - tol       = error bound of compress=abs (absolute) or rel (relative to
+ *               the range of each field)
+ * - delta     = # of rst files written as deltas of the last full restart
+ *               between full ones (see restart.c)
+ * - delta_block = size in zones of the blocks of delta restarts
+ * - composite = level L of a vtk file of one variable over the root Domain
+ *               at the resolution of level L (see output_comp.c)
+ * - coarsen   = n to write the finest level coarsened by 2,4,..,2^n as vtk
  *   
  * EXAMPLE of an <outputN> block for a VTK dump:
  * - <output1>
@@ -69,6 +80,8 @@
  * - data_output() -
  * - data_output_destruct()
  * - OutData1,2,3()   -
+ * - OutField3()      - shared 3D array of an output expression
+ * - OutPrim3()       - shared 3D array of primitives
  *
  * PRIVATE FUNCTION PROTOTYPES:
  * - expr_*()
@@ -76,6 +89,10 @@
  * - free_output()
  * - parse_slice()
  * - getRGB()
+ * - out_range()
+ * - field_key()
+ * - field_find()
+ * - field_release()
  *
  * VARIABLE TYPE AND STRUCTURE DEFINITIONS: none
  *============================================================================*/
@@ -107,6 +124,20 @@ static OutputS *OutArray = NULL;    /* Array of Output modes */
 static OutputS rst_out;             /* Restart Output */
 static int rst_flag = 0;            /* (0,1) -> Restart Outputs are (off,on) */
 
+/* Fields shared by the outputs made in one call to data_output(): each is
+ * evaluated once per Grid by OutField3() or OutPrim3(), and freed when no
+ * output still pending in the call reads it.  expr=NULL for the primitives. */
+typedef struct OutField_s{
+  GridS *pG;
+  ConsFun_t expr;
+  void ***data;     /* Real*** of expr, or PrimS*** */
+  int nx[3];
+}OutFieldS;
+
+static OutFieldS *field = NULL;
+static int nfield = 0, maxfield = 0;
+static int *out_pending = NULL;     /* 1 for outputs not yet made in call */
+
 /*==============================================================================
  * PRIVATE FUNCTION PROTOTYPES:
  *   expr_*
@@ -114,6 +145,10 @@ static int rst_flag = 0;            /* (0,1) -> Restart Outputs are (off,on) */
  *   free_output
  *   parse_slice
  *   getRGB
+ *   out_range     - range of zones of a Grid in 3D outputs
+ *   field_key     - expression of the shared field read by an output
+ *   field_find    - finds or adds the shared field of a Grid
+ *   field_release - frees shared fields no pending output reads
  *============================================================================*/
 
 Real expr_d  (const GridS *pG, const int i, const int j, const int k);
@@ -162,6 +197,10 @@ static ConsFun_t getexpr(const int n, const char *expr);
 static void free_output(OutputS *pout);
 static void parse_slice(char *block, char *axname, Real *l, Real *u, int *flag);
 float *getRGB(char *name);
+static void out_range(GridS *pG, int lo[3], int hi[3]);
+static int field_key(OutputS *pOut, ConsFun_t *pexpr);
+static OutFieldS *field_find(GridS *pG, ConsFun_t expr);
+static void field_release(void);
 
 /*=========================== PUBLIC FUNCTIONS ===============================*/
 /*----------------------------------------------------------------------------*/
@@ -171,9 +210,12 @@ float *getRGB(char *name);
 void init_output(MeshS *pM)
 {
   int i,j,outn,maxout,nl,nd;
-  char block[80], *fmt, defid[10];
+  char block[80], *fmt, defid[10], *zip;
   OutputS new_out;
   int usr_expr_flag;
+#ifdef MPI_PARALLEL
+  int ierr,thread_level;
+#endif
 
   maxout = par_geti_def("job","maxout",MAXOUT_DEFAULT);
 
@@ -182,6 +224,9 @@ void init_output(MeshS *pM)
   if((OutArray = malloc(maxout*sizeof(OutputS))) == NULL){
     ath_error("[init_output]: Error allocating output array\n");
   }
+  if((out_pending = calloc(maxout,sizeof(int))) == NULL){
+    ath_error("[init_output]: Error allocating output array\n");
+  }
 
 /*--- loop over maxout output blocks, reading parameters into a temporary -----*
  *--- OutputS called new_out --------------------------------------------------*/
@@ -222,6 +267,64 @@ void init_output(MeshS *pM)
     if(par_exist(block,"out_fmt")) 
       fmt = new_out.out_fmt = par_gets(block,"out_fmt");
 
+/* VTK files can be written one per Domain with MPI-IO, or in the background,
+ * see vtk_file.c.  XML (vti) files are always written one per rank. */
+    if(par_exist(block,"out_fmt") && strcmp(fmt,"vtk") == 0) {
+      new_out.shared = par_geti_def(block,"shared",0);
+      new_out.async = par_geti_def(block,"async",0);
+    }
+    if(par_exist(block,"out_fmt") && strcmp(fmt,"vti") == 0)
+      new_out.async = par_geti_def(block,"async",0);
+#ifdef MPI_PARALLEL
+/* The writer thread needs MPI_THREAD_FUNNELED: it makes no MPI calls, but
+ * runs alongside the main thread, which does */
+    if (new_out.async) {
+      ierr = MPI_Query_thread(&thread_level);
+      if (thread_level < MPI_THREAD_FUNNELED) {
+        ath_perr(-1,"[init_output]: MPI provides no thread support, %s/async ignored\n",
+          block);
+        new_out.async = 0;
+      }
+    }
+#endif
+
+/* Binary dumps can compress their fields with zlib, see ath_zip.c */
+    if(par_exist(block,"out_fmt") && strcmp(fmt,"bin") == 0) {
+      zip = par_gets_def(block,"compress","none");
+      if (strcmp(zip,"none") == 0) new_out.zip = zip_none;
+      else if (strcmp(zip,"zlib") == 0) new_out.zip = zip_lossless;
+      else if (strcmp(zip,"abs") == 0) new_out.zip = zip_abs;
+      else if (strcmp(zip,"rel") == 0) new_out.zip = zip_rel;
+      else ath_error("[init_output]: %s/compress=%s is not none, zlib, abs or rel\n",
+        block,zip);
+      free(zip);
+#ifndef ZLIB_ENABLED
+      if (new_out.zip != zip_none)
+        ath_error("[init_output]: %s/compress requires configure --enable-zlib\n",
+          block);
+#endif
+      if (new_out.zip == zip_abs || new_out.zip == zip_rel) {
+        new_out.ztol = par_getd(block,"tol");
+        if (new_out.ztol <= 0.0)
+          ath_error("[init_output]: %s/tol must be positive\n",block);
+      }
+    }
+
+/* Restarts can be written as the blocks changed since the last full restart,
+ * see restart.c */
+    if(par_exist(block,"out_fmt") && strcmp(fmt,"rst") == 0) {
+      new_out.delta = par_geti_def(block,"delta",0);
+      new_out.dblock = par_geti_def(block,"delta_block",16);
+      if (new_out.delta < 0 || new_out.dblock < 1)
+        ath_error("[init_output]: %s/delta must be >= 0 and delta_block > 0\n",
+          block);
+#ifdef PARTICLES
+      if (new_out.delta > 0)
+        ath_error("[init_output]: %s/delta cannot be used with particles\n",
+          block);
+#endif
+    }
+
 /* out:     controls what variable can be output (all, prim, or any of expr_*)
  * out_fmt: controls format of output (single variable) or dump (all cons/prim)
  * if "out" doesn't exist, we assume 'cons' variables are meant to be dumped */
@@ -307,6 +410,13 @@ Now use the default one.\n");
 	new_out.out_fun = dump_vtk;
 #ifdef PARTICLES
         new_out.out_pargrid = 1; /* bin particles */
+#endif
+	goto add_it;
+      }
+      else if (strcmp(fmt,"vti")==0){
+	new_out.out_fun = dump_vti;
+#ifdef PARTICLES
+        new_out.out_pargrid = 1; /* bin particles */
 #endif
 	goto add_it;
       }
@@ -354,6 +464,10 @@ Now use the default one.\n");
         new_out.out_fun = dump_vtk;
         goto add_it;
       }
+      else if (strcmp(fmt,"vti")==0){
+        new_out.out_fun = dump_vti;
+        goto add_it;
+      }
       else{    /* Unknown data dump (fatal error) */
         ath_error("Unsupported dump mode for %s/out_fmt=%s for out=prim\n",
           block,fmt);
@@ -460,8 +574,38 @@ Now use the default one.\n");
       new_out.out_fun = output_pgm;
     else if (strcmp(fmt,"ppm")==0)
       new_out.out_fun = output_ppm;
-    else if (strcmp(fmt,"vtk")==0)
-      new_out.out_fun = output_vtk;
+    else if (strcmp(fmt,"vtk")==0) {
+/* A composite of the SMR levels, or coarsened copies of the finest level,
+ * can be written instead of a file per Grid, see output_comp.c */
+      new_out.comp_level = par_geti_def(block,"composite",-1);
+      new_out.coarsen = par_geti_def(block,"coarsen",0);
+      if (new_out.comp_level >= pM->NLevels || new_out.coarsen < 0)
+        ath_error("[init_output]: %s/composite must be < %d and coarsen >= 0\n",
+          block,pM->NLevels);
+      if (new_out.comp_level >= 0 || new_out.coarsen > 0) {
+        if (new_out.ndim != 3)
+          ath_error("[init_output]: %s/composite and coarsen need 3D output\n",
+            block);
+/* the conserved variables are restricted and the expression evaluated on
+ * them, so it must be one of the built-in expressions of U */
+        if (usr_expr_flag || strstr(new_out.out,"par") != NULL)
+          ath_error("[init_output]: %s/composite and coarsen need an expression of the conserved variables, not %s\n",
+            block,new_out.out);
+        nl = pM->NLevels - 1;
+        j = 1 << new_out.coarsen;
+        for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++)
+          for (i=0; i<3; i++)
+            if (pM->Domain[nl][nd].Disp[i] % j != 0 ||
+                pM->Domain[nl][nd].Nx[i] % j != 0)
+              ath_error("[init_output]: %s/coarsen=%d does not divide Domain %d of level %d\n",
+                block,new_out.coarsen,nd,nl);
+        new_out.out_fun = output_comp;
+      }
+      else
+        new_out.out_fun = output_vtk;
+    }
+    else if (strcmp(fmt,"vti")==0)
+      new_out.out_fun = output_vti;
     else if (strcmp(fmt,"tab")==0)
       new_out.out_fun = output_tab;
     else {
@@ -549,6 +693,12 @@ void data_output(MeshS *pM, const int flag)
     }
   }
 
+/* Plan the outputs: fields read by several of them are evaluated once, by
+ * the first, and kept until the last is made (see OutField3()) */
+
+  field_release();
+  for (n=0; n<out_count; n++) out_pending[n] = (dump_flag[n] != 0);
+
 /* Loop over all elements in output array, if dump_flag != 0, make output */
 
   for (n=0; n<out_count; n++) {
@@ -562,6 +712,8 @@ void data_output(MeshS *pM, const int flag)
 
       OutArray[n].num++;
 
+      out_pending[n] = 0;
+      field_release();
     }
   }
 
@@ -617,10 +769,17 @@ void data_output_destruct(void)
   }
 
   if (OutArray != NULL) {
+    for (i=0; i<out_count; i++) out_pending[i] = 0;
+    field_release();
     free(OutArray);
     OutArray = NULL;
     out_count = 0;
   }
+  if (out_pending != NULL) free(out_pending);
+  out_pending = NULL;
+  if (field != NULL) free(field);
+  field = NULL;
+  maxfield = 0;
 
   return;
 }
@@ -636,46 +795,18 @@ void data_output_destruct(void)
 Real ***OutData3(GridS *pgrid, OutputS *pout, int *Nx1, int *Nx2, int *Nx3)
 {
   Real ***data;
-  int i,j,k,il,jl,kl,iu,ju,ku;
+  int i,j,k,il,jl,kl,lo[3],hi[3];
 
   if (pout->ndim != 3) ath_error("[OutData3] <output%d> %s is %d-D, not 3-D\n",
     pout->n,pout->out, pout->ndim);
 
-#ifdef WRITE_GHOST_CELLS
-  if(pgrid->Nx[0] > 1){
-    il = pgrid->is - nghost;
-    iu = pgrid->ie + nghost;
-  } else{
-    il = pgrid->is;
-    iu = pgrid->ie;
-  }
-
-  if(pgrid->Nx[1] > 1){
-    jl = pgrid->js - nghost;
-    ju = pgrid->je + nghost;
-  } else{
-    jl = pgrid->js;
-    ju = pgrid->je;
-  }
-
-  if(pgrid->Nx[2] > 1){
-    kl = pgrid->ks - nghost;
-    ku = pgrid->ke + nghost;
-  } else{
-    kl = pgrid->ks;
-    ku = pgrid->ke;
-  }
-#else
-  il = pgrid->is;
-  iu = pgrid->ie;
-  jl = pgrid->js;
-  ju = pgrid->je;
-  kl = pgrid->ks;
-  ku = pgrid->ke;
-#endif
-  *Nx1 = iu-il+1;
-  *Nx2 = ju-jl+1;
-  *Nx3 = ku-kl+1;
+  out_range(pgrid,lo,hi);
+  il = lo[0];
+  jl = lo[1];
+  kl = lo[2];
+  *Nx1 = hi[0]-lo[0]+1;
+  *Nx2 = hi[1]-lo[1]+1;
+  *Nx3 = hi[2]-lo[2]+1;
 
   data = (Real***) calloc_3d_array(*Nx3,*Nx2,*Nx1,sizeof(Real));
   if (data == NULL) ath_error("[OutData3] Error creating 3D data array\n");
@@ -686,6 +817,69 @@ Real ***OutData3(GridS *pgrid, OutputS *pout, int *Nx1, int *Nx2, int *Nx3)
   return data;
 }
 
+/*----------------------------------------------------------------------------*/
+/*! \fn Real ***OutField3(GridS *pgrid, OutputS *pout, int *Nx1, int *Nx2,
+ *                        int *Nx3)
+ *  \brief Returns the 3D array of OutData3() for the output expression of
+ *   pout, evaluated only once for the Grid by all outputs made in the same
+ *   call to data_output().  The array belongs to data_output(), and must not
+ *   be freed or modified.
+ *
+ * Dimensions of array returned in arguments. */
+
+Real ***OutField3(GridS *pgrid, OutputS *pout, int *Nx1, int *Nx2, int *Nx3)
+{
+  OutFieldS *pF;
+
+  if (pout->expr == NULL)
+    ath_error("[OutField3] <output%d> %s has no expression\n",pout->n,pout->out);
+
+  pF = field_find(pgrid,pout->expr);
+  if (pF->data == NULL)
+    pF->data = (void***)OutData3(pgrid,pout,&pF->nx[0],&pF->nx[1],&pF->nx[2]);
+
+  *Nx1 = pF->nx[0];
+  *Nx2 = pF->nx[1];
+  *Nx3 = pF->nx[2];
+  return (Real***)pF->data;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn PrimS ***OutPrim3(GridS *pgrid, int *Nx1, int *Nx2, int *Nx3)
+ *  \brief Returns the primitives of the zones of the Grid written by dumps,
+ *   computed only once for the Grid by all outputs made in the same call to
+ *   data_output().  The array belongs to data_output(), and must not be freed
+ *   or modified.
+ *
+ * Dimensions of array returned in arguments. */
+
+PrimS ***OutPrim3(GridS *pgrid, int *Nx1, int *Nx2, int *Nx3)
+{
+  OutFieldS *pF;
+  PrimS ***W;
+  int i,j,k,lo[3],hi[3];
+
+  pF = field_find(pgrid,NULL);
+  if (pF->data == NULL) {
+    out_range(pgrid,lo,hi);
+    for (i=0; i<3; i++) pF->nx[i] = hi[i]-lo[i]+1;
+    W = (PrimS***)calloc_3d_array(pF->nx[2],pF->nx[1],pF->nx[0],sizeof(PrimS));
+    if (W == NULL) ath_error("[OutPrim3] Error creating 3D prim array\n");
+
+    for (k=lo[2]; k<=hi[2]; k++) {
+    for (j=lo[1]; j<=hi[1]; j++) {
+    for (i=lo[0]; i<=hi[0]; i++) {
+      W[k-lo[2]][j-lo[1]][i-lo[0]] = Cons_to_Prim(&(pgrid->U[k][j][i]));
+    }}}
+    pF->data = (void***)W;
+  }
+
+  *Nx1 = pF->nx[0];
+  *Nx2 = pF->nx[1];
+  *Nx3 = pF->nx[2];
+  return (PrimS***)pF->data;
+}
+
 /*----------------------------------------------------------------------------*/
 /*! \fn Real **OutData2(GridS *pgrid, OutputS *pout, int *Nx1, int *Nx2)
  *  \brief Creates 2D array of output data with two dimensions equal to Grid
@@ -1417,6 +1611,105 @@ static void parse_slice(char *block, char *axname, Real *l, Real *u, int *flag)
 
 }
 
+/*----------------------------------------------------------------------------*/
+/*! \fn static void out_range(GridS *pG, int lo[3], int hi[3])
+ *  \brief Sets the range of zones [lo,hi] of a Grid in 3D outputs and dumps:
+ *   the active zones, and the ghost zones with WRITE_GHOST_CELLS. */
+
+static void out_range(GridS *pG, int lo[3], int hi[3])
+{
+  lo[0] = pG->is;  hi[0] = pG->ie;
+  lo[1] = pG->js;  hi[1] = pG->je;
+  lo[2] = pG->ks;  hi[2] = pG->ke;
+
+#ifdef WRITE_GHOST_CELLS
+  if(pG->Nx[0] > 1){
+    lo[0] -= nghost;
+    hi[0] += nghost;
+  }
+  if(pG->Nx[1] > 1){
+    lo[1] -= nghost;
+    hi[1] += nghost;
+  }
+  if(pG->Nx[2] > 1){
+    lo[2] -= nghost;
+    hi[2] += nghost;
+  }
+#endif
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int field_key(OutputS *pOut, ConsFun_t *pexpr)
+ *  \brief Returns 1 if the output function of pOut reads a shared field, with
+ *   *pexpr its expression (NULL for the primitives), else 0. */
+
+static int field_key(OutputS *pOut, ConsFun_t *pexpr)
+{
+  *pexpr = NULL;
+
+  if (pOut->out_fun == dump_vtk || pOut->out_fun == dump_vti ||
+      pOut->out_fun == dump_binary)
+    return (strcmp(pOut->out,"prim") == 0);
+
+  if (pOut->out_fun == output_vtk || pOut->out_fun == output_vti ||
+      pOut->out_fun == output_tab || pOut->out_fun == output_comp) {
+    *pexpr = pOut->expr;
+    return (pOut->ndim == 3 && pOut->expr != NULL);
+  }
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static OutFieldS *field_find(GridS *pG, ConsFun_t expr)
+ *  \brief Returns the shared field of expr (NULL for the primitives) on the
+ *   Grid, adding it with no data if it is not there. */
+
+static OutFieldS *field_find(GridS *pG, ConsFun_t expr)
+{
+  int f;
+
+  for (f=0; f<nfield; f++)
+    if (field[f].pG == pG && field[f].expr == expr) return &(field[f]);
+
+  if (nfield == maxfield) {
+    maxfield = (maxfield > 0) ? 2*maxfield : 8;
+    if ((field = (OutFieldS*)realloc(field,maxfield*sizeof(OutFieldS))) == NULL)
+      ath_error("[field_find]: realloc returned a NULL pointer\n");
+  }
+  field[nfield].pG = pG;
+  field[nfield].expr = expr;
+  field[nfield].data = NULL;
+
+  return &(field[nfield++]);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void field_release(void)
+ *  \brief Frees the shared fields that no output still pending in the call
+ *   to data_output() reads, and all of them between calls. */
+
+static void field_release(void)
+{
+  ConsFun_t expr;
+  int f,m=0,n,used;
+
+  for (f=0; f<nfield; f++) {
+    used = 0;
+    for (n=0; n<out_count; n++)
+      if (out_pending[n] && field_key(&(OutArray[n]),&expr) &&
+          expr == field[f].expr) used = 1;
+
+    if (used) field[m++] = field[f];
+    else if (field[f].data != NULL) free_3d_array(field[f].data);
+  }
+  nfield = m;
+
+  return;
+}
+
 /*----------------------------------------------------------------------------*/
 /*! \fn float *getRGB(char *name)
  *  \brief function for accessing palettes stored stored in structure RGB.
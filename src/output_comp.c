@@ -0,0 +1,350 @@
+#include "copyright.h"
+/*============================================================================*/
+/*! \file output_comp.c
+ *  \brief Function to write a single variable as a composite of the SMR
+ *   levels at one resolution, in VTK "legacy" format.
+ *
+ * PURPOSE: Function to write a single variable as one VTK file covering the
+ *   root Domain at the resolution of level L, selected with composite=L in a
+ *   vtk <output> block, instead of a file per Grid and level.  Each zone of
+ *   the composite holds the finest data over it: zones of a coarser level l
+ *   fill the 2^(L-l) zones of level L along each axis inside them, and zones
+ *   of finer levels are restricted to level L by volume averaging.  As in
+ *   RestrictCorrect() in smr.c, it is the conserved variables that are
+ *   restricted: all of ConsS is gathered on the composite, and the output
+ *   expression is then evaluated on it, so that e.g. the pressure of a zone
+ *   is that of its restricted mass, momentum and energy rather than the
+ *   average of the pressures inside it.  The expression must therefore be a
+ *   built-in expression of U (checked in init_output()).  Coarse zones under
+ *   finer levels are not used, so the composite is the same whether or not
+ *   they have been updated since the last restriction.
+ *
+ *   With coarsen=n, the finest level is also written coarsened by 2, 4, ...,
+ *   2^n along each axis, one file per factor and Domain, each zone the
+ *   expression evaluated on the average of the conserved variables of the
+ *   zones of the finest level inside it.  The Disp and Nx of
+ *   the Domains of the finest level must be multiples of 2^n.
+ *
+ *   The Grids of all ranks are gathered on rank 0, which writes the files in
+ *   its directory, as
+ *   - <problem_id>-compL.NNNN.<id>.vtk              (composite=L)
+ *   - <problem_id>-levF[-domD]-cX.NNNN.<id>.vtk     (coarsened by X)
+ *   with F the finest level.  The composite is meant for quick looks at
+ *   coarse levels: rank 0 holds all of ConsS over it, and its size grows as
+ *   8^L.  Only 3D data can be written.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ * - output_comp() - writes composite VTK files (single variable).
+ *
+ * PRIVATE FUNCTION PROTOTYPES:
+ * - comp_gather() - gathers levels of the Mesh on a uniform array on rank 0
+ * - comp_eval()   - evaluates the output expression on the gathered array
+ * - comp_write()  - writes a uniform array to a VTK file on rank 0
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "athena.h"
+#include "globals.h"
+#include "prototypes.h"
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   comp_gather() - gathers levels of the Mesh on a uniform array on rank 0
+ *   comp_eval()   - evaluates the output expression on the gathered array
+ *   comp_write()  - writes a uniform array to a VTK file on rank 0
+ *============================================================================*/
+
+static double *comp_gather(MeshS *pM, const int nlmin, const int nlmax,
+                           const int res, const int lo[3], const int n[3]);
+static double *comp_eval(OutputS *pOut, double *cons, const int n[3],
+                         const Real x0[3], const Real dx[3]);
+static void comp_write(MeshS *pM, OutputS *pOut, const char *levstr,
+                       const char *domstr, const double *data, const int n[3],
+                       const Real x0[3], const Real dx[3]);
+
+/*=========================== PUBLIC FUNCTIONS ===============================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn void output_comp(MeshS *pM, OutputS *pOut)
+ *  \brief Writes composite VTK files (single variable). */
+
+void output_comp(MeshS *pM, OutputS *pOut)
+{
+  DomainS *pD;
+  double *data;
+  char levstr[16],domstr[32];
+  int nf,nd,m,dim,f,lo[3],n[3];
+  Real x0[3],dx[3];
+
+#ifdef WRITE_GHOST_CELLS
+  ath_error("[output_comp]: composite files cannot include ghost cells\n");
+#endif
+
+  nf = pM->NLevels - 1;
+
+/* Composite of all levels over the root Domain, at level comp_level */
+
+  if (pOut->comp_level >= 0) {
+    f = 1 << pOut->comp_level;
+    for (dim=0; dim<3; dim++) {
+      lo[dim] = 0;
+      n[dim] = pM->Nx[dim]*f;
+      x0[dim] = pM->RootMinX[dim];
+      dx[dim] = pM->dx[dim]/(Real)f;
+    }
+    data = comp_gather(pM,0,nf,pOut->comp_level,lo,n);
+    data = comp_eval(pOut,data,n,x0,dx);
+    sprintf(levstr,"comp%d",pOut->comp_level);
+    comp_write(pM,pOut,levstr,NULL,data,n,x0,dx);
+    if (data != NULL) free(data);
+  }
+
+/* Finest level coarsened by 2^m, m=1..coarsen: averages of that level only,
+ * on the grid of the (possibly negative) level nf-m */
+
+  for (nd=0; nd<(pM->DomainsPerLevel[nf]); nd++){
+    if (pOut->ndomain != -1 && pOut->ndomain != nd) continue;
+    pD = &(pM->Domain[nf][nd]);
+    for (m=1; m<=pOut->coarsen; m++) {
+      f = 1 << m;
+      for (dim=0; dim<3; dim++) {
+        lo[dim] = pD->Disp[dim]/f;
+        n[dim] = pD->Nx[dim]/f;
+        x0[dim] = pD->MinX[dim];
+        dx[dim] = pD->dx[dim]*(Real)f;
+      }
+      data = comp_gather(pM,nf,nf,nf-m,lo,n);
+      data = comp_eval(pOut,data,n,x0,dx);
+      sprintf(levstr,"lev%d",nf);
+      if (nd > 0) sprintf(domstr,"dom%d-c%d",nd,f);
+      else sprintf(domstr,"c%d",f);
+      comp_write(pM,pOut,levstr,domstr,data,n,x0,dx);
+      if (data != NULL) free(data);
+    }
+  }
+
+  return;
+}
+
+/*=========================== PRIVATE FUNCTIONS ==============================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn static double *comp_gather(MeshS *pM, const int nlmin,
+ *                                 const int nlmax, const int res,
+ *                                 const int lo[3], const int n[3])
+ *  \brief Returns on rank 0 (NULL on others) the conserved variables (all
+ *   of ConsS, nvar = sizeof(ConsS)/sizeof(Real) values per zone) on the
+ *   n[0]*n[1]*n[2] zones from lo (k,j,i order, in units of zones of level
+ *   res) filled from the Grids of levels nlmin to nlmax.
+ *
+ *   Only the zones of these levels not covered by a Domain of the next level
+ *   (below nlmax) are used, so each zone of the array is filled by the
+ *   finest data over it: a zone of a level nl <= res fills the zones of the
+ *   array inside it, and a zone of a level nl > res adds its share of volume
+ *   to the zone of the array it lies in.  Which zones are covered follows
+ *   from the Domains of the Mesh, known on all ranks, so with MPI the arrays
+ *   of all ranks are simply summed on rank 0. */
+
+static double *comp_gather(MeshS *pM, const int nlmin, const int nlmax,
+                           const int res, const int lo[3], const int n[3])
+{
+  const int nvar = sizeof(ConsS)/sizeof(Real);
+  DomainS *pC;
+  GridS *pG;
+  Real *u,w;
+  double *data,*pd;
+  int nl,nd,nc,i,j,k,ii,jj,kk,d,f,v,nx1,nx2,nx3,cov,g[3],t0[3],t1[3];
+  long m,ntot;
+#ifdef MPI_PARALLEL
+  double *sum=NULL;
+  int ierr;
+#endif
+
+  ntot = (long)n[0]*(long)n[1]*(long)n[2]*nvar;
+  if ((data = (double*)calloc(ntot,sizeof(double))) == NULL)
+    ath_error("[output_comp]: malloc failed for %ld values\n",ntot);
+
+  for (nl=nlmin; nl<=nlmax; nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      if (pM->Domain[nl][nd].Grid == NULL) continue;
+      pG = pM->Domain[nl][nd].Grid;
+      nx1 = pG->Nx[0];
+      nx2 = pG->Nx[1];
+      nx3 = pG->Nx[2];
+
+      f = (nl <= res) ? (1 << (res-nl)) : (1 << (nl-res));
+      w = (nl <= res) ? 1.0 : 1.0/(Real)(f*f*f);
+      for (k=0; k<nx3; k++) {
+      for (j=0; j<nx2; j++) {
+      for (i=0; i<nx1; i++) {
+        g[0] = pG->Disp[0] + i;
+        g[1] = pG->Disp[1] + j;
+        g[2] = pG->Disp[2] + k;
+
+/* skip zones refined by a Domain of the next level; Disp and Nx of Domains
+ * are even, so a zone is covered whole or not at all */
+        cov = 0;
+        if (nl < nlmax) {
+          for (nc=0; nc<(pM->DomainsPerLevel[nl+1]) && !cov; nc++){
+            pC = &(pM->Domain[nl+1][nc]);
+            cov = 1;
+            for (d=0; d<3; d++)
+              if (2*g[d] < pC->Disp[d] || 2*g[d] >= pC->Disp[d] + pC->Nx[d])
+                cov = 0;
+          }
+        }
+        if (cov) continue;
+
+/* zones t0..t1-1 of the array covered by (or covering) this zone */
+        for (d=0; d<3; d++) {
+          if (nl <= res) {
+            t0[d] = MAX(g[d]*f - lo[d], 0);
+            t1[d] = MIN((g[d]+1)*f - lo[d], n[d]);
+          } else {
+            t0[d] = g[d]/f - lo[d];
+            t1[d] = (t0[d] >= 0 && t0[d] < n[d]) ? t0[d]+1 : t0[d];
+          }
+        }
+
+        u = (Real*)&(pG->U[k+pG->ks][j+pG->js][i+pG->is]);
+        for (kk=t0[2]; kk<t1[2]; kk++) {
+        for (jj=t0[1]; jj<t1[1]; jj++) {
+        for (ii=t0[0]; ii<t1[0]; ii++) {
+          m = ((long)kk*n[1] + jj)*n[0] + ii;
+          pd = &(data[m*nvar]);
+          for (v=0; v<nvar; v++) pd[v] += w*u[v];
+        }}}
+      }}}
+    }
+  }
+
+#ifdef MPI_PARALLEL
+  if (myID_Comm_world == 0) {
+    if ((sum = (double*)malloc(ntot*sizeof(double))) == NULL)
+      ath_error("[output_comp]: malloc failed for %ld values\n",ntot);
+  }
+  ierr = MPI_Reduce(data, sum, (int)ntot, MPI_DOUBLE, MPI_SUM, 0,
+    MPI_COMM_WORLD);
+  free(data);
+  data = sum;
+#endif /* MPI_PARALLEL */
+
+  return data;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static double *comp_eval(OutputS *pOut, double *cons, const int n[3],
+ *                               const Real x0[3], const Real dx[3])
+ *  \brief Evaluates the output expression of pOut on the conserved variables
+ *   returned by comp_gather() for n[0]*n[1]*n[2] zones with origin x0 and
+ *   spacing dx, and returns it (NULL if cons is NULL, i.e. not on rank 0).
+ *   cons is freed.
+ *
+ *   The expression is called on a Grid without ghost zones that holds only
+ *   U and the geometry of the composite, which is all the built-in
+ *   expressions (and cc_pos()) read. */
+
+static double *comp_eval(OutputS *pOut, double *cons, const int n[3],
+                         const Real x0[3], const Real dx[3])
+{
+  const int nvar = sizeof(ConsS)/sizeof(Real);
+  GridS grid;
+  Real *u;
+  double *data,*pd;
+  int i,j,k,v;
+  long m;
+
+  if (cons == NULL) return NULL;
+
+  memset(&grid,0,sizeof(GridS));
+  grid.U = (ConsS***)calloc_3d_array(n[2],n[1],n[0],sizeof(ConsS));
+  if (grid.U == NULL) ath_error("[output_comp]: malloc failed for U\n");
+  if ((data = (double*)malloc((long)n[0]*n[1]*n[2]*sizeof(double))) == NULL)
+    ath_error("[output_comp]: malloc failed for output array\n");
+  for (i=0; i<3; i++) {
+    grid.Nx[i] = n[i];
+    grid.MinX[i] = x0[i];
+    grid.MaxX[i] = x0[i] + n[i]*dx[i];
+  }
+  grid.dx1 = dx[0];  grid.dx2 = dx[1];  grid.dx3 = dx[2];
+  grid.ie = n[0]-1;  grid.je = n[1]-1;  grid.ke = n[2]-1;
+
+  m = 0;
+  for (k=0; k<n[2]; k++) {
+  for (j=0; j<n[1]; j++) {
+  for (i=0; i<n[0]; i++) {
+    u = (Real*)&(grid.U[k][j][i]);
+    pd = &(cons[m*nvar]);
+    for (v=0; v<nvar; v++) u[v] = (Real)pd[v];
+    data[m] = (*pOut->expr)(&grid,i,j,k);
+
+/* Store the global min / max, for output at end of run */
+    pOut->gmin = MIN(data[m],pOut->gmin);
+    pOut->gmax = MAX(data[m],pOut->gmax);
+    m++;
+  }}}
+
+  free_3d_array(grid.U);
+  free(cons);
+  return data;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void comp_write(MeshS *pM, OutputS *pOut, const char *levstr,
+ *                             const char *domstr, const double *data,
+ *                             const int n[3], const Real x0[3],
+ *                             const Real dx[3])
+ *  \brief Writes the n[0]*n[1]*n[2] zones of data, with origin x0 and spacing
+ *   dx, to a VTK file named with levstr and domstr, on rank 0 only. */
+
+static void comp_write(MeshS *pM, OutputS *pOut, const char *levstr,
+                       const char *domstr, const double *data, const int n[3],
+                       const Real x0[3], const Real dx[3])
+{
+  FILE *pfile;
+  char *fname;
+  int big_end = ath_big_endian();
+  float *buf;
+  long i,m;
+
+  if (myID_Comm_world != 0) return;
+
+  if((fname = ath_fname(NULL,pM->outfilename,levstr,domstr,num_digit,
+      pOut->num,pOut->id,"vtk")) == NULL){
+    ath_error("[output_comp]: Error constructing filename\n");
+  }
+  if((pfile = fopen(fname,"w")) == NULL){
+    ath_error("[output_comp]: Unable to open vtk file %s\n",fname);
+  }
+  free(fname);
+
+  if((buf = (float *)malloc(n[0]*sizeof(float))) == NULL){
+    ath_error("[output_comp]: malloc failed for temporary array\n");
+  }
+
+/* There are five basic parts to the VTK "legacy" file format, as in
+ * output_vtk() */
+
+  fprintf(pfile,"# vtk DataFile Version 2.0\n");
+  fprintf(pfile,"Really cool Athena data at time= %e, composite %s\n",
+    pM->time,(domstr != NULL) ? domstr : levstr);
+  fprintf(pfile,"BINARY\n");
+  fprintf(pfile,"DATASET STRUCTURED_POINTS\n");
+  fprintf(pfile,"DIMENSIONS %d %d %d\n",n[0]+1,n[1]+1,n[2]+1);
+  fprintf(pfile,"ORIGIN %e %e %e \n",x0[0],x0[1],x0[2]);
+  fprintf(pfile,"SPACING %e %e %e \n",dx[0],dx[1],dx[2]);
+  fprintf(pfile,"CELL_DATA %ld \n",(long)n[0]*(long)n[1]*(long)n[2]);
+  fprintf(pfile,"SCALARS %s float\n", pOut->id);
+  fprintf(pfile,"LOOKUP_TABLE default\n");
+
+  for (m=0; m<(long)n[1]*(long)n[2]; m++) {
+    for (i=0; i<n[0]; i++) buf[i] = (float)data[m*n[0] + i];
+    if(!big_end) ath_bswap(buf,sizeof(float),n[0]);
+    fwrite(buf,sizeof(float),(size_t)n[0],pfile);
+  }
+
+  fclose(pfile);
+  free(buf);
+  return;
+}
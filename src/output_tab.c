@@ -228,8 +228,8 @@ void output_tab_3d(MeshS *pM, OutputS *pOut, int nl, int nd)
     sprintf(fmt," %s",pOut->dat_fmt);
   }
 
-/* compute 3D array of data */
-  data = OutData3(pGrid,pOut,&nx1,&nx2,&nx3);
+/* 3D array of data, shared with other outputs of this cycle */
+  data = OutField3(pGrid,pOut,&nx1,&nx2,&nx3);
   minmax3(data,nx3,nx2,nx1,&dmin,&dmax);
 
 /* construct output filename */
@@ -279,5 +279,4 @@ void output_tab_3d(MeshS *pM, OutputS *pOut, int nl, int nd)
   }
 
   fclose(pFile);
-  free_3d_array(data); /* Free the memory we malloc'd */
 }
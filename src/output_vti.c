@@ -0,0 +1,102 @@
+#include "copyright.h"
+/*============================================================================*/
+/*! \file output_vti.c
+ *  \brief Function to write a single variable in VTK XML ImageData format.
+ *
+ * PURPOSE: Function to write a single variable in VTK XML ImageData format
+ *   (out_fmt=vti), as a .vti file per Grid, a .pvti file per Domain and a
+ *   .vtm file per output (see vtk_file.c).  With SMR, dumps are made for all
+ *   levels and domains, unless nlevel and ndomain are specified in <output>
+ *   block.  Only 3D data can be written.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ * - output_vti() - writes VTK XML file (single variable).
+ *============================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "athena.h"
+#include "prototypes.h"
+
+/*=========================== PUBLIC FUNCTIONS ===============================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn void output_vti(MeshS *pM, OutputS *pOut)
+ *  \brief Writes VTK XML file (single variable). */
+
+void output_vti(MeshS *pM, OutputS *pOut)
+{
+  GridS *pGrid;
+  int nl,nd,nx1,nx2,nx3,i,j,k,m,nx[3],ncomp=1;
+  char *name = pOut->id;
+  Real dmin, dmax;
+  Real ***data3d=NULL; /* 3D array of data to be dumped */
+  float *data;         /* data actually output has to be floats */
+
+#ifdef WRITE_GHOST_CELLS
+  ath_error("[output_vti]: vti files cannot include ghost cells\n");
+#endif
+  if (pOut->ndim != 3)
+    ath_error("[output_vti]: Only able to output 3D\n");
+
+/* Loop over all Domains in Mesh, and output Grid data */
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      if (pM->Domain[nl][nd].Grid != NULL){
+
+/* write files if domain and level match input, or are not specified (-1) */
+      if ((pOut->nlevel == -1 || pOut->nlevel == nl) &&
+          (pOut->ndomain == -1 || pOut->ndomain == nd)){
+        pGrid = pM->Domain[nl][nd].Grid;
+
+/* 3D array of data values, shared with other outputs of this cycle */
+        data3d = OutField3(pGrid,pOut,&nx1,&nx2,&nx3);
+
+/* Store the global min / max, for output at end of run */
+        minmax3(data3d,nx3,nx2,nx1,&dmin,&dmax);
+        pOut->gmin = MIN(dmin,pOut->gmin);
+        pOut->gmax = MAX(dmax,pOut->gmax);
+
+        if((data = (float *)malloc(nx1*nx2*nx3*sizeof(float))) == NULL){
+          ath_error("[output_vti]: malloc failed for temporary array\n");
+          return;
+        }
+        m = 0;
+        for (k=0; k<nx3; k++) {
+          for (j=0; j<nx2; j++) {
+            for (i=0; i<nx1; i++) {
+              data[m++] = (float)data3d[k][j][i];
+            }
+          }
+        }
+
+/* open output file.  pOut->id will either be name of variable, if 'id=...'
+ * was included in <ouput> block, or 'outN' where N is number of <output>
+ * block.  */
+        nx[0] = nx1;
+        nx[1] = nx2;
+        nx[2] = nx3;
+        vtk_open(pM,pOut,nl,nd,pOut->id,nx);
+        vti_header(pGrid->time,1,&name,&ncomp);
+        vti_write(data,1);
+        vti_close();
+
+        free(data);
+      }}
+    }
+  }
+
+/* Write the index files of all Domains output */
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      if ((pOut->nlevel == -1 || pOut->nlevel == nl) &&
+          (pOut->ndomain == -1 || pOut->ndomain == nd))
+        vti_index(pM,pOut,nl,nd,pOut->id,1,&name,&ncomp);
+    }
+  }
+  vti_blocks(pM,pOut,pOut->id);
+
+  return;
+}
@@ -5,7 +5,9 @@
  *
  * PURPOSE: Function to write a single variable in VTK "legacy" format.  With
  *   SMR, dumps are made for all levels and domains, unless nlevel and ndomain
- *   are specified in <output> block.
+ *   are specified in <output> block.  3D data can be written by all Grids of
+ *   a Domain into one file with shared=1 (see vtk_file.c); 2D slices are
+ *   always written one file per rank.
  *
  * CONTAINS PUBLIC FUNCTIONS: 
  * - output_vtk() - writes VTK file (single variable).
@@ -174,46 +176,32 @@ static void output_vtk_2d(MeshS *pM, OutputS *pOut, int nl, int nd)
 
 /*----------------------------------------------------------------------------*/
 /*! \fn static void output_vtk_3d(MeshS *pM, OutputS *pOut, int nl, int nd)
- *  \brief Writes 3D data  */
+ *  \brief Writes 3D data, for the whole Grid at once  */
 
 static void output_vtk_3d(MeshS *pM, OutputS *pOut, int nl, int nd)
 {
   GridS *pGrid=pM->Domain[nl][nd].Grid;
-  FILE *pfile;
-  char *fname,*plev=NULL,*pdom=NULL;
-  char levstr[8],domstr[8];
-/* Upper and Lower bounds on i,j,k for data dump */
   int big_end = ath_big_endian();
-  int nx1,nx2,nx3,i,j,k;
+  int nx1,nx2,nx3,i,j,k,m,nx[3];
   Real dmin, dmax;
   Real ***data3d=NULL; /* 3D array of data to be dumped */
   float *data;         /* data actually output has to be floats */
-  double x1, x2, x3;
-
-/* Allocate memory for and compute 3D array of data values */
-  data3d = OutData3(pGrid,pOut,&nx1,&nx2,&nx3);
 
-/* construct output filename.  pOut->id will either be name of variable,
- * if 'id=...' was included in <ouput> block, or 'outN' where N is number of
- * <output> block.  */
-  if (nl>0) {
-    plev = &levstr[0];
-    sprintf(plev,"lev%d",nl);
-  }
-  if (nd>0) {
-    pdom = &domstr[0];
-    sprintf(pdom,"dom%d",nd);
-  }
+#ifdef WRITE_GHOST_CELLS
+  if (pOut->shared)
+    ath_error("[output_vtk]: shared files cannot include ghost cells\n");
+#endif
 
-  if((fname = ath_fname(plev,pM->outfilename,plev,pdom,num_digit,
-      pOut->num,pOut->id,"vtk")) == NULL){
-    ath_error("[output_vtk]: Error constructing filename\n");
-  }
+/* 3D array of data values, shared with other outputs of this cycle */
+  data3d = OutField3(pGrid,pOut,&nx1,&nx2,&nx3);
 
-/* open output file */
-  if((pfile = fopen(fname,"w")) == NULL){
-    ath_error("[output_vtk]: Unable to open vtk file %s\n",fname);
-  }
+/* open output file.  pOut->id will either be name of variable, if 'id=...'
+ * was included in <ouput> block, or 'outN' where N is number of <output>
+ * block.  */
+  nx[0] = nx1;
+  nx[1] = nx2;
+  nx[2] = nx3;
+  vtk_open(pM,pOut,nl,nd,pOut->id,nx);
 
 /* Store the global min / max, for output at end of run */
   minmax3(data3d,nx3,nx2,nx1,&dmin,&dmax);
@@ -222,10 +210,7 @@ static void output_vtk_3d(MeshS *pM, OutputS *pOut, int nl, int nd)
 
 /* Allocate memory for temporary array of floats */
 
-  x1 = pGrid->MinX[0];
-  x2 = pGrid->MinX[1];
-  x3 = pGrid->MinX[2];
-  if((data = (float *)malloc(nx1*sizeof(float))) == NULL){
+  if((data = (float *)malloc(nx1*nx2*nx3*sizeof(float))) == NULL){
      ath_error("[output_vtk]: malloc failed for temporary array\n");
      return;
   }
@@ -233,46 +218,39 @@ static void output_vtk_3d(MeshS *pM, OutputS *pOut, int nl, int nd)
 /* There are five basic parts to the VTK "legacy" file format.  */
 /*  1. Write file version and identifier */
 
-  fprintf(pfile,"# vtk DataFile Version 2.0\n");
+  vtk_printf("# vtk DataFile Version 2.0\n");
 
 /*  2. Header */
 
-  fprintf(pfile,"Really cool Athena data at time= %e, level= %i, domain= %i\n",
+  vtk_printf("Really cool Athena data at time= %e, level= %i, domain= %i\n",
     pGrid->time,nl,nd);
 
 /*  3. File format */
 
-  fprintf(pfile,"BINARY\n");
-
-/*  4. Dataset structure */
-
-  fprintf(pfile,"DATASET STRUCTURED_POINTS\n");
-  fprintf(pfile,"DIMENSIONS %d %d %d\n",nx1+1,nx2+1,nx3+1);
-  fprintf(pfile,"ORIGIN %e %e %e \n",x1,x2,x3);
-  fprintf(pfile,"SPACING %e %e %e \n",pGrid->dx1,pGrid->dx2,pGrid->dx3);
+  vtk_printf("BINARY\n");
 
-/*  5. Data  */
+/*  4. Dataset structure, and 5. Data  */
 
-  fprintf(pfile,"CELL_DATA %d \n", nx1*nx2*nx3);
+  vtk_dataset();
 
 /* Write data */
 
-  fprintf(pfile,"SCALARS %s float\n", pOut->id);
-  fprintf(pfile,"LOOKUP_TABLE default\n");
+  vtk_printf("SCALARS %s float\n", pOut->id);
+  vtk_printf("LOOKUP_TABLE default\n");
+  m = 0;
   for (k=0; k<nx3; k++) {
     for (j=0; j<nx2; j++) {
       for (i=0; i<nx1; i++) {
-        data[i] = (float)data3d[k][j][i];
+        data[m++] = (float)data3d[k][j][i];
       }
-      if(!big_end) ath_bswap(data,sizeof(float),nx1);
-      fwrite(data,sizeof(float),(size_t)nx1,pfile);
     }
   }
+  if(!big_end) ath_bswap(data,sizeof(float),m);
+  vtk_write(data,1);
 
 /* close file and free memory */
 
-  fclose(pfile);
+  vtk_close();
   free(data);
-  free_3d_array(data3d);
   return;
 }
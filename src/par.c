@@ -49,6 +49,7 @@
  * - void par_sets()       - sets/adds a string
  * - void par_seti()       - sets/adds an integer
  * - void par_setd()       - sets/adds a Real
+ * - void par_unset()      - removes a Par from a Block, if present
  * - void par_dump()       - print out all Blocks/Pars for debugging
  * - void par_close()      - free memory
  * - void par_dist_mpi()   - broadcast Blocks and Pars to children in MPI 
@@ -370,6 +371,30 @@ void par_setd(char *block, char *name, char *fmt, double dval, char *comment)
   return;
 }
 
+/*----------------------------------------------------------------------------*/
+/*! \fn void par_unset(char *block, char *name)
+ *  \brief Remove a Par from a Block; does nothing if either does not exist */
+
+void par_unset(char *block, char *name)
+{
+  Block *bp = find_block(block);
+  Par *pp, *prev = NULL;
+
+  if (bp == NULL) return;
+  for(pp = bp->p; pp != NULL; prev = pp, pp = pp->next){
+    if (strcmp(pp->name,name) == 0) {
+      if (prev) prev->next = pp->next;
+      else      bp->p = pp->next;
+      if (pp->name)    free(pp->name);
+      if (pp->value)   free(pp->value);
+      if (pp->comment) free(pp->comment);
+      free(pp);
+      return;
+    }
+  }
+  return;
+}
+
 /*----------------------------------------------------------------------------*/
 /*! \fn void par_dump(int mode, FILE *fp)
  *  \brief  Debugging aid: print out the current status of all Blocks/Pars */
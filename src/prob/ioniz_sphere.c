@@ -4,6 +4,18 @@
  *
  * PURPOSE: Problem generator for an ionization front irradiating a spherical adiabatic atmosphere.
  *
+ * The mass-loss rate of the planet is measured in situ if shell_dnstep > 0 in
+ * the <problem> block: every shell_dnstep steps, the mass flux d*v_r and the
+ * neutral mass flux s[0]*v_r through shell_n spherical shells from shell_rmin
+ * to shell_rmax (default 8 shells from rp to 4rp) are appended to
+ * <problem_id>.mdot.  Each shell is measured on the finest Domain that holds
+ * it, by averaging over the zones within half a zone of it.
+ *
+ * The zones within 0.75 rp are reset to the initial profile every step, and
+ * are excised (see excise.c).  With excise_radiation = 1 in the <problem>
+ * block, the ionizing radiation also skips them, which is only exact while
+ * they stay optically thick and never limit the radiation time step.
+ *
  * AUTHORS: A. Tripathi, M. Krumholz, X. Bai
  *============================================================================*/
 
@@ -24,6 +36,17 @@ static Real GMstar, adist, GM,K,Cp,rp,rreset2,rho0,Rsoft, trad, flux;
 static Real TidalPot(const Real x1, const Real x2, const Real x3);
 static Real PlanetPot(const Real x1, const Real x2, const Real x3);
 static Real print_flux(const GridS *pG, const int i, const int j, const int k);
+static int in_reset(const Real x1, const Real x2, const Real x3);
+static int excise_rad;  /* 1 if the radiation skips the reset region */
+
+/* Shells of the mass-loss diagnostic: shell_n radii from shell_r0 in steps of
+ * shell_dr, each measured on Domain[shell_lev][shell_dom].  shell_dn < 0 until
+ * shell_init() has read the parameters, and 0 if the diagnostic is off. */
+static int shell_dn=-1, shell_n=0, *shell_lev=NULL, *shell_dom=NULL;
+static Real shell_r0, shell_dr;
+static void shell_init(MeshS *pM);
+static void shell_pick(MeshS *pM);
+static void shell_dump(MeshS *pM);
 
 void problem(DomainS *pDomain)
 {
@@ -162,8 +185,17 @@ void problem(DomainS *pDomain)
 /*   } */
 /*   else {ath_pout(0,"On domain level %d, number %d: Not adding a radiator plane\n", pDomain->Level, pDomain->DomNumber);} */
 
+/* Zones within rreset are held at the profile set above.  The radiation
+ * skips them only with excise_radiation=1 (approximate, see excise.c) */
+  excise_rad = par_geti_def("problem","excise_radiation",0);
+  excise_grid(pGrid, in_reset, excise_rad);
+  excise_save(pGrid);
+
 /* enroll gravity of planet */
   StaticGravPot = PlanetPot;
+
+  /* Userwork_in_loop() refolds the CFL signal speeds of every zone */
+  cfl_track_userwork();
 #ifdef SHEARING_BOX
   ShearingBoxPot = TidalPot;
 #endif
@@ -222,6 +254,20 @@ void problem_read_restart(MeshS *pM, FILE *fp)
   Cp = pow(rho0,Gamma_1) - (Gamma_1/Gamma)*GM/K/rin;
 
   Rsoft= 0.01*rp;
+
+  /* The restart was written after Userwork_in_loop(), so the zones within
+     rreset hold the profile */
+  excise_rad = par_geti_def("problem","excise_radiation",0);
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      if (pM->Domain[nl][nd].Grid != NULL) {
+        pGrid = pM->Domain[nl][nd].Grid;
+        excise_grid(pGrid, in_reset, excise_rad);
+        excise_save(pGrid);
+      }
+    }
+  }
+
 #ifdef ION_RADIATION  
   if (par_geti("problem","nradplanes") == 1) {  
     flux = par_getd("problem","flux");
@@ -231,6 +277,9 @@ void problem_read_restart(MeshS *pM, FILE *fp)
 #endif
 
   StaticGravPot = PlanetPot;
+
+  /* Userwork_in_loop() refolds the CFL signal speeds of every zone */
+  cfl_track_userwork();
 #ifdef SHEARING_BOX
   ShearingBoxPot = TidalPot;
 #endif
@@ -256,12 +305,10 @@ void Userwork_in_loop(MeshS *pM)
 {
   /*Use this function to fix the profile within rreset, at each timestep*/
 
-  Real x1,x2,x3,rad2,myrho,powindex;
+  Real x1,x2,x3,rad2;
   int is,ie,js,je,ks,ke, nl, nd, i, j, k;
   GridS *pGrid;
 
-  powindex=1.0/Gamma_1;
-
   for (nl=0; nl<(pM->NLevels); nl++){
     for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
       if (pM->Domain[nl][nd].Grid != NULL) {
@@ -270,30 +317,31 @@ void Userwork_in_loop(MeshS *pM)
 	is = pGrid->is;  ie = pGrid->ie;
 	js = pGrid->js;  je = pGrid->je;
 	ks = pGrid->ks;  ke = pGrid->ke;
-	
+
+	/*Reset values within the boundary to the saved profile*/
+	excise_reset(pGrid);
+
+	/*Interior zones of the excised region are never changed, and their
+	  signal speeds are folded once*/
+	cfl_reset(pGrid);
+	excise_cfl(pGrid);
 	for (k=ks; k<=ke; k++) {
 	  for (j=js; j<=je; j++) {
 	    for (i=is; i<=ie; i++) {
-	      cc_pos(pGrid,i,j,k,&x1,&x2,&x3);
-	      rad2 = x1*x1 + x2*x2 + x3*x3;
-
-	      if ((pGrid->U[k][j][i].d < 0) || isnan(pGrid->U[k][j][i].d)) fprintf(stderr, "Neg or NaN dens: %e at k:%d j:%d i:%d, rad: %f, lev:%d \n",pGrid->U[k][j][i].d, k, j, i, rad2, nl);
-	      if (pGrid->U[k][j][i].E < 0 || isnan(pGrid->U[k][j][i].E)) fprintf(stderr, "Neg or NaN E: %e at k:%d j:%d i:%d, rad: %f, lev:%d \n",pGrid->U[k][j][i].E, k, j, i, rad2, nl);
-
-	      /*Reset values within the boundary*/
-	      if (rad2 <= rreset2) { /*AT: May need to change this to a smaller r*/
-		myrho = pow(Gamma_1/Gamma*GM/K/MAX(sqrt(rad2),TINY_NUMBER) + Cp,powindex);
-		myrho = MIN(myrho, rho0);
-		pGrid->U[k][j][i].d  = myrho;
-		pGrid->U[k][j][i].M1 = 0.0;
-		pGrid->U[k][j][i].M2 = 0.0;
-		pGrid->U[k][j][i].M3 = 0.0;
-		pGrid->U[k][j][i].E = K*pow(myrho,Gamma)/Gamma_1; 
-		pGrid->U[k][j][i].s[0] = pGrid->U[k][j][i].d;
+	      if (EXCISE_SKIP(pGrid,i,j,k)) continue;
+
+	      if ((pGrid->U[k][j][i].d < 0) || isnan(pGrid->U[k][j][i].d) ||
+		  (pGrid->U[k][j][i].E < 0) || isnan(pGrid->U[k][j][i].E)) {
+		cc_pos(pGrid,i,j,k,&x1,&x2,&x3);
+		rad2 = x1*x1 + x2*x2 + x3*x3;
+		if ((pGrid->U[k][j][i].d < 0) || isnan(pGrid->U[k][j][i].d)) fprintf(stderr, "Neg or NaN dens: %e at k:%d j:%d i:%d, rad: %f, lev:%d \n",pGrid->U[k][j][i].d, k, j, i, rad2, nl);
+		if (pGrid->U[k][j][i].E < 0 || isnan(pGrid->U[k][j][i].E)) fprintf(stderr, "Neg or NaN E: %e at k:%d j:%d i:%d, rad: %f, lev:%d \n",pGrid->U[k][j][i].E, k, j, i, rad2, nl);
 	      }
+	      cfl_fold(pGrid,i,j,k);
 	    }
 	  }
 	}
+	pGrid->cfl_valid = 1;
       }
     }
   }
@@ -302,6 +350,11 @@ void Userwork_in_loop(MeshS *pM)
   /*   add_radplane_3d(pGrid, -1, flux); */
   /*   radplanecount = -999; /\*To avoid entering this loop again*\/ */
   /* } */
+
+  /*Mass-loss rates through the shells, every shell_dn steps*/
+  if (shell_dn < 0) shell_init(pM);
+  if (shell_dn > 0 && (pM->nstep + 1) % shell_dn == 0) shell_dump(pM);
+
   return;
 }
 
@@ -309,6 +362,15 @@ void Userwork_after_loop(MeshS *pM)
 {
 }
 
+/*------------------------------------------------------------------------------
+ * in_reset: zones within rreset, held at the initial profile
+ */
+
+static int in_reset(const Real x1, const Real x2, const Real x3)
+{
+  return (x1*x1 + x2*x2 + x3*x3 <= rreset2);
+}
+
 /*------------------------------------------------------------------------------
  * PlanetPot:
  */
@@ -346,6 +408,196 @@ static Real TidalPot(const Real x1, const Real x2, const Real x3)
 }
 
 
+/*------------------------------------------------------------------------------
+ * shell_init: reads the parameters of the shells
+ */
+
+static void shell_init(MeshS *pM)
+{
+  Real rmin, rmax;
+
+  shell_dn = par_geti_def("problem","shell_dnstep",0);
+  if (shell_dn <= 0) {
+    shell_dn = 0;
+    return;
+  }
+  shell_n = par_geti_def("problem","shell_n",8);
+  rmin = par_getd_def("problem","shell_rmin",rp);
+  rmax = par_getd_def("problem","shell_rmax",4.0*rp);
+  if (shell_n < 1 || rmin <= 0.0 || rmax < rmin)
+    ath_error("[ioniz_sphere]: bad shells: shell_n=%d, r=%e to %e\n",
+              shell_n, rmin, rmax);
+  shell_r0 = rmin;
+  shell_dr = (shell_n > 1) ? (rmax - rmin)/(Real)(shell_n - 1) : 1.0;
+
+  shell_lev = (int*)calloc_1d_array(shell_n, sizeof(int));
+  shell_dom = (int*)calloc_1d_array(shell_n, sizeof(int));
+  if (shell_lev == NULL || shell_dom == NULL)
+    ath_error("[ioniz_sphere]: malloc returned a NULL pointer\n");
+
+  return;
+}
+
+/*------------------------------------------------------------------------------
+ * shell_pick: picks for each shell the finest Domain that contains it within
+ *   half a zone.  Called before each dump, as the Domains change if the Mesh
+ *   is regridded (see refine_flag.c).
+ */
+
+static void shell_pick(MeshS *pM)
+{
+  DomainS *pD;
+  Real r, h;
+  int s, nl, nd, dim, inside;
+
+  /* Shells that leave the root Domain are averaged over the part inside */
+  for (s=0; s<shell_n; s++) {
+    r = shell_r0 + s*shell_dr;
+    shell_lev[s] = 0;
+    shell_dom[s] = 0;
+    for (nl=0; nl<(pM->NLevels); nl++){
+      for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+        pD = &(pM->Domain[nl][nd]);
+        h = 0.5*pD->dx[0];
+        inside = 1;
+        for (dim=0; dim<3; dim++) {
+          if (pD->Nx[dim] > 1 && (pD->MinX[dim] > -(r+h) ||
+                                  pD->MaxX[dim] < r+h)) inside = 0;
+        }
+        if (inside && nl >= shell_lev[s]) {
+          shell_lev[s] = nl;
+          shell_dom[s] = nd;
+        }
+      }
+    }
+  }
+
+  return;
+}
+
+/*------------------------------------------------------------------------------
+ * shell_dump: appends the mass-loss rates 4 pi r^2 <d*v_r> and 4 pi r^2
+ *   <s[0]*v_r> through each shell to <problem_id>.mdot, averaging over the
+ *   zones of its Domain within half a zone of it.  Called at the end of a
+ *   step, before pM->time is advanced.
+ */
+
+static void shell_dump(MeshS *pM)
+{
+  GridS *pG;
+  FILE *fp;
+  char *fname;
+  double *sum, *gsum=NULL;
+  Real x1, x2, x3, r, h, rs, rmax, mr;
+  int i, j, k, s, slo, shi, nl, nd, nuse;
+#ifdef MPI_PARALLEL
+  int ierr;
+#endif
+
+  shell_pick(pM);
+  sum = (double*)calloc_1d_array(3*shell_n, sizeof(double));
+  if (sum == NULL)
+    ath_error("[ioniz_sphere]: malloc returned a NULL pointer\n");
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      if (pM->Domain[nl][nd].Grid == NULL) continue;
+      pG = pM->Domain[nl][nd].Grid;
+
+      /* Only the zones near the shells measured on this Domain are visited */
+      nuse = 0;
+      rmax = 0.0;
+      for (s=0; s<shell_n; s++) {
+        if (shell_lev[s] != nl || shell_dom[s] != nd) continue;
+        nuse++;
+        rmax = shell_r0 + s*shell_dr;
+      }
+      if (nuse == 0) continue;
+      h = 0.5*pG->dx1;
+      rmax += h;
+
+      for (k=pG->ks; k<=pG->ke; k++) {
+        cc_pos(pG,pG->is,pG->js,k,&x1,&x2,&x3);
+        if (fabs(x3) > rmax) continue;
+        for (j=pG->js; j<=pG->je; j++) {
+          cc_pos(pG,pG->is,j,k,&x1,&x2,&x3);
+          if (fabs(x2) > rmax) continue;
+          for (i=pG->is; i<=pG->ie; i++) {
+            cc_pos(pG,i,j,k,&x1,&x2,&x3);
+            r = sqrt(x1*x1 + x2*x2 + x3*x3);
+            if (r > rmax || r < shell_r0 - h) continue;
+            slo = MAX(0, (int)ceil((r - h - shell_r0)/shell_dr));
+            shi = MIN(shell_n-1, (int)floor((r + h - shell_r0)/shell_dr));
+            for (s=slo; s<=shi; s++) {
+              rs = shell_r0 + s*shell_dr;
+              if (shell_lev[s] != nl || shell_dom[s] != nd ||
+                  rs <= r - h || rs > r + h) continue;
+              mr = (pG->U[k][j][i].M1*x1 + pG->U[k][j][i].M2*x2 +
+                    pG->U[k][j][i].M3*x3)/r;
+              sum[3*s]   += 1.0;
+              sum[3*s+1] += mr;
+              sum[3*s+2] += mr*pG->U[k][j][i].s[0]/pG->U[k][j][i].d;
+            }
+          }
+        }
+      }
+    }
+  }
+
+#ifdef MPI_PARALLEL
+  if (myID_Comm_world == 0) {
+    gsum = (double*)calloc_1d_array(3*shell_n, sizeof(double));
+    if (gsum == NULL)
+      ath_error("[ioniz_sphere]: malloc returned a NULL pointer\n");
+  }
+  ierr = MPI_Reduce(sum, gsum, 3*shell_n, MPI_DOUBLE, MPI_SUM, 0,
+                    MPI_COMM_WORLD);
+  free_1d_array(sum);
+  if (myID_Comm_world != 0) return;
+#else
+  gsum = sum;
+#endif
+
+  if ((fname = ath_fname(NULL,pM->outfilename,NULL,NULL,0,0,NULL,"mdot"))
+      == NULL)
+    ath_error("[ioniz_sphere]: Error constructing filename\n");
+
+  /* Column headers, if the file is new */
+  if ((fp = fopen(fname,"r")) != NULL) {
+    fclose(fp);
+    fp = fopen(fname,"a");
+  } else if ((fp = fopen(fname,"w")) != NULL) {
+    fprintf(fp,"# Mass-loss rates through spherical shells (mass/time)\n");
+    fprintf(fp,"#   [1]=time   ");
+    for (s=0; s<shell_n; s++) {
+      rs = shell_r0 + s*shell_dr;
+      fprintf(fp,"   [%d]=Mdot(r=%.3e,lev%d)",2*s+2,rs,shell_lev[s]);
+      fprintf(fp,"   [%d]=Mdot_n(r=%.3e,lev%d)",2*s+3,rs,shell_lev[s]);
+    }
+    fprintf(fp,"\n#\n");
+  }
+  if (fp == NULL)
+    ath_error("[ioniz_sphere]: Unable to open %s\n",fname);
+
+  fprintf(fp,"%14.6e",pM->time + pM->dt);
+  for (s=0; s<shell_n; s++) {
+    rs = shell_r0 + s*shell_dr;
+    if (gsum[3*s] > 0.0) {
+      fprintf(fp," %14.6e %14.6e",4.0*PI*rs*rs*gsum[3*s+1]/gsum[3*s],
+              4.0*PI*rs*rs*gsum[3*s+2]/gsum[3*s]);
+    } else {
+      fprintf(fp," %14.6e %14.6e",0.0,0.0);
+    }
+  }
+  fprintf(fp,"\n");
+  fclose(fp);
+
+  free(fname);
+  free_1d_array(gsum);
+
+  return;
+}
+
 #ifdef ION_RADIATION
 /*----------------------------------------------------------------------------*/
 /*! \fn static print_flux(const Grid *pG,const int i,const int j,
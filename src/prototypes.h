@@ -65,6 +65,13 @@ char *ath_fname(const char *path, const char *basename,
 void ath_sig_init(void);
 int  ath_sig_act(int *piquit);
 
+/*----------------------------------------------------------------------------*/
+/* ath_zip.c */
+#ifdef ZLIB_ENABLED
+void ath_zwrite(const float *data, const long n, const int mode,
+                const Real tol, FILE *fp);
+#endif
+
 /*----------------------------------------------------------------------------*/
 /* baton.c */
 void baton_start(const int Nb, const int tag);
@@ -74,7 +81,12 @@ void baton_stop(const int Nb, const int tag);
 /* bvals_mhd.c  */
 void bvals_mhd_init(MeshS *pM);
 void bvals_mhd_fun(DomainS *pD, enum BCDirection dir, VGFun_t prob_bc);
+void bvals_mhd_destruct(MeshS *pM);
 void bvals_mhd(DomainS *pDomain);
+void bvals_mhd_start(DomainS *pD);
+void bvals_mhd_finish(DomainS *pD);
+double bvals_mhd_wait_time(void);
+double bvals_mhd_bytes_saved(void);
 
 /*----------------------------------------------------------------------------*/
 /* bvals_shear.c  */
@@ -133,18 +145,39 @@ Prim1DS check_Prim1D (const Cons1DS *pU, const Real *pBx);
 #endif /* SPECIAL_RELATIVITY */
 
 
+/*----------------------------------------------------------------------------*/
+/* excise.c */
+void excise_grid(GridS *pG, ExciseFun_t inside, const int rad);
+void excise_save(GridS *pG);
+void excise_reset(GridS *pG);
+void excise_cfl(GridS *pG);
+void excise_regrid(GridS *pG);
+void excise_free(GridS *pG);
+
 /*----------------------------------------------------------------------------*/
 /* init_grid.c */
 void init_grid(MeshS *pM);
+void grid_destruct(GridS *pG);
 
 /*----------------------------------------------------------------------------*/
 /* init_mesh.c */
 void init_mesh(MeshS *pM);
 void get_myGridIndex(DomainS *pD, const int my_id, int *pi, int *pj, int *pk);
+#ifdef MPI_PARALLEL
+void decomp_calibrate(MeshS *pM, const double t_hydro, const double t_rad,
+                      const double t_comm, const int nstep);
+int get_nGrids(MeshS *pM);
+int get_myGridID(MeshS *pM, const int nl, const int nd);
+int rebalance_check(MeshS *pM, const Real threshold);
+#endif
 
 /*----------------------------------------------------------------------------*/
 /* new_dt.c */
 void new_dt(MeshS *pM);
+void cfl_reset(GridS *pG);
+void cfl_fold(GridS *pG, const int i, const int j, const int k);
+void cfl_track_userwork(void);
+void cfl_userwork_done(MeshS *pM);
 
 /*----------------------------------------------------------------------------*/
 /* output.c - and related files */
@@ -156,11 +189,15 @@ void dump_history_enroll(const ConsFun_t pfun, const char *label);
 Real ***OutData3(GridS *pGrid, OutputS *pOut, int *Nx1, int *Nx2, int *Nx3);
 Real  **OutData2(GridS *pGrid, OutputS *pOut, int *Nx1, int *Nx2);
 Real   *OutData1(GridS *pGrid, OutputS *pOut, int *Nx1);
+Real ***OutField3(GridS *pGrid, OutputS *pOut, int *Nx1, int *Nx2, int *Nx3);
+PrimS ***OutPrim3(GridS *pGrid, int *Nx1, int *Nx2, int *Nx3);
 
 void output_pdf  (MeshS *pM, OutputS *pOut);
 void output_pgm  (MeshS *pM, OutputS *pOut);
 void output_ppm  (MeshS *pM, OutputS *pOut);
+void output_comp (MeshS *pM, OutputS *pOut);
 void output_vtk  (MeshS *pM, OutputS *pOut);
+void output_vti  (MeshS *pM, OutputS *pOut);
 void output_tab  (MeshS *pM, OutputS *pOut);
 
 void dump_binary  (MeshS *pM, OutputS *pOut);
@@ -168,6 +205,7 @@ void dump_history (MeshS *pM, OutputS *pOut);
 void dump_tab_cons(MeshS *pM, OutputS *pOut);
 void dump_tab_prim(MeshS *pM, OutputS *pOut);
 void dump_vtk     (MeshS *pM, OutputS *pOut);
+void dump_vti     (MeshS *pM, OutputS *pOut);
 
 /*----------------------------------------------------------------------------*/
 /* par.c */
@@ -186,6 +224,7 @@ double par_getd_def(char *block, char *name, double def);
 void   par_sets(char *block, char *name, char *sval, char *comment);
 void   par_seti(char *block, char *name, char *fmt, int ival, char *comment);
 void   par_setd(char *block, char *name, char *fmt, double dval, char *comment);
+void   par_unset(char *block, char *name);
 
 void   par_dump(int mode, FILE *fp);
 void   par_close(void);
@@ -209,10 +248,22 @@ void gasvshift(const Real x1, const Real x2, const Real x3, Real *u1, Real *u2,
 void Userforce_particle(Vector *ft, const Real x1, const Real x2, const Real x3, const Real v1, const Real v2, const Real v3);
 #endif
 
+/*----------------------------------------------------------------------------*/
+/* refine_flag.c  */
+void refine_flag_init(MeshS *pM);
+int refine_flag(MeshS *pM);
+void migrate_grids(MeshS *pM);
+
 /*----------------------------------------------------------------------------*/
 /* restart.c  */
 void dump_restart(MeshS *pM, OutputS *pout);
 void restart_grids(char *res_file, MeshS *pM);
+void restart_reset(void);
+long restart_pack_grid(GridS *pG, Real *buf, const int unpack);
+#ifdef MPI_PARALLEL
+void read_grid_layout(char *res_file);
+int *restart_grid_ranks(MeshS *pM);
+#endif
 
 /*----------------------------------------------------------------------------*/
 /* show_config.c */
@@ -223,7 +274,17 @@ void show_config_par(void);
 /* smr.c */
 void RestrictCorrect(MeshS *pM);
 void Prolongate(MeshS *pM);
+void RestrictCorrectLevel(MeshS *pM, const int nl);
+void ProlongateLevel(MeshS *pM, const int nl, const Real w);
+void ProlongateSave(MeshS *pM, const int nl);
+void RestrictCorrectStep(MeshS *pM, const int nl);
+void ProlongateStep(MeshS *pM, const int nl);
+void SMR_report(void);
+void SubcycleFluxes(MeshS *pM, const int nl, const int substep);
 void SMR_init(MeshS *pM);
+void SMR_destruct(void);
+void ProCon(GridS *pG, Real ****pq, const int ips, const int ipe,
+            const int jps, const int jpe, const int kps, const int kpe);
 
 void ionradRestrictCorrect(MeshS *pM);
 
@@ -257,4 +318,23 @@ Real vecpot2b3i(Real (*A1)(Real,Real,Real), Real (*A2)(Real,Real,Real),
 void InverseMatrix(Real **a, int n, Real **b);
 void MatrixMult(Real **a, Real **b, int m, int n, int l, Real **c);
 #endif
+
+/*----------------------------------------------------------------------------*/
+/* vtk_file.c */
+void vtk_open(MeshS *pM, OutputS *pOut, const int nl, const int nd,
+              const char *id, const int nx[3]);
+void vtk_dataset(void);
+void vtk_printf(const char *fmt, ...);
+void vtk_write(float *data, const int ncomp);
+void vtk_close(void);
+void vtk_flush(void);
+void vtk_report(void);
+void vti_header(const Real time, const int narr, char *name[],
+                const int ncomp[]);
+void vti_write(float *data, const int ncomp);
+void vti_close(void);
+void vti_index(MeshS *pM, OutputS *pOut, const int nl, const int nd,
+               const char *id, const int narr, char *name[],
+               const int ncomp[]);
+void vti_blocks(MeshS *pM, OutputS *pOut, const char *id);
 #endif /* PROTOTYPES_H */
@@ -256,7 +256,7 @@ void lr_states(const GridS *pG, const Prim1DS W[], const Real Bxc[],
 
 #elif defined(HLLE_FLUX) || defined(HLLC_FLUX) || defined(HLLD_FLUX)
 
-    for (n=0; n<NWAVE; n++) {
+    for (n=0; n<(NWAVE+NSCALARS); n++) {
       pWl[n] = Wrv[n];
       pWr[n] = Wlv[n];
     }
@@ -293,6 +293,13 @@ void lr_states(const GridS *pG, const Prim1DS W[], const Real Bxc[],
       }
     }
 
+/* Advected quantities are carried by the entropy wave, at speed Vx */
+    for (n=NWAVE; n<(NWAVE+NSCALARS); n++) {
+      qx = 0.5*dtodx*W[i].Vx;
+      if (hllallwave_flag || W[i].Vx > 0.) pWl[n] -= qx*dW[n];
+      if (hllallwave_flag || W[i].Vx < 0.) pWr[n] -= qx*dW[n];
+    }
+
 #else  /* include steps 8-9 only if using CTU integrator (AND NOT HLL) */   
     qx = 0.5*MAX(ev[NWAVE-1],0.0)*dtodx;
 #ifdef CYLINDRICAL
@@ -508,7 +508,7 @@ void lr_states(const GridS* pG, const Prim1DS W[], const Real Bxc[],
 
 
 #elif defined(HLLE_FLUX) || defined(HLLC_FLUX) || defined(HLLD_FLUX)
-    for (n=0; n<NWAVE; n++) {
+    for (n=0; n<(NWAVE+NSCALARS); n++) {
       pWl[n] = Wrv[n];
       pWr[n] = Wlv[n];
     }
@@ -555,6 +555,16 @@ void lr_states(const GridS* pG, const Prim1DS W[], const Real Bxc[],
       }
     }
 
+/* Advected quantities are carried by the entropy wave, at speed Vx */
+    for (n=NWAVE; n<(NWAVE+NSCALARS); n++) {
+      qx1 = 0.5*dtodx*W[i].Vx;
+      qc  = FOUR_3RDS*SQR(qx1);
+      if (hllallwave_flag || W[i].Vx > 0.0)
+        pWl[n] -= qx1*(dW[n]-W6[n]) + qc*W6[n];
+      if (hllallwave_flag || W[i].Vx < 0.0)
+        pWr[n] -= qx1*(dW[n]+W6[n]) + qc*W6[n];
+    }
+
 
 #else /* include steps 18-19 only if using CTU integrator */
 
@@ -0,0 +1,1281 @@
+#include "copyright.h"
+/*============================================================================*/
+/*! \file refine_flag.c
+ *  \brief Flags cells that need refinement, and regrids the fine Domains of
+ *   the Mesh to cover them.
+ *
+ * PURPOSE: Flags cells that need refinement, and regrids the fine Domains of
+ *   the Mesh to cover them.  A cell is flagged if the relative jump in
+ *   density to a neighbor exceeds refine_dgrad, or (with passive scalars) the
+ *   jump in neutral fraction s[0]/d exceeds refine_xgrad.  Neighbors in the
+ *   ghost zones count, so jumps across the edges of Grids are flagged too.
+ *
+ *   Every refine_interval steps (all in <job>; 0 turns this off) the flagged
+ *   cells of each level mark the root cells they lie in, padded by
+ *   refine_buffer cells of that level, for refinement on the next level.
+ *   Connected marked root cells are grouped into boxes, which are made to
+ *   nest as init_mesh() requires (see fix_boxes()).  Levels are built from the
+ *   finest down, so that each box contains the boxes of the next level with
+ *   the margin they need.  The finest level keeps its Domains while none of
+ *   its parent's cells is flagged.  The number of levels is fixed.
+ *
+ *   If the boxes differ from the Domains, the <domain> blocks of the fine
+ *   levels in the par database are rewritten, and the Mesh is rebuilt with
+ *   init_mesh() and init_grid().  Each fine level is then prolongated from the
+ *   new level below, and overwritten by the old data of that level where
+ *   there is any.  Restart files written afterwards hold the new Domains.
+ *
+ *   Regridding requires SMR with the root Domain in <domain1>, and with MPI
+ *   decomp_plan=1, so that the new Domains are divided into Grids (of at least
+ *   nghost cells) by the planner.  MHD, self-gravity, particles, the shearing
+ *   box, FARGO and explicit diffusion are not supported.  Boundary functions
+ *   enrolled by the problem with bvals_mhd_fun() are carried over to new
+ *   Domains at the same edge of the root Domain, on ranks that held such a
+ *   Domain before; other ranks use the function given by the BC flag.
+ *
+ *   With MPI and rebalance_interval in <job>, migrate_grids() rebuilds the
+ *   Mesh the same way, with the same Domains, to move Grids to the ranks
+ *   planned by rebalance_check() in init_mesh.c.  The data of each Grid is
+ *   sent to its new rank in the sections of a restart file (see
+ *   restart_pack_grid()).  The same physics is supported as for regridding.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ * - refine_flag_init() - reads parameters
+ * - refine_flag()      - flags cells and regrids the Mesh
+ * - migrate_grids()    - moves Grids to the ranks planned for load balance  */
+/*============================================================================*/
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "athena.h"
+#include "globals.h"
+#include "prototypes.h"
+
+/* Parameters, set from <job> in refine_flag_init() */
+static int interval=0, buffer=4;
+static Real dgrad=0.5, xgrad=0.1;
+
+#ifdef STATIC_MESH_REFINEMENT
+/*! \struct RBoxS
+ *  \brief Box of root cells lo[n] to hi[n]-1 in each direction */
+typedef struct RBox_s{
+  int lo[3], hi[3];
+}RBoxS;
+
+/*! \struct RPatchS
+ *  \brief Cells lo[n] to hi[n]-1 (indices on their level) held by rank; on
+ *   that rank, cell i,j,k is U[k-org[2]][j-org[1]][i-org[0]] of Grid pG */
+typedef struct RPatch_s{
+  int lo[3], hi[3];
+  int rank;
+  ConsS ***U;
+  int org[3];
+  GridS *pG;
+}RPatchS;
+
+/* Boundary functions at the six faces of the root Domain (ix1,ox1,..,ox3),
+ * from Domains on this rank at those faces */
+static VGFun_t bc_fun[6];
+#endif /* STATIC_MESH_REFINEMENT */
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   flag_jump()    - tests the jump between two cells
+ *   flag_level()   - marks root cells with flagged cells of a level
+ *   dilate()       - pads the marked root cells
+ *   find_boxes()   - bounding boxes of connected marked root cells
+ *   add_box()      - appends a box to a list
+ *   fix_boxes()    - makes the boxes of a level valid Domains
+ *   cmp_box()      - orders boxes for qsort()
+ *   domain_box()   - box of root cells covered by a Domain
+ *   save_bcfun()   - saves the boundary functions at the root faces
+ *   regrid()       - rebuilds the Mesh with new fine Domains
+ *   build_mesh()   - builds a new Mesh from the par database
+ *   finish_mesh()  - sets ghost zones of a new Mesh, and frees the old one
+ *   move_grids()   - sends the data of each Grid to its new rank
+ *   get_patches()  - lists the Grids of a level
+ *   copy_patches() - copies cells between Grids, across ranks
+ *   copy_cells()   - copies cells between two patches on this rank
+ *   pack_cells()   - copies cells of a patch to or from a message buffer
+ *   prolong_level()- fills a level by prolongation of the level below
+ *   free_domains() - frees the Domains and Grids of the old Mesh
+ *============================================================================*/
+
+static int flag_jump(const ConsS *pU0, const ConsS *pU1);
+#ifdef STATIC_MESH_REFINEMENT
+static void flag_level(MeshS *pM, const int nl, char *flag);
+static void dilate(const int *nr, const int pad, char *flag, char *work);
+static int find_boxes(const int *nr, char *flag, int *stack, RBoxS **box,
+                      int *max);
+static void add_box(RBoxS **box, int *n, int *max, const RBoxS *pB);
+static int fix_boxes(MeshS *pM, const int nl, RBoxS *box, int n);
+static int cmp_box(const void *a, const void *b);
+static void domain_box(const DomainS *pD, RBoxS *pB);
+static void save_bcfun(MeshS *pM);
+static void regrid(MeshS *pM, RBoxS **box, const int *nbox);
+static void build_mesh(MeshS *pM, MeshS *pOld);
+static void finish_mesh(MeshS *pM, MeshS *pOld);
+#ifdef MPI_PARALLEL
+static void move_grids(MeshS *pOld, MeshS *pM);
+#endif
+static int get_patches(MeshS *pM, const int nl, RPatchS **patch);
+static void copy_patches(const int nsrc, RPatchS *src, const int ndst,
+                         RPatchS *dst);
+static void copy_cells(const RPatchS *pS, RPatchS *pD, const int *lo,
+                       const int *hi);
+#ifdef MPI_PARALLEL
+static void pack_cells(RPatchS *pP, const int *lo, const int *hi, ConsS *buf,
+                       const int unpack);
+#endif
+static void prolong_level(MeshS *pM, const int nl);
+static void free_domains(MeshS *pM);
+#endif /* STATIC_MESH_REFINEMENT */
+
+/*=========================== PUBLIC FUNCTIONS ===============================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn void refine_flag_init(MeshS *pM)
+ *  \brief Reads the refinement criteria from <job>, and checks that the Mesh
+ *   can be regridded, or rebuilt by migrate_grids() */
+
+void refine_flag_init(MeshS *pM)
+{
+  int rebal=0;
+
+#ifdef MPI_PARALLEL
+  rebal = (par_geti_def("job","rebalance_interval",0) > 0);
+#endif
+  interval = par_geti_def("job","refine_interval",0);
+  if (interval <= 0 && !rebal) return;
+  if (interval > 0) {
+    dgrad = par_getd_def("job","refine_dgrad",0.5);
+    xgrad = par_getd_def("job","refine_xgrad",0.1);
+    buffer = par_geti_def("job","refine_buffer",4);
+    if (buffer < 0)
+      ath_error("[refine_flag_init]: refine_buffer=%d must be >= 0\n",buffer);
+  }
+
+#ifndef STATIC_MESH_REFINEMENT
+  if (interval > 0)
+    ath_error("[refine_flag_init]: refine_interval requires --enable-smr\n");
+#else
+#if defined(MHD) || defined(SELF_GRAVITY) || defined(PARTICLES) || defined(SHEARING_BOX) || defined(FARGO)
+  ath_error("[refine_flag_init]: refine_interval and rebalance_interval not supported with MHD, self-gravity, particles, shearing box or FARGO\n");
+#endif
+#if defined(RESISTIVITY) || defined(VISCOSITY) || defined(THERMAL_CONDUCTION)
+  ath_error("[refine_flag_init]: refine_interval and rebalance_interval not supported with explicit diffusion\n");
+#endif
+  if (interval > 0) {
+#ifdef MPI_PARALLEL
+    if (par_geti_def("job","decomp_plan",0) == 0)
+      ath_error("[refine_flag_init]: refine_interval requires decomp_plan=1\n");
+#endif
+    if (pM->Domain[0][0].InputBlock != 1)
+      ath_error("[refine_flag_init]: refine_interval requires the root Domain in <domain1>\n");
+  }
+
+  save_bcfun(pM);
+#endif /* STATIC_MESH_REFINEMENT */
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn int refine_flag(MeshS *pM)
+ *  \brief Every refine_interval steps, flags cells on all Grids, and regrids
+ *   the Mesh if the boxes that cover them differ from the fine Domains.
+ *   Returns 1 if the Mesh was regridded, in which case the integrator and
+ *   radiation arrays must be allocated again.  Must be called by all ranks,
+ *   with the ghost zones of all Grids set. */
+
+int refine_flag(MeshS *pM)
+{
+#ifdef STATIC_MESH_REFINEMENT
+  RBoxS **box,b;
+  int *nbox,*maxbox,*stack;
+  char *flag,*work;
+  int nl,nd,n,m,ntot,nr[3],irefine,changed=0;
+  double cells,cells_old;
+#ifdef MPI_PARALLEL
+  int ierr;
+#endif
+
+  if (interval <= 0 || (pM->nstep % interval) != 0 || pM->NLevels < 2)
+    return 0;
+
+  for (n=0; n<3; n++) nr[n] = pM->Nx[n];
+  ntot = nr[0]*nr[1]*nr[2];
+  flag = (char*)calloc_1d_array(ntot,sizeof(char));
+  work = (char*)calloc_1d_array(ntot,sizeof(char));
+  stack = (int*)calloc_1d_array(ntot,sizeof(int));
+  box = (RBoxS**)calloc_1d_array(pM->NLevels,sizeof(RBoxS*));
+  nbox = (int*)calloc_1d_array(pM->NLevels,sizeof(int));
+  maxbox = (int*)calloc_1d_array(pM->NLevels,sizeof(int));
+  if (flag == NULL || work == NULL || stack == NULL || box == NULL ||
+      nbox == NULL || maxbox == NULL)
+    ath_error("[refine_flag]: malloc returned a NULL pointer\n");
+
+/* Boxes of each level, from the finest down */
+
+  for (nl=(pM->NLevels)-1; nl>0; nl--){
+    memset(flag, 0, ntot);
+    flag_level(pM, nl, flag);
+#ifdef MPI_PARALLEL
+    ierr = MPI_Allreduce(flag, work, ntot, MPI_BYTE, MPI_BOR, MPI_COMM_WORLD);
+    memcpy(flag, work, ntot);
+#endif
+    irefine = 1<<(nl-1);
+    dilate(nr, (buffer + irefine - 1)/irefine, flag, work);
+    nbox[nl] = find_boxes(nr, flag, stack, &box[nl], &maxbox[nl]);
+
+/* Each box of the next level, with the margin of nghost/2 cells of level nl
+ * that init_mesh() requires between it and its parent */
+
+    if (nl < (pM->NLevels)-1) {
+      m = (nghost + 4*irefine - 1)/(4*irefine);
+      for (nd=0; nd<nbox[nl+1]; nd++){
+        b = box[nl+1][nd];
+        for (n=0; n<3; n++){
+          if (nr[n] == 1) continue;
+          b.lo[n] = MAX(b.lo[n] - m, 0);
+          b.hi[n] = MIN(b.hi[n] + m, nr[n]);
+        }
+        add_box(&box[nl], &nbox[nl], &maxbox[nl], &b);
+      }
+    }
+
+/* The finest level keeps its Domains if nothing is flagged */
+
+    if (nbox[nl] == 0) {
+      for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+        domain_box(&(pM->Domain[nl][nd]), &b);
+        add_box(&box[nl], &nbox[nl], &maxbox[nl], &b);
+      }
+    }
+
+    nbox[nl] = fix_boxes(pM, nl, box[nl], nbox[nl]);
+    qsort(box[nl], nbox[nl], sizeof(RBoxS), cmp_box);
+  }
+
+/* Compare with the Domains, which are sorted the same way */
+
+  ath_pout(0,"[refine_flag]: cycle %d\n",pM->nstep);
+  for (nl=1; nl<(pM->NLevels); nl++){
+    irefine = 1<<nl;
+    cells = cells_old = 0.0;
+    for (nd=0; nd<nbox[nl]; nd++){
+      b = box[nl][nd];
+      cells += (double)(b.hi[0]-b.lo[0])*(double)(b.hi[1]-b.lo[1])*
+        (double)(b.hi[2]-b.lo[2]);
+    }
+    for (n=0; n<3; n++) if (nr[n] > 1) cells *= irefine;
+    if (nbox[nl] != pM->DomainsPerLevel[nl]) changed = 1;
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      domain_box(&(pM->Domain[nl][nd]), &b);
+      cells_old += (double)pM->Domain[nl][nd].Nx[0]*
+        (double)pM->Domain[nl][nd].Nx[1]*(double)pM->Domain[nl][nd].Nx[2];
+      if (!changed) {
+        for (n=0; n<3; n++){
+          if (b.lo[n] != box[nl][nd].lo[n] || b.hi[n] != box[nl][nd].hi[n])
+            changed = 1;
+        }
+      }
+    }
+    ath_pout(0,"  level %d: %d Domains of %e cells (now %d of %e cells)\n",
+      nl,nbox[nl],cells,pM->DomainsPerLevel[nl],cells_old);
+  }
+
+  if (changed) {
+    regrid(pM, box, nbox);
+    for (nl=1; nl<(pM->NLevels); nl++){
+      for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+        ath_pout(0,"  level %d domain %d: iDisp=%d jDisp=%d kDisp=%d"
+          " Nx=%d,%d,%d\n",
+          nl,nd,pM->Domain[nl][nd].Disp[0],pM->Domain[nl][nd].Disp[1],
+          pM->Domain[nl][nd].Disp[2],pM->Domain[nl][nd].Nx[0],
+          pM->Domain[nl][nd].Nx[1],pM->Domain[nl][nd].Nx[2]);
+      }
+    }
+  } else {
+    ath_pout(0,"  Domains unchanged\n");
+  }
+
+  for (nl=1; nl<(pM->NLevels); nl++)
+    if (box[nl] != NULL) free(box[nl]);
+  free_1d_array(box);
+  free_1d_array(nbox);
+  free_1d_array(maxbox);
+  free_1d_array(flag);
+  free_1d_array(work);
+  free_1d_array(stack);
+  return changed;
+#else
+  return 0;
+#endif /* STATIC_MESH_REFINEMENT */
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void migrate_grids(MeshS *pM)
+ *  \brief Rebuilds the Mesh with the same Domains and Grids, on the ranks
+ *   planned by rebalance_check(), and moves the data of each Grid to its new
+ *   rank.  The integrator and radiation arrays must then be allocated again,
+ *   as after a regrid.  Must be called by all ranks. */
+
+void migrate_grids(MeshS *pM)
+{
+#if defined(STATIC_MESH_REFINEMENT) && defined(MPI_PARALLEL)
+  MeshS old = *pM;
+  int nl,nd;
+
+  save_bcfun(pM);
+  bvals_mhd_destruct(pM);
+  SMR_destruct();
+  restart_reset();
+
+  build_mesh(pM, &old);
+  move_grids(&old, pM);
+  finish_mesh(pM, &old);
+
+/* The Grids keep the time step (spread as by new_dt()) */
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      if (pM->Domain[nl][nd].Grid != NULL) {
+        if (pM->subcycle)
+          pM->Domain[nl][nd].Grid->dt = pM->dt/(Real)(1 << nl);
+        else
+          pM->Domain[nl][nd].Grid->dt = pM->dt;
+      }
+    }
+  }
+#else
+  ath_error("[migrate_grids]: requires --enable-smr and --enable-mpi\n");
+#endif
+
+  return;
+}
+
+/*=========================== PRIVATE FUNCTIONS ==============================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn static int flag_jump(const ConsS *pU0, const ConsS *pU1)
+ *  \brief Returns 1 if the jump in density or neutral fraction between two
+ *   cells exceeds the refinement criteria */
+
+static int flag_jump(const ConsS *pU0, const ConsS *pU1)
+{
+  if (fabs(pU1->d - pU0->d) > dgrad*MIN(pU0->d,pU1->d)) return 1;
+#if (NSCALARS > 0)
+  if (fabs(pU1->s[0]/pU1->d - pU0->s[0]/pU0->d) > xgrad) return 1;
+#endif
+  return 0;
+}
+
+#ifdef STATIC_MESH_REFINEMENT
+/*----------------------------------------------------------------------------*/
+/*! \fn static void flag_level(MeshS *pM, const int nl, char *flag)
+ *  \brief Sets flag[] to 1 for each root cell that holds a flagged cell of a
+ *   Grid on level nl-1 on this rank.  Each active cell is compared with its
+ *   neighbors in all directions, including those in the ghost zones. */
+
+static void flag_level(MeshS *pM, const int nl, char *flag)
+{
+  GridS *pG;
+  ConsS *pU;
+  const int irefine = 1<<(nl-1);
+  int nd,i,j,k,g[3];
+
+  for (nd=0; nd<(pM->DomainsPerLevel[nl-1]); nd++){
+    pG = pM->Domain[nl-1][nd].Grid;
+    if (pG == NULL) continue;
+
+    for (k=pG->ks; k<=pG->ke; k++){
+    for (j=pG->js; j<=pG->je; j++){
+    for (i=pG->is; i<=pG->ie; i++){
+      pU = &(pG->U[k][j][i]);
+      if (!(flag_jump(pU,&pG->U[k][j][i-1]) ||
+            flag_jump(pU,&pG->U[k][j][i+1]) ||
+            (pG->Nx[1] > 1 && (flag_jump(pU,&pG->U[k][j-1][i]) ||
+                               flag_jump(pU,&pG->U[k][j+1][i]))) ||
+            (pG->Nx[2] > 1 && (flag_jump(pU,&pG->U[k-1][j][i]) ||
+                               flag_jump(pU,&pG->U[k+1][j][i])))))
+        continue;
+      g[0] = (i - pG->is + pG->Disp[0])/irefine;
+      g[1] = (j - pG->js + pG->Disp[1])/irefine;
+      g[2] = (k - pG->ks + pG->Disp[2])/irefine;
+      flag[g[0] + pM->Nx[0]*(g[1] + pM->Nx[1]*g[2])] = 1;
+    }}}
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void dilate(const int *nr, const int pad, char *flag,
+ *                         char *work)
+ *  \brief Marks all root cells within pad cells (in each direction) of a
+ *   marked root cell, one direction at a time */
+
+static void dilate(const int *nr, const int pad, char *flag, char *work)
+{
+  const int ntot = nr[0]*nr[1]*nr[2];
+  int c,d,i,l,stride;
+
+  if (pad == 0) return;
+
+  for (d=0; d<3; d++){
+    if (nr[d] == 1) continue;
+    stride = (d == 0) ? 1 : ((d == 1) ? nr[0] : nr[0]*nr[1]);
+    memcpy(work, flag, ntot);
+    for (c=0; c<ntot; c++){
+      if (!work[c]) continue;
+      i = (c/stride) % nr[d];
+      for (l=MAX(i-pad,0); l<=MIN(i+pad,nr[d]-1); l++)
+        flag[c + (l-i)*stride] = 1;
+    }
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int find_boxes(const int *nr, char *flag, int *stack,
+ *                            RBoxS **box, int *max)
+ *  \brief Replaces *box with the bounding boxes of the sets of marked root
+ *   cells connected through faces, edges or corners, and returns their number.
+ *   Visited cells are set to 2 in flag[]; stack[] must hold every cell. */
+
+static int find_boxes(const int *nr, char *flag, int *stack, RBoxS **box,
+                      int *max)
+{
+  RBoxS b;
+  int c,c1,n=0,ns,d,ijk[3],nb[3],di,dj,dk;
+
+  for (c=0; c<nr[0]*nr[1]*nr[2]; c++){
+    if (flag[c] != 1) continue;
+
+    flag[c] = 2;
+    stack[0] = c;
+    ns = 1;
+    b.lo[0] = b.lo[1] = b.lo[2] = INT_MAX;
+    b.hi[0] = b.hi[1] = b.hi[2] = 0;
+    while (ns > 0) {
+      c1 = stack[--ns];
+      ijk[0] = c1 % nr[0];
+      ijk[1] = (c1/nr[0]) % nr[1];
+      ijk[2] = c1/(nr[0]*nr[1]);
+      for (d=0; d<3; d++){
+        b.lo[d] = MIN(b.lo[d],ijk[d]);
+        b.hi[d] = MAX(b.hi[d],ijk[d]+1);
+      }
+      for (dk=-1; dk<=1; dk++){
+      for (dj=-1; dj<=1; dj++){
+      for (di=-1; di<=1; di++){
+        nb[0] = ijk[0] + di;
+        nb[1] = ijk[1] + dj;
+        nb[2] = ijk[2] + dk;
+        if (nb[0] < 0 || nb[0] >= nr[0] || nb[1] < 0 || nb[1] >= nr[1] ||
+            nb[2] < 0 || nb[2] >= nr[2]) continue;
+        c1 = nb[0] + nr[0]*(nb[1] + nr[1]*nb[2]);
+        if (flag[c1] != 1) continue;
+        flag[c1] = 2;
+        stack[ns++] = c1;
+      }}}
+    }
+    add_box(box, &n, max, &b);
+  }
+
+  return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void add_box(RBoxS **box, int *n, int *max, const RBoxS *pB)
+ *  \brief Appends *pB to the list *box of *n boxes, with room for *max */
+
+static void add_box(RBoxS **box, int *n, int *max, const RBoxS *pB)
+{
+  if (*n == *max) {
+    *max = (*max > 0) ? 2*(*max) : 16;
+    if ((*box = (RBoxS*)realloc(*box, (*max)*sizeof(RBoxS))) == NULL)
+      ath_error("[refine_flag]: realloc returned a NULL pointer\n");
+  }
+  (*box)[(*n)++] = *pB;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int fix_boxes(MeshS *pM, const int nl, RBoxS *box, int n)
+ *  \brief Makes the n boxes of level nl valid Domains for init_mesh() and
+ *   bvals_mhd_init(), and returns their number.
+ *
+ *   Each box is widened to at least 2*nghost cells of level nl, and extended
+ *   to the edge of the root Domain if it is closer to it than nghost/2 cells
+ *   of its parent (since the parent then reaches that edge too).  In periodic
+ *   directions, a box at either edge spans the root Domain.  Boxes that
+ *   overlap or touch are then merged into their bounding box, until no two
+ *   do.  Boxes only grow, so they still hold the boxes of the next level. */
+
+static int fix_boxes(MeshS *pM, const int nl, RBoxS *box, int n)
+{
+  const int irefine = 1<<nl;
+  const int w = (2*nghost + irefine - 1)/irefine;
+  const int m = (nghost + irefine - 1)/irefine;
+  int a,b,d,c,merged,per[3];
+
+  per[0] = (pM->BCFlag_ix1 == 4 || pM->BCFlag_ox1 == 4);
+  per[1] = (pM->BCFlag_ix2 == 4 || pM->BCFlag_ox2 == 4);
+  per[2] = (pM->BCFlag_ix3 == 4 || pM->BCFlag_ox3 == 4);
+
+  do {
+    for (a=0; a<n; a++){
+      for (d=0; d<3; d++){
+        if (pM->Nx[d] == 1) continue;
+        if (box[a].hi[d] - box[a].lo[d] < w) {
+          c = w - (box[a].hi[d] - box[a].lo[d]);
+          box[a].lo[d] -= c/2;
+          box[a].hi[d] += c - c/2;
+          if (box[a].lo[d] < 0) {
+            box[a].hi[d] -= box[a].lo[d];
+            box[a].lo[d] = 0;
+          }
+          if (box[a].hi[d] > pM->Nx[d]) {
+            box[a].lo[d] = MAX(box[a].lo[d] - (box[a].hi[d] - pM->Nx[d]), 0);
+            box[a].hi[d] = pM->Nx[d];
+          }
+        }
+        if (box[a].lo[d] < m) box[a].lo[d] = 0;
+        if (pM->Nx[d] - box[a].hi[d] < m) box[a].hi[d] = pM->Nx[d];
+        if (per[d] && (box[a].lo[d] == 0 || box[a].hi[d] == pM->Nx[d])) {
+          box[a].lo[d] = 0;
+          box[a].hi[d] = pM->Nx[d];
+        }
+      }
+    }
+
+    merged = 0;
+    for (a=0; a<n; a++){
+      for (b=a+1; b<n; b++){
+        if (box[a].lo[0] <= box[b].hi[0] && box[a].hi[0] >= box[b].lo[0] &&
+            box[a].lo[1] <= box[b].hi[1] && box[a].hi[1] >= box[b].lo[1] &&
+            box[a].lo[2] <= box[b].hi[2] && box[a].hi[2] >= box[b].lo[2]) {
+          for (d=0; d<3; d++){
+            box[a].lo[d] = MIN(box[a].lo[d],box[b].lo[d]);
+            box[a].hi[d] = MAX(box[a].hi[d],box[b].hi[d]);
+          }
+          box[b] = box[--n];
+          b = a;
+          merged = 1;
+        }
+      }
+    }
+  } while (merged);
+
+  return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int cmp_box(const void *a, const void *b)
+ *  \brief Orders boxes by their first cell, in x3 then x2 then x1 */
+
+static int cmp_box(const void *a, const void *b)
+{
+  const RBoxS *pA = (const RBoxS*)a, *pB = (const RBoxS*)b;
+  int d;
+
+  for (d=2; d>=0; d--){
+    if (pA->lo[d] != pB->lo[d]) return (pA->lo[d] < pB->lo[d]) ? -1 : 1;
+  }
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void domain_box(const DomainS *pD, RBoxS *pB)
+ *  \brief Sets *pB to the root cells covered by Domain pD */
+
+static void domain_box(const DomainS *pD, RBoxS *pB)
+{
+  const int irefine = 1<<(pD->Level);
+  int d;
+
+  for (d=0; d<3; d++){
+    if (pD->Nx[d] > 1) {
+      pB->lo[d] = pD->Disp[d]/irefine;
+      pB->hi[d] = (pD->Disp[d] + pD->Nx[d])/irefine;
+    } else {
+      pB->lo[d] = 0;
+      pB->hi[d] = 1;
+    }
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void save_bcfun(MeshS *pM)
+ *  \brief Saves the boundary functions of Domains with a Grid on this rank at
+ *   each face of the root Domain */
+
+static void save_bcfun(MeshS *pM)
+{
+  DomainS *pD;
+  int nl,nd,irefine;
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    irefine = 1<<nl;
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      pD = &(pM->Domain[nl][nd]);
+      if (pD->Grid == NULL) continue;
+      if (pD->Disp[0] == 0 && pD->ix1_BCFun != NULL) bc_fun[0] = pD->ix1_BCFun;
+      if ((pD->Disp[0] + pD->Nx[0])/irefine == pM->Nx[0] &&
+          pD->ox1_BCFun != NULL) bc_fun[1] = pD->ox1_BCFun;
+      if (pM->Nx[1] > 1) {
+        if (pD->Disp[1] == 0 && pD->ix2_BCFun != NULL)
+          bc_fun[2] = pD->ix2_BCFun;
+        if ((pD->Disp[1] + pD->Nx[1])/irefine == pM->Nx[1] &&
+            pD->ox2_BCFun != NULL) bc_fun[3] = pD->ox2_BCFun;
+      }
+      if (pM->Nx[2] > 1) {
+        if (pD->Disp[2] == 0 && pD->ix3_BCFun != NULL)
+          bc_fun[4] = pD->ix3_BCFun;
+        if ((pD->Disp[2] + pD->Nx[2])/irefine == pM->Nx[2] &&
+            pD->ox3_BCFun != NULL) bc_fun[5] = pD->ox3_BCFun;
+      }
+    }
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void regrid(MeshS *pM, RBoxS **box, const int *nbox)
+ *  \brief Replaces the Domains of levels 1 and up with the nbox[nl] boxes
+ *   box[nl] of each level, and remaps the data.
+ *
+ *   The <domain> blocks are rewritten (root in <domain1>, then the fine
+ *   levels in order) without NGrid_x* or AutoWithNProc, so that the planner
+ *   divides the new Domains into Grids.  The old Mesh is kept until the new
+ *   Grids are filled: level 0 and the old parts of each fine level are
+ *   copied, and the rest is prolongated from the new level below.  Ghost zones
+ *   are then set as at the start of a run. */
+
+static void regrid(MeshS *pM, RBoxS **box, const int *nbox)
+{
+  MeshS old = *pM;
+  RPatchS *src,*dst;
+  char block[80];
+  int nl,nb,id,irefine,nsrc,ndst;
+  Real dt0 = pM->dt;
+
+  save_bcfun(pM);
+
+/* Free the boundary, SMR and restart buffers set up for the old Grids */
+
+  bvals_mhd_destruct(pM);
+  SMR_destruct();
+  restart_reset();
+
+/* Rewrite the <domain> blocks of levels 1 and up */
+
+  id = 1;
+  for (nl=1; nl<(pM->NLevels); nl++){
+    irefine = 1<<nl;
+    for (nb=0; nb<nbox[nl]; nb++){
+      sprintf(block,"domain%d",++id);
+      par_seti(block,"level","%d",nl,"refinement level");
+      par_seti(block,"Nx1","%d",(box[nl][nb].hi[0] - box[nl][nb].lo[0])*
+        irefine,"Number of zones in X1-direction");
+      par_seti(block,"Nx2","%d",(pM->Nx[1] > 1) ?
+        (box[nl][nb].hi[1] - box[nl][nb].lo[1])*irefine : 1,
+        "Number of zones in X2-direction");
+      par_seti(block,"Nx3","%d",(pM->Nx[2] > 1) ?
+        (box[nl][nb].hi[2] - box[nl][nb].lo[2])*irefine : 1,
+        "Number of zones in X3-direction");
+      par_seti(block,"iDisp","%d",box[nl][nb].lo[0]*irefine,
+        "i-displacement measured in cells of this level");
+      if (pM->Nx[1] > 1) par_seti(block,"jDisp","%d",box[nl][nb].lo[1]*
+        irefine,"j-displacement measured in cells of this level");
+      if (pM->Nx[2] > 1) par_seti(block,"kDisp","%d",box[nl][nb].lo[2]*
+        irefine,"k-displacement measured in cells of this level");
+      par_unset(block,"NGrid_x1");
+      par_unset(block,"NGrid_x2");
+      par_unset(block,"NGrid_x3");
+      par_unset(block,"AutoWithNProc");
+    }
+  }
+  par_seti("job","num_domains","%d",id,"number of Domains in Mesh");
+
+  build_mesh(pM, &old);
+
+/* Copy level 0.  Fill each fine level from the new level below, then copy
+ * the old data of that level over it. */
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    if (nl > 0) prolong_level(pM, nl);
+    nsrc = get_patches(&old, nl, &src);
+    ndst = get_patches(pM, nl, &dst);
+    copy_patches(nsrc, src, ndst, dst);
+    free(src);
+    free(dst);
+  }
+
+  finish_mesh(pM, &old);
+
+/* The first step on the new Mesh is at most as long as the one planned */
+
+  pM->dt = 0.5*dt0;
+  new_dt(pM);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void build_mesh(MeshS *pM, MeshS *pOld)
+ *  \brief Builds a new Mesh in pM from the par database with init_mesh() and
+ *   init_grid(), keeping the time, output name and radiation sources of the
+ *   old Mesh pOld, and sets up its boundary functions (including those of
+ *   the radiation) and SMR and boundary buffers.  The Grids are not filled. */
+
+static void build_mesh(MeshS *pM, MeshS *pOld)
+{
+  DomainS *pD;
+  int nl,nd,irefine;
+
+  init_mesh(pM);
+  pM->time = pOld->time;
+  pM->nstep = pOld->nstep;
+  pM->dt = pOld->dt;
+  free(pM->outfilename);
+  pM->outfilename = pOld->outfilename;
+#ifdef ION_RADPLANE
+  free_1d_array(pM->radplanelist->dir);
+  free(pM->radplanelist);
+  pM->radplanelist = pOld->radplanelist;
+#endif
+  init_grid(pM);
+
+/* Faces at the edge of the root Domain keep the boundary functions there,
+ * except periodic ones which bvals_mhd_init() must set up */
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    irefine = 1<<nl;
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      pD = &(pM->Domain[nl][nd]);
+      if (pD->Grid == NULL) continue;
+      if (pD->Disp[0] == 0 && pM->BCFlag_ix1 != 4)
+        pD->ix1_BCFun = bc_fun[0];
+      if ((pD->Disp[0] + pD->Nx[0])/irefine == pM->Nx[0] &&
+          pM->BCFlag_ox1 != 4) pD->ox1_BCFun = bc_fun[1];
+      if (pM->Nx[1] > 1) {
+        if (pD->Disp[1] == 0 && pM->BCFlag_ix2 != 4)
+          pD->ix2_BCFun = bc_fun[2];
+        if ((pD->Disp[1] + pD->Nx[1])/irefine == pM->Nx[1] &&
+            pM->BCFlag_ox2 != 4) pD->ox2_BCFun = bc_fun[3];
+      }
+      if (pM->Nx[2] > 1) {
+        if (pD->Disp[2] == 0 && pM->BCFlag_ix3 != 4)
+          pD->ix3_BCFun = bc_fun[4];
+        if ((pD->Disp[2] + pD->Nx[2])/irefine == pM->Nx[2] &&
+            pM->BCFlag_ox3 != 4) pD->ox3_BCFun = bc_fun[5];
+      }
+    }
+  }
+
+  SMR_init(pM);
+  bvals_mhd_init(pM);
+#ifdef ION_RADIATION
+  bvals_ionrad_destruct();
+  bvals_ionrad_init(pM);
+#endif
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void finish_mesh(MeshS *pM, MeshS *pOld)
+ *  \brief Sets the ghost zones of the filled Grids of a new Mesh as at the
+ *   start of a run, and the state of any excised zones, then frees the old
+ *   Mesh pOld and saves the boundary functions of the new one */
+
+static void finish_mesh(MeshS *pM, MeshS *pOld)
+{
+  GridS *pG;
+  int nl,nd,n;
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      if (pM->Domain[nl][nd].Grid != NULL){
+        bvals_mhd(&(pM->Domain[nl][nd]));
+#ifdef ION_RADIATION
+        bvals_ionrad(&(pM->Domain[nl][nd]));
+#endif
+      }
+    }
+  }
+  Prolongate(pM);
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      pG = pM->Domain[nl][nd].Grid;
+      if (pG == NULL) continue;
+      pG->bvals_dirty = DIRTY_ALL;
+      pG->cfl_valid = 0;
+      excise_regrid(pG);
+    }
+  }
+
+  free_domains(pOld);
+  for (n=0; n<6; n++) bc_fun[n] = NULL;
+  save_bcfun(pM);
+
+  return;
+}
+
+#ifdef MPI_PARALLEL
+/*----------------------------------------------------------------------------*/
+/*! \fn static void move_grids(MeshS *pOld, MeshS *pM)
+ *  \brief Copies the data of each Grid of the old Mesh pOld into the Grid at
+ *   the same place in the new Mesh pM, which has the same Domains and Grids
+ *   but other ranks.  The data is packed by restart_pack_grid().  All ranks
+ *   visit the Grids in the same order, so messages between two ranks are
+ *   posted in the same order on both.  Must be called by all ranks. */
+
+static void move_grids(MeshS *pOld, MeshS *pM)
+{
+  DomainS *pOD,*pD;
+  Real **buf=NULL,*tmp;
+  GridS **mgrid=NULL;
+  MPI_Request *rq=NULL;
+  long cnt;
+  int nl,nd,n,m,l,ro,rn,pass,nmsg=0,ierr;
+
+/* Count the messages of this rank in the first pass, and post them in the
+ * second.  Grids that stay on this rank are copied in the second pass. */
+
+  for (pass=0; pass<2; pass++){
+    nmsg = 0;
+    for (nl=0; nl<(pM->NLevels); nl++){
+      for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+        pOD = &(pOld->Domain[nl][nd]);
+        pD = &(pM->Domain[nl][nd]);
+        for(n=0; n<(pD->NGrid[2]); n++){
+        for(m=0; m<(pD->NGrid[1]); m++){
+        for(l=0; l<(pD->NGrid[0]); l++){
+          ro = pOD->GData[n][m][l].ID_Comm_world;
+          rn = pD->GData[n][m][l].ID_Comm_world;
+          if (ro != myID_Comm_world && rn != myID_Comm_world) continue;
+
+          if (ro == rn) {
+            if (pass == 1) {
+              cnt = restart_pack_grid(pD->Grid, NULL, 0);
+              if ((tmp = (Real*)calloc_1d_array(cnt,sizeof(Real))) == NULL)
+                ath_error("[migrate_grids]: malloc returned a NULL pointer\n");
+              restart_pack_grid(pOD->Grid, tmp, 0);
+              restart_pack_grid(pD->Grid, tmp, 1);
+              free_1d_array(tmp);
+            }
+            continue;
+          }
+
+          if (pass == 1) {
+            cnt = restart_pack_grid((ro == myID_Comm_world) ? pOD->Grid :
+              pD->Grid, NULL, 0);
+            if ((buf[nmsg] = (Real*)calloc_1d_array(cnt,sizeof(Real)))
+                == NULL)
+              ath_error("[migrate_grids]: malloc returned a NULL pointer\n");
+            if (ro == myID_Comm_world) {
+              restart_pack_grid(pOD->Grid, buf[nmsg], 0);
+              mgrid[nmsg] = NULL;
+              ierr = MPI_Isend(buf[nmsg], cnt*(int)sizeof(Real), MPI_BYTE, rn,
+                migrate_tag, MPI_COMM_WORLD, &(rq[nmsg]));
+            } else {
+              mgrid[nmsg] = pD->Grid;
+              ierr = MPI_Irecv(buf[nmsg], cnt*(int)sizeof(Real), MPI_BYTE, ro,
+                migrate_tag, MPI_COMM_WORLD, &(rq[nmsg]));
+            }
+          }
+          nmsg++;
+        }}}
+      }
+    }
+
+    if (pass == 0) {
+      buf = (Real**)calloc_1d_array(MAX(nmsg,1),sizeof(Real*));
+      mgrid = (GridS**)calloc_1d_array(MAX(nmsg,1),sizeof(GridS*));
+      rq = (MPI_Request*)calloc_1d_array(MAX(nmsg,1),sizeof(MPI_Request));
+      if (buf == NULL || mgrid == NULL || rq == NULL)
+        ath_error("[migrate_grids]: malloc returned a NULL pointer\n");
+    }
+  }
+
+  ierr = MPI_Waitall(nmsg, rq, MPI_STATUSES_IGNORE);
+  for (n=0; n<nmsg; n++){
+    if (mgrid[n] != NULL) restart_pack_grid(mgrid[n], buf[n], 1);
+    free_1d_array(buf[n]);
+  }
+  free_1d_array(buf);
+  free_1d_array(mgrid);
+  free_1d_array(rq);
+
+  return;
+}
+#endif /* MPI_PARALLEL */
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int get_patches(MeshS *pM, const int nl, RPatchS **patch)
+ *  \brief Sets *patch to a new list of the active cells of all Grids on level
+ *   nl (in the order of GData), and returns their number */
+
+static int get_patches(MeshS *pM, const int nl, RPatchS **patch)
+{
+  DomainS *pD;
+  GridS *pG;
+  GridsDataS *pGD;
+  int nd,n,m,l,d,np=0;
+
+  for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+    pD = &(pM->Domain[nl][nd]);
+    np += pD->NGrid[0]*pD->NGrid[1]*pD->NGrid[2];
+  }
+  if ((*patch = (RPatchS*)calloc(MAX(np,1),sizeof(RPatchS))) == NULL)
+    ath_error("[refine_flag]: malloc returned a NULL pointer\n");
+
+  np = 0;
+  for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+    pD = &(pM->Domain[nl][nd]);
+    for(n=0; n<(pD->NGrid[2]); n++){
+    for(m=0; m<(pD->NGrid[1]); m++){
+    for(l=0; l<(pD->NGrid[0]); l++){
+      pGD = &(pD->GData[n][m][l]);
+      for (d=0; d<3; d++){
+        (*patch)[np].lo[d] = pGD->Disp[d];
+        (*patch)[np].hi[d] = pGD->Disp[d] + pGD->Nx[d];
+      }
+      (*patch)[np].rank = pGD->ID_Comm_world;
+      pG = pD->Grid;
+      if (pGD->ID_Comm_world == myID_Comm_world && pG != NULL) {
+        (*patch)[np].U = pG->U;
+        (*patch)[np].org[0] = pG->Disp[0] - pG->is;
+        (*patch)[np].org[1] = pG->Disp[1] - pG->js;
+        (*patch)[np].org[2] = pG->Disp[2] - pG->ks;
+        (*patch)[np].pG = pG;
+      }
+      np++;
+    }}}
+  }
+
+  return np;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void copy_patches(const int nsrc, RPatchS *src, const int ndst,
+ *                               RPatchS *dst)
+ *  \brief Copies the cells where each of the nsrc patches src[] overlaps one
+ *   of the ndst patches dst[].  All ranks list the same patches, so messages
+ *   between two ranks are posted in the same order on both.  Must be called
+ *   by all ranks. */
+
+static void copy_patches(const int nsrc, RPatchS *src, const int ndst,
+                         RPatchS *dst)
+{
+  int s,d,n,lo[3],hi[3],ncell;
+#ifdef MPI_PARALLEL
+  ConsS **buf=NULL;
+  int pass,nmsg=0,ierr,*mdst=NULL,(*mbox)[6]=NULL;
+  MPI_Request *rq=NULL;
+#endif
+
+#ifdef MPI_PARALLEL
+/* Count the messages of this rank in the first pass, and post them in the
+ * second.  A message holds the ConsS of one overlap, x1 fastest, as bytes
+ * (all ranks run the same binary). */
+
+  for (pass=0; pass<2; pass++){
+    nmsg = 0;
+#endif
+    for (d=0; d<ndst; d++){
+      for (s=0; s<nsrc; s++){
+        ncell = 1;
+        for (n=0; n<3; n++){
+          lo[n] = MAX(src[s].lo[n],dst[d].lo[n]);
+          hi[n] = MIN(src[s].hi[n],dst[d].hi[n]);
+          ncell *= MAX(hi[n] - lo[n],0);
+        }
+        if (ncell == 0) continue;
+
+        if (src[s].rank == myID_Comm_world && dst[d].rank == myID_Comm_world){
+#ifdef MPI_PARALLEL
+          if (pass == 1)
+#endif
+            copy_cells(&src[s], &dst[d], lo, hi);
+          continue;
+        }
+
+#ifdef MPI_PARALLEL
+        if (src[s].rank != myID_Comm_world && dst[d].rank != myID_Comm_world)
+          continue;
+        if (pass == 1) {
+          if ((buf[nmsg] = (ConsS*)calloc_1d_array(ncell,sizeof(ConsS)))
+              == NULL)
+            ath_error("[refine_flag]: malloc returned a NULL pointer\n");
+          if (src[s].rank == myID_Comm_world) {
+            pack_cells(&src[s], lo, hi, buf[nmsg], 0);
+            mdst[nmsg] = -1;
+            ierr = MPI_Isend(buf[nmsg], ncell*(int)sizeof(ConsS), MPI_BYTE,
+              dst[d].rank, regrid_tag, MPI_COMM_WORLD, &(rq[nmsg]));
+          } else {
+            mdst[nmsg] = d;
+            for (n=0; n<3; n++){
+              mbox[nmsg][n] = lo[n];
+              mbox[nmsg][3+n] = hi[n];
+            }
+            ierr = MPI_Irecv(buf[nmsg], ncell*(int)sizeof(ConsS), MPI_BYTE,
+              src[s].rank, regrid_tag, MPI_COMM_WORLD, &(rq[nmsg]));
+          }
+        }
+        nmsg++;
+#endif /* MPI_PARALLEL */
+      }
+    }
+
+#ifdef MPI_PARALLEL
+    if (pass == 0) {
+      buf = (ConsS**)calloc_1d_array(MAX(nmsg,1),sizeof(ConsS*));
+      mdst = (int*)calloc_1d_array(MAX(nmsg,1),sizeof(int));
+      mbox = (int(*)[6])calloc_1d_array(MAX(nmsg,1),6*sizeof(int));
+      rq = (MPI_Request*)calloc_1d_array(MAX(nmsg,1),sizeof(MPI_Request));
+      if (buf == NULL || mdst == NULL || mbox == NULL || rq == NULL)
+        ath_error("[refine_flag]: malloc returned a NULL pointer\n");
+    }
+  }
+
+  ierr = MPI_Waitall(nmsg, rq, MPI_STATUSES_IGNORE);
+  for (n=0; n<nmsg; n++){
+    if (mdst[n] >= 0)
+      pack_cells(&dst[mdst[n]], &(mbox[n][0]), &(mbox[n][3]), buf[n], 1);
+    free_1d_array(buf[n]);
+  }
+  free_1d_array(buf);
+  free_1d_array(mdst);
+  free_1d_array(mbox);
+  free_1d_array(rq);
+#endif /* MPI_PARALLEL */
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void copy_cells(const RPatchS *pS, RPatchS *pD, const int *lo,
+ *                             const int *hi)
+ *  \brief Copies cells lo[n] to hi[n]-1 from patch pS to patch pD, both on
+ *   this rank */
+
+static void copy_cells(const RPatchS *pS, RPatchS *pD, const int *lo,
+                       const int *hi)
+{
+  int i,j,k;
+
+  for (k=lo[2]; k<hi[2]; k++){
+  for (j=lo[1]; j<hi[1]; j++){
+  for (i=lo[0]; i<hi[0]; i++){
+    pD->U[k-pD->org[2]][j-pD->org[1]][i-pD->org[0]] =
+      pS->U[k-pS->org[2]][j-pS->org[1]][i-pS->org[0]];
+  }}}
+
+  return;
+}
+
+#ifdef MPI_PARALLEL
+/*----------------------------------------------------------------------------*/
+/*! \fn static void pack_cells(RPatchS *pP, const int *lo, const int *hi,
+ *                             ConsS *buf, const int unpack)
+ *  \brief Copies cells lo[n] to hi[n]-1 of patch pP into buf (x1 fastest), or
+ *   from buf if unpack is 1 */
+
+static void pack_cells(RPatchS *pP, const int *lo, const int *hi, ConsS *buf,
+                       const int unpack)
+{
+  int i,j,k;
+
+  for (k=lo[2]; k<hi[2]; k++){
+  for (j=lo[1]; j<hi[1]; j++){
+  for (i=lo[0]; i<hi[0]; i++){
+    if (unpack)
+      pP->U[k-pP->org[2]][j-pP->org[1]][i-pP->org[0]] = *(buf++);
+    else
+      *(buf++) = pP->U[k-pP->org[2]][j-pP->org[1]][i-pP->org[0]];
+  }}}
+
+  return;
+}
+#endif /* MPI_PARALLEL */
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void prolong_level(MeshS *pM, const int nl)
+ *  \brief Fills the active cells of the Grids on level nl of the new Mesh by
+ *   prolongation from level nl-1, with ProCon().
+ *
+ *   The parent zones under each Grid, plus one on each side, are gathered
+ *   from level nl-1 into a work array.  Zones beyond the edge of the root
+ *   Domain, and the planes either side of the Grid in collapsed directions,
+ *   are copies of the nearest gathered zone.  The children of every parent
+ *   zone the Grid overlaps are set, so a Grid that starts or ends inside a
+ *   parent zone also gets one ghost cell on that side. */
+
+static void prolong_level(MeshS *pM, const int nl)
+{
+  RPatchS *src,*dst;
+  GridS *pG;
+  ConsS ***pC;
+  Real ****pq;
+  int nsrc,ndst,p,n,nv,i,j,k,ii,jj,kk,nc[3],flo[3],fhi[3],ijks[3],ijke[3];
+
+  nsrc = get_patches(pM, nl-1, &src);
+  ndst = get_patches(pM, nl, &dst);
+
+/* Parent zones of each Grid, clipped to the root Domain */
+
+  for (p=0; p<ndst; p++){
+    for (n=0; n<3; n++){
+      if (pM->Nx[n] > 1) {
+        dst[p].org[n] = dst[p].lo[n]/2 - 1;
+        nc[n] = (dst[p].hi[n] + 1)/2 + 1 - dst[p].org[n];
+        dst[p].lo[n] = MAX(dst[p].org[n], 0);
+        dst[p].hi[n] = MIN(dst[p].org[n] + nc[n], pM->Nx[n]<<(nl-1));
+      } else {
+        dst[p].org[n] = -1;
+        nc[n] = 3;
+      }
+    }
+    if (dst[p].pG != NULL) {
+      dst[p].U = (ConsS***)calloc_3d_array(nc[2],nc[1],nc[0],sizeof(ConsS));
+      if (dst[p].U == NULL)
+        ath_error("[refine_flag]: malloc returned a NULL pointer\n");
+    }
+  }
+
+  copy_patches(nsrc, src, ndst, dst);
+
+  pq = (Real****)calloc_1d_array(NVAR,sizeof(Real***));
+  if (pq == NULL) ath_error("[refine_flag]: malloc returned a NULL pointer\n");
+
+  for (p=0; p<ndst; p++){
+    pG = dst[p].pG;
+    if (pG == NULL) continue;
+    pC = dst[p].U;
+
+    for (n=0; n<3; n++){
+      nc[n] = (pM->Nx[n] > 1) ? (pG->Disp[n] + pG->Nx[n] + 1)/2 + 1 -
+        dst[p].org[n] : 3;
+      flo[n] = dst[p].lo[n] - dst[p].org[n];
+      fhi[n] = dst[p].hi[n] - dst[p].org[n] - 1;
+    }
+    for (nv=0; nv<NVAR; nv++){
+      if ((pq[nv] = (Real***)calloc_3d_array(nc[2],nc[1],nc[0],sizeof(Real)))
+          == NULL)
+        ath_error("[refine_flag]: malloc returned a NULL pointer\n");
+    }
+
+/* Fill zones not gathered, and load pq with P in place of E (see
+ * prolongate_level() in smr.c) */
+
+    for (k=0; k<nc[2]; k++){
+    for (j=0; j<nc[1]; j++){
+    for (i=0; i<nc[0]; i++){
+      kk = MIN(MAX(k,flo[2]),fhi[2]);
+      jj = MIN(MAX(j,flo[1]),fhi[1]);
+      ii = MIN(MAX(i,flo[0]),fhi[0]);
+      if (kk != k || jj != j || ii != i) pC[k][j][i] = pC[kk][jj][ii];
+    }}}
+
+    for (k=0; k<nc[2]; k++){
+    for (j=0; j<nc[1]; j++){
+    for (i=0; i<nc[0]; i++){
+#if !defined(BAROTROPIC) && !defined(SPECIAL_RELATIVITY) && !defined(FIRST_ORDER)
+      pC[k][j][i].E -= 0.5*(SQR(pC[k][j][i].M1) + SQR(pC[k][j][i].M2) +
+        SQR(pC[k][j][i].M3))/pC[k][j][i].d;
+#endif
+      for (nv=0; nv<NVAR; nv++)
+        pq[nv][k][j][i] = ((Real*)&(pC[k][j][i]))[nv];
+    }}}
+
+/* Cells of the parent zones over the Grid, which start at an even index */
+
+    ijks[0] = pG->is - (pG->Disp[0] & 1);
+    ijke[0] = pG->ie + ((pG->Disp[0] + pG->Nx[0]) & 1);
+    ijks[1] = pG->js;
+    ijke[1] = pG->je;
+    ijks[2] = pG->ks;
+    ijke[2] = pG->ke;
+    for (n=1; n<3; n++){
+      if (pM->Nx[n] == 1) continue;
+      ijks[n] -= (pG->Disp[n] & 1);
+      ijke[n] += ((pG->Disp[n] + pG->Nx[n]) & 1);
+    }
+    ProCon(pG, pq, ijks[0], ijke[0], ijks[1], ijke[1], ijks[2], ijke[2]);
+
+    for (nv=0; nv<NVAR; nv++) free_3d_array(pq[nv]);
+    free_3d_array(dst[p].U);
+  }
+
+  free_1d_array(pq);
+  free(src);
+  free(dst);
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void free_domains(MeshS *pM)
+ *  \brief Frees the Grids, Domains and communicators of a Mesh replaced by
+ *   regrid() or migrate_grids() */
+
+static void free_domains(MeshS *pM)
+{
+  DomainS *pD;
+  int nl,nd;
+#ifdef MPI_PARALLEL
+  DomainS *pCD;
+  int ncd,d,child;
+#endif
+
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      pD = &(pM->Domain[nl][nd]);
+      grid_destruct(pD->Grid);
+      free_3d_array(pD->GData);
+
+#ifdef MPI_PARALLEL
+      if (pD->Comm_Domain != MPI_COMM_NULL) MPI_Comm_free(&(pD->Comm_Domain));
+      MPI_Group_free(&(pD->Group_Domain));
+
+/* Comm_Children was made only if a child overlaps (as in init_mesh()), and is
+ * the Comm_Parent of the children */
+
+      child = 0;
+      for (ncd=0; nl<(pM->NLevels)-1 && ncd<(pM->DomainsPerLevel[nl+1]); ncd++){
+        pCD = &(pM->Domain[nl+1][ncd]);
+        for (d=0, child=1; d<3; d++){
+          if (!(pD->Disp[d] < ((pCD->Nx[d] > 1) ?
+                (pCD->Disp[d] + pCD->Nx[d])/2 : 1) &&
+                pD->Disp[d] + pD->Nx[d] > pCD->Disp[d]/2)) child = 0;
+        }
+        if (child) break;
+      }
+      if (child) {
+        if (pD->Comm_Children != MPI_COMM_NULL)
+          MPI_Comm_free(&(pD->Comm_Children));
+        MPI_Group_free(&(pD->Group_Children));
+      }
+#endif /* MPI_PARALLEL */
+    }
+  }
+
+  free(pM->Domain[0]);
+  free(pM->Domain);
+  free_1d_array(pM->DomainsPerLevel);
+
+  return;
+}
+#endif /* STATIC_MESH_REFINEMENT */
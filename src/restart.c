@@ -19,19 +19,65 @@
  *   values read from the athinput file contained in the resfile can be
  *   superceded by input from the command line, or another input file.
  *
- * MPI parallel jobs must be restarted on the same number of processors as they
- * were run originally.
+ * With MPI, rank 0 also writes a small text file (with extension .lay) giving
+ * for each Grid the rank whose restart file holds it, its offset in that file,
+ * the rank it is to be updated by on restart, and its level, Domain, Disp and
+ * Nx.  Grids are written by the rank they are updated by (load rebalancing
+ * moves them while the run continues, see migrate_grids() in refine_flag.c),
+ * but a .lay file may give other ranks, whose Grids are then read from the
+ * files of their writers.  Together, the restart files and the .lay file hold every
+ * level as a global array, so a job may also be restarted on any number of
+ * processors and any decomposition into Grids (e.g. a new <domain> NGrid_x1):
+ * each new Grid is then filled from the parts of the old Grids of its Domain
+ * that overlap it, and problem_read_restart() is given the USER_DATA of rank 0.
+ * Restart files without a .lay file must be read on the same number of
+ * processors and decomposition they were written with, as must those with a
+ * .lay file written before the geometry of Grids was recorded.
  *
  * With SMR, restart files contain ALL levels and domains being updated by each
  * processor in one file, written in the default directory for the process.
  *
+ * With delta=N in the <output> block, each full restart is followed by N
+ * delta restarts, which hold only the blocks of delta_block^3 zones of each
+ * Grid that changed since the last full restart, found by comparing a 64 bit
+ * hash of each block with that in the full restart.  A delta restart has the
+ * same name, header and USER_DATA as a full one, then a BASE section giving
+ * the number of the full restart, and for each Grid the list of changed
+ * blocks followed by their data, section by section.  It is read by reading
+ * each Grid from the full restart (which must be kept in the same directory)
+ * and replacing the changed blocks, so a run restarts from a delta file
+ * exactly as from a full one.  With MPI, the .lay file of a delta restart
+ * also gives the offset of each Grid in the full restart.
+ *
  * CONTAINS PUBLIC FUNCTIONS: 
  * - restart_grids() - reads nstep,time,dt,ConsS and B from restart file 
  * - dump_restart()  - writes a restart file
+ * - read_grid_layout()   - reads the .lay file of a restart on rank 0
+ * - restart_grid_ranks() - ranks of Grids given by the .lay file, if not
+ *                          repartitioned
+ * - restart_reset()  - forgets the Grids of the last restart, after a regrid
+ * - restart_pack_grid() - copies the restart data of a Grid to or from a
+ *                         buffer
+ *
+ * PRIVATE FUNCTION PROTOTYPES:
+ * - read_grid()    - reads the data of one Grid
+ * - read_section() - reads one section of the data of a Grid
+ * - read_delta()   - replaces the changed blocks of a section of a Grid
+ * - grid_section() - copies one section of the data of a Grid into a buffer
+ * - grid_blocks()  - number of blocks of a Grid in delta restarts
+ * - block_range()  - range of zones of a block in a section
+ * - block_hash()   - hashes of the blocks of a Grid
+ * - write_delta()  - writes the changed blocks of a Grid
+ * - base_fname()   - name of the full restart of a delta restart
+ * - open_base()    - opens the full restart of a delta restart
+ * - open_at()      - opens a restart file at an offset
+ * - write_layout() - writes the .lay file
+ * - rank_fname()   - name of the restart file written by a given rank
  *									      */
 /*============================================================================*/
 
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -41,6 +87,55 @@
 #include "prototypes.h"
 #include "particles/particle.h"
 
+static void read_grid(GridS *pG, FILE *fp, FILE *fd, const int disp[3],
+                      const int nx[3]);
+static void read_section(FILE *fp, const char *name, Real *buf, const long n);
+static void read_delta(FILE *fd, const char *name, Real *buf, const long sx,
+                       const long sy, const long sz);
+static int grid_section(GridS *pG, const int s, char *name, Real *buf,
+                        long sn[3], const int unpack);
+static int grid_blocks(const int nx[3], const int bsize, int nb[3]);
+static void block_range(const int b, const int bsize, const int nb[3],
+                        const long sn[3], long lo[3], long hi[3]);
+static void block_hash(GridS *pG, const int bsize, uint64_t *hash);
+static void write_delta(GridS *pG, FILE *fp, const int bsize,
+                        const uint64_t *hash);
+static void base_fname(const char *name, const int num, char *bname);
+static FILE *open_base(const char *name);
+
+/* State of delta restarts: the number of the last full restart (-1 before
+ * the first), the number of deltas written since, and the hashes of the
+ * blocks in it of each Grid of this rank, in the order of the loop over
+ * Domains */
+static int dlt_base=-1, dlt_count=0, dlt_ngrid=0;
+static uint64_t **dlt_hash=NULL;
+
+/* Blocks of the Grid being read by read_grid() from a delta restart */
+static int dlt_bsize=0, dlt_nb[3], dlt_nchg=0, *dlt_list=NULL;
+
+#ifdef MPI_PARALLEL
+static FILE *open_at(const char *name, const long off);
+static void write_layout(MeshS *pM, OutputS *pout, long *offset,
+                         long *boffset);
+static void rank_fname(const char *base, const int id, char *name);
+
+/* Offsets of Grids and USER_DATA in the last full restart, for the .lay
+ * files of its deltas */
+static long *dlt_boff=NULL;
+
+/* Layout of the restart being read, from read_grid_layout(): for each Grid
+ * the rank whose file holds it, its offset, its rank in this run, (if
+ * lay_geom) its level, Domain, Disp[3] and Nx[3], and (for a delta restart)
+ * its offset in the full restart; and for each rank the offset of USER_DATA.
+ * lay_ngrid=0 without a .lay file.  lay_repart is set by
+ * restart_grid_ranks() if the Grids of this run differ from those written. */
+static int lay_ngrid=0, lay_nproc=0, *lay_file=NULL, *lay_run=NULL;
+static int lay_geom=0, (*lay_grid)[8]=NULL, lay_repart=0;
+static long *lay_off=NULL, *lay_user=NULL, *lay_boff=NULL;
+static char lay_base[MAXLEN];     /* restart filename of rank 0 */
+static char lay_bbase[MAXLEN];    /* its full restart, for a delta restart */
+#endif
+
 /*----------------------------------------------------------------------------*/
 /*! \fn void restart_grids(char *res_file, MeshS *pM)
  *  \brief Reads nstep, time, dt, and arrays of ConsS and interface B
@@ -56,26 +151,27 @@
 void restart_grids(char *res_file, MeshS *pM)
 {
   GridS *pG;
-  FILE *fp;
-  char line[MAXLEN];
-  int i,j,k,is,ie,js,je,ks,ke,nl,nd;
-#ifdef MHD
-  int ib=0,jb=0,kb=0;
-#endif
-#if (NSCALARS > 0)
-  int n;
-  char scalarstr[16];
-#endif
-#ifdef PARTICLES
-  long p;
+  FILE *fp,*fb=NULL;
+  char line[MAXLEN],bname[MAXLEN];
+  int nl,nd,base=-1;
+  long pos;
+#ifdef MPI_PARALLEL
+  FILE *fg;
+  char gname[MAXLEN];
+  int id,g,dim,*gd;
+  long ncell,nread,nover;
 #endif
 /* #ifdef ION_RADPLANE */
 /*   int dir, nradplane; */
 /*   Real flux; */
 /* #endif */
 
-/* Open the restart file */
+/* Open the restart file.  When repartitioning, there may be more ranks than
+ * files, and all ranks read the file of rank 0 */
 
+#ifdef MPI_PARALLEL
+  if (lay_repart) res_file = lay_base;
+#endif
   if((fp = fopen(res_file,"r")) == NULL)
     ath_error("[restart_grids]: Error opening the restart file\nIf this is a MPI job, make sure each file from each processor is in the same directory.\n");
 
@@ -108,342 +204,111 @@ void restart_grids(char *res_file, MeshS *pM)
     ath_error("[restart_grids]: Expected TIME_STEP, found %s",line);
   fread(&(pM->dt),sizeof(Real),1,fp);
 
+/* A delta restart gives the number of its full restart, from which the Grids
+ * are read before their changed blocks.  Without a layout both files are
+ * read in sequence. */
+
+  pos = ftell(fp);
+  fgets(line,MAXLEN,fp);    /* Read the '\n' preceeding the next string */
+  fgets(line,MAXLEN,fp);
+  if(strncmp(line,"BASE",4) == 0) {
+    fread(&base,sizeof(int),1,fp);
+    base_fname(res_file,base,bname);
+#ifdef MPI_PARALLEL
+    if (lay_ngrid > 0) base_fname(lay_base,base,lay_bbase);
+    else
+#endif
+    fb = open_base(bname);
+  } else {
+    fseek(fp,pos,SEEK_SET);
+  }
+
 /* Now loop over all Domains containing a Grid on this processor */
 
   for (nl=0; nl<=(pM->NLevels)-1; nl++){
   for (nd=0; nd<=(pM->DomainsPerLevel[nl])-1; nd++){
     if (pM->Domain[nl][nd].Grid != NULL) {
       pG=pM->Domain[nl][nd].Grid;
-      is = pG->is;
-      ie = pG->ie;
-      js = pG->js;
-      je = pG->je;
-      ks = pG->ks;
-      ke = pG->ke;
 
 /* propagate time and dt to all Grids */
 
       pG->time = pM->time;
       pG->dt   = pM->dt;
 
-/* Read the density */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"DENSITY",7) != 0)
-        ath_error("[restart_grids]: Expected DENSITY, found %s",line);
-      for (k=ks; k<=ke; k++) {
-        for (j=js; j<=je; j++) {
-          for (i=is; i<=ie; i++) {
-            fread(&(pG->U[k][j][i].d),sizeof(Real),1,fp);
-          }
-        }
-      }
-
-/* Read the x1-momentum */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"1-MOMENTUM",10) != 0)
-        ath_error("[restart_grids]: Expected 1-MOMENTUM, found %s",line);
-      for (k=ks; k<=ke; k++) {
-        for (j=js; j<=je; j++) {
-          for (i=is; i<=ie; i++) {
-            fread(&(pG->U[k][j][i].M1),sizeof(Real),1,fp);
-          }
-        }
-      }
-
-/* Read the x2-momentum */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"2-MOMENTUM",10) != 0)
-        ath_error("[restart_grids]: Expected 2-MOMENTUM, found %s",line);
-      for (k=ks; k<=ke; k++) {
-        for (j=js; j<=je; j++) {
-          for (i=is; i<=ie; i++) {
-            fread(&(pG->U[k][j][i].M2),sizeof(Real),1,fp);
-          }
-        }
-      }
-
-/* Read the x3-momentum */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"3-MOMENTUM",10) != 0)
-        ath_error("[restart_grids]: Expected 3-MOMENTUM, found %s",line);
-      for (k=ks; k<=ke; k++) {
-        for (j=js; j<=je; j++) {
-          for (i=is; i<=ie; i++) {
-            fread(&(pG->U[k][j][i].M3),sizeof(Real),1,fp);
-          }
-        }
-      }
-
-#ifndef BAROTROPIC
-/* Read energy density */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"ENERGY",6) != 0)
-        ath_error("[restart_grids]: Expected ENERGY, found %s",line);
-      for (k=ks; k<=ke; k++) {
-        for (j=js; j<=je; j++) {
-          for (i=is; i<=ie; i++) {
-            fread(&(pG->U[k][j][i].E),sizeof(Real),1,fp);
-          }
-        }
-      }
-#endif
-
-#ifdef MHD
-/* if there is more than one cell in each dimension, need to read one more
- * face-centered field component than the number of cells.  [ijk]b is
- * the number of extra cells to be read  */
-
-      if (ie > is) ib=1;
-      if (je > js) jb=1;
-      if (ke > ks) kb=1;
-
-/* Read the face-centered x1 B-field */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"1-FIELD",7) != 0)
-        ath_error("[restart_grids]: Expected 1-FIELD, found %s",line);
-      for (k=ks; k<=ke; k++) {
-        for (j=js; j<=je; j++) {
-          for (i=is; i<=ie+ib; i++) {
-            fread(&(pG->B1i[k][j][i]),sizeof(Real),1,fp);
-          }
-        }
-      }
-
-/* Read the face-centered x2 B-field */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"2-FIELD",7) != 0)
-        ath_error("[restart_grids]: Expected 2-FIELD, found %s",line);
-      for (k=ks; k<=ke; k++) {
-        for (j=js; j<=je+jb; j++) {
-          for (i=is; i<=ie; i++) {
-            fread(&(pG->B2i[k][j][i]),sizeof(Real),1,fp);
-          }
-        }
-      }
-
-/* Read the face-centered x3 B-field */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"3-FIELD",7) != 0)
-        ath_error("[restart_grids]: Expected 3-FIELD, found %s",line);
-      for (k=ks; k<=ke+kb; k++) {
-        for (j=js; j<=je; j++) {
-          for (i=is; i<=ie; i++) {
-            fread(&(pG->B3i[k][j][i]),sizeof(Real),1,fp);
+#ifdef MPI_PARALLEL
+/* When repartitioning, read every old Grid of this Domain that overlaps this
+ * Grid, and check that together they cover it */
+
+      if (lay_repart) {
+        ncell = (long)pG->Nx[0]*(long)pG->Nx[1]*(long)pG->Nx[2];
+        nread = 0;
+        for (g=0; g<lay_ngrid; g++){
+          gd = lay_grid[g];
+          if (gd[0] != nl || gd[1] != nd) continue;
+          nover = 1;
+          for (dim=0; dim<3; dim++)
+            nover *= MAX(0, MIN(gd[2+dim]+gd[5+dim], pG->Disp[dim]+pG->Nx[dim])
+                          - MAX(gd[2+dim], pG->Disp[dim]));
+          if (nover == 0) continue;
+
+          rank_fname(lay_base, lay_file[g], gname);
+          fg = open_at(gname, lay_off[g]);
+          if (base >= 0) {
+            rank_fname(lay_bbase, lay_file[g], gname);
+            fb = open_at(gname, lay_boff[g]);
+            read_grid(pG, fb, fg, &gd[2], &gd[5]);
+            fclose(fb);
+            fb = NULL;
+          } else {
+            read_grid(pG, fg, NULL, &gd[2], &gd[5]);
           }
+          fclose(fg);
+          nread += nover;
         }
+        if (nread != ncell)
+          ath_error("[restart_grids]: Grid of Domain[%d][%d] has %ld of %ld zones in restart\n",
+            nl,nd,nread,ncell);
+        continue;
       }
 
-/* initialize the cell center magnetic fields as either the average of the face
- * centered field if there is more than one cell in that dimension, or just
- * the face centered field if not  */
-
-      for (k=ks; k<=ke; k++) {
-      for (j=js; j<=je; j++) {
-      for (i=is; i<=ie; i++) {
-        pG->U[k][j][i].B1c = pG->B1i[k][j][i];
-        pG->U[k][j][i].B2c = pG->B2i[k][j][i];
-        pG->U[k][j][i].B3c = pG->B3i[k][j][i];
-        if(ib==1) pG->U[k][j][i].B1c=0.5*(pG->B1i[k][j][i] +pG->B1i[k][j][i+1]);
-        if(jb==1) pG->U[k][j][i].B2c=0.5*(pG->B2i[k][j][i] +pG->B2i[k][j+1][i]);
-        if(kb==1) pG->U[k][j][i].B3c=0.5*(pG->B3i[k][j][i] +pG->B3i[k+1][j][i]);
-      }}}
-#endif
-
-#ifdef ION_RADPLANE
-
-/* Read the radiation flux */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"EDGEFLUX",8) != 0)
-        ath_error("[restart_grids]: Expected Edgeflux, found %s",line);
-      for (k=ks-nghost; k<=ke-nghost+1; k++) {
-        for (j=js-nghost; j<=je-nghost+1; j++) {
-          for (i=is-nghost; i<=ie-nghost+1; i++) {
-            fread(&(pG->EdgeFlux[k][j][i]),sizeof(Real),1,fp);
-          }
+/* With a layout, read the Grid at its offset in the file of its old rank */
+
+      if (lay_ngrid > 0) {
+        id = get_myGridID(pM,nl,nd);
+        if (lay_file[id] == myID_Comm_world) {
+          fg = fp;
+          if (fseek(fg, lay_off[id], SEEK_SET) != 0)
+            ath_error("[restart_grids]: fseek() error\n");
+        } else {
+          rank_fname(lay_base, lay_file[id], gname);
+          fg = open_at(gname, lay_off[id]);
         }
-      }
-
-/*   /\* Read list of radiator planes *\/ */
-/*   fgets(line,MAXLEN,fp);/\* Read the '\n' preceeding the next string *\/ */
-/*   fgets(line,MAXLEN,fp); */
-/*   if(strncmp(line,"RADIATOR PLANE LIST",19) != 0) */
-/*     ath_error("[restart_grid_block]: Expected RADIATOR PLANE LIST, found %s",line); */
-/*   fread(&nradplane,sizeof(int),1,fp); */
-/*   for (n=0; n<nradplane; n++) { */
-/*     fread(&dir,sizeof(int),1,fp); */
-/*     fread(&flux,sizeof(Real),1,fp); */
-/*     add_radplane_3d(pG, dir, flux); */
-/*   } */
-#endif /* ION_RADPLANE */
-
-#if (NSCALARS > 0)
-/* Read any passively advected scalars */
-/* Following code only works if NSCALARS < 10 */
-
-      for (n=0; n<NSCALARS; n++) {
-        fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-        fgets(line,MAXLEN,fp);
-        sprintf(scalarstr, "SCALAR %d", n);
-        if(strncmp(line,scalarstr,8) != 0)
-          ath_error("[restart_grids]: Expected %s, found %s",scalarstr,line);
-        for (k=ks; k<=ke; k++) {
-          for (j=js; j<=je; j++) {
-            for (i=is; i<=ie; i++) {
-              fread(&(pG->U[k][j][i].s[n]),sizeof(Real),1,fp);
-            }
-          }
+        if (base >= 0) {
+          rank_fname(lay_bbase, lay_file[id], gname);
+          fb = open_at(gname, lay_boff[id]);
+          read_grid(pG, fb, fg, pG->Disp, pG->Nx);
+          fclose(fb);
+          fb = NULL;
+        } else {
+          read_grid(pG, fg, NULL, pG->Disp, pG->Nx);
         }
+        if (fg != fp) fclose(fg);
+        continue;
       }
 #endif
-
-#ifdef PARTICLES
-/* Read particle properties and the complete particle list */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"PARTICLE LIST",13) != 0)
-        ath_error("[restart_grids]: Expected PARTICLE LIST, found %s",line);
-      fread(&(pG->nparticle),sizeof(long),1,fp);
-      fread(&(pG->partypes),sizeof(int),1,fp);
-      for (i=0; i<pG->partypes; i++) {          /* particle property list */
-#ifdef FEEDBACK
-        fread(&(pG->grproperty[i].m),sizeof(Real),1,fp);
-#endif
-        fread(&(pG->grproperty[i].rad),sizeof(Real),1,fp);
-        fread(&(pG->grproperty[i].rho),sizeof(Real),1,fp);
-        fread(&(tstop0[i]),sizeof(Real),1,fp);
-        fread(&(grrhoa[i]),sizeof(Real),1,fp);
-      }
-      fread(&(alamcoeff),sizeof(Real),1,fp);  /* coef to calc Reynolds number */
-
-      for (i=0; i<pG->partypes; i++)
-        fread(&(pG->grproperty[i].integrator),sizeof(short),1,fp);
-
-/* Read the x1-positions */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"PARTICLE X1",11) != 0)
-        ath_error("[restart_grids]: Expected PARTICLE X1, found %s",line);
-      for (p=0; p<pG->nparticle; p++) {
-        fread(&(pG->particle[p].x1),sizeof(Real),1,fp);
-      }
-
-/* Read the x2-positions */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"PARTICLE X2",11) != 0)
-        ath_error("[restart_grids]: Expected PARTICLE X2, found %s",line);
-      for (p=0; p<pG->nparticle; p++) {
-        fread(&(pG->particle[p].x2),sizeof(Real),1,fp);
-      }
-
-/* Read the x3-positions */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"PARTICLE X3",11) != 0)
-        ath_error("[restart_grids]: Expected PARTICLE X3, found %s",line);
-      for (p=0; p<pG->nparticle; p++) {
-        fread(&(pG->particle[p].x3),sizeof(Real),1,fp);
-      }
-
-/* Read the v1 velocity */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"PARTICLE V1",11) != 0)
-        ath_error("[restart_grids]: Expected PARTICLE V1, found %s",line);
-      for (p=0; p<pG->nparticle; p++) {
-        fread(&(pG->particle[p].v1),sizeof(Real),1,fp);
-      }
-
-/* Read the v2 velocity */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"PARTICLE V2",11) != 0)
-        ath_error("[restart_grids]: Expected PARTICLE V2, found %s",line);
-      for (p=0; p<pG->nparticle; p++) {
-        fread(&(pG->particle[p].v2),sizeof(Real),1,fp);
-      }
-
-/* Read the v3 velocity */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"PARTICLE V3",11) != 0)
-        ath_error("[restart_grids]: Expected PARTICLE V3, found %s",line);
-      for (p=0; p<pG->nparticle; p++) {
-        fread(&(pG->particle[p].v3),sizeof(Real),1,fp);
-      }
-
-/* Read particle properties */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"PARTICLE PROPERTY",17) != 0)
-        ath_error("[restart_grids]: Expected PARTICLE PROPERTY, found %s",line);
-      for (p=0; p<pG->nparticle; p++) {
-        fread(&(pG->particle[p].property),sizeof(int),1,fp);
-        pG->particle[p].pos = 1;	/* grid particle */
-      }
-
-/* Read particle my_id */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"PARTICLE MY_ID",14) != 0)
-        ath_error("[restart_grids]: Expected PARTICLE MY_ID, found %s",line);
-      for (p=0; p<pG->nparticle; p++) {
-        fread(&(pG->particle[p].my_id),sizeof(long),1,fp);
-      }
-
-#ifdef MPI_PARALLEL
-/* Read particle init_id */
-
-      fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
-      fgets(line,MAXLEN,fp);
-      if(strncmp(line,"PARTICLE INIT_ID",16) != 0)
-        ath_error("[restart_grids]: Expected PARTICLE INIT_ID, found %s",line);
-      for (p=0; p<pG->nparticle; p++) {
-        fread(&(pG->particle[p].init_id),sizeof(int),1,fp);
-      }
-#endif
-
-/* count the number of particles with different types */
-
-      for (i=0; i<pG->partypes; i++)
-        pG->grproperty[i].num = 0;
-      for (p=0; p<pG->nparticle; p++)
-        pG->grproperty[pG->particle[p].property].num += 1;
-
-#endif /* PARTICLES */
-
+      if (fb != NULL) read_grid(pG, fb, fp, pG->Disp, pG->Nx);
+      else read_grid(pG, fp, NULL, pG->Disp, pG->Nx);
     }
   }} /* End loop over all Domains --------------------------------------------*/
+  if (fb != NULL) fclose(fb);
 
 /* Call a user function to read his/her problem-specific data! */
 
+#ifdef MPI_PARALLEL
+  if (lay_ngrid > 0 && fseek(fp, lay_user[lay_repart ? 0 : myID_Comm_world],
+      SEEK_SET) != 0)
+    ath_error("[restart_grids]: fseek() error\n");
+#endif
   fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
   fgets(line,MAXLEN,fp);
   if(strncmp(line,"USER_DATA",9) != 0)
@@ -480,31 +345,52 @@ void dump_restart(MeshS *pM, OutputS *pout)
 #endif
   int bufsize, nbuf = 0;
   Real *buf = NULL;
+  int g,delta,nb[3];
+#ifdef MPI_PARALLEL
+  long *offset;
+  int ngrid,nproc,ierr;
+
+  ngrid = get_nGrids(pM);
+  ierr = MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+  if ((offset = (long*)calloc_1d_array(ngrid+nproc, sizeof(long))) == NULL)
+    ath_error("[dump_restart]: malloc returned a NULL pointer\n");
+#endif
 
-/* Allocate memory for buffer */
+/* Allocate memory for buffer.  With MPI all ranks join write_layout() below,
+ * so a rank that cannot allocate aborts the job rather than skip the dump */
   bufsize = 262144 / sizeof(Real);  /* 256 KB worth of Reals */
   if ((buf = (Real*)calloc_1d_array(bufsize, sizeof(Real))) == NULL) {
-    ath_perr(-1,"[dump_restart]: Error allocating memory for buffer\n");
-    return;  /* Right now, we just don't write instead of aborting completely */
+    ath_error("[dump_restart]: Error allocating memory for buffer\n");
   }
 #ifdef PARTICLES
   ibufsize = 262144 / sizeof(int);  /* 256 KB worth of ints */
   if ((ibuf = (int*)calloc_1d_array(ibufsize, sizeof(int))) == NULL) {
-    ath_perr(-1,"[dump_restart]: Error allocating memory for buffer\n");
-    return;  /* Right now, we just don't write instead of aborting completely */
+    ath_error("[dump_restart]: Error allocating memory for buffer\n");
   }
   lbufsize = 262144 / sizeof(long);  /* 256 KB worth of longs */
   if ((lbuf = (long*)calloc_1d_array(lbufsize, sizeof(long))) == NULL) {
-    ath_perr(-1,"[dump_restart]: Error allocating memory for buffer\n");
-    return;  /* Right now, we just don't write instead of aborting completely */
+    ath_error("[dump_restart]: Error allocating memory for buffer\n");
   }
   sbufsize = 262144 / sizeof(short);  /* 256 KB worth of longs */
   if ((sbuf = (short*)calloc_1d_array(sbufsize, sizeof(short))) == NULL) {
-    ath_perr(-1,"[dump_restart]: Error allocating memory for buffer\n");
-    return;  /* Right now, we just don't write instead of aborting completely */
+    ath_error("[dump_restart]: Error allocating memory for buffer\n");
   }
 #endif
 
+/* Write a delta of the last full restart, unless pout->delta deltas of it
+ * have been written already.  The hashes of the blocks of each Grid in full
+ * restarts are kept if delta > 0. */
+
+  delta = (pout->delta > 0 && dlt_base >= 0 && dlt_count < pout->delta);
+  if (pout->delta > 0 && dlt_hash == NULL) {
+    for (nl=0; nl<=(pM->NLevels)-1; nl++)
+      for (nd=0; nd<=(pM->DomainsPerLevel[nl])-1; nd++)
+        if (pM->Domain[nl][nd].Grid != NULL) dlt_ngrid++;
+    dlt_hash = (uint64_t**)calloc_1d_array(MAX(dlt_ngrid,1),sizeof(uint64_t*));
+    if (dlt_hash == NULL)
+      ath_error("[dump_restart]: malloc returned a NULL pointer\n");
+  }
+
 /* Create filename and Open the output file */
 
   if((fname = ath_fname(NULL,pM->outfilename,NULL,NULL,num_digit,
@@ -544,8 +430,17 @@ void dump_restart(MeshS *pM, OutputS *pout)
   if(fwrite(&(pM->dt),sizeof(Real),1,fp) != 1)
     ath_error("[dump_restart]: fwrite() error\n");
 
+/* Write out the number of the full restart of a delta restart */
+
+  if (delta) {
+    fprintf(fp,"\nBASE\n");
+    if(fwrite(&dlt_base,sizeof(int),1,fp) != 1)
+      ath_error("[dump_restart]: fwrite() error\n");
+  }
+
 /* Now loop over all Domains containing a Grid on this processor */
 
+  g = 0;
   for (nl=0; nl<=(pM->NLevels)-1; nl++){
   for (nd=0; nd<=(pM->DomainsPerLevel[nl])-1; nd++){
     if (pM->Domain[nl][nd].Grid != NULL) {
@@ -556,6 +451,26 @@ void dump_restart(MeshS *pM, OutputS *pout)
       je = pG->je;
       ks = pG->ks;
       ke = pG->ke;
+#ifdef MPI_PARALLEL
+      offset[get_myGridID(pM,nl,nd)] = ftell(fp);
+#endif
+
+/* A delta restart has only the blocks changed since the full restart.  A
+ * full restart with deltas keeps the hashes of its blocks. */
+
+      if (delta) {
+        write_delta(pG, fp, pout->dblock, dlt_hash[g++]);
+        continue;
+      }
+      if (pout->delta > 0) {
+        if (dlt_hash[g] == NULL) {
+          dlt_hash[g] = (uint64_t*)calloc_1d_array(
+            grid_blocks(pG->Nx,pout->dblock,nb), sizeof(uint64_t));
+          if (dlt_hash[g] == NULL)
+            ath_error("[dump_restart]: malloc returned a NULL pointer\n");
+        }
+        block_hash(pG, pout->dblock, dlt_hash[g++]);
+      }
 
 /* Write the density */
 
@@ -972,12 +887,1145 @@ void dump_restart(MeshS *pM, OutputS *pout)
     
 /* call a user function to write his/her problem-specific data! */
     
+#ifdef MPI_PARALLEL
+  offset[ngrid+myID_Comm_world] = ftell(fp);
+#endif
   fprintf(fp,"\nUSER_DATA\n");
   problem_write_restart(pM, fp);
 
   fclose(fp);
 
   free_1d_array(buf);
+#ifdef MPI_PARALLEL
+  write_layout(pM, pout, offset, delta ? dlt_boff : NULL);
+#endif
+
+/* Deltas that follow are taken from this restart if it is full */
+
+  if (delta) {
+    dlt_count++;
+  } else if (pout->delta > 0) {
+    dlt_base = pout->num;
+    dlt_count = 0;
+#ifdef MPI_PARALLEL
+    if (dlt_boff != NULL) free_1d_array(dlt_boff);
+    dlt_boff = offset;
+    offset = NULL;
+#endif
+  }
+#ifdef MPI_PARALLEL
+  if (offset != NULL) free_1d_array(offset);
+#endif
+
+  return;
+}
+
+#ifdef MPI_PARALLEL
+/*----------------------------------------------------------------------------*/
+/*! \fn void read_grid_layout(char *res_file)
+ *  \brief Reads the .lay file written with the restart file res_file (the
+ *   name on rank 0) and shares it with all ranks.  Called by main() before
+ *   init_mesh(), which assigns Grids to the ranks given there, or repartitions
+ *   the restart (see restart_grid_ranks()).  Nothing is done if there is no
+ *   .lay file. */
+
+void read_grid_layout(char *res_file)
+{
+  FILE *fp=NULL;
+  char name[MAXLEN],line[MAXLEN],*pc;
+  int g,r,n,ierr,hdr[3];
+
+  hdr[0] = hdr[1] = hdr[2] = 0;
+  if (myID_Comm_world == 0) {
+    strcpy(lay_base, res_file);
+    strcpy(name, res_file);
+    pc = strrchr(name,'.');
+    if (pc != NULL && strcmp(pc,".rst") == 0) {
+      strcpy(pc,".lay");
+      if ((fp = fopen(name,"r")) != NULL) {
+        if (fgets(line,MAXLEN,fp) == NULL ||
+            sscanf(line,"%d %d %d",&hdr[0],&hdr[1],&hdr[2]) < 2)
+          ath_error("[read_grid_layout]: Error reading %s\n",name);
+      }
+    }
+  }
+  ierr = MPI_Bcast(hdr, 3, MPI_INT, 0, MPI_COMM_WORLD);
+  if (hdr[0] <= 0) return;
+
+/* The third field of the header is the version of the layout: 2 if the
+ * geometry of each Grid follows its offset, 3 if its offset in the full
+ * restart of a delta restart follows that, none before */
+
+  lay_ngrid = hdr[0];
+  lay_nproc = hdr[1];
+  lay_geom = (hdr[2] >= 2);
+  lay_file = (int*)calloc_1d_array(lay_ngrid, sizeof(int));
+  lay_run  = (int*)calloc_1d_array(lay_ngrid, sizeof(int));
+  lay_grid = (int(*)[8])calloc_1d_array(lay_ngrid, 8*sizeof(int));
+  lay_off  = (long*)calloc_1d_array(lay_ngrid, sizeof(long));
+  lay_boff = (long*)calloc_1d_array(lay_ngrid, sizeof(long));
+  lay_user = (long*)calloc_1d_array(lay_nproc, sizeof(long));
+  if (lay_file == NULL || lay_run == NULL || lay_grid == NULL ||
+      lay_off == NULL || lay_boff == NULL || lay_user == NULL)
+    ath_error("[read_grid_layout]: malloc returned a NULL pointer\n");
+
+  if (myID_Comm_world == 0) {
+    for (g=0; g<lay_ngrid; g++){
+      if (fscanf(fp,"%d %d %ld %d",&r,&lay_file[g],&lay_off[g],&lay_run[g])
+          != 4 || r != g)
+        ath_error("[read_grid_layout]: Error reading Grid %d\n",g);
+      for (n=0; n<8 && lay_geom; n++){
+        if (fscanf(fp,"%d",&lay_grid[g][n]) != 1)
+          ath_error("[read_grid_layout]: Error reading Grid %d\n",g);
+      }
+      if (hdr[2] >= 3 && fscanf(fp,"%ld",&lay_boff[g]) != 1)
+        ath_error("[read_grid_layout]: Error reading Grid %d\n",g);
+    }
+    for (r=0; r<lay_nproc; r++){
+      if (fscanf(fp,"%ld",&lay_user[r]) != 1)
+        ath_error("[read_grid_layout]: Error reading USER_DATA offsets\n");
+    }
+    fclose(fp);
+  }
+  ierr = MPI_Bcast(lay_base, MAXLEN, MPI_CHAR, 0, MPI_COMM_WORLD);
+  ierr = MPI_Bcast(lay_file, lay_ngrid, MPI_INT, 0, MPI_COMM_WORLD);
+  ierr = MPI_Bcast(lay_run, lay_ngrid, MPI_INT, 0, MPI_COMM_WORLD);
+  ierr = MPI_Bcast(lay_grid, 8*lay_ngrid, MPI_INT, 0, MPI_COMM_WORLD);
+  ierr = MPI_Bcast(lay_off, lay_ngrid, MPI_LONG, 0, MPI_COMM_WORLD);
+  ierr = MPI_Bcast(lay_boff, lay_ngrid, MPI_LONG, 0, MPI_COMM_WORLD);
+  ierr = MPI_Bcast(lay_user, lay_nproc, MPI_LONG, 0, MPI_COMM_WORLD);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn int *restart_grid_ranks(MeshS *pM)
+ *  \brief Returns the ranks of all Grids (in get_myGridID() order) read by
+ *   read_grid_layout(), or NULL if there are none or if the restart is to be
+ *   repartitioned.  Called by init_mesh() once the Grids of pM are set.
+ *
+ *   The restart is repartitioned if the number of ranks, or the number, Disp
+ *   or Nx of the Grids of pM differ from those written.  init_mesh() then
+ *   keeps its own assignment of Grids, and restart_grids() fills each Grid
+ *   from the old Grids that overlap it. */
+
+int *restart_grid_ranks(MeshS *pM)
+{
+  DomainS *pD;
+  GridsDataS *pGD;
+  int nl,nd,n,m,l,g,dim,nproc,ierr;
+
+  if (lay_ngrid == 0) return NULL;
+
+  ierr = MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+  lay_repart = (lay_nproc != nproc || lay_ngrid != get_nGrids(pM));
+  g = 0;
+  for (nl=0; nl<(pM->NLevels) && !lay_repart; nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      pD = (DomainS*)&(pM->Domain[nl][nd]);
+      for(n=0; n<(pD->NGrid[2]); n++){
+      for(m=0; m<(pD->NGrid[1]); m++){
+      for(l=0; l<(pD->NGrid[0]); l++){
+        pGD = &(pD->GData[n][m][l]);
+        for (dim=0; dim<3 && lay_geom; dim++){
+          if (pGD->Disp[dim] != lay_grid[g][2+dim] ||
+              pGD->Nx[dim] != lay_grid[g][5+dim]) lay_repart = 1;
+        }
+        g++;
+      }}}
+    }
+  }
+  if (!lay_repart) return lay_run;
+
+  if (!lay_geom)
+    ath_error("[restart_grid_ranks]: restart written by %d procs with %d Grids cannot be read by %d procs with %d Grids\n",
+      lay_nproc,lay_ngrid,nproc,get_nGrids(pM));
+#ifdef PARTICLES
+  ath_error("[restart_grid_ranks]: restarts with particles cannot be repartitioned\n");
+#endif
+  ath_pout(0,"Repartitioning restart of %d Grids on %d procs to %d Grids on %d procs\n",
+    lay_ngrid,lay_nproc,get_nGrids(pM),nproc);
+
+  return NULL;
+}
+#endif /* MPI_PARALLEL */
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void restart_reset(void)
+ *  \brief Forgets the Grids of the restarts read and written so far, after the
+ *   Grids of the Mesh have been changed by a regrid or moved to other ranks
+ *   (see refine_flag.c).  The
+ *   next restart is then a full one, and init_mesh() does not use the .lay
+ *   file of the restart the run was started from. */
+
+void restart_reset(void)
+{
+  int g;
+
+  if (dlt_hash != NULL) {
+    for (g=0; g<dlt_ngrid; g++)
+      if (dlt_hash[g] != NULL) free_1d_array(dlt_hash[g]);
+    free_1d_array(dlt_hash);
+  }
+  dlt_hash = NULL;
+  dlt_ngrid = 0;
+  dlt_base = -1;
+  dlt_count = 0;
+
+#ifdef MPI_PARALLEL
+  if (dlt_boff != NULL) free_1d_array(dlt_boff);
+  dlt_boff = NULL;
+
+  if (lay_ngrid > 0) {
+    free_1d_array(lay_file);
+    free_1d_array(lay_run);
+    free_1d_array(lay_grid);
+    free_1d_array(lay_off);
+    free_1d_array(lay_boff);
+    free_1d_array(lay_user);
+    lay_file = NULL;  lay_run = NULL;  lay_grid = NULL;
+    lay_off = NULL;   lay_boff = NULL; lay_user = NULL;
+  }
+  lay_ngrid = 0;
+  lay_nproc = 0;
+  lay_repart = 0;
+#endif /* MPI_PARALLEL */
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn long restart_pack_grid(GridS *pG, Real *buf, const int unpack)
+ *  \brief Copies all sections of the data of pG written by dump_restart(), one
+ *   after the other, into buf (or from buf into pG if unpack is 1), and
+ *   returns the number of values.  With buf=NULL, only counts them.  Used to
+ *   move Grids between ranks by migrate_grids(). */
+
+long restart_pack_grid(GridS *pG, Real *buf, const int unpack)
+{
+  Real *sbuf;
+  char name[16];
+  long n=0,ns,sn[3];
+  int s;
+
+  sbuf = (Real*)calloc_1d_array((pG->Nx[0]+1)*(pG->Nx[1]+1)*
+    (long)(pG->Nx[2]+1),sizeof(Real));
+  if (sbuf == NULL)
+    ath_error("[restart_pack_grid]: malloc returned a NULL pointer\n");
+
+  for (s=0; grid_section(pG,s,name,sbuf,sn,0); s++) {
+    ns = sn[0]*sn[1]*sn[2];
+    if (buf != NULL) {
+      if (unpack) {
+        memcpy(sbuf,&buf[n],ns*sizeof(Real));
+        grid_section(pG,s,name,sbuf,sn,1);
+      } else {
+        memcpy(&buf[n],sbuf,ns*sizeof(Real));
+      }
+    }
+    n += ns;
+  }
+
+  free_1d_array(sbuf);
+  return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void read_grid(GridS *pG, FILE *fp, FILE *fd,
+ *                            const int disp[3], const int nx[3])
+ *  \brief Reads ConsS, interface B, and other data of one Grid of a restart
+ *   file, starting at the line preceding "DENSITY", and copies the part of it
+ *   overlapping pG.  The Grid read has nx zones at disp in its level: pG->Nx
+ *   and pG->Disp unless the restart is repartitioned.  For a delta restart,
+ *   fp is the full restart and fd the delta, at the line preceding "BLOCKS",
+ *   whose blocks replace those of fp; else fd is NULL. */
+
+static void read_grid(GridS *pG, FILE *fp, FILE *fd, const int disp[3],
+                      const int nx[3])
+{
+  int i,j,k,is,ie,js,je,ks,ke,il,ih,jl,jh,kl,kh,io,jo,ko,nb[3];
+  long m,ncell,mx,my;
+  Real *buf;
+  char line[MAXLEN];
+#ifdef MHD
+  int ib=0,jb=0,kb=0;
+#endif
+#if (NSCALARS > 0)
+  int n;
+  char scalarstr[16];
+#endif
+#ifdef PARTICLES
+  long p;
+#endif
+
+  is = pG->is;
+  ie = pG->ie;
+  js = pG->js;
+  je = pG->je;
+  ks = pG->ks;
+  ke = pG->ke;
+
+/* [ijk]o are the indices in pG of the first zone read, and [ijk]l..[ijk]h the
+ * range of zones of pG read.  All of pG is read unless repartitioned. */
+
+  io = is + disp[0] - pG->Disp[0];
+  jo = js + disp[1] - pG->Disp[1];
+  ko = ks + disp[2] - pG->Disp[2];
+  il = MAX(is, io);  ih = MIN(ie, io + nx[0] - 1);
+  jl = MAX(js, jo);  jh = MIN(je, jo + nx[1] - 1);
+  kl = MAX(ks, ko);  kh = MIN(ke, ko + nx[2] - 1);
+
+/* Each section is read at once into buf, and copied into the Grid.  The
+ * largest (face-centered B, EdgeFlux) has one more value along each axis */
+
+  mx = nx[0];
+  my = nx[1];
+  ncell = mx*my*(long)nx[2];
+  buf = (Real*)calloc_1d_array((mx+1)*(my+1)*(long)(nx[2]+1),sizeof(Real));
+  if (buf == NULL)
+    ath_error("[restart_grids]: malloc returned a NULL pointer\n");
+
+/* The list of the blocks of a delta restart, which must be those of this
+ * Grid.  read_delta() then replaces them in each section read. */
+
+  if (fd != NULL) {
+    fgets(line,MAXLEN,fd); /* Read the '\n' preceeding the next string */
+    fgets(line,MAXLEN,fd);
+    if(strncmp(line,"BLOCKS",6) != 0)
+      ath_error("[restart_grids]: Expected BLOCKS, found %s",line);
+    if(fread(&dlt_bsize,sizeof(int),1,fd) != 1 ||
+       fread(dlt_nb,sizeof(int),3,fd) != 3 ||
+       fread(&dlt_nchg,sizeof(int),1,fd) != 1 || dlt_bsize < 1 ||
+       grid_blocks(nx,dlt_bsize,nb) <= 0 || nb[0] != dlt_nb[0] ||
+       nb[1] != dlt_nb[1] || nb[2] != dlt_nb[2])
+      ath_error("[restart_grids]: Error reading BLOCKS\n");
+    dlt_list = (int*)calloc_1d_array(MAX(dlt_nchg,1),sizeof(int));
+    if (dlt_list == NULL)
+      ath_error("[restart_grids]: malloc returned a NULL pointer\n");
+    if(fread(dlt_list,sizeof(int),dlt_nchg,fd) != (size_t)dlt_nchg)
+      ath_error("[restart_grids]: Error reading BLOCKS\n");
+  }
+
+/* Read the density */
+
+  read_section(fp,"DENSITY",buf,ncell);
+  if (fd != NULL) read_delta(fd,"DENSITY",buf,mx,my,nx[2]);
+  for (k=kl; k<=kh; k++) {
+    for (j=jl; j<=jh; j++) {
+      m = ((k-ko)*my + j-jo)*mx + il-io;
+      for (i=il; i<=ih; i++) {
+        pG->U[k][j][i].d = buf[m++];
+      }
+    }
+  }
+
+/* Read the x1-momentum */
+
+  read_section(fp,"1-MOMENTUM",buf,ncell);
+  if (fd != NULL) read_delta(fd,"1-MOMENTUM",buf,mx,my,nx[2]);
+  for (k=kl; k<=kh; k++) {
+    for (j=jl; j<=jh; j++) {
+      m = ((k-ko)*my + j-jo)*mx + il-io;
+      for (i=il; i<=ih; i++) {
+        pG->U[k][j][i].M1 = buf[m++];
+      }
+    }
+  }
+
+/* Read the x2-momentum */
+
+  read_section(fp,"2-MOMENTUM",buf,ncell);
+  if (fd != NULL) read_delta(fd,"2-MOMENTUM",buf,mx,my,nx[2]);
+  for (k=kl; k<=kh; k++) {
+    for (j=jl; j<=jh; j++) {
+      m = ((k-ko)*my + j-jo)*mx + il-io;
+      for (i=il; i<=ih; i++) {
+        pG->U[k][j][i].M2 = buf[m++];
+      }
+    }
+  }
+
+/* Read the x3-momentum */
+
+  read_section(fp,"3-MOMENTUM",buf,ncell);
+  if (fd != NULL) read_delta(fd,"3-MOMENTUM",buf,mx,my,nx[2]);
+  for (k=kl; k<=kh; k++) {
+    for (j=jl; j<=jh; j++) {
+      m = ((k-ko)*my + j-jo)*mx + il-io;
+      for (i=il; i<=ih; i++) {
+        pG->U[k][j][i].M3 = buf[m++];
+      }
+    }
+  }
+
+#ifndef BAROTROPIC
+/* Read energy density */
+
+  read_section(fp,"ENERGY",buf,ncell);
+  if (fd != NULL) read_delta(fd,"ENERGY",buf,mx,my,nx[2]);
+  for (k=kl; k<=kh; k++) {
+    for (j=jl; j<=jh; j++) {
+      m = ((k-ko)*my + j-jo)*mx + il-io;
+      for (i=il; i<=ih; i++) {
+        pG->U[k][j][i].E = buf[m++];
+      }
+    }
+  }
+#endif
+
+#ifdef MHD
+/* if there is more than one cell in each dimension, need to read one more
+ * face-centered field component than the number of cells.  [ijk]b is
+ * the number of extra cells to be read  */
+
+  if (ie > is) ib=1;
+  if (je > js) jb=1;
+  if (ke > ks) kb=1;
+
+/* Read the face-centered x1 B-field */
+
+  read_section(fp,"1-FIELD",buf,(mx+ib)*my*(long)nx[2]);
+  if (fd != NULL) read_delta(fd,"1-FIELD",buf,mx+ib,my,nx[2]);
+  for (k=kl; k<=kh; k++) {
+    for (j=jl; j<=jh; j++) {
+      m = ((k-ko)*my + j-jo)*(mx+ib) + il-io;
+      for (i=il; i<=ih+ib; i++) {
+        pG->B1i[k][j][i] = buf[m++];
+      }
+    }
+  }
+
+/* Read the face-centered x2 B-field */
+
+  read_section(fp,"2-FIELD",buf,mx*(my+jb)*(long)nx[2]);
+  if (fd != NULL) read_delta(fd,"2-FIELD",buf,mx,my+jb,nx[2]);
+  for (k=kl; k<=kh; k++) {
+    for (j=jl; j<=jh+jb; j++) {
+      m = ((k-ko)*(my+jb) + j-jo)*mx + il-io;
+      for (i=il; i<=ih; i++) {
+        pG->B2i[k][j][i] = buf[m++];
+      }
+    }
+  }
+
+/* Read the face-centered x3 B-field */
+
+  read_section(fp,"3-FIELD",buf,mx*my*(long)(nx[2]+kb));
+  if (fd != NULL) read_delta(fd,"3-FIELD",buf,mx,my,nx[2]+kb);
+  for (k=kl; k<=kh+kb; k++) {
+    for (j=jl; j<=jh; j++) {
+      m = ((k-ko)*my + j-jo)*mx + il-io;
+      for (i=il; i<=ih; i++) {
+        pG->B3i[k][j][i] = buf[m++];
+      }
+    }
+  }
+
+/* initialize the cell center magnetic fields as either the average of the face
+ * centered field if there is more than one cell in that dimension, or just
+ * the face centered field if not  */
+
+  for (k=kl; k<=kh; k++) {
+  for (j=jl; j<=jh; j++) {
+  for (i=il; i<=ih; i++) {
+    pG->U[k][j][i].B1c = pG->B1i[k][j][i];
+    pG->U[k][j][i].B2c = pG->B2i[k][j][i];
+    pG->U[k][j][i].B3c = pG->B3i[k][j][i];
+    if(ib==1) pG->U[k][j][i].B1c=0.5*(pG->B1i[k][j][i] +pG->B1i[k][j][i+1]);
+    if(jb==1) pG->U[k][j][i].B2c=0.5*(pG->B2i[k][j][i] +pG->B2i[k][j+1][i]);
+    if(kb==1) pG->U[k][j][i].B3c=0.5*(pG->B3i[k][j][i] +pG->B3i[k+1][j][i]);
+  }}}
+#endif
+
+#ifdef ION_RADPLANE
+
+/* Read the radiation flux */
+
+  read_section(fp,"EDGEFLUX",buf,(mx+1)*(my+1)*(long)(nx[2]+1));
+  if (fd != NULL) read_delta(fd,"EDGEFLUX",buf,mx+1,my+1,nx[2]+1);
+  for (k=kl-nghost; k<=kh-nghost+1; k++) {
+    for (j=jl-nghost; j<=jh-nghost+1; j++) {
+      m = ((k-ko+nghost)*(my+1) + j-jo+nghost)*(mx+1) + il-io;
+      for (i=il-nghost; i<=ih-nghost+1; i++) {
+        pG->EdgeFlux[k][j][i] = buf[m++];
+      }
+    }
+  }
+
+/*   /\* Read list of radiator planes *\/ */
+/*   fgets(line,MAXLEN,fp);/\* Read the '\n' preceeding the next string *\/ */
+/*   fgets(line,MAXLEN,fp); */
+/*   if(strncmp(line,"RADIATOR PLANE LIST",19) != 0) */
+/*     ath_error("[restart_grid_block]: Expected RADIATOR PLANE LIST, found %s",line); */
+/*   fread(&nradplane,sizeof(int),1,fp); */
+/*   for (n=0; n<nradplane; n++) { */
+/*     fread(&dir,sizeof(int),1,fp); */
+/*     fread(&flux,sizeof(Real),1,fp); */
+/*     add_radplane_3d(pG, dir, flux); */
+/*   } */
+#endif /* ION_RADPLANE */
+
+#if (NSCALARS > 0)
+/* Read any passively advected scalars */
+/* Following code only works if NSCALARS < 10 */
+
+  for (n=0; n<NSCALARS; n++) {
+    sprintf(scalarstr, "SCALAR %d", n);
+    read_section(fp,scalarstr,buf,ncell);
+    if (fd != NULL) read_delta(fd,scalarstr,buf,mx,my,nx[2]);
+    for (k=kl; k<=kh; k++) {
+      for (j=jl; j<=jh; j++) {
+        m = ((k-ko)*my + j-jo)*mx + il-io;
+        for (i=il; i<=ih; i++) {
+          pG->U[k][j][i].s[n] = buf[m++];
+        }
+      }
+    }
+  }
+#endif
+
+  free_1d_array(buf);
+  if (fd != NULL) {
+    free_1d_array(dlt_list);
+    dlt_list = NULL;
+  }
+
+#ifdef PARTICLES
+/* Read particle properties and the complete particle list */
+
+  fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
+  fgets(line,MAXLEN,fp);
+  if(strncmp(line,"PARTICLE LIST",13) != 0)
+    ath_error("[restart_grids]: Expected PARTICLE LIST, found %s",line);
+  fread(&(pG->nparticle),sizeof(long),1,fp);
+  fread(&(pG->partypes),sizeof(int),1,fp);
+  for (i=0; i<pG->partypes; i++) {          /* particle property list */
+#ifdef FEEDBACK
+    fread(&(pG->grproperty[i].m),sizeof(Real),1,fp);
+#endif
+    fread(&(pG->grproperty[i].rad),sizeof(Real),1,fp);
+    fread(&(pG->grproperty[i].rho),sizeof(Real),1,fp);
+    fread(&(tstop0[i]),sizeof(Real),1,fp);
+    fread(&(grrhoa[i]),sizeof(Real),1,fp);
+  }
+  fread(&(alamcoeff),sizeof(Real),1,fp);  /* coef to calc Reynolds number */
+
+  for (i=0; i<pG->partypes; i++)
+    fread(&(pG->grproperty[i].integrator),sizeof(short),1,fp);
+
+/* Read the x1-positions */
+
+  fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
+  fgets(line,MAXLEN,fp);
+  if(strncmp(line,"PARTICLE X1",11) != 0)
+    ath_error("[restart_grids]: Expected PARTICLE X1, found %s",line);
+  for (p=0; p<pG->nparticle; p++) {
+    fread(&(pG->particle[p].x1),sizeof(Real),1,fp);
+  }
+
+/* Read the x2-positions */
+
+  fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
+  fgets(line,MAXLEN,fp);
+  if(strncmp(line,"PARTICLE X2",11) != 0)
+    ath_error("[restart_grids]: Expected PARTICLE X2, found %s",line);
+  for (p=0; p<pG->nparticle; p++) {
+    fread(&(pG->particle[p].x2),sizeof(Real),1,fp);
+  }
+
+/* Read the x3-positions */
+
+  fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
+  fgets(line,MAXLEN,fp);
+  if(strncmp(line,"PARTICLE X3",11) != 0)
+    ath_error("[restart_grids]: Expected PARTICLE X3, found %s",line);
+  for (p=0; p<pG->nparticle; p++) {
+    fread(&(pG->particle[p].x3),sizeof(Real),1,fp);
+  }
+
+/* Read the v1 velocity */
+
+  fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
+  fgets(line,MAXLEN,fp);
+  if(strncmp(line,"PARTICLE V1",11) != 0)
+    ath_error("[restart_grids]: Expected PARTICLE V1, found %s",line);
+  for (p=0; p<pG->nparticle; p++) {
+    fread(&(pG->particle[p].v1),sizeof(Real),1,fp);
+  }
+
+/* Read the v2 velocity */
+
+  fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
+  fgets(line,MAXLEN,fp);
+  if(strncmp(line,"PARTICLE V2",11) != 0)
+    ath_error("[restart_grids]: Expected PARTICLE V2, found %s",line);
+  for (p=0; p<pG->nparticle; p++) {
+    fread(&(pG->particle[p].v2),sizeof(Real),1,fp);
+  }
+
+/* Read the v3 velocity */
+
+  fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
+  fgets(line,MAXLEN,fp);
+  if(strncmp(line,"PARTICLE V3",11) != 0)
+    ath_error("[restart_grids]: Expected PARTICLE V3, found %s",line);
+  for (p=0; p<pG->nparticle; p++) {
+    fread(&(pG->particle[p].v3),sizeof(Real),1,fp);
+  }
+
+/* Read particle properties */
+
+  fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
+  fgets(line,MAXLEN,fp);
+  if(strncmp(line,"PARTICLE PROPERTY",17) != 0)
+    ath_error("[restart_grids]: Expected PARTICLE PROPERTY, found %s",line);
+  for (p=0; p<pG->nparticle; p++) {
+    fread(&(pG->particle[p].property),sizeof(int),1,fp);
+    pG->particle[p].pos = 1;	/* grid particle */
+  }
+
+/* Read particle my_id */
+
+  fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
+  fgets(line,MAXLEN,fp);
+  if(strncmp(line,"PARTICLE MY_ID",14) != 0)
+    ath_error("[restart_grids]: Expected PARTICLE MY_ID, found %s",line);
+  for (p=0; p<pG->nparticle; p++) {
+    fread(&(pG->particle[p].my_id),sizeof(long),1,fp);
+  }
+
+#ifdef MPI_PARALLEL
+/* Read particle init_id */
+
+  fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
+  fgets(line,MAXLEN,fp);
+  if(strncmp(line,"PARTICLE INIT_ID",16) != 0)
+    ath_error("[restart_grids]: Expected PARTICLE INIT_ID, found %s",line);
+  for (p=0; p<pG->nparticle; p++) {
+    fread(&(pG->particle[p].init_id),sizeof(int),1,fp);
+  }
+#endif
+
+/* count the number of particles with different types */
+
+  for (i=0; i<pG->partypes; i++)
+    pG->grproperty[i].num = 0;
+  for (p=0; p<pG->nparticle; p++)
+    pG->grproperty[pG->particle[p].property].num += 1;
+
+#endif /* PARTICLES */
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void read_section(FILE *fp, const char *name, Real *buf,
+ *                               const long n)
+ *  \brief Reads the line preceding a section, checks that the section is
+ *   name, and reads its n Reals into buf with one fread() */
+
+static void read_section(FILE *fp, const char *name, Real *buf, const long n)
+{
+  char line[MAXLEN];
+
+  fgets(line,MAXLEN,fp); /* Read the '\n' preceeding the next string */
+  fgets(line,MAXLEN,fp);
+  if(strncmp(line,name,strlen(name)) != 0)
+    ath_error("[restart_grids]: Expected %s, found %s",name,line);
+  if(fread(buf,sizeof(Real),(size_t)n,fp) != (size_t)n)
+    ath_error("[restart_grids]: Unexpected end of file reading %s\n",name);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void read_delta(FILE *fd, const char *name, Real *buf,
+ *                             const long sx, const long sy, const long sz)
+ *  \brief Reads section name of a Grid of a delta restart, holding the blocks
+ *   listed in dlt_list, and copies them into buf, which holds the section of
+ *   sx*sy*sz values read from the full restart */
+
+static void read_delta(FILE *fd, const char *name, Real *buf, const long sx,
+                       const long sy, const long sz)
+{
+  Real *dbuf;
+  long i,j,k,m,n,sn[3],lo[3],hi[3];
+  int b;
+
+  sn[0] = sx;
+  sn[1] = sy;
+  sn[2] = sz;
+  n = 0;
+  for (b=0; b<dlt_nchg; b++) {
+    block_range(dlt_list[b],dlt_bsize,dlt_nb,sn,lo,hi);
+    n += (hi[0]-lo[0])*(hi[1]-lo[1])*(hi[2]-lo[2]);
+  }
+  if ((dbuf = (Real*)calloc_1d_array(MAX(n,1),sizeof(Real))) == NULL)
+    ath_error("[restart_grids]: malloc returned a NULL pointer\n");
+  read_section(fd,name,dbuf,n);
+
+  m = 0;
+  for (b=0; b<dlt_nchg; b++) {
+    block_range(dlt_list[b],dlt_bsize,dlt_nb,sn,lo,hi);
+    for (k=lo[2]; k<hi[2]; k++) {
+      for (j=lo[1]; j<hi[1]; j++) {
+        for (i=lo[0]; i<hi[0]; i++) {
+          buf[(k*sy + j)*sx + i] = dbuf[m++];
+        }
+      }
+    }
+  }
+
+  free_1d_array(dbuf);
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int grid_section(GridS *pG, const int s, char *name, Real *buf,
+ *                              long sn[3], const int unpack)
+ *  \brief Copies section s (counted from 0 in the order written by
+ *   dump_restart()) of the data of pG into buf (or from buf into pG if unpack
+ *   is 1), sets its name and its size sn along each axis, and returns 1;
+ *   returns 0 if there is no section s.  buf must hold
+ *   (Nx[0]+1)*(Nx[1]+1)*(Nx[2]+1) values. */
+
+/* Copies one value of a section between the Grid and buf */
+#define SECTION_COPY(x) if (unpack) (x) = buf[m++]; else buf[m++] = (x)
+
+static int grid_section(GridS *pG, const int s, char *name, Real *buf,
+                        long sn[3], const int unpack)
+{
+  int i,j,k,is,ie,js,je,ks,ke,ns=0;
+  long m=0;
+#ifdef MHD
+  int ib=0,jb=0,kb=0;
+#endif
+#if (NSCALARS > 0)
+  int n;
+#endif
+
+  is = pG->is;
+  ie = pG->ie;
+  js = pG->js;
+  je = pG->je;
+  ks = pG->ks;
+  ke = pG->ke;
+  sn[0] = ie-is+1;
+  sn[1] = je-js+1;
+  sn[2] = ke-ks+1;
+
+  if (s == ns++) {
+    strcpy(name,"DENSITY");
+    for (k=ks; k<=ke; k++)
+      for (j=js; j<=je; j++)
+        for (i=is; i<=ie; i++) SECTION_COPY(pG->U[k][j][i].d);
+    return 1;
+  }
+  if (s == ns++) {
+    strcpy(name,"1-MOMENTUM");
+    for (k=ks; k<=ke; k++)
+      for (j=js; j<=je; j++)
+        for (i=is; i<=ie; i++) SECTION_COPY(pG->U[k][j][i].M1);
+    return 1;
+  }
+  if (s == ns++) {
+    strcpy(name,"2-MOMENTUM");
+    for (k=ks; k<=ke; k++)
+      for (j=js; j<=je; j++)
+        for (i=is; i<=ie; i++) SECTION_COPY(pG->U[k][j][i].M2);
+    return 1;
+  }
+  if (s == ns++) {
+    strcpy(name,"3-MOMENTUM");
+    for (k=ks; k<=ke; k++)
+      for (j=js; j<=je; j++)
+        for (i=is; i<=ie; i++) SECTION_COPY(pG->U[k][j][i].M3);
+    return 1;
+  }
+#ifndef BAROTROPIC
+  if (s == ns++) {
+    strcpy(name,"ENERGY");
+    for (k=ks; k<=ke; k++)
+      for (j=js; j<=je; j++)
+        for (i=is; i<=ie; i++) SECTION_COPY(pG->U[k][j][i].E);
+    return 1;
+  }
+#endif
+
+#ifdef MHD
+/* face-centered fields have one more value along their axis, see
+ * dump_restart() */
+
+  if (ie > is) ib = 1;
+  if (je > js) jb = 1;
+  if (ke > ks) kb = 1;
+  if (s == ns++) {
+    strcpy(name,"1-FIELD");
+    sn[0] += ib;
+    for (k=ks; k<=ke; k++)
+      for (j=js; j<=je; j++)
+        for (i=is; i<=ie+ib; i++) SECTION_COPY(pG->B1i[k][j][i]);
+    return 1;
+  }
+  if (s == ns++) {
+    strcpy(name,"2-FIELD");
+    sn[1] += jb;
+    for (k=ks; k<=ke; k++)
+      for (j=js; j<=je+jb; j++)
+        for (i=is; i<=ie; i++) SECTION_COPY(pG->B2i[k][j][i]);
+    return 1;
+  }
+  if (s == ns++) {
+    strcpy(name,"3-FIELD");
+    sn[2] += kb;
+    for (k=ks; k<=ke+kb; k++)
+      for (j=js; j<=je; j++)
+        for (i=is; i<=ie; i++) SECTION_COPY(pG->B3i[k][j][i]);
+    return 1;
+  }
+#endif
+
+#ifdef ION_RADPLANE
+  if (s == ns++) {
+    strcpy(name,"EDGEFLUX");
+    sn[0]++;
+    sn[1]++;
+    sn[2]++;
+    for (k=ks-nghost; k<=ke-nghost+1; k++)
+      for (j=js-nghost; j<=je-nghost+1; j++)
+        for (i=is-nghost; i<=ie-nghost+1; i++)
+          SECTION_COPY(pG->EdgeFlux[k][j][i]);
+    return 1;
+  }
+#endif
+
+#if (NSCALARS > 0)
+  for (n=0; n<NSCALARS; n++) {
+    if (s == ns++) {
+      sprintf(name,"SCALAR %d",n);
+      for (k=ks; k<=ke; k++)
+        for (j=js; j<=je; j++)
+          for (i=is; i<=ie; i++) SECTION_COPY(pG->U[k][j][i].s[n]);
+      return 1;
+    }
+  }
+#endif
+
+  return 0;
+}
+#undef SECTION_COPY
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int grid_blocks(const int nx[3], const int bsize, int nb[3])
+ *  \brief Sets the number of blocks of bsize zones along each axis of a Grid
+ *   of nx zones (the last may be smaller), and returns their total number */
+
+static int grid_blocks(const int nx[3], const int bsize, int nb[3])
+{
+  int dim;
+
+  for (dim=0; dim<3; dim++) nb[dim] = (nx[dim] + bsize - 1)/bsize;
+
+  return nb[0]*nb[1]*nb[2];
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void block_range(const int b, const int bsize, const int nb[3],
+ *                              const long sn[3], long lo[3], long hi[3])
+ *  \brief Sets the range lo..hi-1 along each axis of block b (numbered with
+ *   x1 fastest) of a section of sn values along each axis.  The last block
+ *   along an axis also holds the extra faces of face-centered sections. */
+
+static void block_range(const int b, const int bsize, const int nb[3],
+                        const long sn[3], long lo[3], long hi[3])
+{
+  int dim,c[3];
+
+  c[0] = b % nb[0];
+  c[1] = (b/nb[0]) % nb[1];
+  c[2] = b/(nb[0]*nb[1]);
+  for (dim=0; dim<3; dim++) {
+    lo[dim] = (long)c[dim]*bsize;
+    hi[dim] = (c[dim] == nb[dim]-1) ? sn[dim] : lo[dim] + bsize;
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void block_hash(GridS *pG, const int bsize, uint64_t *hash)
+ *  \brief Computes a 64 bit hash of all sections of each block of bsize
+ *   zones of pG.  Each value is taken as a word and hashed with FNV-1a,
+ *   followed by an xorshift so that its high bits reach all bits of the hash
+ *   (a sign flip would otherwise only change the top bit). */
+
+static void block_hash(GridS *pG, const int bsize, uint64_t *hash)
+{
+  Real *buf;
+  char name[16];
+  long i,j,k,sn[3],lo[3],hi[3];
+  uint64_t h,v;
+  int b,s,nblk,nb[3];
+
+  nblk = grid_blocks(pG->Nx,bsize,nb);
+  buf = (Real*)calloc_1d_array((pG->Nx[0]+1)*(pG->Nx[1]+1)*(long)(pG->Nx[2]+1),
+    sizeof(Real));
+  if (buf == NULL)
+    ath_error("[dump_restart]: malloc returned a NULL pointer\n");
+
+  for (b=0; b<nblk; b++) hash[b] = 14695981039346656037ULL;
+  for (s=0; grid_section(pG,s,name,buf,sn,0); s++) {
+    for (b=0; b<nblk; b++) {
+      block_range(b,bsize,nb,sn,lo,hi);
+      h = hash[b];
+      for (k=lo[2]; k<hi[2]; k++) {
+        for (j=lo[1]; j<hi[1]; j++) {
+          for (i=lo[0]; i<hi[0]; i++) {
+            v = 0;
+            memcpy(&v,&buf[(k*sn[1] + j)*sn[0] + i],sizeof(Real));
+            h = (h ^ v)*1099511628211ULL;
+            h ^= h >> 32;
+          }
+        }
+      }
+      hash[b] = h;
+    }
+  }
+
+  free_1d_array(buf);
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void write_delta(GridS *pG, FILE *fp, const int bsize,
+ *                              const uint64_t *hash)
+ *  \brief Writes the blocks of bsize zones of pG whose hash differs from
+ *   hash (that in the full restart): the BLOCKS section (bsize, the number of
+ *   blocks along each axis, the number of changed blocks and their indices),
+ *   then each section of dump_restart() with the values of the changed
+ *   blocks, block after block. */
+
+static void write_delta(GridS *pG, FILE *fp, const int bsize,
+                        const uint64_t *hash)
+{
+  Real *buf,*dbuf;
+  uint64_t *hnew;
+  char name[16];
+  long i,j,k,m,ncell,sn[3],lo[3],hi[3];
+  int b,s,nblk,nchg,nb[3],*list;
+
+  nblk = grid_blocks(pG->Nx,bsize,nb);
+  ncell = (pG->Nx[0]+1)*(pG->Nx[1]+1)*(long)(pG->Nx[2]+1);
+  buf  = (Real*)calloc_1d_array(ncell,sizeof(Real));
+  dbuf = (Real*)calloc_1d_array(ncell,sizeof(Real));
+  hnew = (uint64_t*)calloc_1d_array(nblk,sizeof(uint64_t));
+  list = (int*)calloc_1d_array(nblk,sizeof(int));
+  if (buf == NULL || dbuf == NULL || hnew == NULL || list == NULL)
+    ath_error("[dump_restart]: malloc returned a NULL pointer\n");
+
+  block_hash(pG,bsize,hnew);
+  nchg = 0;
+  for (b=0; b<nblk; b++) if (hnew[b] != hash[b]) list[nchg++] = b;
+
+  fprintf(fp,"\nBLOCKS\n");
+  if(fwrite(&bsize,sizeof(int),1,fp) != 1 ||
+     fwrite(nb,sizeof(int),3,fp) != 3 ||
+     fwrite(&nchg,sizeof(int),1,fp) != 1 ||
+     fwrite(list,sizeof(int),nchg,fp) != (size_t)nchg)
+    ath_error("[dump_restart]: fwrite() error\n");
+
+  for (s=0; grid_section(pG,s,name,buf,sn,0); s++) {
+    m = 0;
+    for (b=0; b<nchg; b++) {
+      block_range(list[b],bsize,nb,sn,lo,hi);
+      for (k=lo[2]; k<hi[2]; k++) {
+        for (j=lo[1]; j<hi[1]; j++) {
+          for (i=lo[0]; i<hi[0]; i++) {
+            dbuf[m++] = buf[(k*sn[1] + j)*sn[0] + i];
+          }
+        }
+      }
+    }
+    fprintf(fp,"\n%s\n",name);
+    if(fwrite(dbuf,sizeof(Real),m,fp) != (size_t)m)
+      ath_error("[dump_restart]: fwrite() error\n");
+  }
+
+  free_1d_array(buf);
+  free_1d_array(dbuf);
+  free_1d_array(hnew);
+  free_1d_array(list);
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void base_fname(const char *name, const int num, char *bname)
+ *  \brief Builds the name of restart number num from the name of another
+ *   restart, replacing the digits between its last two periods. */
+
+static void base_fname(const char *name, const int num, char *bname)
+{
+  char *pe,*pd;
+
+  strcpy(bname, name);
+  pe = strrchr(bname,'.');
+  pd = pe;
+  if (pd != NULL) {
+    do{
+      pd--;
+    }while(pd > bname && *pd != '.');
+  }
+  if (pe == NULL || *pd != '.' || pe - pd < 2)
+    ath_error("[restart_grids]: No restart number in %s\n",name);
+  sprintf(pd+1,"%0*d%s",(int)(pe - pd - 1),num,&(name[pe - bname]));
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static FILE *open_base(const char *name)
+ *  \brief Opens the full restart of a delta restart, and skips its parameter
+ *   file, N_STEP, TIME and TIME_STEP, to the line preceding its first Grid */
+
+static FILE *open_base(const char *name)
+{
+  FILE *fp;
+  char line[MAXLEN];
+  int nstep;
+  Real t;
+
+  if((fp = fopen(name,"r")) == NULL)
+    ath_error("[restart_grids]: Error opening the full restart file %s of a delta restart\n",
+      name);
+
+  do{
+    if (fgets(line,MAXLEN,fp) == NULL)
+      ath_error("[restart_grids]: Unexpected end of file reading %s\n",name);
+  }while(strncmp(line,"<par_end>",9) != 0);
+
+  fgets(line,MAXLEN,fp);
+  if(strncmp(line,"N_STEP",6) != 0)
+    ath_error("[restart_grids]: Expected N_STEP, found %s",line);
+  fread(&nstep,sizeof(int),1,fp);
+  fgets(line,MAXLEN,fp);   /* Read the '\n' preceeding the next string */
+  fgets(line,MAXLEN,fp);
+  if(strncmp(line,"TIME",4) != 0)
+    ath_error("[restart_grids]: Expected TIME, found %s",line);
+  fread(&t,sizeof(Real),1,fp);
+  fgets(line,MAXLEN,fp);   /* Read the '\n' preceeding the next string */
+  fgets(line,MAXLEN,fp);
+  if(strncmp(line,"TIME_STEP",9) != 0)
+    ath_error("[restart_grids]: Expected TIME_STEP, found %s",line);
+  fread(&t,sizeof(Real),1,fp);
+
+  return fp;
+}
+
+#ifdef MPI_PARALLEL
+/*----------------------------------------------------------------------------*/
+/*! \fn static FILE *open_at(const char *name, const long off)
+ *  \brief Opens the restart file name at offset off */
+
+static FILE *open_at(const char *name, const long off)
+{
+  FILE *fp;
+
+  if((fp = fopen(name,"r")) == NULL)
+    ath_error("[restart_grids]: Error opening restart file %s\n",name);
+  if (fseek(fp, off, SEEK_SET) != 0)
+    ath_error("[restart_grids]: fseek() error\n");
+
+  return fp;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void write_layout(MeshS *pM, OutputS *pout, long *offset,
+ *                                long *boffset)
+ *  \brief Gathers the offsets of Grids (offset[0..ngrid-1], in get_myGridID()
+ *   order) and of USER_DATA (offset[ngrid+rank]) in the restart files of all
+ *   ranks, and writes them on rank 0 to the .lay file of this restart with
+ *   the rank of each Grid on restart (the current one) and its level, Domain,
+ *   Disp and Nx.  For a
+ *   delta restart, boffset holds the offsets of the full restart, which
+ *   follow (version 3); else it is NULL. */
+
+static void write_layout(MeshS *pM, OutputS *pout, long *offset,
+                         long *boffset)
+{
+  DomainS *pD;
+  GridsDataS *pGD;
+  FILE *fp;
+  char *fname;
+  long *off=NULL,*boff=NULL;
+  int nl,nd,n,m,l,g,r,ngrid,nproc,ierr;
+
+  ngrid = get_nGrids(pM);
+  ierr = MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+  if (myID_Comm_world == 0) {
+    if ((off = (long*)calloc_1d_array(ngrid+nproc, sizeof(long))) == NULL ||
+        (boff = (long*)calloc_1d_array(ngrid+nproc, sizeof(long))) == NULL)
+      ath_error("[write_layout]: malloc returned a NULL pointer\n");
+  }
+  ierr = MPI_Reduce(offset, off, ngrid+nproc, MPI_LONG, MPI_SUM, 0,
+    MPI_COMM_WORLD);
+  if (boffset != NULL)
+    ierr = MPI_Reduce(boffset, boff, ngrid+nproc, MPI_LONG, MPI_SUM, 0,
+      MPI_COMM_WORLD);
+  if (myID_Comm_world != 0) return;
+
+  if((fname = ath_fname(NULL,pM->outfilename,NULL,NULL,num_digit,
+      pout->num,NULL,"lay")) == NULL){
+    ath_error("[write_layout]: Error constructing filename\n");
+  }
+  if((fp = fopen(fname,"w")) == NULL)
+    ath_error("[write_layout]: Unable to open layout file %s\n",fname);
+
+  fprintf(fp,"%d %d %d\n",ngrid,nproc,(boffset != NULL) ? 3 : 2);
+  g = 0;
+  for (nl=0; nl<(pM->NLevels); nl++){
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      pD = (DomainS*)&(pM->Domain[nl][nd]);
+      for(n=0; n<(pD->NGrid[2]); n++){
+      for(m=0; m<(pD->NGrid[1]); m++){
+      for(l=0; l<(pD->NGrid[0]); l++){
+        pGD = &(pD->GData[n][m][l]);
+        r = pGD->ID_Comm_world;
+        fprintf(fp,"%d %d %ld %d %d %d %d %d %d %d %d %d",g,r,off[g],r,nl,nd,
+          pGD->Disp[0],pGD->Disp[1],pGD->Disp[2],pGD->Nx[0],pGD->Nx[1],
+          pGD->Nx[2]);
+        if (boffset != NULL) fprintf(fp," %ld",boff[g]);
+        fprintf(fp,"\n");
+        g++;
+      }}}
+    }
+  }
+  for (r=0; r<nproc; r++) fprintf(fp,"%ld\n",off[ngrid+r]);
+
+  fclose(fp);
+  free(fname);
+  free_1d_array(off);
+  free_1d_array(boff);
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void rank_fname(const char *base, const int id, char *name)
+ *  \brief Builds the name of the restart file written by rank id from that of
+ *   rank 0 (base), inserting -id# before the first period as main() does. */
+
+static void rank_fname(const char *base, const int id, char *name)
+{
+  char *pc;
+
+  strcpy(name, base);
+  if (id == 0) return;
+
+  pc = strrchr(name,'.');
+  do{
+    pc--;
+  }while(pc > name && *pc != '.');
+  sprintf(pc,"-id%d%s",id,&(base[pc - name]));
 
   return;
 }
+#endif /* MPI_PARALLEL */
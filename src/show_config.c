@@ -169,6 +169,12 @@ void show_config(void)
   ath_pout(0," FFT:                     OFF\n");
 #endif
 
+#ifdef ZLIB_ENABLED
+  ath_pout(0," zlib compression:        ON\n");
+#else
+  ath_pout(0," zlib compression:        OFF\n");
+#endif
+
 #ifdef SHEARING_BOX
   ath_pout(0," Shearing Box:            ON\n");
 #else
@@ -333,6 +339,12 @@ void show_config_par(void)
   par_sets("configure","FFT","no","FFT enabled?");
 #endif
 
+#ifdef ZLIB_ENABLED
+  par_sets("configure","zlib","yes","zlib compression enabled?");
+#else
+  par_sets("configure","zlib","no","zlib compression enabled?");
+#endif
+
 #ifdef SHEARING_BOX
   par_sets("configure","ShearingBox","yes","Shearing box enabled?");
 #else
@@ -14,20 +14,46 @@
  *    corrects cells at fine/coarse boundaries using restricted fine Grid fluxes
  * - Prolongate(): sets BC on fine Grid by prolongation (interpolation) of
  *     coarse Grid solution into fine grid ghost zones
+ * - RestrictCorrectLevel(): RestrictCorrect() for one level and its parents
+ * - ProlongateLevel(): Prolongate() for one level from its parents, with the
+ *     parent solution interpolated in time
+ * - RestrictCorrectStep(), ProlongateStep(): one level of RestrictCorrect()
+ *     and Prolongate(), to overlap their messages with other work
+ * - SMR_report(): prints the rates of the prolongation/restriction kernels
+ * - ProlongateSave(): saves parent solution used by ProlongateLevel()
+ * - SubcycleFluxes(): averages fine Grid fluxes over the two substeps
  * - SMR_init(): allocates memory for send/receive buffers
+ * - SMR_destruct(): frees memory allocated by SMR_init()
+ * - ProCon(): prolongates conserved variables into a region of a child Grid
  * - ionradRestrictCorrect(): similar to RestrictCorrect, but only restricts
  *    energy and neutral density (first passive scalar)
  *
+ * With time subcycling (<time>/subcycle=1) each level advances with half the
+ * dt of its parent, so fine Grids are synchronized with their parents only at
+ * the end of each parent step.  In between, ProlongateLevel() sets fine Grid
+ * ghost zones from a linear interpolation of the parent solution saved by
+ * ProlongateSave() at the start of the parent step and the current one, and
+ * the fluxes used for the flux correction are the average over the substeps.
+ *
  * PRIVATE FUNCTION PROTOTYPES: 
- * - ProCon() - prolongates conserved variables
+ * - restrict_correct() - RestrictCorrect() for a range of levels
+ * - restrict_level() - one level of restrict_correct()
+ * - prolongate() - Prolongate() for a range of levels
+ * - prolongate_level() - one level of prolongate()
+ * - load_gz() - loads parent zones that overlap child ghost zones
+ * - pro_cons() - prolongates conserved variables over a ghost zone region
+ * - res_cons() - restricts conserved variables over an overlap region
+ * - mcd_slopes() - monotonized central-difference slopes along a row
  * - ProFld() - prolongates face-centered B field using TR formulas
  * - mcd_slope() - returns monotonized central-difference slope		      */
 /*============================================================================*/
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <sys/time.h>
 #include "defs.h"
 #include "athena.h"
 #include "globals.h"
@@ -56,8 +82,31 @@ static MPI_Request  **ion_send_rq=NULL;
 #endif /*MPI_PARALLEL*/
 
 static int maxND, *start_addrP;
+static double ***old_bufP=NULL;  /* saved parent data for ProlongateLevel() */
+
+/* Index of each cell-centered variable, in the order of ConsS */
+enum {IDN=0, IM1, IM2, IM3
+#ifndef BAROTROPIC
+  , IEN
+#endif
+#ifdef MHD
+  , IB1, IB2, IB3
+#endif
+};
+
+/* Parent zones received for child ghost zones, one array per variable in
+ * ConsS (with P in place of E, see prolongate_level()), and the slopes of a
+ * row of them */
+static Real ***GZ[3][NVAR];
+static Real **GZslope=NULL;
+
+/* Offsets in ConsS of the variables restricted by RestrictCorrect() and by
+ * ionradRestrictCorrect() */
+static int rc_var[NVAR], ion_var[NVAR], n_ion_var=0;
+
+/* Wall time spent in, and cells produced by, pro_cons() and res_cons() */
+static double pro_time=0.0, pro_cells=0.0, res_time=0.0, res_cells=0.0;
 
-static ConsS ***GZ[3];
 #ifdef MHD
 Real **SMRemf1, **SMRemf2, **SMRemf3;
 Real3Vect ***BFld[3];
@@ -65,32 +114,56 @@ Real3Vect ***BFld[3];
 
 /*==============================================================================
  * PRIVATE FUNCTION PROTOTYPES: 
- *   ProCon - prolongates conserved variables
+ *   restrict_correct - RestrictCorrect() for a range of levels
+ *   restrict_level - one level of restrict_correct()
+ *   prolongate - Prolongate() for a range of levels
+ *   prolongate_level - one level of prolongate()
+ *   load_gz - loads parent zones that overlap child ghost zones
+ *   pro_cons - prolongates conserved variables over a ghost zone region
+ *   res_cons - restricts conserved variables over an overlap region
+ *   mcd_slopes - monotonized central-difference slopes along a row
+ *   wtime - wall clock time
  *   ProFld - prolongates face-centered B field using TR formulas
  *   mcd_slope - returns monotonized central-difference slope
  *============================================================================*/
 
-void ProCon(const ConsS Uim1,const ConsS Ui,  const ConsS Uip1,
-            const ConsS Ujm1,const ConsS Ujp1,
-            const ConsS Ukm1,const ConsS Ukp1, ConsS PCon[][2][2]);
+static void restrict_correct(MeshS *pM, const int nlmin, const int nlmax);
+static void restrict_level(MeshS *pM, const int nl, const int nlmin,
+                           const int nlmax);
+static void prolongate(MeshS *pM, const int nlmin, const int nlmax,
+                       const Real w);
+static void prolongate_level(MeshS *pM, const int nl, const int nlmin,
+                             const int nlmax, const Real w);
+static void load_gz(GridS *pG, GridOvrlpS *pCO, const int nDim, double *pSnd);
+static void pro_cons(GridS *pG, Real ****pq, const int ips, const int ipe,
+                     const int jps, const int jpe, const int kps,
+                     const int kpe);
+static int res_cons(GridS *pG, const int ips, const int ipe, const int jps,
+                    const int jpe, const int kps, const int kpe,
+                    const int *var, const int nvar, double *pSnd);
+#ifndef FIRST_ORDER
+static void mcd_slopes(const int n, const Real *vl, const Real *vc,
+                       const Real *vr, Real *dq);
+#endif /* FIRST_ORDER */
+static double wtime(void);
 #ifdef MHD
 void ProFld(Real3Vect BGZ[][3][3], Real3Vect PFld[][3][3], 
   const Real dx1c, const Real dx2c, const Real dx3c);
-#endif /* MHD */
 #ifndef FIRST_ORDER
 static Real mcd_slope(const Real vl, const Real vc, const Real vr);
 #endif /* FIRST_ORDER */
+#endif /* MHD */
 
 #ifdef ION_RADPLANE
 void ionradRestrictCorrect(MeshS *pM)
 {
   GridS *pG;
   int nl,nd,ncg,dim,nDim,npg,rbufN,start_addr,cnt,nCons,nFlx;
-  int i,ii,ics,ice,ips,ipe;
-  int j,jj,jcs,jce,jps,jpe;
-  int k,kk,kcs,kce,kps,kpe;
-  Real q1,q2,q3,fact;
-  double *pRcv,*pSnd;
+  int i,ics,ice,ips,ipe;
+  int j,jcs,jce,jps,jpe;
+  int k,kcs,kce,kps,kpe;
+  Real q1,q2,q3;
+  double *pRcv;
   double addedstuff;
   GridOvrlpS *pCO, *pPO;
 #if (NSCALARS > 0)
@@ -102,7 +175,6 @@ void ionradRestrictCorrect(MeshS *pM)
 #ifdef MPI_PARALLEL
   int ierr,mAddress,mIndex,mCount;
 #endif
-  int nvarion = 2;
 
   /* if (pM->nstep < 1) {fprintf(stderr, "In ionradrestrictcorrect \n");} */
 
@@ -743,72 +815,11 @@ void ionradRestrictCorrect(MeshS *pM)
       kpe = pPO->ijke[2];
 
 /*--- Step 3a. Restrict conserved variables  ---------------------------------*/
-/* 1D/2D/3D problem: Conservative average of conserved variables in x1. */
+/* Conservative average of conserved variables over the 2/4/8 child cells in
+ * each parent cell in 1D/2D/3D problems. */
 
-      pSnd = (double*)&(ion_send_bufRC[nd][start_addr]);
-      
-      for (k=kps; k<=kpe; k+=2) {
-      for (j=jps; j<=jpe; j+=2) {
-      for (i=ips; i<=ipe; i+=2) {
-
-#ifndef BAROTROPIC
-        *(pSnd++) = pG->U[k][j][i].E  + pG->U[k][j][i+1].E;
-#endif
-
-#if (NSCALARS > 0)
-        for (n=0; n<NSCALARS; n++) 
-          *(pSnd++) = pG->U[k][j][i].s[n] + pG->U[k][j][i+1].s[n];
-#endif
-      }}}
-      fact = 0.5;
-      nCons = (ipe-ips+1)*(nvarion)/2;
-
-/* 2D/3D problem: Add conservative average in x2 */
-
-      if (pG->Nx[1] > 1) {
-        pSnd = (double*)&(ion_send_bufRC[nd][start_addr]); /* restart pointer */
-        for (k=kps; k<=kpe; k+=2) {
-        for (j=jps; j<=jpe; j+=2) {
-        for (i=ips; i<=ipe; i+=2) {
-
-#ifndef BAROTROPIC
-          *(pSnd++) += pG->U[k][j+1][i].E  + pG->U[k][j+1][i+1].E;
-#endif
-
-#if (NSCALARS > 0)
-          for (n=0; n<NSCALARS; n++) 
-            *(pSnd++) += pG->U[k][j+1][i].s[n] + pG->U[k][j+1][i+1].s[n];
-#endif
-        }}}
-        fact = 0.25;
-        nCons = (jpe-jps+1)*(ipe-ips+1)*(nvarion)/4;
-      }
-
-/* 3D problem: Add conservative average in x3 */
-
-      if (pG->Nx[2] > 1) {
-        pSnd = (double*)&(ion_send_bufRC[nd][start_addr]);  /* restart pointer */
-        for (k=kps; k<=kpe; k+=2) {
-        for (j=jps; j<=jpe; j+=2) {
-        for (i=ips; i<=ipe; i+=2) {
-
-#ifndef BAROTROPIC
-          *(pSnd++) += pG->U[k+1][j  ][i].E  + pG->U[k+1][j  ][i+1].E +
-                       pG->U[k+1][j+1][i].E  + pG->U[k+1][j+1][i+1].E;
-#endif
-#if (NSCALARS > 0)
-          for (n=0; n<NSCALARS; n++) 
-            *(pSnd++) += pG->U[k+1][j  ][i].s[n] + pG->U[k+1][j  ][i+1].s[n] +
-                         pG->U[k+1][j+1][i].s[n] + pG->U[k+1][j+1][i+1].s[n];
-#endif
-        }}}
-        fact = 0.125;
-        nCons = (kpe-kps+1)*(jpe-jps+1)*(ipe-ips+1)*(nvarion)/8;
-      }
-
-/* reset pointer to beginning and normalize averages */
-      pSnd = (double*)&(ion_send_bufRC[nd][start_addr]);  
-      for (i=start_addr; i<(start_addr+nCons); i++) *(pSnd++) *= fact;
+      nCons = res_cons(pG, ips, ipe, jps, jpe, kps, kpe, ion_var, n_ion_var,
+                       &(ion_send_bufRC[nd][start_addr]));
       cnt = nCons;
 
 /* #ifdef MHD */
@@ -1205,9 +1216,60 @@ void ionradRestrictCorrect(MeshS *pM)
  */
 
 void RestrictCorrect(MeshS *pM)
+{
+  restrict_correct(pM, 0, (pM->NLevels)-1);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void RestrictCorrectLevel(MeshS *pM, const int nl)
+ *  \brief Restricts Grids at level nl onto their parents at level nl-1 only,
+ *   used between the substeps of the parent level with subcycling. */
+
+void RestrictCorrectLevel(MeshS *pM, const int nl)
+{
+  restrict_correct(pM, nl-1, nl);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void RestrictCorrectStep(MeshS *pM, const int nl)
+ *  \brief Performs the step of RestrictCorrect() for level nl only: receives
+ *   from the children of level nl, and restricts level nl onto its parents.
+ *   Calling this for nl=NLevels-1 down to 0, each as soon as level nl has been
+ *   integrated, is the same as calling RestrictCorrect() after all levels are
+ *   integrated, but the messages sent by level nl are in flight while the
+ *   coarser levels are integrated.  The sends are completed in the call for
+ *   level nl-1. */
+
+void RestrictCorrectStep(MeshS *pM, const int nl)
+{
+  restrict_level(pM, nl, 0, (pM->NLevels)-1);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void restrict_correct(MeshS *pM, const int nlmin,
+ *                                   const int nlmax)
+ *  \brief Restricts from level nlmax down to level nlmin.  Grids at nlmax do
+ *   not receive from their children, and Grids at nlmin do not send to their
+ *   parents. */
+
+static void restrict_correct(MeshS *pM, const int nlmin, const int nlmax)
+{
+  int nl;
+
+  for (nl=nlmax; nl>=nlmin; nl--) restrict_level(pM, nl, nlmin, nlmax);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void restrict_level(MeshS *pM, const int nl, const int nlmin,
+ *                                 const int nlmax)
+ *  \brief Step nl of restrict_correct(): gets data from the children of level
+ *   nl (if nl<nlmax), and restricts level nl onto its parents (if nl>nlmin). */
+
+static void restrict_level(MeshS *pM, const int nl, const int nlmin,
+                           const int nlmax)
 {
   GridS *pG;
-  int nl,nd,ncg,dim,nDim,npg,rbufN,start_addr,cnt,nCons,nFlx;
+  int nd,ncg,dim,nDim,npg,rbufN,start_addr,cnt,nCons,nFlx,ndp,ndc;
   int i,ii,ics,ice,ips,ipe;
   int j,jj,jcs,jce,jps,jpe;
   int k,kk,kcs,kce,kps,kpe;
@@ -1228,16 +1290,17 @@ void RestrictCorrect(MeshS *pM)
   nDim=1;
   for (i=1; i<3; i++) if (pM->Nx[i]>1) nDim++;
 
-/* Loop over all Domains, starting at maxlevel */
-
-  for (nl=(pM->NLevels)-1; nl>=0; nl--){
+/* # of Domains at this level that get data from children (ndc) and that send
+ * data to parents (ndp) */
+  ndc = (nl < nlmax) ? pM->DomainsPerLevel[nl] : 0;
+  ndp = (nl > nlmin) ? pM->DomainsPerLevel[nl] : 0;
 
 #ifdef MPI_PARALLEL
 /* Post non-blocking receives at level nl-1 for data from child Grids at this
  * level (nl).  This data is sent in Step 3 below, and will be read in Step 1
  * at the next iteration of the loop. */ 
 
-  if (nl>0) {
+  if (nl>nlmin) {
     for (nd=0; nd<(pM->DomainsPerLevel[nl-1]); nd++){
       if (pM->Domain[nl-1][nd].Grid != NULL) {
         pG=pM->Domain[nl-1][nd].Grid;
@@ -1266,12 +1329,15 @@ void RestrictCorrect(MeshS *pM)
 /* Loop over Domains and child Grids.  Maxlevel domains skip this step because
  * they have NCGrids=0 */
 
-  for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+  for (nd=0; nd<ndc; nd++){
 
   if (pM->Domain[nl][nd].Grid != NULL) { /* there is a Grid on this processor */
     pG=pM->Domain[nl][nd].Grid;
     rbufN = (nl % 2);
 
+/* Zones under child Grids change, so new_dt() must sweep this Grid again */
+    if (pG->NCGrid > 0) pG->cfl_valid = 0;
+
     for (ncg=0; ncg<(pG->NCGrid); ncg++){
 
 /*--- Step 1a. Get restricted solution and fluxes. ---------------------------*/
@@ -1842,13 +1908,36 @@ void RestrictCorrect(MeshS *pM)
     }  /* end loop over child grids */
   }} /* end loop over Domains */
 
+#ifdef MPI_PARALLEL
+/*--- Check non-blocking sends at level nl+1 completed. ----------------------*/
+/* For MPI jobs, wait for all non-blocking sends made in Step 3e by the Grids at
+ * level nl+1 to complete before send_bufRC and send_rq are reused below.  These
+ * are left in flight until now so that they overlap with whatever is done
+ * between the steps for levels nl+1 and nl (see RestrictCorrectStep()).  Waiting
+ * on all sends of a Grid at once is more efficient if there are multiple
+ * messages per Grid. */
+
+  if (nl < nlmax) {
+    for (nd=0; nd<(pM->DomainsPerLevel[nl+1]); nd++){
+      if (pM->Domain[nl+1][nd].Grid != NULL) {
+        pG=pM->Domain[nl+1][nd].Grid;
+
+        if (pG->NPGrid > pG->NmyPGrid) {
+          mCount = pG->NPGrid - pG->NmyPGrid;
+          ierr = MPI_Waitall(mCount, send_rq[nd], MPI_STATUS_IGNORE);
+        }
+      }
+    }
+  }
+#endif /* MPI_PARALLEL */
+
 /*=== Step 3. Restrict child solution and fluxes and send ====================*/
 /* Loop over all Domains and parent Grids.  Maxlevel grids skip straight to this
  * step to start the chain of communication.  Root (level=0) skips this step
  * since it has NPGrid=0.  If there is a parent Grid on this processor, it will
  * be first in the PGrid array, so it will be at start of send_bufRC */
 
-  for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+  for (nd=0; nd<ndp; nd++){
 
   if (pM->Domain[nl][nd].Grid != NULL) { /* there is a Grid on this processor */
     pG=pM->Domain[nl][nd].Grid;          /* set pointer to this Grid */
@@ -1868,100 +1957,11 @@ void RestrictCorrect(MeshS *pM)
       kpe = pPO->ijke[2];
 
 /*--- Step 3a. Restrict conserved variables  ---------------------------------*/
-/* 1D/2D/3D problem: Conservative average of conserved variables in x1. */
-
-      pSnd = (double*)&(send_bufRC[nd][start_addr]);
-      for (k=kps; k<=kpe; k+=2) {
-      for (j=jps; j<=jpe; j+=2) {
-      for (i=ips; i<=ipe; i+=2) {
-        *(pSnd++) = pG->U[k][j][i].d  + pG->U[k][j][i+1].d;
-        *(pSnd++) = pG->U[k][j][i].M1 + pG->U[k][j][i+1].M1;
-        *(pSnd++) = pG->U[k][j][i].M2 + pG->U[k][j][i+1].M2;
-        *(pSnd++) = pG->U[k][j][i].M3 + pG->U[k][j][i+1].M3;
-#ifndef BAROTROPIC
-        *(pSnd++) = pG->U[k][j][i].E  + pG->U[k][j][i+1].E;
-#endif
-#ifdef MHD
-        *(pSnd++) = pG->U[k][j][i].B1c + pG->U[k][j][i+1].B1c;
-        *(pSnd++) = pG->U[k][j][i].B2c + pG->U[k][j][i+1].B2c;
-        *(pSnd++) = pG->U[k][j][i].B3c + pG->U[k][j][i+1].B3c;
-#endif
-#if (NSCALARS > 0)
-        for (n=0; n<NSCALARS; n++) 
-          *(pSnd++) = pG->U[k][j][i].s[n] + pG->U[k][j][i+1].s[n];
-#endif
-      }}}
-      fact = 0.5;
-      nCons = (ipe-ips+1)*(NVAR)/2;
+/* Conservative average of conserved variables over the 2/4/8 child cells in
+ * each parent cell in 1D/2D/3D problems. */
 
-/* 2D/3D problem: Add conservative average in x2 */
-
-      if (pG->Nx[1] > 1) {
-        pSnd = (double*)&(send_bufRC[nd][start_addr]); /* restart pointer */
-        for (k=kps; k<=kpe; k+=2) {
-        for (j=jps; j<=jpe; j+=2) {
-        for (i=ips; i<=ipe; i+=2) {
-          *(pSnd++) += pG->U[k][j+1][i].d  + pG->U[k][j+1][i+1].d;
-          *(pSnd++) += pG->U[k][j+1][i].M1 + pG->U[k][j+1][i+1].M1;
-          *(pSnd++) += pG->U[k][j+1][i].M2 + pG->U[k][j+1][i+1].M2;
-          *(pSnd++) += pG->U[k][j+1][i].M3 + pG->U[k][j+1][i+1].M3;
-#ifndef BAROTROPIC
-          *(pSnd++) += pG->U[k][j+1][i].E  + pG->U[k][j+1][i+1].E;
-#endif
-#ifdef MHD
-          *(pSnd++) += pG->U[k][j+1][i].B1c + pG->U[k][j+1][i+1].B1c;
-          *(pSnd++) += pG->U[k][j+1][i].B2c + pG->U[k][j+1][i+1].B2c;
-          *(pSnd++) += pG->U[k][j+1][i].B3c + pG->U[k][j+1][i+1].B3c;
-#endif
-#if (NSCALARS > 0)
-          for (n=0; n<NSCALARS; n++) 
-            *(pSnd++) += pG->U[k][j+1][i].s[n] + pG->U[k][j+1][i+1].s[n];
-#endif
-        }}}
-        fact = 0.25;
-        nCons = (jpe-jps+1)*(ipe-ips+1)*(NVAR)/4;
-      }
-
-/* 3D problem: Add conservative average in x3 */
-
-      if (pG->Nx[2] > 1) {
-        pSnd = (double*)&(send_bufRC[nd][start_addr]);  /* restart pointer */
-        for (k=kps; k<=kpe; k+=2) {
-        for (j=jps; j<=jpe; j+=2) {
-        for (i=ips; i<=ipe; i+=2) {
-          *(pSnd++) += pG->U[k+1][j  ][i].d  + pG->U[k+1][j  ][i+1].d +
-                       pG->U[k+1][j+1][i].d  + pG->U[k+1][j+1][i+1].d;
-          *(pSnd++) += pG->U[k+1][j  ][i].M1 + pG->U[k+1][j  ][i+1].M1 +
-                       pG->U[k+1][j+1][i].M1 + pG->U[k+1][j+1][i+1].M1;
-          *(pSnd++) += pG->U[k+1][j  ][i].M2 + pG->U[k+1][j  ][i+1].M2 +
-                       pG->U[k+1][j+1][i].M2 + pG->U[k+1][j+1][i+1].M2;
-          *(pSnd++) += pG->U[k+1][j  ][i].M3 + pG->U[k+1][j  ][i+1].M3 +
-                       pG->U[k+1][j+1][i].M3 + pG->U[k+1][j+1][i+1].M3;
-#ifndef BAROTROPIC
-          *(pSnd++) += pG->U[k+1][j  ][i].E  + pG->U[k+1][j  ][i+1].E +
-                       pG->U[k+1][j+1][i].E  + pG->U[k+1][j+1][i+1].E;
-#endif
-#ifdef MHD
-          *(pSnd++) += pG->U[k+1][j  ][i].B1c + pG->U[k+1][j  ][i+1].B1c +
-                       pG->U[k+1][j+1][i].B1c + pG->U[k+1][j+1][i+1].B1c;
-          *(pSnd++) += pG->U[k+1][j  ][i].B2c + pG->U[k+1][j  ][i+1].B2c +
-                       pG->U[k+1][j+1][i].B2c + pG->U[k+1][j+1][i+1].B2c;
-          *(pSnd++) += pG->U[k+1][j  ][i].B3c + pG->U[k+1][j  ][i+1].B3c +
-                       pG->U[k+1][j+1][i].B3c + pG->U[k+1][j+1][i+1].B3c;
-#endif
-#if (NSCALARS > 0)
-          for (n=0; n<NSCALARS; n++) 
-            *(pSnd++) += pG->U[k+1][j  ][i].s[n] + pG->U[k+1][j  ][i+1].s[n] +
-                         pG->U[k+1][j+1][i].s[n] + pG->U[k+1][j+1][i+1].s[n];
-#endif
-        }}}
-        fact = 0.125;
-        nCons = (kpe-kps+1)*(jpe-jps+1)*(ipe-ips+1)*(NVAR)/8;
-      }
-
-/* reset pointer to beginning and normalize averages */
-      pSnd = (double*)&(send_bufRC[nd][start_addr]);  
-      for (i=start_addr; i<(start_addr+nCons); i++) *(pSnd++) *= fact;
+      nCons = res_cons(pG, ips, ipe, jps, jpe, kps, kpe, rc_var, NVAR,
+                       &(send_bufRC[nd][start_addr]));
       cnt = nCons;
 
 #ifdef MHD
@@ -2331,46 +2331,161 @@ void RestrictCorrect(MeshS *pM)
     }  /* end loop over parent grids */
   }} /* end loop over Domains per level */
 
-#ifdef MPI_PARALLEL
-/*--- Step 4. Check non-blocking sends completed. ----------------------------*/
-/* For MPI jobs, wait for all non-blocking sends in Step 3e to complete.  This
- * is more efficient if there are multiple messages per Grid. */
+}
+
+/*============================================================================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn void Prolongate(MeshS *pM)
+ *  \brief Sets BC on fine Grid by prolongation (interpolation) of
+ *     coarse Grid solution into fine grid ghost zones */
+void Prolongate(MeshS *pM)
+{
+  prolongate(pM, 0, (pM->NLevels)-1, 1.0);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void ProlongateLevel(MeshS *pM, const int nl, const Real w)
+ *  \brief Sets ghost zones of Grids at level nl only, from the parent solution
+ *   interpolated in time: w*(current) + (1-w)*(saved by ProlongateSave()). */
+
+void ProlongateLevel(MeshS *pM, const int nl, const Real w)
+{
+  prolongate(pM, nl-1, nl, w);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void ProlongateStep(MeshS *pM, const int nl)
+ *  \brief Performs the step of Prolongate() for level nl only: sets the ghost
+ *   zones of level nl from its parents, and sends to the children of level nl.
+ *   Calling this for nl=0 up to NLevels-1, each as soon as the boundary values
+ *   of level nl are set, is the same as calling Prolongate() after the
+ *   boundary values of all levels are set, but the messages sent by level nl
+ *   are in flight while the boundary values of level nl+1 are finished.  The
+ *   sends are completed in the call for level nl+1. */
+
+void ProlongateStep(MeshS *pM, const int nl)
+{
+  prolongate_level(pM, nl, 0, (pM->NLevels)-1, 1.0);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void ProlongateSave(MeshS *pM, const int nl)
+ *  \brief Saves the zones of Grids at level nl that are sent to child ghost
+ *   zones, for use by ProlongateLevel() later in the step of level nl. */
+
+void ProlongateSave(MeshS *pM, const int nl)
+{
+  GridS *pG;
+  int nd,ncg,dim,nDim,addr;
+
+  nDim=1;
+  for (dim=1; dim<3; dim++) if (pM->Nx[dim]>1) nDim++;
 
   for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
     if (pM->Domain[nl][nd].Grid != NULL) {
       pG=pM->Domain[nl][nd].Grid;
+      addr = 0;
+      for (ncg=0; ncg<(pG->NCGrid); ncg++){
+        load_gz(pG, &(pG->CGrid[ncg]), nDim, &(old_bufP[nl][nd][addr]));
+        addr += pG->CGrid[ncg].nWordsP;
+      }
+    }
+  }
+}
 
-      if (pG->NPGrid > pG->NmyPGrid) {
-        mCount = pG->NPGrid - pG->NmyPGrid;
-        ierr = MPI_Waitall(mCount, send_rq[nd], MPI_STATUS_IGNORE);
+/*----------------------------------------------------------------------------*/
+/*! \fn void SubcycleFluxes(MeshS *pM, const int nl, const int substep)
+ *  \brief Called after each substep of Grids at level nl.  After the first
+ *   the fluxes at the fine/coarse boundaries are saved, after the second they
+ *   are replaced by the average over both, so RestrictCorrect() uses the time
+ *   averaged fine flux. */
+
+void SubcycleFluxes(MeshS *pM, const int nl, const int substep)
+{
+  GridS *pG;
+  GridOvrlpS *pPO;
+  int nd,npg,dim,n1,n2,m,n;
+#if (NSCALARS > 0)
+  int ns;
+#endif
+
+  for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+    if (pM->Domain[nl][nd].Grid == NULL) continue;
+    pG=pM->Domain[nl][nd].Grid;
+
+    for (npg=0; npg<(pG->NPGrid); npg++){
+      pPO=(GridOvrlpS*)&(pG->PGrid[npg]);
+      for (dim=0; dim<6; dim++){
+        if (pPO->myFlx[dim] == NULL) continue;
+
+/* myFlx is indexed [k][j] at x1-faces, [k][i] at x2-faces, [j][i] at x3 */
+        n2 = (dim < 4) ? pPO->ijke[2] - pPO->ijks[2] + 1 :
+                         pPO->ijke[1] - pPO->ijks[1] + 1;
+        n1 = (dim < 2) ? pPO->ijke[1] - pPO->ijks[1] + 1 :
+                         pPO->ijke[0] - pPO->ijks[0] + 1;
+
+        for (n=0; n<n2; n++){
+        for (m=0; m<n1; m++){
+          if (substep == 0) {
+            pPO->subFlx[dim][n][m] = pPO->myFlx[dim][n][m];
+          } else {
+            pPO->myFlx[dim][n][m].d =
+              0.5*(pPO->myFlx[dim][n][m].d  + pPO->subFlx[dim][n][m].d );
+            pPO->myFlx[dim][n][m].M1 =
+              0.5*(pPO->myFlx[dim][n][m].M1 + pPO->subFlx[dim][n][m].M1);
+            pPO->myFlx[dim][n][m].M2 =
+              0.5*(pPO->myFlx[dim][n][m].M2 + pPO->subFlx[dim][n][m].M2);
+            pPO->myFlx[dim][n][m].M3 =
+              0.5*(pPO->myFlx[dim][n][m].M3 + pPO->subFlx[dim][n][m].M3);
+#ifndef BAROTROPIC
+            pPO->myFlx[dim][n][m].E =
+              0.5*(pPO->myFlx[dim][n][m].E  + pPO->subFlx[dim][n][m].E );
+#endif
+#if (NSCALARS > 0)
+            for (ns=0; ns<NSCALARS; ns++) pPO->myFlx[dim][n][m].s[ns] =
+              0.5*(pPO->myFlx[dim][n][m].s[ns] + pPO->subFlx[dim][n][m].s[ns]);
+#endif
+          }
+        }}
       }
     }
   }
-#endif /* MPI_PARALLEL */
+}
 
-  } /* end loop over levels */
+/*----------------------------------------------------------------------------*/
+/*! \fn static void prolongate(MeshS *pM, const int nlmin, const int nlmax,
+ *                             const Real w)
+ *  \brief Prolongates from level nlmin up to level nlmax.  If w<1, the data
+ *   sent by each parent is interpolated with that saved by ProlongateSave(). */
+
+static void prolongate(MeshS *pM, const int nlmin, const int nlmax,
+                       const Real w)
+{
+  int nl;
+
+  for (nl=nlmin; nl<=nlmax; nl++) prolongate_level(pM, nl, nlmin, nlmax, w);
 }
 
-/*============================================================================*/
 /*----------------------------------------------------------------------------*/
-/*! \fn void Prolongate(MeshS *pM)
- *  \brief Sets BC on fine Grid by prolongation (interpolation) of
- *     coarse Grid solution into fine grid ghost zones */
-void Prolongate(MeshS *pM)
+/*! \fn static void prolongate_level(MeshS *pM, const int nl, const int nlmin,
+ *                                   const int nlmax, const Real w)
+ *  \brief Step nl of prolongate(): sends to the children of level nl (if
+ *   nl<nlmax), and sets the ghost zones of level nl from its parents (if
+ *   nl>nlmin). */
+
+static void prolongate_level(MeshS *pM, const int nl, const int nlmin,
+                             const int nlmax, const Real w)
 {
   GridS *pG;
-  int nDim,nl,nd,ncg,dim,npg,rbufN,id,l,m,n,mend,nend;
-  int i,ii,ics,ice,ips,ipe,igzs,igze;
-  int j,jj,jcs,jce,jps,jpe,jgzs,jgze;
-  int k,kk,kcs,kce,kps,kpe,kgzs,kgze;
+  int nDim,nd,ncg,dim,npg,rbufN,id,n,ndp,ndc,addr;
+  int i,ips,ipe,igzs,igze;
+  int j,jps,jpe,jgzs,jgze;
+  int k,kps,kpe,kgzs,kgze;
   int ngz1,ngz2,ngz3;
-  double *pRcv,*pSnd;
+  double *pRcv,*pSnd,*pOld;
   GridOvrlpS *pCO, *pPO;
-  ConsS ProlongedC[2][2][2];
-#if (NSCALARS > 0)
-  int ns;
-#endif
 #ifdef MHD
+  int ii,jj,kk,l,m,mend,nend;
   Real3Vect BGZ[3][3][3], ProlongedF[3][3][3];
 #endif
 #ifdef MPI_PARALLEL
@@ -2381,16 +2496,17 @@ void Prolongate(MeshS *pM)
   nDim=1;
   for (dim=1; dim<3; dim++) if (pM->Nx[dim]>1) nDim++;
 
-/* Loop over all levels, starting at root level */
-
-  for (nl=0; nl<(pM->NLevels); nl++){
+/* # of Domains at this level that send data to children (ndc) and that get
+ * data from parents (ndp) */
+  ndc = (nl < nlmax) ? pM->DomainsPerLevel[nl] : 0;
+  ndp = (nl > nlmin) ? pM->DomainsPerLevel[nl] : 0;
 
 #ifdef MPI_PARALLEL
 /* Post non-blocking receives at level nl+1 for data from parent Grids at this
  * level (nl). This data is sent in Step 1 below,
  * and will be read in Step 2 during the next iteration of nl */
 
-  if (nl<(pM->NLevels)-1) {
+  if (nl<nlmax) {
     for (nd=0; nd<(pM->DomainsPerLevel[nl+1]); nd++){
       if (pM->Domain[nl+1][nd].Grid != NULL) {
         pG=pM->Domain[nl+1][nd].Grid;
@@ -2418,14 +2534,36 @@ void Prolongate(MeshS *pM)
   }
 #endif /* MPI_PARALLEL */
 
+#ifdef MPI_PARALLEL
+/*--- Check non-blocking sends at level nl-1 completed. ----------------------*/
+/* For MPI jobs, wait for all non-blocking sends made in Step 1 by the Grids at
+ * level nl-1 to complete before send_bufP and send_rq are reused below.  These
+ * are left in flight until now so that they overlap with whatever is done
+ * between the steps for levels nl-1 and nl (see ProlongateStep()). */
+
+  if (nl > nlmin) {
+    for (nd=0; nd<(pM->DomainsPerLevel[nl-1]); nd++){
+      if (pM->Domain[nl-1][nd].Grid != NULL) {
+        pG=pM->Domain[nl-1][nd].Grid;
+
+        if (pG->NCGrid > pG->NmyCGrid) {
+          mCount = pG->NCGrid - pG->NmyCGrid;
+          ierr = MPI_Waitall(mCount, send_rq[nd], MPI_STATUS_IGNORE);
+        }
+      }
+    }
+  }
+#endif /* MPI_PARALLEL */
+
 /*=== Step 1. Send step ======================================================*/
 /* Loop over all Domains, and send ghost zones to all child Grids. */
 
-  for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+  for (nd=0; nd<ndc; nd++){
 
   if (pM->Domain[nl][nd].Grid != NULL) { /* there is a Grid on this processor */
     pG=pM->Domain[nl][nd].Grid;
     for(i=0; i<maxND; i++) start_addrP[i] = 0;
+    addr = 0;
 
     for (ncg=0; ncg<(pG->NCGrid); ncg++){
       pCO=(GridOvrlpS*)&(pG->CGrid[ncg]);    /* ptr to child Grid overlap */
@@ -2434,63 +2572,19 @@ void Prolongate(MeshS *pM)
  * same processor.  Start address must be different for each DomN */
       pSnd = (double*)&(send_bufP[pCO->DomN][start_addrP[pCO->DomN]]); 
 
-      for (dim=0; dim<(2*nDim); dim++){
-        if (pCO->myFlx[dim] != NULL) {
-
-/* Get coordinates ON THIS GRID of zones that overlap child Grid ghost zones */
-
-          ics = pCO->ijks[0] - (nghost/2) - 1;
-          ice = pCO->ijke[0] + (nghost/2) + 1;
-          if (pG->Nx[1] > 1) {
-            jcs = pCO->ijks[1] - (nghost/2) - 1;
-            jce = pCO->ijke[1] + (nghost/2) + 1;
-          } else {
-            jcs = pCO->ijks[1];
-            jce = pCO->ijke[1];
-          }
-          if (pG->Nx[2] > 1) {
-            kcs = pCO->ijks[2] - (nghost/2) - 1;
-            kce = pCO->ijke[2] + (nghost/2) + 1;
-          } else {
-            kcs = pCO->ijks[2];
-            kce = pCO->ijke[2];
-          }
-          if (dim == 0) ice = pCO->ijks[0];
-          if (dim == 1) ics = pCO->ijke[0];
-          if (dim == 2) jce = pCO->ijks[1];
-          if (dim == 3) jcs = pCO->ijke[1];
-          if (dim == 4) kce = pCO->ijks[2];
-          if (dim == 5) kcs = pCO->ijke[2];
-
 /*--- Step 1a. ---------------------------------------------------------------*/
 /* Load send buffer with values in zones that overlap child ghost zones */
 
-          for (k=kcs; k<=kce; k++) {
-          for (j=jcs; j<=jce; j++) {
-          for (i=ics; i<=ice; i++) {
-            *(pSnd++) = pG->U[k][j][i].d;
-            *(pSnd++) = pG->U[k][j][i].M1;
-            *(pSnd++) = pG->U[k][j][i].M2;
-            *(pSnd++) = pG->U[k][j][i].M3;
-#ifndef BAROTROPIC
-            *(pSnd++) = pG->U[k][j][i].E;
-#endif
-#ifdef MHD
-            *(pSnd++) = pG->U[k][j][i].B1c;
-            *(pSnd++) = pG->U[k][j][i].B2c;
-            *(pSnd++) = pG->U[k][j][i].B3c;
-            *(pSnd++) = pG->B1i[k][j][i];
-            *(pSnd++) = pG->B2i[k][j][i];
-            *(pSnd++) = pG->B3i[k][j][i];
-#endif
-#if (NSCALARS > 0)
-            for (ns=0; ns<NSCALARS; ns++) {
-               *(pSnd++) = pG->U[k][j][i].s[ns];
-            }
-#endif
-          }}}
-        }
+      load_gz(pG, pCO, nDim, pSnd);
+
+/* With subcycling, interpolate in time between the parent solution saved at
+ * the start of its step and the current one */
+
+      if (w < 1.0) {
+        pOld = (double*)&(old_bufP[nl][nd][addr]);
+        for (i=0; i<pCO->nWordsP; i++) pSnd[i] = w*pSnd[i] + (1.0-w)*pOld[i];
       }
+      addr += pCO->nWordsP;
 
 /*--- Step 1b. ---------------------------------------------------------------*/
 /* non-blocking send of data to child, using Domain number as tag. */
@@ -2513,7 +2607,7 @@ void Prolongate(MeshS *pM)
  * into ghost zones. */
 
 
-  for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+  for (nd=0; nd<ndp; nd++){
 
   if (pM->Domain[nl][nd].Grid != NULL) { /* there is a Grid on this processor */
     pG=pM->Domain[nl][nd].Grid;          /* set pointer to Grid */
@@ -2590,68 +2684,54 @@ void Prolongate(MeshS *pM)
           if (pG->Nx[1] > 1) {
             jgzs = 0;
             jgze = ngz2-1;
-            mend = 1;
           } else {
             ngz2 = 1;
             jgzs = 1;
             jgze = 1;
-            mend = 0;
           }
           if (pG->Nx[2] > 1) {
             kgzs = 0;
             kgze = ngz3-1;
-            nend = 1;
           } else {
             ngz3 = 1;
             kgzs = 1;
             kgze = 1;
-            nend = 0;
           }
 
-/* Load GZ array with values in receive buffer */
+/* Load GZ arrays with values in receive buffer.  The cell-centered variables
+ * come in the order of ConsS, with face-centered fields before the scalars */
 
           for (k=kgzs; k<=kgze; k++) {
           for (j=jgzs; j<=jgze; j++) {
           for (i=igzs; i<=igze; i++) {
-            GZ[id][k][j][i].d  = *(pRcv++);
-            GZ[id][k][j][i].M1 = *(pRcv++);
-            GZ[id][k][j][i].M2 = *(pRcv++);
-            GZ[id][k][j][i].M3 = *(pRcv++);
-#ifndef BAROTROPIC
-            GZ[id][k][j][i].E = *(pRcv++);
-#endif
+            for (n=0; n<(NVAR-NSCALARS); n++) GZ[id][n][k][j][i] = *(pRcv++);
 #ifdef MHD
-            GZ[id][k][j][i].B1c = *(pRcv++);
-            GZ[id][k][j][i].B2c = *(pRcv++);
-            GZ[id][k][j][i].B3c = *(pRcv++);
             BFld[id][k][j][i].x = *(pRcv++);
             BFld[id][k][j][i].y = *(pRcv++);
             BFld[id][k][j][i].z = *(pRcv++);
 #endif
-#if (NSCALARS > 0)
-            for (ns=0; ns<NSCALARS; ns++) {
-              GZ[id][k][j][i].s[ns] = *(pRcv++);
-            }
-#endif
+            for (n=(NVAR-NSCALARS); n<NVAR; n++) GZ[id][n][k][j][i] = *(pRcv++);
           }}}
 
-/* Set BC on GZ array in 1D; and on GZ and BFld arrays in 2D */
+/* Set BC on GZ arrays in 1D; and on GZ and BFld arrays in 2D */
 
           if (nDim == 1) {
+            for (n=0; n<NVAR; n++) {
             for (i=igzs; i<=igze; i++) {
-              GZ[id][1][0][i] = GZ[id][1][1][i];
-              GZ[id][1][2][i] = GZ[id][1][1][i];
-              GZ[id][0][1][i] = GZ[id][1][1][i];
-              GZ[id][2][1][i] = GZ[id][1][1][i];
-            }
+              GZ[id][n][1][0][i] = GZ[id][n][1][1][i];
+              GZ[id][n][1][2][i] = GZ[id][n][1][1][i];
+              GZ[id][n][0][1][i] = GZ[id][n][1][1][i];
+              GZ[id][n][2][1][i] = GZ[id][n][1][1][i];
+            }}
           }
 
           if (nDim == 2) {
+            for (n=0; n<NVAR; n++) {
             for (j=jgzs; j<=jgze; j++) {
             for (i=igzs; i<=igze; i++) {
-              GZ[id][0][j][i] = GZ[id][1][j][i];
-              GZ[id][2][j][i] = GZ[id][1][j][i];
-            }}
+              GZ[id][n][0][j][i] = GZ[id][n][1][j][i];
+              GZ[id][n][2][j][i] = GZ[id][n][1][j][i];
+            }}}
 #ifdef MHD
             for (j=jgzs; j<=jgze; j++) {
             for (i=igzs; i<=igze; i++) {
@@ -2661,6 +2741,23 @@ void Prolongate(MeshS *pM)
 #endif /* MHD */
           }
 
+#if !defined(BAROTROPIC) && !defined(SPECIAL_RELATIVITY) && !defined(FIRST_ORDER)
+/* Prolongate P not E.   This is intentionally non-conservative.  pro_cons()
+ * adds the kinetic and magnetic energy of the prolongated cells back. */
+
+          for (k=kgzs; k<=kgze; k++) {
+          for (j=jgzs; j<=jgze; j++) {
+          for (i=igzs; i<=igze; i++) {
+            GZ[id][IEN][k][j][i] -= 0.5*(SQR(GZ[id][IM1][k][j][i]) +
+              SQR(GZ[id][IM2][k][j][i]) + SQR(GZ[id][IM3][k][j][i]))/
+              GZ[id][IDN][k][j][i];
+#ifdef MHD
+            GZ[id][IEN][k][j][i] -= 0.5*(SQR(GZ[id][IB1][k][j][i]) +
+              SQR(GZ[id][IB2][k][j][i]) + SQR(GZ[id][IB3][k][j][i]));
+#endif /* MHD */
+          }}}
+#endif
+
 /*--- Steps 3b.  Prolongate cell-centered values -----------------------------*/
 /* Get coordinates ON THIS GRID of ghost zones that overlap parent Grid */
 
@@ -2689,40 +2786,18 @@ void Prolongate(MeshS *pM)
 
 /* Prolongate these values in ghost zones */
 
-          for (k=kps, kk=1; k<=kpe; k+=2, kk++) {
-          for (j=jps, jj=1; j<=jpe; j+=2, jj++) {
-          for (i=ips, ii=1; i<=ipe; i+=2, ii++) {
+          pro_cons(pG, GZ[id], ips, ipe, jps, jpe, kps, kpe);
 
-            ProCon(GZ[id][kk][jj][ii-1],GZ[id][kk][jj][ii],GZ[id][kk][jj][ii+1],
-                   GZ[id][kk][jj-1][ii],                   GZ[id][kk][jj+1][ii],
-                   GZ[id][kk-1][jj][ii],                   GZ[id][kk+1][jj][ii],
-                   ProlongedC);
+#ifdef MHD
+/*--- Steps 3c.  Prolongate face-centered B ----------------------------------*/
 
-/* 1D/2D/3D problem, set solution prolongated in x1 */
+          mend = (pG->Nx[1] > 1) ? 1 : 0;
+          nend = (pG->Nx[2] > 1) ? 1 : 0;
 
-            for (n=0; n<=nend; n++) {
-            for (m=0; m<=mend; m++) {
-            for (l=0; l<=1; l++) {
-              pG->U[k+n][j+m][i+l].d  = ProlongedC[n][m][l].d;
-              pG->U[k+n][j+m][i+l].M1 = ProlongedC[n][m][l].M1;
-              pG->U[k+n][j+m][i+l].M2 = ProlongedC[n][m][l].M2;
-              pG->U[k+n][j+m][i+l].M3 = ProlongedC[n][m][l].M3;
-#ifndef BAROTROPIC
-              pG->U[k+n][j+m][i+l].E  = ProlongedC[n][m][l].E;
-#endif
-#ifdef MHD
-              pG->U[k+n][j+m][i+l].B1c = ProlongedC[n][m][l].B1c;
-              pG->U[k+n][j+m][i+l].B2c = ProlongedC[n][m][l].B2c;
-              pG->U[k+n][j+m][i+l].B3c = ProlongedC[n][m][l].B3c;
-#endif
-#if (NSCALARS > 0)
-              for (ns=0; ns<NSCALARS; ns++) 
-                pG->U[k+n][j+m][i+l].s[ns] = ProlongedC[n][m][l].s[ns];
-#endif
-            }}}
+          for (k=kps, kk=1; k<=kpe; k+=2, kk++) {
+          for (j=jps, jj=1; j<=jpe; j+=2, jj++) {
+          for (i=ips, ii=1; i<=ipe; i+=2, ii++) {
 
-#ifdef MHD
-/*--- Steps 3c.  Prolongate face-centered B ----------------------------------*/
 /* Set prolonged face-centered B fields for 1D (trivial case)  */
 
             if (nDim == 1) {
@@ -2871,9 +2946,8 @@ void Prolongate(MeshS *pM)
                   0.5*(ProlongedF[n][m][l].z + ProlongedF[n+1][m][l].z);
               }}}
             }
-
-#endif /* MHD */
           }}}
+#endif /* MHD */
 
         }
       } /* end loop over dims */
@@ -2886,7 +2960,7 @@ void Prolongate(MeshS *pM)
  * prevent "send" in Step 1 above from over-writing data in buffer on the next
  * iteration of the loop over levels (for nl=nl+1). */
 
-  for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+  for (nd=0; nd<ndc; nd++){
     if (pM->Domain[nl][nd].Grid != NULL) { 
       pG=pM->Domain[nl][nd].Grid; 
       rbufN = ((nl+1) % 2);
@@ -2904,22 +2978,6 @@ void Prolongate(MeshS *pM)
     }
   }
 
-#ifdef MPI_PARALLEL
-/* For MPI jobs, wait for all non-blocking sends in Step 1 to complete */
-
-  for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
-    if (pM->Domain[nl][nd].Grid != NULL) {
-      pG=pM->Domain[nl][nd].Grid;
-
-      if (pG->NCGrid > pG->NmyCGrid) {
-        mCount = pG->NCGrid - pG->NmyCGrid;
-        ierr = MPI_Waitall(mCount, send_rq[nd], MPI_STATUS_IGNORE);
-      }
-    }
-  }
-#endif /* MPI_PARALLEL */
-
-  } /* end loop over levels */
 }
 
 /*============================================================================*/
@@ -2930,7 +2988,7 @@ void Prolongate(MeshS *pM)
 
 void SMR_init(MeshS *pM)
 {
-  int nl,nd,sendRC,recvRC,sendP,recvP,npg,ncg;
+  int n,nl,nd,sendRC,recvRC,sendP,recvP,npg,ncg;
   int max_sendRC=1,max_recvRC=1,max_sendP=1,max_recvP=1;
   int max1=0,max2=0,max3=0,maxCG=1;
 #ifdef MHD
@@ -3031,6 +3089,12 @@ void SMR_init(MeshS *pM)
     (double**)calloc_2d_array(maxND,max_sendP,sizeof(double))) == NULL)
     ath_error("[SMR_init]:Failed to allocate send_bufP\n");
 
+  if (pM->subcycle) {
+    if((old_bufP = (double***)calloc_3d_array(pM->NLevels,maxND,max_sendP,
+      sizeof(double))) == NULL)
+      ath_error("[SMR_init]:Failed to allocate old_bufP\n");
+  }
+
   if((recv_bufP =
     (double***)calloc_3d_array(2,maxND,max_recvP,sizeof(double))) == NULL)
     ath_error("[SMR_init]: Failed to allocate recv_bufP\n");
@@ -3039,12 +3103,26 @@ void SMR_init(MeshS *pM)
   max2 += 2*nghost;
   max3 += 2*nghost;
 
-  if((GZ[0]=(ConsS***)calloc_3d_array(max3,max2,nghost,sizeof(ConsS)))
-    ==NULL) ath_error("[SMR_init]:Failed to allocate GZ[0]C\n");
-  if((GZ[1]=(ConsS***)calloc_3d_array(max3,nghost,max1,sizeof(ConsS)))
-    ==NULL) ath_error("[SMR_init]:Failed to allocate GZ[1]C\n");
-  if((GZ[2]=(ConsS***)calloc_3d_array(nghost,max2,max1,sizeof(ConsS)))
-    ==NULL) ath_error("[SMR_init]:Failed to allocate GZ[2]C\n");
+  for (n=0; n<NVAR; n++) {
+    if((GZ[0][n]=(Real***)calloc_3d_array(max3,max2,nghost,sizeof(Real)))
+      ==NULL) ath_error("[SMR_init]:Failed to allocate GZ[0]C\n");
+    if((GZ[1][n]=(Real***)calloc_3d_array(max3,nghost,max1,sizeof(Real)))
+      ==NULL) ath_error("[SMR_init]:Failed to allocate GZ[1]C\n");
+    if((GZ[2][n]=(Real***)calloc_3d_array(nghost,max2,max1,sizeof(Real)))
+      ==NULL) ath_error("[SMR_init]:Failed to allocate GZ[2]C\n");
+  }
+  if((GZslope=(Real**)calloc_2d_array(3,MAX(max1,nghost),sizeof(Real)))
+    ==NULL) ath_error("[SMR_init]:Failed to allocate GZslope\n");
+
+/* Variables restricted by RestrictCorrect() (all), and by
+ * ionradRestrictCorrect() (energy and scalars) */
+
+  for (n=0; n<NVAR; n++) rc_var[n] = n;
+  n_ion_var = 0;
+#ifndef BAROTROPIC
+  ion_var[n_ion_var++] = IEN;
+#endif
+  for (n=(NVAR-NSCALARS); n<NVAR; n++) ion_var[n_ion_var++] = n;
 #ifdef MHD
   ngh1 = nghost + 1;
   if((BFld[0]=(Real3Vect***)calloc_3d_array(max3,max2,ngh1,sizeof(Real3Vect)))
@@ -3057,271 +3135,362 @@ void SMR_init(MeshS *pM)
 
   return;
 }
-/*=========================== PRIVATE FUNCTIONS ==============================*/
+
 /*----------------------------------------------------------------------------*/
-/*! \fn void ProCon(const ConsS Uim1,const ConsS Ui,  const ConsS Uip1,
- *            const ConsS Ujm1,const ConsS Ujp1,
- *            const ConsS Ukm1,const ConsS Ukp1, ConsS PCon[][2][2])
- *  \brief Prolongates conserved variables in a 2x2x2 cube.
- */
+/*! \fn void SMR_report(void)
+ *  \brief Prints the number of cells set by the prolongation and restriction
+ *   kernels on this processor, and their rate in cells per wall-second. */
 
-void ProCon(const ConsS Uim1,const ConsS Ui,  const ConsS Uip1,
-            const ConsS Ujm1,const ConsS Ujp1,
-            const ConsS Ukm1,const ConsS Ukp1, ConsS PCon[][2][2])
+void SMR_report(void)
 {
-  int i,j,k;
-  Real dq1,dq2,dq3,Pim1,Pi,Pip1,Pjm1,Pjp1,Pkm1,Pkp1;
-#ifdef SPECIAL_RELATIVITY
-  PrimS W;
-  Real Vsq;
-  int fail,dfail,Pfail,Vfail;
+  ath_pout(0,"\nSMR prolongation: %e child cells, %e cells/wall-second\n",
+    pro_cells, (pro_time > 0.0) ? pro_cells/pro_time : 0.0);
+  ath_pout(0,"SMR restriction: %e parent cells, %e cells/wall-second\n",
+    res_cells, (res_time > 0.0) ? res_cells/res_time : 0.0);
+
+  return;
+}
+/*----------------------------------------------------------------------------*/
+/*! \fn void SMR_destruct(void)
+ *  \brief Frees memory allocated by SMR_init(), so that it can be called again
+ *   for a new Mesh.  No message may be in flight. */
+
+void SMR_destruct(void)
+{
+  int n;
+
+  free_1d_array(start_addrP);
+  free_2d_array(send_bufRC);
+#ifdef ION_RADIATION
+  free_2d_array(ion_send_bufRC);
+  ion_send_bufRC = NULL;
 #endif
+#ifdef MPI_PARALLEL
+  free_3d_array(recv_bufRC);
+  free_3d_array(recv_rq);
+  free_2d_array(send_rq);
+  recv_bufRC = NULL;  recv_rq = NULL;  send_rq = NULL;
+#ifdef ION_RADIATION
+  free_3d_array(ion_recv_bufRC);
+  free_3d_array(ion_recv_rq);
+  free_2d_array(ion_send_rq);
+  ion_recv_bufRC = NULL;  ion_recv_rq = NULL;  ion_send_rq = NULL;
+#endif /* ION_RADIATION */
+#endif /* MPI_PARALLEL */
+#ifdef MHD
+  free_2d_array(SMRemf1);
+  free_2d_array(SMRemf2);
+  free_2d_array(SMRemf3);
+  for (n=0; n<3; n++) free_3d_array(BFld[n]);
+#endif /* MHD */
+  free_2d_array(send_bufP);
+  if (old_bufP != NULL) free_3d_array(old_bufP);
+  free_3d_array(recv_bufP);
+  start_addrP = NULL;  send_bufRC = NULL;
+  send_bufP = NULL;  old_bufP = NULL;  recv_bufP = NULL;
+
+  for (n=0; n<NVAR; n++) {
+    free_3d_array(GZ[0][n]);
+    free_3d_array(GZ[1][n]);
+    free_3d_array(GZ[2][n]);
+  }
+  free_2d_array(GZslope);
+  GZslope = NULL;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void ProCon(GridS *pG, Real ****pq, const int ips, const int ipe,
+ *                  const int jps, const int jpe, const int kps, const int kpe)
+ *  \brief Prolongates conserved variables from the parent zones in pq into
+ *   the cells ips:ipe, jps:jpe, kps:kpe of pG, see pro_cons().
+ *
+ *   pq[nv][kk][jj][ii] holds one variable of ConsS per nv (with P in place of
+ *   E, as in prolongate_level()) for the parent zones over the region plus one
+ *   zone on each side, so the first parent zone is at kk=jj=ii=1, and planes
+ *   0 to 2 must be set in collapsed dimensions.  ips, jps, kps must be the
+ *   first child cell of a parent zone.  Requires SMR_init(). */
+
+void ProCon(GridS *pG, Real ****pq, const int ips, const int ipe,
+            const int jps, const int jpe, const int kps, const int kpe)
+{
+  pro_cons(pG, pq, ips, ipe, jps, jpe, kps, kpe);
+  return;
+}
+
+/*=========================== PRIVATE FUNCTIONS ==============================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn static void load_gz(GridS *pG, GridOvrlpS *pCO, const int nDim,
+ *                          double *pSnd)
+ *  \brief Loads buffer with values in zones of parent Grid pG that overlap
+ *   ghost zones of the child Grid described by pCO. */
+
+static void load_gz(GridS *pG, GridOvrlpS *pCO, const int nDim, double *pSnd)
+{
+  int dim,i,ics,ice,j,jcs,jce,k,kcs,kce;
 #if (NSCALARS > 0)
-  int n;
+  int ns;
 #endif
 
-/* First order prolongation -- just copy values */
-#ifdef FIRST_ORDER
+  for (dim=0; dim<(2*nDim); dim++){
+    if (pCO->myFlx[dim] != NULL) {
+
+/* Get coordinates ON THIS GRID of zones that overlap child Grid ghost zones */
 
-  for (k=0; k<2; k++){
-  for (j=0; j<2; j++){
-  for (i=0; i<2; i++){
-    PCon[k][j][i].d  = Ui.d;
-    PCon[k][j][i].M1 = Ui.M1;
-    PCon[k][j][i].M2 = Ui.M2;
-    PCon[k][j][i].M3 = Ui.M3;
+      ics = pCO->ijks[0] - (nghost/2) - 1;
+      ice = pCO->ijke[0] + (nghost/2) + 1;
+      if (pG->Nx[1] > 1) {
+        jcs = pCO->ijks[1] - (nghost/2) - 1;
+        jce = pCO->ijke[1] + (nghost/2) + 1;
+      } else {
+        jcs = pCO->ijks[1];
+        jce = pCO->ijke[1];
+      }
+      if (pG->Nx[2] > 1) {
+        kcs = pCO->ijks[2] - (nghost/2) - 1;
+        kce = pCO->ijke[2] + (nghost/2) + 1;
+      } else {
+        kcs = pCO->ijks[2];
+        kce = pCO->ijke[2];
+      }
+      if (dim == 0) ice = pCO->ijks[0];
+      if (dim == 1) ics = pCO->ijke[0];
+      if (dim == 2) jce = pCO->ijks[1];
+      if (dim == 3) jcs = pCO->ijke[1];
+      if (dim == 4) kce = pCO->ijks[2];
+      if (dim == 5) kcs = pCO->ijke[2];
+
+      for (k=kcs; k<=kce; k++) {
+      for (j=jcs; j<=jce; j++) {
+      for (i=ics; i<=ice; i++) {
+        *(pSnd++) = pG->U[k][j][i].d;
+        *(pSnd++) = pG->U[k][j][i].M1;
+        *(pSnd++) = pG->U[k][j][i].M2;
+        *(pSnd++) = pG->U[k][j][i].M3;
 #ifndef BAROTROPIC
-    PCon[k][j][i].E  = Ui.E;
-#endif /* BAROTROPIC */
+        *(pSnd++) = pG->U[k][j][i].E;
+#endif
 #ifdef MHD
-    PCon[k][j][i].B1c = Ui.B1c;
-    PCon[k][j][i].B2c = Ui.B2c;
-    PCon[k][j][i].B3c = Ui.B3c;
-#endif /* MHD */
+        *(pSnd++) = pG->U[k][j][i].B1c;
+        *(pSnd++) = pG->U[k][j][i].B2c;
+        *(pSnd++) = pG->U[k][j][i].B3c;
+        *(pSnd++) = pG->B1i[k][j][i];
+        *(pSnd++) = pG->B2i[k][j][i];
+        *(pSnd++) = pG->B3i[k][j][i];
+#endif
 #if (NSCALARS > 0)
-    for (n=0; n<NSCALARS; n++) PCon[k][j][i].s[n] = Ui.s[n];
-#endif /* NSCALARS */
-  }}}
-
-/* second order prolongation -- apply limited slope reconstruction */
-#else /* SECOND_ORDER or THIRD_ORDER */
-
-/* density */
-  dq1 = mcd_slope(Uim1.d, Ui.d, Uip1.d);
-  dq2 = mcd_slope(Ujm1.d, Ui.d, Ujp1.d);
-  dq3 = mcd_slope(Ukm1.d, Ui.d, Ukp1.d);
-  for (k=0; k<2; k++){
-  for (j=0; j<2; j++){
-  for (i=0; i<2; i++){
-    PCon[k][j][i].d  = Ui.d 
-      + (0.5*i - 0.25)*dq1 + (0.5*j - 0.25)*dq2 + (0.5*k - 0.25)*dq3;;
-  }}}
-
-/* 1-momentum */
-  dq1 = mcd_slope(Uim1.M1, Ui.M1, Uip1.M1);
-  dq2 = mcd_slope(Ujm1.M1, Ui.M1, Ujp1.M1);
-  dq3 = mcd_slope(Ukm1.M1, Ui.M1, Ukp1.M1);
-  for (k=0; k<2; k++){
-  for (j=0; j<2; j++){
-  for (i=0; i<2; i++){
-    PCon[k][j][i].M1 = Ui.M1 
-      + (0.5*i - 0.25)*dq1 + (0.5*j - 0.25)*dq2 + (0.5*k - 0.25)*dq3;;
-  }}}
-
-/* 2-momentum */
-  dq1 = mcd_slope(Uim1.M2, Ui.M2, Uip1.M2);
-  dq2 = mcd_slope(Ujm1.M2, Ui.M2, Ujp1.M2);
-  dq3 = mcd_slope(Ukm1.M2, Ui.M2, Ukp1.M2);
-  for (k=0; k<2; k++){
-  for (j=0; j<2; j++){
-  for (i=0; i<2; i++){
-    PCon[k][j][i].M2 = Ui.M2 
-      + (0.5*i - 0.25)*dq1 + (0.5*j - 0.25)*dq2 + (0.5*k - 0.25)*dq3;;
-  }}}
-
-/* 3-momentum */
-  dq1 = mcd_slope(Uim1.M3, Ui.M3, Uip1.M3);
-  dq2 = mcd_slope(Ujm1.M3, Ui.M3, Ujp1.M3);
-  dq3 = mcd_slope(Ukm1.M3, Ui.M3, Ukp1.M3);
-  for (k=0; k<2; k++){
-  for (j=0; j<2; j++){
-  for (i=0; i<2; i++){
-    PCon[k][j][i].M3 = Ui.M3 
-      + (0.5*i - 0.25)*dq1 + (0.5*j - 0.25)*dq2 + (0.5*k - 0.25)*dq3;;
-  }}}
-
-#ifdef MHD
-/* 1-cell-centered magnetic field */
-  dq1 = mcd_slope(Uim1.B1c, Ui.B1c, Uip1.B1c);
-  dq2 = mcd_slope(Ujm1.B1c, Ui.B1c, Ujp1.B1c);
-  dq3 = mcd_slope(Ukm1.B1c, Ui.B1c, Ukp1.B1c);
-  for (k=0; k<2; k++){
-  for (j=0; j<2; j++){
-  for (i=0; i<2; i++){
-    PCon[k][j][i].B1c = Ui.B1c 
-      + (0.5*i - 0.25)*dq1 + (0.5*j - 0.25)*dq2 + (0.5*k - 0.25)*dq3;;
-  }}}
-
-/* 2-cell-centered magnetic field */
-  dq1 = mcd_slope(Uim1.B2c, Ui.B2c, Uip1.B2c);
-  dq2 = mcd_slope(Ujm1.B2c, Ui.B2c, Ujp1.B2c);
-  dq3 = mcd_slope(Ukm1.B2c, Ui.B2c, Ukp1.B2c);
-  for (k=0; k<2; k++){
-  for (j=0; j<2; j++){
-  for (i=0; i<2; i++){
-    PCon[k][j][i].B2c = Ui.B2c 
-      + (0.5*i - 0.25)*dq1 + (0.5*j - 0.25)*dq2 + (0.5*k - 0.25)*dq3;;
-  }}}
-
-/* 3-cell-centered magnetic field */
-  dq1 = mcd_slope(Uim1.B3c, Ui.B3c, Uip1.B3c);
-  dq2 = mcd_slope(Ujm1.B3c, Ui.B3c, Ujp1.B3c);
-  dq3 = mcd_slope(Ukm1.B3c, Ui.B3c, Ukp1.B3c);
-  for (k=0; k<2; k++){
-  for (j=0; j<2; j++){
-  for (i=0; i<2; i++){
-    PCon[k][j][i].B3c = Ui.B3c 
-      + (0.5*i - 0.25)*dq1 + (0.5*j - 0.25)*dq2 + (0.5*k - 0.25)*dq3;;
-  }}}
-#endif /* MHD */
+        for (ns=0; ns<NSCALARS; ns++) {
+           *(pSnd++) = pG->U[k][j][i].s[ns];
+        }
+#endif
+      }}}
+    }
+  }
+}
 
-#ifndef BAROTROPIC
+/*----------------------------------------------------------------------------*/
+/*! \fn static void pro_cons(GridS *pG, Real ****pq, const int ips,
+ *                           const int ipe, const int jps, const int jpe,
+ *                           const int kps, const int kpe)
+ *  \brief Prolongates conserved variables from the parent zones in pq (one
+ *   array per variable, GZ[id]) into the child ghost zones ips:ipe, jps:jpe,
+ *   kps:kpe of pG, a row of parent zones at a time.
+ *
+ *   Slopes of each variable are found for the whole row by mcd_slopes(), and
+ *   the 2x2x2 child cells of every parent zone in the row are then set.  With
+ *   second order, pq holds P in place of E, and the kinetic and magnetic
+ *   energy of the child cells is added back.  This gives the same result as
+ *   reconstructing one parent zone at a time. */
+
+static void pro_cons(GridS *pG, Real ****pq, const int ips, const int ipe,
+                     const int jps, const int jpe, const int kps,
+                     const int kpe)
+{
+  const int nst = sizeof(ConsS)/sizeof(Real);   /* stride of ConsS in Reals */
+  Real *dq1=GZslope[0], *dq2=GZslope[1], *dq3=GZslope[2];
+  Real *pc,*pU,cf1,cf2,cf3;
+  int i,j,k,ii,jj,kk,l,m,n,nv,ni,mend,nend;
+  double tstart = wtime();
+#if !defined(BAROTROPIC) && !defined(SPECIAL_RELATIVITY) && !defined(FIRST_ORDER)
+  ConsS *pC;
+#endif
 #ifdef SPECIAL_RELATIVITY
+  PrimS W;
+  int fail;
+#endif
 
-/* Prolongate E not P. Otherwise we'd need lots & lots of calls to
- * Con_to_Prim, or a complete rewrite of the code here, so we'll just
- * do this for now */
-
-  dq1 = mcd_slope(Uim1.E, Ui.E, Uip1.E);
-  dq2 = mcd_slope(Ujm1.E, Ui.E, Ujp1.E);
-  dq3 = mcd_slope(Ukm1.E, Ui.E, Ukp1.E);
-  for (k=0; k<2; k++){
-  for (j=0; j<2; j++){
-  for (i=0; i<2; i++){
-    PCon[k][j][i].E = Ui.E 
-      + (0.5*i - 0.25)*dq1 + (0.5*j - 0.25)*dq2 + (0.5*k - 0.25)*dq3;;
-  }}}
+  ni = (ipe - ips)/2 + 1;
+  mend = (pG->Nx[1] > 1) ? 1 : 0;
+  nend = (pG->Nx[2] > 1) ? 1 : 0;
 
-#else
+  for (k=kps, kk=1; k<=kpe; k+=2, kk++) {
+  for (j=jps, jj=1; j<=jpe; j+=2, jj++) {
 
-/* Prolongate P not E.   This is intentionally non-conservative. */
+    for (nv=0; nv<NVAR; nv++) {
+      pc = &(pq[nv][kk][jj][1]);
 
-  Pi   = Ui.E   - 0.5*(SQR(Ui.M1  ) + SQR(Ui.M2  ) + SQR(Ui.M3  ))/Ui.d;
-  Pim1 = Uim1.E - 0.5*(SQR(Uim1.M1) + SQR(Uim1.M2) + SQR(Uim1.M3))/Uim1.d;
-  Pip1 = Uip1.E - 0.5*(SQR(Uip1.M1) + SQR(Uip1.M2) + SQR(Uip1.M3))/Uip1.d;
-#ifdef MHD
-  Pi   -= 0.5*(SQR(Ui.B1c  ) + SQR(Ui.B2c  ) + SQR(Ui.B3c  ));
-  Pim1 -= 0.5*(SQR(Uim1.B1c) + SQR(Uim1.B2c) + SQR(Uim1.B3c));
-  Pip1 -= 0.5*(SQR(Uip1.B1c) + SQR(Uip1.B2c) + SQR(Uip1.B3c));
-#endif /* MHD */
-  dq1 = mcd_slope(Pim1, Pi, Pip1);
+/* First order prolongation -- just copy values */
+#ifdef FIRST_ORDER
+      for (ii=0; ii<ni; ii++) {
+        dq1[ii] = 0.0;
+        dq2[ii] = 0.0;
+        dq3[ii] = 0.0;
+      }
+#else
+      mcd_slopes(ni, &(pq[nv][kk][jj][0]), pc, &(pq[nv][kk][jj][2]), dq1);
+      mcd_slopes(ni, &(pq[nv][kk][jj-1][1]), pc, &(pq[nv][kk][jj+1][1]), dq2);
+      mcd_slopes(ni, &(pq[nv][kk-1][jj][1]), pc, &(pq[nv][kk+1][jj][1]), dq3);
+#endif
+
+      for (n=0; n<=nend; n++) {
+      for (m=0; m<=mend; m++) {
+      for (l=0; l<=1; l++) {
+        cf1 = 0.5*l - 0.25;
+        cf2 = 0.5*m - 0.25;
+        cf3 = 0.5*n - 0.25;
+        pU = (Real*)&(pG->U[k+n][j+m][ips+l]) + nv;
+        for (ii=0; ii<ni; ii++) {
+          pU[2*ii*nst] = pc[ii] + cf1*dq1[ii] + cf2*dq2[ii] + cf3*dq3[ii];
+        }
+      }}}
+    }
 
-  Pjm1 = Ujm1.E - 0.5*(SQR(Ujm1.M1) + SQR(Ujm1.M2) + SQR(Ujm1.M3))/Ujm1.d;
-  Pjp1 = Ujp1.E - 0.5*(SQR(Ujp1.M1) + SQR(Ujp1.M2) + SQR(Ujp1.M3))/Ujp1.d;
-#ifdef MHD
-  Pjm1 -= 0.5*(SQR(Ujm1.B1c) + SQR(Ujm1.B2c) + SQR(Ujm1.B3c));
-  Pjp1 -= 0.5*(SQR(Ujp1.B1c) + SQR(Ujp1.B2c) + SQR(Ujp1.B3c));
-#endif /* MHD */
-  dq2 = mcd_slope(Pjm1, Pi, Pjp1);
+#if !defined(BAROTROPIC) && !defined(SPECIAL_RELATIVITY) && !defined(FIRST_ORDER)
+/* Add kinetic and magnetic energy of child cells to prolongated P */
 
-  Pkm1 = Ukm1.E - 0.5*(SQR(Ukm1.M1) + SQR(Ukm1.M2) + SQR(Ukm1.M3))/Ukm1.d;
-  Pkp1 = Ukp1.E - 0.5*(SQR(Ukp1.M1) + SQR(Ukp1.M2) + SQR(Ukp1.M3))/Ukp1.d;
-#ifdef MHD
-  Pkm1 -= 0.5*(SQR(Ukm1.B1c) + SQR(Ukm1.B2c) + SQR(Ukm1.B3c));
-  Pkp1 -= 0.5*(SQR(Ukp1.B1c) + SQR(Ukp1.B2c) + SQR(Ukp1.B3c));
-#endif /* MHD */
-  dq3 = mcd_slope(Pkm1, Pi, Pkp1);
-
-  for (k=0; k<2; k++){
-  for (j=0; j<2; j++){
-  for (i=0; i<2; i++){
-    PCon[k][j][i].E = Pi
-      + (0.5*i - 0.25)*dq1 + (0.5*j - 0.25)*dq2 + (0.5*k - 0.25)*dq3;
-    PCon[k][j][i].E += 0.5*(SQR(PCon[k][j][i].M1) + SQR(PCon[k][j][i].M2) +
-      SQR(PCon[k][j][i].M3))/PCon[k][j][i].d;
+    for (n=0; n<=nend; n++) {
+    for (m=0; m<=mend; m++) {
+      for (i=ips; i<(ips+2*ni); i++) {
+        pC = &(pG->U[k+n][j+m][i]);
+        pC->E += 0.5*(SQR(pC->M1) + SQR(pC->M2) + SQR(pC->M3))/pC->d;
 #ifdef MHD
-    PCon[k][j][i].E += 0.5*(SQR(PCon[k][j][i].B1c) + SQR(PCon[k][j][i].B2c) +
-      SQR(PCon[k][j][i].B3c));
+        pC->E += 0.5*(SQR(pC->B1c) + SQR(pC->B2c) + SQR(pC->B3c));
 #endif /* MHD */
-  }}}
-
-#endif /* SPECIAL_RELATIVITY */
-#endif /* BAROTROPIC */
-
-#if (NSCALARS > 0)
-/* passive scalars */
-  for (n=0; n<NSCALARS; n++) {
-    dq1 = mcd_slope(Uim1.s[n], Ui.s[n], Uip1.s[n]);
-    dq2 = mcd_slope(Ujm1.s[n], Ui.s[n], Ujp1.s[n]);
-    dq3 = mcd_slope(Ukm1.s[n], Ui.s[n], Ukp1.s[n]);
-    for (k=0; k<2; k++){
-    for (j=0; j<2; j++){
-    for (i=0; i<2; i++){
-      PCon[k][j][i].s[n] = Ui.s[n] 
-        + (0.5*i - 0.25)*dq1 + (0.5*j - 0.25)*dq2 + (0.5*k - 0.25)*dq3;;
-    }}}
-  }
-#endif /* NSCALARS */
+      }
+    }}
+#endif
 
 #ifdef SPECIAL_RELATIVITY
 /* With SR, we need to ensure that the new state is physical, otherwise
- * everything will fall apart at the next time step */
-  dfail = 0;
-  Pfail = 0;
-  Vfail = 0;
-  fail = 0;
-  for (k=0; k<2; k++){
-  for (j=0; j<2; j++){
-  for (i=0; i<2; i++){
-    W = check_Prim(&(PCon[k][j][i]));
-    Vsq = SQR(W.V1) + SQR(W.V2) + SQR(W.V3);
-    if (W.d < 0.0){
-      dfail++;
-      fail = 1;
+ * everything will fall apart at the next time step.  If the state is
+ * unphysical, revert to first order prolongation */
+
+    for (i=ips, ii=1; i<=ipe; i+=2, ii++) {
+      fail = 0;
+      for (n=0; n<=nend; n++) {
+      for (m=0; m<=mend; m++) {
+      for (l=0; l<=1; l++) {
+        W = check_Prim(&(pG->U[k+n][j+m][i+l]));
+        if (W.d < 0.0 || W.P < 0.0 || (SQR(W.V1) + SQR(W.V2) + SQR(W.V3)) > 1.0)
+          fail = 1;
+      }}}
+      if (fail) {
+        for (n=0; n<=nend; n++) {
+        for (m=0; m<=mend; m++) {
+        for (l=0; l<=1; l++) {
+          pU = (Real*)&(pG->U[k+n][j+m][i+l]);
+          for (nv=0; nv<NVAR; nv++) pU[nv] = pq[nv][kk][jj][ii];
+        }}}
+      }
     }
-    if (W.P < 0.0){
-      Pfail++;
-      fail = 1;
+#endif /* SPECIAL_RELATIVITY */
+  }}
+
+  pro_cells += (double)(2*ni)*(double)((jpe-jps+1)*(kpe-kps+1));
+  pro_time += wtime() - tstart;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static int res_cons(GridS *pG, const int ips, const int ipe,
+ *                          const int jps, const int jpe, const int kps,
+ *                          const int kpe, const int *var, const int nvar,
+ *                          double *pSnd)
+ *  \brief Restricts the nvar conserved variables at offsets var[] in ConsS
+ *   over ips:ipe, jps:jpe, kps:kpe of pG into pSnd, as the average of the
+ *   2/4/8 cells in each parent zone in 1D/2D/3D.  Each parent zone is summed
+ *   in a single pass, in the same order as the separate sums in x1, x2 and x3
+ *   used before.  Returns the number of values written. */
+
+static int res_cons(GridS *pG, const int ips, const int ipe, const int jps,
+                    const int jpe, const int kps, const int kpe,
+                    const int *var, const int nvar, double *pSnd)
+{
+  const int nst = sizeof(ConsS)/sizeof(Real);   /* stride of ConsS in Reals */
+  Real *u00,*u01=NULL,*u10=NULL,*u11=NULL;
+  double q,fact=0.5;
+  int i,j,k,n,v,cnt=0;
+  double tstart = wtime();
+
+  if (pG->Nx[1] > 1) fact = 0.25;
+  if (pG->Nx[2] > 1) fact = 0.125;
+
+  for (k=kps; k<=kpe; k+=2) {
+  for (j=jps; j<=jpe; j+=2) {
+    u00 = (Real*)&(pG->U[k][j][ips]);
+    if (pG->Nx[1] > 1) u01 = (Real*)&(pG->U[k][j+1][ips]);
+    if (pG->Nx[2] > 1) {
+      u10 = (Real*)&(pG->U[k+1][j  ][ips]);
+      u11 = (Real*)&(pG->U[k+1][j+1][ips]);
     }
-    if (Vsq > 1.0){
-      Vfail++;
-      fail = 1;
+
+    for (i=0; i<=(ipe-ips); i+=2) {
+      for (n=0; n<nvar; n++) {
+        v = i*nst + var[n];
+        q = u00[v] + u00[v+nst];
+        if (u01 != NULL) q += u01[v] + u01[v+nst];
+        if (u10 != NULL) q += u10[v] + u10[v+nst] + u11[v] + u11[v+nst];
+        pSnd[cnt++] = q*fact;
+      }
     }
-  }}}
-
-/* If the state is unphysical, revert to first order prologongation */
-
-  if (fail) {
-    
-    for (k=0; k<2; k++){
-      for (j=0; j<2; j++){
-        for (i=0; i<2; i++){
-          PCon[k][j][i].d  = Ui.d;
-          PCon[k][j][i].M1 = Ui.M1;
-          PCon[k][j][i].M2 = Ui.M2;
-          PCon[k][j][i].M3 = Ui.M3;
-#ifndef BAROTROPIC
-          PCon[k][j][i].E  = Ui.E;
-#endif /* BAROTROPIC */
-#ifdef MHD
-          PCon[k][j][i].B1c = Ui.B1c;
-          PCon[k][j][i].B2c = Ui.B2c;
-          PCon[k][j][i].B3c = Ui.B3c;
-#endif /* MHD */
-#if (NSCALARS > 0)
-          for (n=0; n<NSCALARS; n++) PCon[k][j][i].s[n] = Ui.s[n];
-#endif /* NSCALARS */
-        }}}
-  }
+  }}
+
+  res_cells += (double)(cnt/nvar);
+  res_time += wtime() - tstart;
 
-  dfail = 0;
-  Pfail = 0;
-  Vfail = 0;
-  fail = 0;
+  return cnt;
+}
 
-#endif /*SPECIAL_RELATIVITY*/
+#ifndef FIRST_ORDER
+/*----------------------------------------------------------------------------*/
+/*! \fn static void mcd_slopes(const int n, const Real *vl, const Real *vc,
+ *                             const Real *vr, Real *dq)
+ *  \brief Computes the monotonized central-difference slope of mcd_slope()
+ *   for n zones at once, dq[i] from vl[i], vc[i], vr[i].  The loop has no
+ *   calls or early returns so that it can be vectorized. */
+
+static void mcd_slopes(const int n, const Real *vl, const Real *vc,
+                       const Real *vr, Real *dq)
+{
+  int i;
+  Real dvl,dvr,dv,dvm;
+
+  for (i=0; i<n; i++) {
+    dvl = vc[i] - vl[i];
+    dvr = vr[i] - vc[i];
+    dv  = 2.0*MIN(fabs(dvl),fabs(dvr));
+    dvm = 0.5*(fabs(dvl) + fabs(dvr));
+    dv  = MIN(dvm,dv);
+    dq[i] = (dvl > 0.0 && dvr > 0.0) ? dv :
+           ((dvl < 0.0 && dvr < 0.0) ? -dv : 0.0);
+  }
 
+  return;
+}
 #endif /* FIRST_ORDER */
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static double wtime(void)
+ *  \brief Returns the wall clock time in seconds */
+
+static double wtime(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv,NULL);
+  return (double)tv.tv_sec + 1.0e-6*(double)tv.tv_usec;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -3474,7 +3643,7 @@ void ProFld(Real3Vect BGZ[][3][3], Real3Vect PFld[][3][3],
  *  \brief Computes monotonized linear slope.
  */
 
-#ifndef FIRST_ORDER
+#if defined(MHD) && !defined(FIRST_ORDER)
 static Real mcd_slope(const Real vl, const Real vc, const Real vr){
 
   Real dvl = (vc - vl), dvr = (vr - vc);
@@ -3493,6 +3662,6 @@ static Real mcd_slope(const Real vl, const Real vc, const Real vr){
 
   return 0.0;
 }
-#endif /* FIRST_ORDER */
+#endif /* MHD && !FIRST_ORDER */
 
 #endif /* STATIC_MESH_REFINEMENT */
@@ -0,0 +1,834 @@
+#include "copyright.h"
+/*============================================================================*/
+/*! \file vtk_file.c
+ *  \brief Writes the files of dump_vtk(), output_vtk(), dump_vti() and
+ *   output_vti(), one per rank or one per Domain with MPI-IO.
+ *
+ * PURPOSE: Writes the files of dump_vtk() and output_vtk().  The writers
+ *   build the data of each field for the whole Grid in one big-endian buffer,
+ *   and pass it to vtk_write(), so that each field is one large write.
+ *
+ *   dump_vti() and output_vti() (out_fmt=vti) write the same files in the XML
+ *   ImageData format of VTK instead: each Grid writes a .vti file whose
+ *   fields follow its XML header as raw appended data, in the byte order of
+ *   the host, so the buffers are written as they are built with no swapping.
+ *   Rank 0 also writes a .pvti file for each Domain, listing the .vti file
+ *   of each of its Grids with the extent of the Grid in the Domain, and a
+ *   .vtm file listing the .pvti files of all levels and Domains of the dump,
+ *   so that VTK readers assemble the Mesh without a separate join step.
+ *
+ *   By default each rank writes its own file, as before.  With shared=1 in
+ *   the <output> block (MPI only) all Grids of a Domain write one file
+ *   together, run_dir/id0/[levN/]<problem_id>[-levN][-domN].NNNN[.id].vtk,
+ *   laid out as if the Domain were a single Grid.  Rank 0 of the Domain
+ *   writes the text, and the data of each field is written with one
+ *   collective MPI_File_write_all() through a subarray view at the offset of
+ *   the Grid, found from its Disp.  MPI-IO aggregates these into large
+ *   contiguous writes (collective buffering).
+ *
+ *   With async=1 in the <output> block, files written one per rank are
+ *   written by a background thread.  vtk_open() takes one of VTK_NSLOT
+ *   staging buffers, vtk_printf() and vtk_write() copy into it, and
+ *   vtk_close() queues it, so stepping continues while the file is written.
+ *   If no buffer is free vtk_open() waits for the writer (backpressure).
+ *   Shared files are always written in place, since the MPI-IO calls are
+ *   collective.
+ *
+ *   The bytes written and the wall time spent in open/write/close are counted,
+ *   and vtk_report() prints the throughput at the end of the run, to compare
+ *   shared=0 and shared=1, or async=0 and async=1.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ * - vtk_open()    - opens the file of a Grid, or the shared file of a Domain
+ * - vtk_dataset() - writes the dataset structure of the Grid or Domain
+ * - vtk_printf()  - writes text (rank 0 of the Domain only, if shared)
+ * - vtk_write()   - writes one field of the Grid
+ * - vtk_close()   - closes the file, or queues it for the writer
+ * - vtk_flush()   - waits for the writer to finish all queued files
+ * - vtk_report()  - prints the bytes and throughput of all VTK files
+ * - vti_header()  - writes the XML header of a .vti file
+ * - vti_write()   - writes one field of the Grid to a .vti file
+ * - vti_close()   - ends and closes a .vti file
+ * - vti_index()   - writes the .pvti file of a Domain (rank 0)
+ * - vti_blocks()  - writes the .vtm file of a dump (rank 0)               */
+/*============================================================================*/
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "defs.h"
+#include "athena.h"
+#include "globals.h"
+#include "prototypes.h"
+
+#define VTK_MAXTEXT 1024
+#define VTK_NSLOT 2
+
+/* Staging buffer of a file written by the background writer */
+enum {SLOT_FREE, SLOT_FILL, SLOT_QUEUED, SLOT_WRITE};
+typedef struct VtkSlot_s{
+  int state;           /* SLOT_* */
+  long seq;            /* order in which files were queued */
+  char *fname;
+  char *buf;           /* contents of the file */
+  size_t len, size;    /* bytes used and allocated in buf */
+}VtkSlotS;
+
+/* File being written: a FILE on this rank, or a shared MPI file */
+static FILE *vtk_fp = NULL;
+static int vtk_shared = 0;
+static DomainS *vtk_D = NULL;   /* Domain of the Grid written */
+static int vtk_nx[3];           /* # of cells of the Grid written */
+static long vtk_ncell = 0;
+#ifdef MPI_PARALLEL
+static MPI_File vtk_fh;
+static MPI_Comm vtk_comm;
+static int vtk_rank;
+static MPI_Offset vtk_off = 0;  /* end of the file written so far */
+static long vtk_gcell = 0;      /* # of cells in the Domain */
+static MPI_Datatype vtk_type[4];/* views of the Grid for 1 and 3 components */
+static char vtk_text[VTK_MAXTEXT]; /* text not yet written */
+static int vtk_ntext = 0;
+#endif
+
+/* Background writer; slots and writer_* are protected by slot_lock */
+static VtkSlotS slot[VTK_NSLOT];
+static VtkSlotS *vtk_slot = NULL;   /* slot being filled, if async */
+static pthread_t writer;
+static int writer_on = 0, writer_stop = 0;
+static long slot_seq = 0;
+static char writer_err[MAXLEN] = "";  /* first error of the writer, if any */
+static pthread_mutex_t slot_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t slot_cond = PTHREAD_COND_INITIALIZER;
+
+/* Totals for vtk_report() */
+static double vtk_t0, vtk_time = 0.0, vtk_bytes = 0.0, vtk_files = 0.0;
+static double vtk_wait = 0.0, writer_time = 0.0;
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   wtime()       - wall clock time in seconds
+ *   write_bytes() - writes bytes to the file of this rank, or its slot
+ *   vti_fname()   - name of the .pvti file of a Domain
+ *   slot_append() - appends bytes to the slot being filled
+ *   write_slots() - the background writer
+ *   flush_text()  - writes the pending text of a shared file
+ *============================================================================*/
+
+static double wtime(void);
+static void write_bytes(const void *src, const size_t len);
+static char *vti_fname(MeshS *pM, OutputS *pOut, const int nl, const int nd,
+                       const char *id);
+static void slot_append(const void *src, const size_t len);
+static void *write_slots(void *arg);
+#ifdef MPI_PARALLEL
+static void flush_text(void);
+#endif
+
+/*=========================== PUBLIC FUNCTIONS ===============================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn void vtk_open(MeshS *pM, OutputS *pOut, const int nl, const int nd,
+ *                    const char *id, const int nx[3])
+ *  \brief Opens the file of output pOut for the nx[0]*nx[1]*nx[2] cells of the
+ *   Grid in Domain [nl][nd], with extension pOut->out_fmt (vtk or vti).  If
+ *   pOut->shared, all ranks of the Domain open the file of the Domain
+ *   together, and nx must be the active zones. */
+
+void vtk_open(MeshS *pM, OutputS *pOut, const int nl, const int nd,
+              const char *id, const int nx[3])
+{
+  char *fname,*plev=NULL,*pdom=NULL;
+  char levstr[16],domstr[16];
+  int n,err;
+#ifdef MPI_PARALLEL
+  char *name,dirstr[32],*pdir=NULL;
+  GridS *pG;
+  MPI_Info info;
+  int ncomp,gsize[3],lsize[3],start[3],ierr;
+#endif
+
+  vtk_t0 = wtime();
+  vtk_D = &(pM->Domain[nl][nd]);
+  vtk_shared = 0;
+  for (n=0; n<3; n++) vtk_nx[n] = nx[n];
+  vtk_ncell = (long)nx[0]*(long)nx[1]*(long)nx[2];
+
+  if (nl>0) {
+    plev = &levstr[0];
+    sprintf(plev,"lev%d",nl);
+  }
+  if (nd>0) {
+    pdom = &domstr[0];
+    sprintf(pdom,"dom%d",nd);
+  }
+
+#ifdef MPI_PARALLEL
+  if (pOut->shared) {
+    vtk_shared = 1;
+    pG = vtk_D->Grid;
+    vtk_comm = vtk_D->Comm_Domain;
+    MPI_Comm_rank(vtk_comm, &vtk_rank);
+    vtk_gcell = (long)vtk_D->Nx[0]*(long)vtk_D->Nx[1]*(long)vtk_D->Nx[2];
+
+/* The shared file goes where rank 0 writes its own, under the name of rank 0:
+ * problem_id without the "-id<rank>" added in main() */
+
+    pdir = &dirstr[0];
+    if (nl>0) sprintf(pdir,"../id0/lev%d",nl);
+    else sprintf(pdir,"../id0");
+    name = pM->outfilename;
+    if (myID_Comm_world != 0) {
+      name = (char*)malloc(strlen(pM->outfilename)+1);
+      if (name == NULL)
+        ath_error("[vtk_open]: malloc returned a NULL pointer\n");
+      strcpy(name,pM->outfilename);
+      *strrchr(name,'-') = '\0';
+    }
+    fname = ath_fname(pdir,name,plev,pdom,num_digit,pOut->num,id,"vtk");
+    if (name != pM->outfilename) free(name);
+    if (fname == NULL)
+      ath_error("[vtk_open]: Error constructing filename\n");
+
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "romio_cb_write", "enable");
+    ierr = MPI_File_open(vtk_comm, fname, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+      info, &vtk_fh);
+    MPI_Info_free(&info);
+    if (ierr != MPI_SUCCESS)
+      ath_error("[vtk_open]: Unable to open vtk file %s\n",fname);
+    MPI_File_set_size(vtk_fh, 0);
+    free(fname);
+
+/* Views of this Grid in the Domain, C order (k,j,i), with ncomp floats per
+ * cell */
+
+    for (ncomp=1; ncomp<=3; ncomp+=2) {
+      for (n=0; n<3; n++) {
+        gsize[2-n] = vtk_D->Nx[n];
+        lsize[2-n] = nx[n];
+        start[2-n] = pG->Disp[n] - vtk_D->Disp[n];
+      }
+      gsize[2] *= ncomp;
+      lsize[2] *= ncomp;
+      start[2] *= ncomp;
+      MPI_Type_create_subarray(3, gsize, lsize, start, MPI_ORDER_C,
+        MPI_FLOAT, &vtk_type[ncomp]);
+      MPI_Type_commit(&vtk_type[ncomp]);
+    }
+    vtk_off = 0;
+    vtk_ntext = 0;
+    return;
+  }
+#endif /* MPI_PARALLEL */
+
+  if((fname = ath_fname(plev,pM->outfilename,plev,pdom,num_digit,
+      pOut->num,id,pOut->out_fmt)) == NULL)
+    ath_error("[vtk_open]: Error constructing filename\n");
+
+/* With async, take a free slot (waiting for the writer if there is none), and
+ * leave the file to the writer */
+
+  if (pOut->async) {
+    pthread_mutex_lock(&slot_lock);
+    if (!writer_on) {
+      writer_stop = 0;
+      if (pthread_create(&writer, NULL, write_slots, NULL) != 0)
+        ath_error("[vtk_open]: Unable to start the vtk writer thread\n");
+      writer_on = 1;
+    }
+    vtk_slot = NULL;
+    while (vtk_slot == NULL) {
+      for (n=0; n<VTK_NSLOT; n++) {
+        if (slot[n].state == SLOT_FREE) {
+          vtk_slot = &slot[n];
+          break;
+        }
+      }
+      if (vtk_slot == NULL) pthread_cond_wait(&slot_cond, &slot_lock);
+    }
+    vtk_slot->state = SLOT_FILL;
+    err = (writer_err[0] != '\0');
+    pthread_mutex_unlock(&slot_lock);
+    if (err) ath_error("[vtk_open]: %s\n",writer_err);
+    vtk_wait += wtime() - vtk_t0;
+    vtk_slot->fname = fname;
+    vtk_slot->len = 0;
+    return;
+  }
+
+  if ((vtk_fp = fopen(fname,"w")) == NULL)
+    ath_error("[vtk_open]: Unable to open vtk file %s\n",fname);
+  free(fname);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void vtk_dataset(void)
+ *  \brief Writes the DATASET structure and CELL_DATA line of the Grid, or of
+ *   the Domain for a shared file. */
+
+void vtk_dataset(void)
+{
+  GridS *pG = vtk_D->Grid;
+  double x1,x2,x3;
+  int n,nx[3];
+
+  x1 = pG->MinX[0];
+  x2 = pG->MinX[1];
+  x3 = pG->MinX[2];
+  for (n=0; n<3; n++) nx[n] = vtk_nx[n];
+  if (vtk_shared) {
+    x1 = vtk_D->MinX[0];
+    x2 = vtk_D->MinX[1];
+    x3 = vtk_D->MinX[2];
+    for (n=0; n<3; n++) nx[n] = vtk_D->Nx[n];
+  }
+
+  vtk_printf("DATASET STRUCTURED_POINTS\n");
+  vtk_printf("DIMENSIONS %d %d %d\n",nx[0]+1,(pG->Nx[1] > 1) ? nx[1]+1 : 1,
+    (pG->Nx[2] > 1) ? nx[2]+1 : 1);
+  vtk_printf("ORIGIN %e %e %e \n",x1,x2,x3);
+  vtk_printf("SPACING %e %e %e \n",pG->dx1,pG->dx2,pG->dx3);
+  vtk_printf("CELL_DATA %d \n",nx[0]*nx[1]*nx[2]);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void vtk_printf(const char *fmt, ...)
+ *  \brief Writes text to the file.  With a shared file all ranks must call
+ *   it with the same text. */
+
+void vtk_printf(const char *fmt, ...)
+{
+  char text[VTK_MAXTEXT];
+  int n;
+  va_list ap;
+
+  va_start(ap, fmt);
+  if (vtk_slot != NULL) {
+    if ((n = vsnprintf(text, VTK_MAXTEXT, fmt, ap)) >= VTK_MAXTEXT)
+      ath_error("[vtk_printf]: text longer than %d\n",VTK_MAXTEXT);
+    slot_append(text, (size_t)n);
+    va_end(ap);
+    return;
+  }
+#ifdef MPI_PARALLEL
+  if (vtk_shared) {
+    vtk_ntext += vsnprintf(&vtk_text[vtk_ntext], VTK_MAXTEXT - vtk_ntext,
+      fmt, ap);
+    if (vtk_ntext >= VTK_MAXTEXT)
+      ath_error("[vtk_printf]: text longer than %d\n",VTK_MAXTEXT);
+    va_end(ap);
+    return;
+  }
+#endif
+  vfprintf(vtk_fp, fmt, ap);
+  va_end(ap);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void vtk_write(float *data, const int ncomp)
+ *  \brief Writes one field of the Grid, ncomp (1 or 3) floats per cell in
+ *   k,j,i order, already swapped to big-endian. */
+
+void vtk_write(float *data, const int ncomp)
+{
+#ifdef MPI_PARALLEL
+  MPI_Status stat;
+
+  if (vtk_shared) {
+    flush_text();
+    MPI_File_set_view(vtk_fh, vtk_off, MPI_FLOAT, vtk_type[ncomp], "native",
+      MPI_INFO_NULL);
+    if (MPI_File_write_all(vtk_fh, data, (int)(ncomp*vtk_ncell), MPI_FLOAT,
+        &stat) != MPI_SUCCESS)
+      ath_error("[vtk_write]: MPI_File_write_all error\n");
+    vtk_off += (MPI_Offset)(ncomp*vtk_gcell*sizeof(float));
+    return;
+  }
+#endif
+  write_bytes(data, ncomp*vtk_ncell*sizeof(float));
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void vtk_close(void)
+ *  \brief Closes the file, or queues it for the writer, and adds it to the
+ *   totals of vtk_report(). */
+
+void vtk_close(void)
+{
+  if (vtk_slot != NULL) {
+    vtk_bytes += (double)vtk_slot->len;
+    vtk_files += 1.0;
+    pthread_mutex_lock(&slot_lock);
+    vtk_slot->state = SLOT_QUEUED;
+    vtk_slot->seq = slot_seq++;
+    pthread_cond_broadcast(&slot_cond);
+    pthread_mutex_unlock(&slot_lock);
+    vtk_slot = NULL;
+    vtk_time += wtime() - vtk_t0;
+    return;
+  }
+#ifdef MPI_PARALLEL
+  if (vtk_shared) {
+    flush_text();
+    MPI_File_close(&vtk_fh);
+    MPI_Type_free(&vtk_type[1]);
+    MPI_Type_free(&vtk_type[3]);
+    if (vtk_rank == 0) {
+      vtk_bytes += (double)vtk_off;
+      vtk_files += 1.0;
+    }
+    vtk_time += wtime() - vtk_t0;
+    return;
+  }
+#endif
+  vtk_bytes += (double)ftell(vtk_fp);
+  vtk_files += 1.0;
+  fclose(vtk_fp);
+  vtk_fp = NULL;
+  vtk_time += wtime() - vtk_t0;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void vtk_flush(void)
+ *  \brief Waits until the writer has written every queued file, and stops
+ *   it.  It is started again by the next vtk_open() with async. */
+
+void vtk_flush(void)
+{
+  double t0;
+
+  if (!writer_on) return;
+
+  t0 = wtime();
+  pthread_mutex_lock(&slot_lock);
+  writer_stop = 1;
+  pthread_cond_broadcast(&slot_cond);
+  pthread_mutex_unlock(&slot_lock);
+  pthread_join(writer, NULL);
+  writer_on = 0;
+  vtk_wait += wtime() - t0;
+  vtk_time += wtime() - t0;
+  if (writer_err[0] != '\0') ath_error("[vtk_flush]: %s\n",writer_err);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void vtk_report(void)
+ *  \brief Waits for the writer, and prints the number of VTK files, bytes,
+ *   and bytes per wall-second the run spent writing them (the slowest rank).
+ *   With async, also prints the time spent waiting for free buffers and by
+ *   the writer.  Must be called by all ranks. */
+
+void vtk_report(void)
+{
+  double sum[2],tmax[3],my[3];
+
+  vtk_flush();
+  my[0] = vtk_time;
+  my[1] = vtk_wait;
+  my[2] = writer_time;
+#ifdef MPI_PARALLEL
+  sum[0] = vtk_files;
+  sum[1] = vtk_bytes;
+  MPI_Reduce(sum, tmax, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+  sum[0] = tmax[0];
+  sum[1] = tmax[1];
+  MPI_Reduce(my, tmax, 3, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+#else
+  sum[0] = vtk_files;
+  sum[1] = vtk_bytes;
+  tmax[0] = my[0];
+  tmax[1] = my[1];
+  tmax[2] = my[2];
+#endif
+
+  if (sum[0] > 0.0)
+    ath_pout(0,"\nvtk output: %.0f files, %e bytes in %e sec, %e bytes/sec\n",
+      sum[0],sum[1],tmax[0],(tmax[0] > 0.0) ? sum[1]/tmax[0] : 0.0);
+  if (tmax[2] > 0.0)
+    ath_pout(0,"vtk writer: %e sec writing, %e sec waited for\n",
+      tmax[2],tmax[1]);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void vti_header(const Real time, const int narr, char *name[],
+ *                      const int ncomp[])
+ *  \brief Writes the XML header of the .vti file of the Grid opened by
+ *   vtk_open(), for narr fields name[] of ncomp[] (1 or 3) floats per cell,
+ *   up to the start of the appended data.  The Grid is placed in the index
+ *   space of its level (origin RootMinX), as in the .pvti file of its Domain.
+ */
+
+void vti_header(const Real time, const int narr, char *name[],
+                const int ncomp[])
+{
+  GridS *pG = vtk_D->Grid;
+  long off=0;
+  int n,ext[6];
+
+  for (n=0; n<3; n++) {
+    ext[2*n] = pG->Disp[n];
+    ext[2*n+1] = pG->Disp[n] + ((pG->Nx[n] > 1) ? vtk_nx[n] : 0);
+  }
+
+  vtk_printf("<?xml version=\"1.0\"?>\n");
+  vtk_printf("<VTKFile type=\"ImageData\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\">\n",
+    ath_big_endian() ? "BigEndian" : "LittleEndian");
+  vtk_printf("  <ImageData WholeExtent=\"%d %d %d %d %d %d\" Origin=\"%e %e %e\" Spacing=\"%e %e %e\">\n",
+    ext[0],ext[1],ext[2],ext[3],ext[4],ext[5],
+    vtk_D->RootMinX[0],vtk_D->RootMinX[1],vtk_D->RootMinX[2],
+    vtk_D->dx[0],vtk_D->dx[1],vtk_D->dx[2]);
+  vtk_printf("    <FieldData>\n");
+  vtk_printf("      <DataArray type=\"Float64\" Name=\"TIME\" NumberOfTuples=\"1\" format=\"ascii\">%.15e</DataArray>\n",
+    (double)time);
+  vtk_printf("    </FieldData>\n");
+  vtk_printf("    <Piece Extent=\"%d %d %d %d %d %d\">\n",
+    ext[0],ext[1],ext[2],ext[3],ext[4],ext[5]);
+  vtk_printf("      <CellData>\n");
+  for (n=0; n<narr; n++) {
+    vtk_printf("        <DataArray type=\"Float32\" Name=\"%s\" NumberOfComponents=\"%d\" format=\"appended\" offset=\"%ld\"/>\n",
+      name[n],ncomp[n],off);
+    off += sizeof(uint64_t) + ncomp[n]*vtk_ncell*sizeof(float);
+  }
+  vtk_printf("      </CellData>\n");
+  vtk_printf("    </Piece>\n");
+  vtk_printf("  </ImageData>\n");
+  vtk_printf("  <AppendedData encoding=\"raw\">\n_");
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void vti_write(float *data, const int ncomp)
+ *  \brief Writes one field of the Grid to a .vti file: its size in bytes,
+ *   then ncomp floats per cell in k,j,i order, in the byte order of the host.
+ */
+
+void vti_write(float *data, const int ncomp)
+{
+  uint64_t nbyte = (uint64_t)(ncomp*vtk_ncell*sizeof(float));
+
+  write_bytes(&nbyte, sizeof(uint64_t));
+  write_bytes(data, (size_t)nbyte);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void vti_close(void)
+ *  \brief Ends the appended data and XML of a .vti file, and closes it. */
+
+void vti_close(void)
+{
+  vtk_printf("\n  </AppendedData>\n</VTKFile>\n");
+  vtk_close();
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void vti_index(MeshS *pM, OutputS *pOut, const int nl, const int nd,
+ *                     const char *id, const int narr, char *name[],
+ *                     const int ncomp[])
+ *  \brief Writes on rank 0 the .pvti file of Domain [nl][nd] for a dump of
+ *   the fields written by vti_header(): one piece for the .vti file of each
+ *   Grid, found from the rank updating it.  The .pvti file goes where rank 0
+ *   writes its own .vti files, and refers to the others relative to it. */
+
+void vti_index(MeshS *pM, OutputS *pOut, const int nl, const int nd,
+               const char *id, const int narr, char *name[],
+               const int ncomp[])
+{
+  DomainS *pD = &(pM->Domain[nl][nd]);
+  GridsDataS *pGD;
+  FILE *fp;
+  char *fname,*pname,base[MAXLEN],levstr[16],domstr[16];
+  char *plev=NULL,*pdom=NULL;
+  int l,m,n,dim,ext[6];
+
+  if (myID_Comm_world != 0) return;
+
+  if (nl>0) {
+    plev = &levstr[0];
+    sprintf(plev,"lev%d",nl);
+  }
+  if (nd>0) {
+    pdom = &domstr[0];
+    sprintf(pdom,"dom%d",nd);
+  }
+
+  fname = vti_fname(pM,pOut,nl,nd,id);
+  if ((fp = fopen(fname,"w")) == NULL)
+    ath_error("[vti_index]: Unable to open pvti file %s\n",fname);
+  free(fname);
+
+  for (dim=0; dim<3; dim++) {
+    ext[2*dim] = pD->Disp[dim];
+    ext[2*dim+1] = pD->Disp[dim] + ((pD->Nx[dim] > 1) ? pD->Nx[dim] : 0);
+  }
+  fprintf(fp,"<?xml version=\"1.0\"?>\n");
+  fprintf(fp,"<VTKFile type=\"PImageData\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\">\n",
+    ath_big_endian() ? "BigEndian" : "LittleEndian");
+  fprintf(fp,"  <PImageData WholeExtent=\"%d %d %d %d %d %d\" GhostLevel=\"0\" Origin=\"%e %e %e\" Spacing=\"%e %e %e\">\n",
+    ext[0],ext[1],ext[2],ext[3],ext[4],ext[5],
+    pD->RootMinX[0],pD->RootMinX[1],pD->RootMinX[2],
+    pD->dx[0],pD->dx[1],pD->dx[2]);
+  fprintf(fp,"    <PCellData>\n");
+  for (n=0; n<narr; n++)
+    fprintf(fp,"      <PDataArray type=\"Float32\" Name=\"%s\" NumberOfComponents=\"%d\"/>\n",
+      name[n],ncomp[n]);
+  fprintf(fp,"    </PCellData>\n");
+
+  for(n=0; n<(pD->NGrid[2]); n++){
+  for(m=0; m<(pD->NGrid[1]); m++){
+  for(l=0; l<(pD->NGrid[0]); l++){
+    pGD = &(pD->GData[n][m][l]);
+    for (dim=0; dim<3; dim++) {
+      ext[2*dim] = pGD->Disp[dim];
+      ext[2*dim+1] = pGD->Disp[dim] + ((pD->Nx[dim] > 1) ? pGD->Nx[dim] : 0);
+    }
+
+/* File of the rank updating the Grid, as named in vtk_open() on that rank */
+
+    if (pGD->ID_Comm_world == 0) strcpy(base, pM->outfilename);
+    else sprintf(base,"%s-id%d",pM->outfilename,pGD->ID_Comm_world);
+    if ((pname = ath_fname(NULL,base,plev,pdom,num_digit,pOut->num,id,
+        "vti")) == NULL)
+      ath_error("[vti_index]: Error constructing filename\n");
+#ifdef MPI_PARALLEL
+    if (nl>0) {
+      fprintf(fp,"    <Piece Extent=\"%d %d %d %d %d %d\" Source=\"../../id%d/%s/%s\"/>\n",
+        ext[0],ext[1],ext[2],ext[3],ext[4],ext[5],pGD->ID_Comm_world,plev,
+        pname);
+    } else {
+      fprintf(fp,"    <Piece Extent=\"%d %d %d %d %d %d\" Source=\"../id%d/%s\"/>\n",
+        ext[0],ext[1],ext[2],ext[3],ext[4],ext[5],pGD->ID_Comm_world,pname);
+    }
+#else
+    fprintf(fp,"    <Piece Extent=\"%d %d %d %d %d %d\" Source=\"%s\"/>\n",
+      ext[0],ext[1],ext[2],ext[3],ext[4],ext[5],pname);
+#endif
+    free(pname);
+  }}}
+
+  fprintf(fp,"  </PImageData>\n");
+  fprintf(fp,"</VTKFile>\n");
+  fclose(fp);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn void vti_blocks(MeshS *pM, OutputS *pOut, const char *id)
+ *  \brief Writes on rank 0 the .vtm file of a dump, with one block for each
+ *   level holding the .pvti files of its Domains written by vti_index(). */
+
+void vti_blocks(MeshS *pM, OutputS *pOut, const char *id)
+{
+  FILE *fp;
+  char *fname,*pname;
+  int nl,nd,nb;
+
+  if (myID_Comm_world != 0) return;
+
+  if ((fname = ath_fname(NULL,pM->outfilename,NULL,NULL,num_digit,pOut->num,
+      id,"vtm")) == NULL)
+    ath_error("[vti_blocks]: Error constructing filename\n");
+  if ((fp = fopen(fname,"w")) == NULL)
+    ath_error("[vti_blocks]: Unable to open vtm file %s\n",fname);
+  free(fname);
+
+  fprintf(fp,"<?xml version=\"1.0\"?>\n");
+  fprintf(fp,"<VTKFile type=\"vtkMultiBlockDataSet\" version=\"1.0\">\n");
+  fprintf(fp,"  <vtkMultiBlockDataSet>\n");
+  nb = 0;
+  for (nl=0; nl<(pM->NLevels); nl++){
+    if (pOut->nlevel != -1 && pOut->nlevel != nl) continue;
+    fprintf(fp,"    <Block index=\"%d\" name=\"level%d\">\n",nb++,nl);
+    for (nd=0; nd<(pM->DomainsPerLevel[nl]); nd++){
+      if (pOut->ndomain != -1 && pOut->ndomain != nd) continue;
+      pname = vti_fname(pM,pOut,nl,nd,id);
+      fprintf(fp,"      <DataSet index=\"%d\" name=\"domain%d\" file=\"%s\"/>\n",
+        nd,nd,pname);
+      free(pname);
+    }
+    fprintf(fp,"    </Block>\n");
+  }
+  fprintf(fp,"  </vtkMultiBlockDataSet>\n");
+  fprintf(fp,"</VTKFile>\n");
+  fclose(fp);
+
+  return;
+}
+
+/*=========================== PRIVATE FUNCTIONS ==============================*/
+/*----------------------------------------------------------------------------*/
+/*! \fn static double wtime(void)
+ *  \brief Wall clock time in seconds */
+
+static double wtime(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv,NULL);
+  return (double)tv.tv_sec + 1.0e-6*(double)tv.tv_usec;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void write_bytes(const void *src, const size_t len)
+ *  \brief Writes len bytes to the file of this rank, or to its slot */
+
+static void write_bytes(const void *src, const size_t len)
+{
+  if (vtk_slot != NULL) {
+    slot_append(src, len);
+    return;
+  }
+  fwrite(src,1,len,vtk_fp);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static char *vti_fname(MeshS *pM, OutputS *pOut, const int nl,
+ *                             const int nd, const char *id)
+ *  \brief Name of the .pvti file of Domain [nl][nd] on rank 0, relative to
+ *   its directory (that of the .vtm file) */
+
+static char *vti_fname(MeshS *pM, OutputS *pOut, const int nl, const int nd,
+                       const char *id)
+{
+  char *fname,levstr[16],domstr[16],*plev=NULL,*pdom=NULL;
+
+  if (nl>0) {
+    plev = &levstr[0];
+    sprintf(plev,"lev%d",nl);
+  }
+  if (nd>0) {
+    pdom = &domstr[0];
+    sprintf(pdom,"dom%d",nd);
+  }
+  if ((fname = ath_fname(plev,pM->outfilename,plev,pdom,num_digit,pOut->num,
+      id,"pvti")) == NULL)
+    ath_error("[vti_index]: Error constructing filename\n");
+
+  return fname;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void slot_append(const void *src, const size_t len)
+ *  \brief Appends len bytes to the slot being filled, growing its buffer */
+
+static void slot_append(const void *src, const size_t len)
+{
+  VtkSlotS *ps = vtk_slot;
+
+  if (ps->len + len > ps->size) {
+    ps->size = MAX(2*ps->size, ps->len + len);
+    if ((ps->buf = (char*)realloc(ps->buf, ps->size)) == NULL)
+      ath_error("[vtk_write]: realloc returned a NULL pointer\n");
+  }
+  memcpy(&(ps->buf[ps->len]), src, len);
+  ps->len += len;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! \fn static void *write_slots(void *arg)
+ *  \brief The background writer: writes queued slots in the order they were
+ *   queued, and frees them.  Returns once stopped with nothing queued.  It
+ *   makes no MPI calls: the first error is kept in writer_err, and raised by
+ *   the main thread in vtk_open() or vtk_flush(). */
+
+static void *write_slots(void *arg)
+{
+  VtkSlotS *ps;
+  FILE *fp;
+  double t0;
+  int n,err;
+
+  pthread_mutex_lock(&slot_lock);
+  for (;;) {
+    ps = NULL;
+    for (n=0; n<VTK_NSLOT; n++) {
+      if (slot[n].state == SLOT_QUEUED && (ps == NULL || slot[n].seq < ps->seq))
+        ps = &slot[n];
+    }
+    if (ps == NULL) {
+      if (writer_stop) break;
+      pthread_cond_wait(&slot_cond, &slot_lock);
+      continue;
+    }
+    ps->state = SLOT_WRITE;
+    pthread_mutex_unlock(&slot_lock);
+
+/* Errors are left for the main thread, as ath_error() calls MPI_Abort() */
+
+    t0 = wtime();
+    err = 0;
+    if ((fp = fopen(ps->fname,"w")) == NULL) {
+      err = 1;
+    } else {
+      if (fwrite(ps->buf,1,ps->len,fp) != ps->len) err = 2;
+      if (fclose(fp) != 0) err = 2;
+    }
+    writer_time += wtime() - t0;
+
+    pthread_mutex_lock(&slot_lock);
+    if (err && writer_err[0] == '\0')
+      snprintf(writer_err,MAXLEN,"Unable to %s vtk file %s",
+        (err == 1) ? "open" : "write",ps->fname);
+    free(ps->fname);
+    ps->fname = NULL;
+    ps->state = SLOT_FREE;
+    pthread_cond_broadcast(&slot_cond);
+  }
+  pthread_mutex_unlock(&slot_lock);
+
+  return NULL;
+}
+
+#ifdef MPI_PARALLEL
+/*----------------------------------------------------------------------------*/
+/*! \fn static void flush_text(void)
+ *  \brief Writes the text given to vtk_printf() since the last field, from
+ *   rank 0 of the Domain, at the end of the shared file. */
+
+static void flush_text(void)
+{
+  MPI_Status stat;
+
+  if (vtk_ntext == 0) return;
+
+  MPI_File_set_view(vtk_fh, 0, MPI_BYTE, MPI_BYTE, "native", MPI_INFO_NULL);
+  if (vtk_rank == 0) {
+    if (MPI_File_write_at(vtk_fh, vtk_off, vtk_text, vtk_ntext, MPI_CHAR,
+        &stat) != MPI_SUCCESS)
+      ath_error("[vtk_write]: MPI_File_write_at error\n");
+  }
+  vtk_off += (MPI_Offset)vtk_ntext;
+  vtk_ntext = 0;
+
+  return;
+}
+#endif /* MPI_PARALLEL */
+
+#undef VTK_MAXTEXT
+#undef VTK_NSLOT
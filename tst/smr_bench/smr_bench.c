@@ -0,0 +1,108 @@
+#include "copyright.h"
+/*============================================================================*/
+/*! \file smr_bench.c
+ *  \brief Microbenchmark of the SMR prolongation and restriction kernels.
+ *
+ * PURPOSE: Times pro_cons() and res_cons() of smr.c on a single 3D Grid of
+ *   N^3 active zones, and prints the rate of each in cells per wall-second:
+ *   child cells set for prolongation, parent cells produced for restriction,
+ *   as SMR_report() does at the end of a run.  smr.c is included here so that
+ *   its private kernels are called as they are built into athena, with the
+ *   configured NVAR, order and physics.  The rest of the code (wtime(),
+ *   arrays, errors) is linked from the objects in src/.
+ *
+ *   Prolongation fills all N^3 zones from the N/2 parent zones along each
+ *   axis; restriction averages them back.  The data are smooth, so the
+ *   limited slopes are mostly nonzero.
+ *
+ * COMPILE USING: configure with --enable-smr, 'make all', then
+ *   (cd src; make smr_bench), which writes bin/smr_bench.
+ *
+ * USAGE: bin/smr_bench [N [repeats]]    (defaults 64 and 20, N even)
+ *============================================================================*/
+
+#define MAIN_C
+#include "smr.c"
+
+#include <math.h>
+
+#ifndef STATIC_MESH_REFINEMENT
+#error : smr_bench needs configure --enable-smr
+#endif
+
+int main(int argc, char *argv[])
+{
+  GridS G;
+  Real ****pq;
+  double *buf,sum=0.0;
+  int var[NVAR];
+  int nx=64,nrep=20,np,i,j,k,n,r;
+
+#ifdef MPI_PARALLEL
+/* only so that ath_error() can call MPI_Abort() */
+  if (MPI_SUCCESS != MPI_Init(&argc, &argv)) {
+    fprintf(stderr,"[smr_bench]: Error on calling MPI_Init\n");
+    exit(1);
+  }
+#endif
+
+  if (argc > 1) nx = atoi(argv[1]);
+  if (argc > 2) nrep = atoi(argv[2]);
+  if (nx < 2 || nx % 2 != 0 || nrep < 1)
+    ath_error("usage: %s [N [repeats]], N even\n",argv[0]);
+  np = nx/2;
+
+/* A Grid with ghost zones, as init_grid() would set it up */
+
+  memset(&G,0,sizeof(GridS));
+  for (i=0; i<3; i++) G.Nx[i] = nx;
+  G.is = G.js = G.ks = nghost;
+  G.ie = G.je = G.ke = nghost + nx - 1;
+  G.U = (ConsS***)calloc_3d_array(nx+2*nghost,nx+2*nghost,nx+2*nghost,
+    sizeof(ConsS));
+  if (G.U == NULL) ath_error("[smr_bench]: malloc failed for U\n");
+
+/* Parent zones with one zone on each side, one array per variable as GZ[] in
+ * prolongate_level() (P in place of E) */
+
+  if ((pq = (Real****)malloc(NVAR*sizeof(Real***))) == NULL)
+    ath_error("[smr_bench]: malloc failed for pq\n");
+  for (n=0; n<NVAR; n++) {
+    pq[n] = (Real***)calloc_3d_array(np+2,np+2,np+2,sizeof(Real));
+    if (pq[n] == NULL) ath_error("[smr_bench]: malloc failed for pq\n");
+    for (k=0; k<np+2; k++) {
+    for (j=0; j<np+2; j++) {
+    for (i=0; i<np+2; i++) {
+      pq[n][k][j][i] = 1.0 + 0.5*sin(0.3*i + 0.2*j + 0.1*k + n);
+    }}}
+  }
+
+  GZslope = (Real**)calloc_2d_array(3,MAX(np+2,nghost),sizeof(Real));
+  if (GZslope == NULL) ath_error("[smr_bench]: malloc failed for GZslope\n");
+  buf = (double*)malloc((size_t)np*np*np*NVAR*sizeof(double));
+  if (buf == NULL) ath_error("[smr_bench]: malloc failed for buffer\n");
+  for (n=0; n<NVAR; n++) var[n] = n;
+
+  for (r=0; r<nrep; r++) {
+    pro_cons(&G, pq, G.is, G.ie, G.js, G.je, G.ks, G.ke);
+    res_cons(&G, G.is, G.ie, G.js, G.je, G.ks, G.ke, var, NVAR, buf);
+    sum += buf[r % (np*np*np*NVAR)];
+  }
+
+  printf("smr_bench: %d^3 zones, NVAR=%d, %d repeats (check %e)\n",
+    nx,NVAR,nrep,sum);
+  printf("pro_cons: %e child cells, %e cells/wall-second\n",
+    pro_cells, (pro_time > 0.0) ? pro_cells/pro_time : 0.0);
+  printf("res_cons: %e parent cells, %e cells/wall-second\n",
+    res_cells, (res_time > 0.0) ? res_cells/res_time : 0.0);
+
+  for (n=0; n<NVAR; n++) free_3d_array(pq[n]);
+  free(pq);
+  free_2d_array(GZslope);
+  free_3d_array(G.U);
+  free(buf);
+#ifdef MPI_PARALLEL
+  MPI_Finalize();
+#endif
+  return 0;
+}
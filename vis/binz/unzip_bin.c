@@ -0,0 +1,155 @@
+/*==============================================================================
+ * FILE: unzip_bin.c
+ *
+ * PURPOSE: Converts compressed binary dumps (.binz, written by dump_binary()
+ *   with compress=zlib, abs or rel in the <output> block) back into plain .bin
+ *   files, which can be read by the MATLAB and IDL scripts in vis/.  Each
+ *   <name>.binz given is written as <name>.bin in the same directory.  See
+ *   src/ath_zip.c for the format of the compressed fields.
+ *
+ * COMPILE USING: gcc -Wall -W -o unzip_bin unzip_bin.c -lz
+ *
+ * USAGE: ./unzip_bin <file.binz> [<file.binz> ...]
+ *============================================================================*/
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+static void unzip_error(const char *fmt, ...);
+static void unzip_file(const char *in_name);
+
+/* ========================================================================== */
+
+int main(int argc, char* argv[])
+{
+  int i;
+
+  if (argc < 2 || strcmp(argv[1],"-h") == 0) {
+    fprintf(stderr,"\nUsage: %s <file.binz> [<file.binz> ...]\n\n",argv[0]);
+    exit(0);
+  }
+
+  for (i=1; i<argc; i++) unzip_file(argv[i]);
+
+  return 0;
+}
+
+/* ========================================================================== */
+
+/* Converts one .binz file into a .bin file */
+static void unzip_file(const char *in_name)
+{
+  FILE *fidin,*fidout;
+  char *out_name;
+  int coordsys,ndata[7],mode,nfield=0;
+  float dat[4],*x,*data;
+  double x0,dx;
+  int64_t nbyte;
+  uint32_t *w,z,q;
+  unsigned char *zbuf,*buf;
+  uLongf nout;
+  long n,i,len;
+  int b;
+
+  len = strlen(in_name);
+  if (len < 5 || strcmp(in_name+len-5,".binz") != 0)
+    unzip_error("%s is not a .binz file!\n",in_name);
+  out_name = (char*)malloc(len);
+  strncpy(out_name,in_name,len-1);
+  out_name[len-1] = '\0';
+
+  if ((fidin = fopen(in_name,"rb")) == NULL)
+    unzip_error("Fail to open input file %s!\n",in_name);
+  if ((fidout = fopen(out_name,"wb")) == NULL)
+    unzip_error("Fail to open output file %s!\n",out_name);
+
+  /* header and coordinates are copied as they are */
+  if (fread(&coordsys,sizeof(int),1,fidin) != 1 ||
+      fread(ndata,sizeof(int),7,fidin) != 7 ||
+      fread(dat,sizeof(float),4,fidin) != 4)
+    unzip_error("Fail to read header of %s!\n",in_name);
+  fwrite(&coordsys,sizeof(int),1,fidout);
+  fwrite(ndata,sizeof(int),7,fidout);
+  fwrite(dat,sizeof(float),4,fidout);
+
+  len = ndata[0] + ndata[1] + ndata[2];
+  x = (float*)malloc(len*sizeof(float));
+  if (fread(x,sizeof(float),len,fidin) != (size_t)len)
+    unzip_error("Fail to read coordinates of %s!\n",in_name);
+  fwrite(x,sizeof(float),len,fidout);
+  free(x);
+
+  /* fields, until the end of the file */
+  n = (long)ndata[0]*(long)ndata[1]*(long)ndata[2];
+  w = (uint32_t*)malloc(n*sizeof(uint32_t));
+  buf = (unsigned char*)malloc(n*sizeof(uint32_t));
+  data = (float*)malloc(n*sizeof(float));
+  if (w == NULL || buf == NULL || data == NULL)
+    unzip_error("Fail to allocate %ld values!\n",n);
+
+  while (fread(&mode,sizeof(int),1,fidin) == 1) {
+    if (mode == 1) {
+      if (fread(&x0,sizeof(double),1,fidin) != 1 ||
+          fread(&dx,sizeof(double),1,fidin) != 1)
+        unzip_error("Fail to read field %d of %s!\n",nfield,in_name);
+    } else if (mode != 0) {
+      unzip_error("Unknown mode %d of field %d of %s!\n",mode,nfield,in_name);
+    }
+    if (fread(&nbyte,sizeof(int64_t),1,fidin) != 1)
+      unzip_error("Fail to read field %d of %s!\n",nfield,in_name);
+    zbuf = (unsigned char*)malloc(nbyte);
+    if (zbuf == NULL || fread(zbuf,1,nbyte,fidin) != (size_t)nbyte)
+      unzip_error("Fail to read field %d of %s!\n",nfield,in_name);
+
+    nout = n*sizeof(uint32_t);
+    if (uncompress(buf,&nout,zbuf,(uLong)nbyte) != Z_OK ||
+        nout != n*sizeof(uint32_t))
+      unzip_error("Fail to inflate field %d of %s!\n",nfield,in_name);
+    free(zbuf);
+
+    /* byte planes back to words */
+    for (i=0; i<n; i++)
+      for (b=0; b<4; b++) ((unsigned char*)w)[4*i + b] = buf[b*n + i];
+
+    if (mode == 0) {
+      memcpy(data,w,n*sizeof(float));
+    } else {
+      q = 0;
+      for (i=0; i<n; i++) {
+        z = w[i];
+        if (i == 0) q = z;
+        else q += (z >> 1) ^ (uint32_t)(-(int32_t)(z & 1));
+        data[i] = (float)(x0 + dx*(double)q);
+      }
+    }
+    fwrite(data,sizeof(float),n,fidout);
+    nfield++;
+  }
+
+  fclose(fidin);
+  fclose(fidout);
+  fprintf(stderr,"%s: %d fields written to %s\n",in_name,nfield,out_name);
+
+  free(w);
+  free(buf);
+  free(data);
+  free(out_name);
+
+  return;
+}
+
+/* Write an error message and terminate with an error status. */
+static void unzip_error(const char *fmt, ...){
+  va_list ap;
+
+  va_start(ap, fmt);         /* ap starts after the fmt parameter */
+  vfprintf(stderr, fmt, ap); /* print the error message to stderr */
+  va_end(ap);                /* end stdargs (clean up the va_list ap) */
+
+  fflush(stderr);            /* flush it NOW */
+  exit(1);                   /* clean up and exit */
+}
@@ -26,6 +26,11 @@ status = 0;
 
 % PARSE FILENAME AND TEST TO SEE IF .bin
 [path,basename,step,ext] = ath_parse_filename(filename);
+if (strcmp(ext,'.binz'))
+    fprintf(2,'[ath_readbin]:  %s is compressed, convert it to .bin with vis/binz/unzip_bin\n', filename);
+    status = -1;
+    return;
+end;
 if (~strcmp(ext,'.bin'))
     fprintf(2,'[ath_readbin]:  %s is not a .bin file!\n', filename);
     status = -1;